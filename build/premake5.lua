@@ -14,6 +14,30 @@ newoption
     default = "opengl33"
 }
 
+newoption
+{
+    trigger = "trace",
+    description = "compile in the trace-event instrumentation (Chrome/Perfetto JSON export)"
+}
+
+newoption
+{
+    trigger = "physics",
+    value = "ENGINE",
+    description = "physics engine behind PhysicsBackend",
+    allowed = {
+        { "box2d", "Box2D 2.4.2"},
+        { "box2d3", "Box2D 3.1.1, solver on the job system"}
+    },
+    default = "box2d"
+}
+
+newoption
+{
+    trigger = "box2d-avx2",
+    description = "build Box2D 3 with its AVX2 solver path (x64 only)"
+}
+
 function download_progress(total, current)
     local ratio = current / total;
     ratio = math.min(math.max(ratio, 0), 1);
@@ -40,17 +64,18 @@ end
 
 function check_box2d()
     os.chdir("external")
-    if(os.isdir("box2d-2.4.2") == false) then
-        if(not os.isfile("box2d-2.4.2.zip")) then
-            print("Box2D not found, downloading from github")
-            local result_str, response_code = http.download("https://github.com/erincatto/box2d/archive/refs/tags/v2.4.2.zip", "box2d-2.4.2.zip", {
+    local name = "box2d-" .. box2d_version
+    if(os.isdir(name) == false) then
+        if(not os.isfile(name .. ".zip")) then
+            print("Box2D " .. box2d_version .. " not found, downloading from github")
+            local result_str, response_code = http.download("https://github.com/erincatto/box2d/archive/refs/tags/v" .. box2d_version .. ".zip", name .. ".zip", {
                 progress = download_progress,
                 headers = { "From: Premake", "Referer: Premake" }
             })
         end
         print("Unzipping to " ..  os.getcwd())
-        zip.extract("box2d-2.4.2.zip", os.getcwd())
-        os.remove("box2d-2.4.2.zip")
+        zip.extract(name .. ".zip", os.getcwd())
+        os.remove(name .. ".zip")
     end
     os.chdir("../")
 end
@@ -112,7 +137,9 @@ raylib_dir = "external/raylib-master"
 
 -- if you don't want to download box2d, then set this to false, and set the box2d dir to where you want box2d to be pulled from, must be full sources.
 downloadBox2D = true
-box2d_dir = "external/box2d-2.4.2"
+box2dV3 = (_OPTIONS["physics"] == "box2d3")
+box2d_version = box2dV3 and "3.1.1" or "2.4.2"
+box2d_dir = "external/box2d-" .. box2d_version
 
 workspaceName = 'MyGame'
 baseName = path.getbasename(path.getdirectory(os.getcwd()));
@@ -222,6 +249,12 @@ end
         flags { "ShadowedVariables"}
         platform_defines()
 
+        filter {"options:trace"}
+            defines {"PINBALL_TRACE"}
+        filter {"options:physics=box2d3"}
+            defines {"PHYSICS_BOX2D_V3"}
+        filter{}
+
         filter "action:vs*"
             defines{"_WINSOCK_DEPRECATED_NO_WARNINGS", "_CRT_SECURE_NO_WARNINGS"}
             dependson {"raylib"}
@@ -247,6 +280,81 @@ end
         filter{}
         
 
+    -- Reads the live metrics segment (--metrics-shm) from outside the game
+    project "metrics_reader"
+        kind "ConsoleApp"
+        location "build_files/"
+        targetdir "../bin/%{cfg.buildcfg}"
+
+        files { "../tools/metrics_reader/**.cpp", "../include/LiveMetrics.h" }
+        includedirs { "../include" }
+
+        cppdialect "C++17"
+
+        filter "action:vs*"
+            defines{"_CRT_SECURE_NO_WARNINGS"}
+
+        filter "system:linux"
+            links {"pthread", "rt"}
+
+        filter{}
+
+    -- Job system overhead and scaling, run it on the machine you care about
+    project "job_bench"
+        kind "ConsoleApp"
+        location "build_files/"
+        targetdir "../bin/%{cfg.buildcfg}"
+
+        files { "../tools/job_bench/**.cpp", "../src/JobSystem.cpp", "../src/Log.cpp", "../include/JobSystem.h" }
+        includedirs { "../include" }
+        includedirs { raylib_dir .. "/src" }
+
+        cppdialect "C++17"
+
+        filter "action:vs*"
+            defines{"_CRT_SECURE_NO_WARNINGS"}
+
+        filter "system:linux"
+            links {"pthread"}
+
+        filter{}
+
+    -- Step cost of the physics backend compiled in, headless, from 1 to 1024 balls
+    project "physics_bench"
+        kind "ConsoleApp"
+        location "build_files/"
+        targetdir "../bin/%{cfg.buildcfg}"
+
+        files { "../tools/physics_bench/**.cpp", "../src/PhysicsBackendBox2D*.cpp", "../src/JobSystem.cpp", "../src/Log.cpp", "../src/Timer.cpp" }
+        includedirs { "../include" }
+        includedirs { raylib_dir .. "/src" }
+        includedirs { box2d_dir .. "/include" }
+
+        links {"box2d", "raylib"}
+
+        cppdialect "C++17"
+        platform_defines()
+
+        filter {"options:physics=box2d3"}
+            defines {"PHYSICS_BOX2D_V3"}
+
+        filter "action:vs*"
+            defines{"_CRT_SECURE_NO_WARNINGS"}
+            dependson {"box2d", "raylib"}
+            links {"box2d.lib", "raylib.lib"}
+
+        filter "system:windows"
+            links {"winmm", "gdi32", "opengl32"}
+            libdirs {"../bin/%{cfg.buildcfg}"}
+
+        filter "system:linux"
+            links {"pthread", "m", "dl", "rt", "X11"}
+
+        filter "system:macosx"
+            links {"OpenGL.framework", "Cocoa.framework", "IOKit.framework", "CoreFoundation.framework", "CoreAudio.framework", "CoreVideo.framework", "AudioToolbox.framework"}
+
+        filter{}
+
     project "raylib"
         kind "StaticLib"
     
@@ -284,7 +392,6 @@ if (downloadBox2D) then
         
         location "build_files/"
         
-        language "C++"
         targetdir "../bin/%{cfg.buildcfg}"
         
         filter "action:vs*"
@@ -294,12 +401,33 @@ if (downloadBox2D) then
         filter{}
         
         includedirs {box2d_dir, box2d_dir .. "/include", box2d_dir .. "/src" }
-        vpaths
-        {
-            ["Header Files"] = { box2d_dir .. "/include/**.h", box2d_dir .. "/src/**.h"},
-            ["Source Files/*"] = { box2d_dir .. "/src/**.cpp"},
-        }
-        files {box2d_dir .. "/include/**.h", box2d_dir .. "/src/**.cpp", box2d_dir .. "/src/**.h"}
+
+        if (box2dV3) then
+            -- 3.x is C17 with atomics, MSVC still wants them switched on
+            language "C"
+            cdialect "C17"
+            vpaths
+            {
+                ["Header Files"] = { box2d_dir .. "/include/**.h", box2d_dir .. "/src/**.h"},
+                ["Source Files/*"] = { box2d_dir .. "/src/**.c"},
+            }
+            files {box2d_dir .. "/include/**.h", box2d_dir .. "/src/**.c", box2d_dir .. "/src/**.h"}
+
+            filter "action:vs*"
+                buildoptions { "/experimental:c11atomics" }
+
+            filter {"options:box2d-avx2", "platforms:x64"}
+                defines {"BOX2D_AVX2"}
+                vectorextensions "AVX2"
+        else
+            language "C++"
+            vpaths
+            {
+                ["Header Files"] = { box2d_dir .. "/include/**.h", box2d_dir .. "/src/**.h"},
+                ["Source Files/*"] = { box2d_dir .. "/src/**.cpp"},
+            }
+            files {box2d_dir .. "/include/**.h", box2d_dir .. "/src/**.cpp", box2d_dir .. "/src/**.h"}
+        end
         
         filter{}
 end
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "Globals.h"
+
+// Counts every C++ heap allocation (global operator new) by frame phase and tag.
+// The phase is set by Application around PreUpdate/Update/PostUpdate, the tag by
+// ALLOC_TAG scopes (Application tags each module with its name). Allocations on
+// other threads, or outside a tag, land in "Other"/"untagged".
+//
+// C allocations (malloc from raylib, Box2D's block allocator, the decoders) are not seen.
+
+#define ALLOC_MAX_TAGS		32
+
+enum AllocPhase
+{
+	ALLOC_PHASE_OTHER = 0,
+	ALLOC_PHASE_PREUPDATE,
+	ALLOC_PHASE_UPDATE,
+	ALLOC_PHASE_POSTUPDATE,
+	ALLOC_PHASE_COUNT
+};
+
+struct AllocCount
+{
+	uint64 count = 0;
+	uint64 bytes = 0;
+};
+
+namespace AllocTracker
+{
+	// Tag 0 is "untagged". Names must outlive the program (string literals)
+	int RegisterTag(const char* name);
+	int GetTagCount();
+	const char* GetTagName(int tag);
+
+	// Both return the previous value, for restoring
+	int SetTag(int tag);
+	int SetPhase(int phase);
+
+	// Publishes what was allocated since the last call. Game thread only
+	void EndFrame();
+
+	const AllocCount& GetFrame();
+	const AllocCount& GetFramePhase(int phase);
+	const AllocCount& GetFrameTag(int tag);
+	AllocCount GetFrameEntry(int phase, int tag);
+
+	// Since startup
+	AllocCount GetTotal();
+	uint64 GetTotalFrees();
+}
+
+class AllocTagScope
+{
+public:
+
+	AllocTagScope(const char* name) : previous(AllocTracker::SetTag(AllocTracker::RegisterTag(name))) {}
+	~AllocTagScope() { AllocTracker::SetTag(previous); }
+
+private:
+
+	int previous;
+};
+
+class AllocPhaseScope
+{
+public:
+
+	AllocPhaseScope(int phase) : previous(AllocTracker::SetPhase(phase)) {}
+	~AllocPhaseScope() { AllocTracker::SetPhase(previous); }
+
+private:
+
+	int previous;
+};
+
+#define ALLOC_CONCAT_INNER(a, b) a##b
+#define ALLOC_CONCAT(a, b) ALLOC_CONCAT_INNER(a, b)
+
+#define ALLOC_TAG(name)		AllocTagScope ALLOC_CONCAT(allocTag, __LINE__)(name)
@@ -2,14 +2,28 @@
 
 #include "Globals.h"
 #include "Timer.h"
+#include "Module.h"
 #include <vector>
 
+#define MAX_ALLOC_CHECK_REPORTS		10
+#define FIXED_STEP_RANDOM_SEED		1		// raylib RNG seed for --script / --audio-wav runs
+
 class Module;
 class ModuleWindow;
 class ModuleRender;
 class ModuleAudio;
 class ModulePhysics;
 class ModuleGame;
+class EventBus;
+class PerfCounters;
+class FrameArena;
+class FlightRecorder;
+class SpikeDetector;
+class MetricsExport;
+class InputScript;
+class ModuleScheduler;
+class JobSystem;
+struct WorldSnapshot;
 
 class Application
 {
@@ -21,6 +35,14 @@ public:
 	ModulePhysics* physics;
 	ModuleGame* scene_intro;
 
+	EventBus* events;
+	PerfCounters* perf;
+	FrameArena* frame_arena;		// Reset at the start of every Update
+	FlightRecorder* recorder;
+	SpikeDetector* spikes;
+	InputScript* input;
+	JobSystem* jobs;
+
 private:
 
 	std::vector<Module*> list_modules;
@@ -34,16 +56,68 @@ private:
 	uint32 last_sec_frame_count = 0;
 	uint32 prev_last_sec_frame_count = 0;
 
+	int argc = 0;
+	char** argv = nullptr;
+
+	const char* trace_path = "trace.json";
+
+	int alloc_check_warmup = -1;		// Frames before --alloc-check starts counting, -1 when off
+	uint32 alloc_check_failures = 0;
+
+	MetricsExport* metrics;
+	ModuleScheduler* scheduler;
+
+	bool pipelined = false;
+
+	bool fixed_step = false;			// --script / --audio-wav, see GetFrameDelta()
+	float frame_delta = 0.0f;
+	double sim_time = 0.0;
+	update_status simulation_status = UPDATE_CONTINUE;
+	std::vector<float> stage_ms;		// Per module and phase, the last pipelined frame
+
+	int spike_first_section = 0;		// Spike timeline section of the first module's PreUpdate
+
+	WorldSnapshot* quick_save;			// F5 / F9
+	const char* snapshot_path = "snapshot.bin";
+
 public:
 
-	Application();
+	Application(int argc = 0, char** argv = nullptr);
 	~Application();
 
 	bool Init();
 	update_status Update();
 	bool CleanUp();
 
+	// Command line options, "--name value" or a bare "--name" flag
+	bool HasArgument(const char* name) const;
+	const char* GetArgument(const char* name, const char* fallback = nullptr) const;
+
+	// Simulation runs a frame ahead of drawing, see UpdatePipelined()
+	bool IsPipelined() const { return pipelined; }
+
+	// Clock for everything that simulates: physics, game timers, audio sequencing. The
+	// wall clock normally; for --script and --audio-wav a fixed 1 / OFFLINE_AUDIO_FPS step
+	// and the frame count, so the same script renders the same samples every run
+	float GetFrameDelta() const { return frame_delta; }
+	double GetSimTime() const { return sim_time; }
+	bool IsFixedStep() const { return fixed_step; }
+
+	// Whole simulation state, between frames only (never while a step runs)
+	void CaptureWorld(WorldSnapshot& snapshot);
+	bool RestoreWorld(const WorldSnapshot& snapshot);
+
 private:
 
-	void AddModule(Module* module);
+	void AddModule(Module* module, const char* name);
+	void CheckAllocations();
+	void PublishMetrics(double frameStart);
+	int ModuleSection(int module, int phase) const;
+	update_status RunPhase(ModulePhase phase);
+	static update_status RunModulePhase(void* context, int index, ModulePhase phase);
+
+	update_status UpdateModules();
+	update_status UpdatePipelined();
+	update_status RunStage(bool simulation, ModulePhase phase);
+	static void SimulateJob(void* data);
 };
\ No newline at end of file
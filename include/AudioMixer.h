@@ -0,0 +1,255 @@
+#pragma once
+
+#include "Globals.h"
+#include "SpscQueue.h"
+#include "MusicStreamer.h"
+#include "raylib.h"
+
+#include <atomic>
+#include <stdio.h>
+#include <vector>
+
+#define MIXER_SAMPLE_RATE		44100
+#define MIXER_CHANNELS			2
+#define MIXER_BUFFER_FRAMES		512		// Device refill size, ~11.6 ms at 44.1 kHz
+#define MIXER_LOW_LATENCY_FRAMES	128		// Period of the dedicated low-latency device, ~2.9 ms
+#define MIXER_DEVICE_PERIODS	2
+#define MIXER_STREAM_OUTPUT_MS	30.0f	// raylib's device buffering behind the stream (miniaudio default 3 x 10 ms)
+#define MIXER_BLOCK_FRAMES		256		// Frames mixed per internal pass
+#define MAX_MIXER_SAMPLES		96
+#define MAX_MIXER_VOICES		32
+#define MAX_VOICES_PER_SAMPLE	4		// Counted per source sample, variants included
+#define MIXER_COMMAND_QUEUE		256
+#define MIXER_LATENCY_QUEUE		256
+
+struct ma_device;
+
+// Where the mix goes. The stream shares raylib's audio device; the dedicated device
+// opens its own miniaudio playback device with a small period for low-latency play.
+// Offline has no device and no audio thread: the game thread calls Render() and the
+// result is kept in memory and/or written to a WAV, identical from run to run
+enum MixerOutput
+{
+	MIXER_OUTPUT_STREAM = 0,
+	MIXER_OUTPUT_DEVICE,
+	MIXER_OUTPUT_OFFLINE
+};
+
+// Higher priorities steal voices from lower ones, never the other way around
+enum SfxPriority
+{
+	SFX_PRIORITY_LOW = 0,		// wall rattles
+	SFX_PRIORITY_NORMAL,		// flippers, bumpers
+	SFX_PRIORITY_HIGH,			// bonuses, combo cues
+	SFX_PRIORITY_CRITICAL		// ball lost
+};
+
+enum MixerBus
+{
+	MIXER_BUS_MASTER = 0,
+	MIXER_BUS_SFX,
+	MIXER_BUS_MUSIC,
+	MIXER_BUS_COUNT
+};
+
+enum MixerCommandType
+{
+	MIXER_CMD_PLAY = 0,
+	MIXER_CMD_STOP_ALL,
+	MIXER_CMD_SET_GAIN,
+	MIXER_CMD_SET_VOICE_COUNT,
+	MIXER_CMD_PLAY_MUSIC,
+	MIXER_CMD_STOP_MUSIC
+};
+
+// Posted by the game thread, consumed at the start of each mix callback
+struct MixerCommand
+{
+	MixerCommandType type;
+	int id;				// sample id, bus, voice count or music deck depending on type
+	float volume;
+	float pitch;
+	float pan;
+	int priority;
+	uint32 token;		// Music commands: matches the streamer request
+	uint32 fadeFrames;	// Music commands: crossfade length
+	double contactTime;	// Play: GetPerfTime() of the collision that caused it, 0 if none
+	double postTime;	// Play: when the game thread queued it
+};
+
+// Timeline of one collision sound, all GetPerfTime() seconds
+struct LatencySample
+{
+	double contactTime;		// Box2D BeginContact
+	double postTime;		// Play() on the game thread
+	double mixTime;			// Callback that rendered its first frames returned to the device
+};
+
+// Snapshot of the audio thread counters, safe to read from the game thread
+struct MixerStats
+{
+	uint32 callbacks = 0;
+	uint32 framesMixed = 0;
+	int activeVoices = 0;
+	int voiceCount = 0;
+	uint32 voicesStolen = 0;
+	uint32 voicesDropped = 0;
+	uint32 commandsDropped = 0;
+	float lastMixMs = 0.0f;
+	float peakMixMs = 0.0f;
+	float averageMixMs = 0.0f;
+	float bufferMs = 0.0f;		// Time one device buffer covers, the hard budget for a mix
+	float outputLatencyMs = 0.0f;	// Estimated device buffering after the callback returns
+	bool lowLatency = false;
+	uint64 offlineFrames = 0;	// Frames rendered by Render(), offline output only
+	uint32 musicUnderruns = 0;
+	uint32 musicFailedLoads = 0;
+	float musicBufferedMs = 0.0f;
+	float musicPrefetchMs = 0.0f;
+};
+
+// Software mixer feeding a single raylib AudioStream (or its own device) from a callback.
+// Every sample is converted to float stereo at MIXER_SAMPLE_RATE on load, so the
+// audio thread only resamples for pitch, applies gains and clamps.
+// All state below the "audio thread" line is touched by the callback only.
+class AudioMixer
+{
+public:
+
+	AudioMixer();
+
+	// Game thread --------
+	bool Init(int voiceCount, MixerOutput output = MIXER_OUTPUT_STREAM, int bufferFrames = MIXER_BUFFER_FRAMES);
+	void CleanUp();
+
+	// Always consumes the wave data. Returns a 1-based sample id, 0 on failure
+	int AddSample(Wave& wave);
+
+	// Render a resampled, gain-scaled copy of a loaded sample so it can later play
+	// on the unpitched path. Returns the new sample id, 0 on failure
+	int AddVariant(int sample, float pitch, float volume);
+
+	bool Play(int sample, float volume, float pitch, float pan, int priority, double contactTime = 0.0);
+	void StopAll();
+	void SetBusGain(int bus, float gain);
+	void SetVoiceCount(int count);
+
+	// Stream a music file (wav, ogg, mp3) on loop, crossfading from whatever is playing.
+	// Returns as soon as the request is queued, the file is opened on the streamer thread
+	bool PlayMusic(const char* path, float fadeSeconds);
+	void StopMusic(float fadeSeconds);
+
+	MixerStats GetStats() const;
+	bool IsReady() const { return ready; }
+	MixerOutput GetOutput() const { return output; }
+
+	// Offline output only --------
+	// Keep the mix in memory and/or stream it to a 32-bit float WAV. Call before the first Render()
+	bool SetCapture(bool memory, const char* wavPath);
+	// Mix the next frames on the calling thread, music decoding included
+	void Render(uint32 frames);
+	const std::vector<float>& GetCapture() const { return capture; }
+
+	// Timelines of plays that carried a contact time, oldest first
+	bool PopLatency(LatencySample& sample) { return latencies.Pop(sample); }
+
+private:
+
+	struct Voice
+	{
+		int sample = 0;
+		int group = 0;
+		double position = 0.0;
+		float step = 1.0f;
+		float gainL = 0.0f, gainR = 0.0f;
+		int priority = SFX_PRIORITY_LOW;
+		uint64 startedAt = 0;
+		bool active = false;
+	};
+
+	bool Post(const MixerCommand& command);
+	void CloseCapture();
+
+	// Audio thread --------
+	static void AudioCallback(void* buffer, unsigned int frames);
+	static void DeviceCallback(ma_device* device, void* output, const void* input, unsigned int frames);
+	void Mix(float* out, unsigned int frames);
+	void MixBlock(float* out, int frames);
+	void ProcessCommands();
+	void StartVoice(const MixerCommand& command);
+	int AcquireVoice(int group, int priority);
+	void MixVoice(Voice& voice, float* acc, int frames);
+	bool MixMusic(float* dst, int frames);
+
+private:
+
+	static AudioMixer* instance;
+
+	AudioStream stream = { 0 };
+	ma_device* device = nullptr;
+	MixerOutput output = MIXER_OUTPUT_STREAM;
+	int bufferFrames = MIXER_BUFFER_FRAMES;
+	bool ready = false;
+
+	// Offline output
+	std::vector<float> capture;
+	bool captureMemory = false;
+	FILE* captureFile = nullptr;
+	uint64 captureFileFrames = 0;
+	uint64 offlineFrames = 0;
+	alignas(16) float renderBuffer[MIXER_BUFFER_FRAMES * MIXER_CHANNELS];
+
+	// Written by the game thread before the id is ever posted, read-only afterwards
+	struct Sample
+	{
+		float* data = nullptr;
+		uint32 frames = 0;
+		int group = 0;		// Variants share the group of the sample they were rendered from
+	};
+	Sample samples[MAX_MIXER_SAMPLES];
+	int sampleCount = 0;
+
+	SpscQueue<MixerCommand, MIXER_COMMAND_QUEUE> commands;
+	uint32 commandsDropped = 0;
+
+	MusicStreamer streamer;
+	int musicDeck = 0;			// Deck of the latest PlayMusic, game thread
+	uint32 musicToken = 0;
+
+	// Audio thread --------
+	Voice voices[MAX_MIXER_VOICES];
+	int voiceCount = 0;
+	uint64 voiceSequence = 0;
+
+	// Plays started in the current callback, published once it has rendered them
+	LatencySample pendingLatency[MIXER_COMMAND_QUEUE];
+	int pendingLatencyCount = 0;
+	SpscQueue<LatencySample, MIXER_LATENCY_QUEUE> latencies;
+
+	float busGain[MIXER_BUS_COUNT];
+	float busTarget[MIXER_BUS_COUNT];
+
+	// Crossfade state per deck. A deck starts once it is primed and its token is the wanted one
+	uint32 deckWanted[MUSIC_DECKS];
+	uint32 deckFadeFrames[MUSIC_DECKS];
+	float deckGain[MUSIC_DECKS];
+	float deckFadeStep[MUSIC_DECKS];
+	uint32 lastMusicToken = 0;
+
+	alignas(16) float accumulator[MIXER_BLOCK_FRAMES * MIXER_CHANNELS];
+	alignas(16) float sfxBus[MIXER_BLOCK_FRAMES * MIXER_CHANNELS];
+	alignas(16) float scratch[MIXER_BLOCK_FRAMES * MIXER_CHANNELS];
+	alignas(16) float deckBuffer[MIXER_BLOCK_FRAMES * MIXER_CHANNELS];
+
+	// Published for GetStats()
+	std::atomic<uint32> statCallbacks{ 0 };
+	std::atomic<uint32> statFrames{ 0 };
+	std::atomic<int> statActiveVoices{ 0 };
+	std::atomic<int> statVoiceCount{ 0 };
+	std::atomic<uint32> statStolen{ 0 };
+	std::atomic<uint32> statDropped{ 0 };
+	std::atomic<float> statLastMs{ 0.0f };
+	std::atomic<float> statPeakMs{ 0.0f };
+	std::atomic<float> statAverageMs{ 0.0f };
+	std::atomic<uint32> statUnderruns{ 0 };
+};
@@ -0,0 +1,205 @@
+#pragma once
+
+#include "Globals.h"
+#include <tuple>
+
+class PhysBody;
+
+// Gameplay events -----------
+
+// Impact events carry the GetPerfTime() of the Box2D contact, for latency tracking
+
+struct BumperHitEvent
+{
+	PhysBody* source;
+	float impactForce;
+	int points;             // 0 for pieces that only boost the ball
+	double contactTime;
+};
+
+struct FlipperHitEvent
+{
+	PhysBody* source;
+	float impactForce;
+	double contactTime;
+};
+
+struct WallHitEvent
+{
+	PhysBody* source;
+	float impactForce;
+	double contactTime;
+};
+
+struct TargetHitEvent
+{
+	PhysBody* source;
+	bool special;
+};
+
+struct LetterCollectedEvent
+{
+	PhysBody* source;
+	char letter;
+};
+
+struct ComboProgressEvent
+{
+	int progress;
+	int total;
+};
+
+struct ComboCompletedEvent
+{
+	int bonusPoints;
+};
+
+struct ScoreChangedEvent
+{
+	int previousScore;
+	int currentScore;
+	const char* source;
+};
+
+struct BallLostEvent
+{
+	int ballsLeft;
+};
+
+#define MAX_EVENTS_PER_FRAME	64
+#define MAX_EVENT_LISTENERS		8
+#define MAX_DISPATCH_PASSES		4
+
+// One channel per event type: a double-buffered, fixed-size queue plus its listeners.
+// Publishing only copies into the queue; listeners see whole batches at Dispatch()
+template<typename T>
+class EventChannel
+{
+public:
+
+	typedef void (*Handler)(void* listener, const T* events, int count);
+
+	bool Publish(const T& event)
+	{
+		int& count = counts[writeBuffer];
+		if (count >= MAX_EVENTS_PER_FRAME)
+		{
+			dropped++;
+			return false;
+		}
+
+		buffers[writeBuffer][count++] = event;
+		return true;
+	}
+
+	bool AddListener(void* listener, Handler handler)
+	{
+		if (listenerCount >= MAX_EVENT_LISTENERS)
+			return false;
+
+		listeners[listenerCount] = listener;
+		handlers[listenerCount] = handler;
+		listenerCount++;
+		return true;
+	}
+
+	// Deliver the pending batch. Events published by listeners go to the other buffer
+	bool Dispatch()
+	{
+		int readBuffer = writeBuffer;
+		int count = counts[readBuffer];
+		if (count == 0)
+			return false;
+
+		writeBuffer ^= 1;
+		for (int i = 0; i < listenerCount; ++i)
+		{
+			handlers[i](listeners[i], buffers[readBuffer], count);
+		}
+		counts[readBuffer] = 0;
+		delivered += count;
+
+		return true;
+	}
+
+	void Clear()
+	{
+		counts[0] = counts[1] = 0;
+	}
+
+	uint32 GetDropped() const { return dropped; }
+	uint64 GetDelivered() const { return delivered; }
+
+private:
+
+	T buffers[2][MAX_EVENTS_PER_FRAME];
+	int counts[2] = { 0, 0 };
+	int writeBuffer = 0;
+
+	void* listeners[MAX_EVENT_LISTENERS] = {};
+	Handler handlers[MAX_EVENT_LISTENERS] = {};
+	int listenerCount = 0;
+
+	uint32 dropped = 0;
+	uint64 delivered = 0;
+};
+
+// Preallocated bus owned by the Application. Publish from anywhere on the game thread,
+// listeners are called in batches when Application::Update reaches a dispatch point
+class EventBus
+{
+public:
+
+	template<typename T>
+	bool Publish(const T& event)
+	{
+		return std::get<EventChannel<T>>(channels).Publish(event);
+	}
+
+	// Subscribe<EventType, ModuleClass, &ModuleClass::Handler>(module)
+	// Handler signature: void Handler(const EventType* events, int count)
+	template<typename T, typename C, void (C::*Method)(const T*, int)>
+	bool Subscribe(C* listener)
+	{
+		return std::get<EventChannel<T>>(channels).AddListener(listener,
+			[](void* ctx, const T* events, int count) { (((C*)ctx)->*Method)(events, count); });
+	}
+
+	// Flush every channel, repeating while listeners keep publishing follow-up events
+	void Dispatch()
+	{
+		for (int pass = 0; pass < MAX_DISPATCH_PASSES; ++pass)
+		{
+			bool any = false;
+			std::apply([&any](auto&... channel) { ((any |= channel.Dispatch()), ...); }, channels);
+			if (!any) break;
+		}
+	}
+
+	void Clear()
+	{
+		std::apply([](auto&... channel) { (channel.Clear(), ...); }, channels);
+	}
+
+	uint32 GetDroppedCount() const
+	{
+		uint32 total = 0;
+		std::apply([&total](const auto&... channel) { ((total += channel.GetDropped()), ...); }, channels);
+		return total;
+	}
+
+private:
+
+	// Raw gameplay events first, derived ones after, so one pass usually drains a frame
+	std::tuple<
+		EventChannel<BumperHitEvent>,
+		EventChannel<FlipperHitEvent>,
+		EventChannel<WallHitEvent>,
+		EventChannel<TargetHitEvent>,
+		EventChannel<LetterCollectedEvent>,
+		EventChannel<ComboProgressEvent>,
+		EventChannel<ComboCompletedEvent>,
+		EventChannel<ScoreChangedEvent>,
+		EventChannel<BallLostEvent>
+	> channels;
+};
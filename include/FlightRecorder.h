@@ -0,0 +1,105 @@
+#pragma once
+
+#include "Globals.h"
+#include "EventBus.h"
+
+// Ring of compact records covering the last seconds of play, written to disk on a crash
+// (SIGSEGV/SIGABRT), on F4 and at exit. Game thread only; a record is a few stores.
+//
+// File layout, little endian: FlightFileHeader, then header.count FlightRecords, oldest first.
+
+#define FLIGHT_RECORDER_CAPACITY	(1 << 14)		// Records, a power of two
+#define FLIGHT_RECORDER_SECONDS		10.0			// Older records are left out of a dump
+#define FLIGHT_RECORDER_VERSION		1
+
+enum FlightRecordType
+{
+	FLIGHT_FRAME = 1,		// i[0] frame allocations, f[1] dt ms, f[2] update ms
+	FLIGHT_BALL,			// f[0..1] position, f[2..3] velocity, meters
+	FLIGHT_CONTACT,			// code collision type, f[0..1] ball position, f[2] impact force
+	FLIGHT_INPUT,			// code key, i[0] 1 down / 0 up
+	FLIGHT_STATE,			// code new GameState, i[0] previous
+	FLIGHT_SCORE,			// i[0] previous, i[1] current score
+	FLIGHT_BALL_LOST,		// i[0] balls left
+	FLIGHT_MARK				// code dump reason, written right before a dump
+};
+
+enum FlightDumpReason
+{
+	FLIGHT_DUMP_EXIT = 0,
+	FLIGHT_DUMP_HOTKEY,
+	FLIGHT_DUMP_SIGSEGV,
+	FLIGHT_DUMP_SIGABRT
+};
+
+struct FlightRecord
+{
+	double time;			// GetPerfTime()
+	uint32 frame;
+	unsigned short type;
+	unsigned short code;
+	union
+	{
+		float f[4];
+		int i[4];
+	};
+};
+
+struct FlightFileHeader
+{
+	char magic[4];			// "PBFR"
+	uint32 version;
+	uint32 recordSize;
+	uint32 count;
+	uint32 reason;
+	uint32 lastFrame;
+	double dumpTime;
+};
+
+class FlightRecorder
+{
+public:
+
+	FlightRecorder();
+	~FlightRecorder();
+
+	// Dumps to path on SIGSEGV/SIGABRT from now on
+	void Install(const char* path);
+	void Uninstall();
+
+	void BeginFrame(uint32 frame) { currentFrame = frame; }
+
+	void Frame(float dtMs, float updateMs, int allocations);
+	void Ball(float x, float y, float vx, float vy);
+	void Contact(int type, float x, float y, float force);
+	void Input(int key, bool down);
+	void State(int previous, int current);
+
+	// Writes the last FLIGHT_RECORDER_SECONDS of records. Async-signal-safe. Hotkey
+	// dumps go to their own file, the path with the frame appended (flight_1234.bin),
+	// so the exit dump doesn't replace them
+	bool Dump(int reason);
+
+	// File the last Dump() wrote
+	const char* GetDumpPath() const { return dumpPath; }
+
+	void OnScoreChanged(const ScoreChangedEvent* events, int count);
+	void OnBallLost(const BallLostEvent* events, int count);
+
+	uint32 GetDumps() const { return dumps; }
+
+private:
+
+	FlightRecord& Push(int type, int code);
+	void MakeDumpPath(int reason);
+
+private:
+
+	FlightRecord* records = nullptr;
+	uint64 written = 0;
+	uint32 currentFrame = 0;
+	uint32 dumps = 0;
+
+	char path[256] = "flight.bin";
+	char dumpPath[256 + 16] = "flight.bin";
+};
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "Globals.h"
+#include <stddef.h>
+#include <vector>
+
+// Bump-pointer arena for data that only lives until the end of the frame. Application
+// owns one and resets it at the start of every Update, so nothing allocated here may
+// be kept across frames. Game thread only.
+//
+// When it runs out, allocations fall back to the heap and are counted as overflows;
+// raise FRAME_ARENA_SIZE if the overlay ever shows any.
+
+#define FRAME_ARENA_SIZE		(256 * 1024)
+
+class FrameArena
+{
+public:
+
+	FrameArena(size_t capacity = FRAME_ARENA_SIZE);
+	~FrameArena();
+
+	void* Allocate(size_t size, size_t alignment = alignof(max_align_t));
+	void Free(void* ptr);
+
+	// Everything allocated since the last reset is gone
+	void Reset();
+
+	bool Owns(const void* ptr) const { return (const char*)ptr >= memory && (const char*)ptr < memory + capacity; }
+
+	size_t GetCapacity() const { return capacity; }
+	size_t GetUsed() const { return used; }
+	size_t GetLastFrameUsed() const { return lastFrameUsed; }
+	size_t GetHighWater() const { return highWater; }
+	uint32 GetOverflows() const { return overflows; }
+	uint32 GetLastFrameOverflows() const { return lastFrameOverflows; }
+
+private:
+
+	char* memory = nullptr;
+	size_t capacity = 0;
+	size_t used = 0;
+
+	size_t lastFrameUsed = 0;
+	size_t highWater = 0;
+	uint32 overflows = 0;
+	uint32 frameOverflows = 0;
+	uint32 lastFrameOverflows = 0;
+};
+
+// STL allocator on top of a FrameArena. Deallocation is a no-op for arena memory
+template<typename T>
+class FrameAllocator
+{
+public:
+
+	typedef T value_type;
+
+	FrameAllocator(FrameArena* arena) : arena(arena) {}
+	template<typename U> FrameAllocator(const FrameAllocator<U>& other) : arena(other.arena) {}
+
+	T* allocate(size_t n) { return (T*)arena->Allocate(n * sizeof(T), alignof(T)); }
+	void deallocate(T* ptr, size_t) { arena->Free(ptr); }
+
+	template<typename U> bool operator==(const FrameAllocator<U>& other) const { return arena == other.arena; }
+	template<typename U> bool operator!=(const FrameAllocator<U>& other) const { return arena != other.arena; }
+
+	FrameArena* arena;
+};
+
+template<typename T>
+using FrameVector = std::vector<T, FrameAllocator<T>>;
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "Globals.h"
+
+#include <string>
+#include <vector>
+
+#define MAX_INPUT_KEYS		512
+#define MAX_INPUT_TRANSITIONS	32		// Per frame, kept for the flight recorder
+
+// One key transition, applied at the start of the given frame
+struct InputEvent
+{
+	uint32 frame;
+	int key;
+	bool down;
+};
+
+// Keyboard front-end for gameplay input. Forwards to raylib unless a script is playing,
+// in which case keys come from a recorded or generated event list so runs are repeatable.
+// Script files are text, one "<frame> <key> <down|up>" line per transition, '#' comments
+class InputScript
+{
+public:
+
+	InputScript();
+	~InputScript();
+
+	bool Load(const char* path);
+
+	// Start a game, then launch and flip on a fixed rhythm for the given time
+	void GenerateLatencyRun(int seconds);
+
+	// Writes every key transition to path when Finish() is called
+	bool StartRecording(const char* path);
+	void Finish();
+
+	// Called once per frame before any module reads input
+	void BeginFrame(uint32 frame);
+
+	bool IsKeyDown(int key) const;
+	bool IsKeyPressed(int key) const;
+	bool IsKeyReleased(int key) const;
+
+	// Keys that went down or up this frame
+	int GetTransitionCount() const { return transitionCount; }
+	const InputEvent& GetTransition(int index) const { return transitions[index]; }
+
+	bool IsPlaying() const { return playing; }
+	bool IsFinished() const { return playing && next >= events.size() && currentFrame > lastFrame; }
+
+private:
+
+	void AddPress(uint32 frame, int key, uint32 holdFrames);
+
+private:
+
+	std::vector<InputEvent> events;
+	size_t next = 0;
+	uint32 currentFrame = 0;
+	uint32 lastFrame = 0;
+	bool playing = false;
+
+	bool recording = false;
+	std::string recordPath;
+	std::vector<InputEvent> recorded;
+
+	bool down[MAX_INPUT_KEYS];
+	bool previous[MAX_INPUT_KEYS];
+
+	InputEvent transitions[MAX_INPUT_TRANSITIONS];
+	int transitionCount = 0;
+};
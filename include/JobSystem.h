@@ -0,0 +1,106 @@
+#pragma once
+
+#include "Globals.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#define JOB_QUEUE_SIZE		1024	// Per thread. A job that doesn't fit runs inline
+#define MAX_JOB_WORKERS		31
+
+typedef void (*JobFunction)(void* data);
+typedef void (*ParallelForFunction)(void* data, int begin, int end);
+
+// Counts unfinished jobs. Pass the same fence to several Run() calls and
+// JobSystem::Wait() on it to join them all. Must outlive its jobs
+class JobFence
+{
+public:
+
+	bool IsDone() const { return pending.load(std::memory_order_acquire) == 0; }
+
+private:
+
+	friend class JobSystem;
+	std::atomic<int> pending{ 0 };
+};
+
+// Engine-wide worker threads, owned by the Application. Every thread has its own deque:
+// the owner pushes and pops at the back, idle workers steal from the front of the others.
+// Threads that aren't workers (the main thread, the audio thread) share the first deque.
+//
+// Jobs that need the main thread (GL, window, raylib in general) go through
+// RunOnMainThread() and run when the main thread waits on a fence or calls
+// RunMainThreadJobs(), which Application::Update does every frame.
+//
+// Nothing allocates after Start(), so jobs are fine in steady-state frames.
+class JobSystem
+{
+public:
+
+	JobSystem();
+	~JobSystem();
+
+	// The calling thread becomes the main thread. Without workers every job runs inline
+	bool Start(int workerCount);
+	void Stop();
+
+	int GetWorkerCount() const { return (int)workers.size(); }
+	bool IsMainThread() const;
+
+	void Run(JobFunction function, void* data, JobFence* fence = nullptr);
+	void RunOnMainThread(JobFunction function, void* data, JobFence* fence = nullptr);
+
+	// Runs queued jobs instead of blocking, so waiting from inside a job is fine
+	void Wait(JobFence* fence);
+
+	// Calls function over [0, count) in batches of up to batchSize, on every thread
+	// including the caller, and returns when all of them are done
+	void ParallelFor(int count, int batchSize, ParallelForFunction function, void* data);
+
+	// Main thread only
+	void RunMainThreadJobs();
+
+	// Runs one queued job if there is any
+	bool RunOne();
+
+	// Since Start, over all threads
+	uint64 GetJobsRun() const;
+	uint64 GetSteals() const;
+
+private:
+
+	struct Job
+	{
+		JobFunction function;
+		void* data;
+		JobFence* fence;
+	};
+
+	struct WorkQueue;
+
+	bool Push(WorkQueue& queue, const Job& job);
+	bool PopBack(WorkQueue& queue, Job& job);
+	bool PopFront(WorkQueue& queue, Job& job);
+	bool FindJob(int queueIndex, Job& job);
+	void Execute(const Job& job, int queueIndex);
+	void WakeWorker();
+	void WorkerLoop(int queueIndex);
+
+private:
+
+	std::vector<std::thread> workers;
+	WorkQueue* queues = nullptr;		// [0] shared by non-worker threads, then one per worker
+	WorkQueue* mainQueue = nullptr;		// Main-thread jobs, never stolen
+	int queueCount = 0;
+	std::thread::id mainThread;
+
+	std::atomic<int> queued{ 0 };		// Jobs waiting in the stealable queues
+	std::atomic<int> sleeping{ 0 };
+	std::atomic<bool> quit{ false };
+	std::mutex sleepMutex;
+	std::condition_variable wake;
+};
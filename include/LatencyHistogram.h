@@ -0,0 +1,36 @@
+#pragma once
+
+#include "Globals.h"
+
+#define LATENCY_BIN_MS		0.25f
+#define LATENCY_BINS		400		// 0 - 100 ms, slower samples land in the last bin
+
+// Fixed-bin histogram of millisecond timings. Add() never allocates, so it can be fed every frame
+class LatencyHistogram
+{
+public:
+
+	LatencyHistogram();
+
+	void Add(float ms);
+	void Reset();
+
+	uint32 GetCount() const { return count; }
+	float GetMin() const { return count > 0 ? minMs : 0.0f; }
+	float GetMax() const { return maxMs; }
+	float GetMean() const { return count > 0 ? (float)(sumMs / count) : 0.0f; }
+
+	// Upper edge of the bin holding the given fraction (0 - 1) of the samples
+	float GetPercentile(float fraction) const;
+
+	// Percentiles plus an ASCII bar chart through LOG
+	void Print(const char* title) const;
+
+private:
+
+	uint32 bins[LATENCY_BINS];
+	uint32 count;
+	float minMs;
+	float maxMs;
+	double sumMs;
+};
@@ -0,0 +1,62 @@
+#pragma once
+
+// Layout of the live metrics shared-memory segment. Shared with tools/metrics_reader,
+// so this header only depends on the standard library.
+//
+// The game writes once per frame under a seqlock: sequence is odd while a write is in
+// progress. Readers copy the payload between two reads of sequence and retry if it
+// changed or was odd; they never block or slow down the writer.
+
+#include <atomic>
+#include <stdint.h>
+
+#define LIVE_METRICS_MAGIC			0x4D4C4250u		// "PBLM"
+#define LIVE_METRICS_VERSION		2
+#define LIVE_METRICS_DEFAULT_NAME	"pinball_metrics"
+
+struct LiveMetrics
+{
+	uint64_t frame;
+	double time;				// Seconds since the game started
+
+	float frameMs;
+	float updateMs;				// Application::Update, without the wait for the next frame
+	float physicsStepMs;		// Physics backend steps, all substeps
+
+	int32_t bodies;
+	int32_t contacts;			// Live engine contacts, touching or not
+	int32_t contactsBegun;		// Contacts that began during the last frame
+	int32_t physicsSubsteps;	// Steps the frame was split into
+
+	int32_t activeVoices;
+	int32_t voiceCount;
+
+	int32_t gameState;			// GameState
+	int32_t score;
+	int32_t ballsLeft;
+};
+
+struct LiveMetricsSegment
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t size;				// sizeof(LiveMetricsSegment) of the writer
+	std::atomic<uint32_t> sequence;
+	LiveMetrics metrics;
+};
+
+// Reader side of the seqlock. Returns false if the writer kept the segment busy
+inline bool ReadLiveMetrics(const LiveMetricsSegment* segment, LiveMetrics* out, int attempts = 64)
+{
+	for (int i = 0; i < attempts; ++i)
+	{
+		uint32_t before = segment->sequence.load(std::memory_order_acquire);
+		if (before & 1) continue;
+
+		*out = segment->metrics;
+
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (segment->sequence.load(std::memory_order_relaxed) == before) return true;
+	}
+	return false;
+}
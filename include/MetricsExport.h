@@ -0,0 +1,30 @@
+#pragma once
+
+#include "LiveMetrics.h"
+
+// Game side of the live metrics segment (see LiveMetrics.h). Enabled with
+// --metrics-shm [name]; tools/metrics_reader attaches to it read-only.
+class MetricsExport
+{
+public:
+
+	MetricsExport();
+	~MetricsExport();
+
+	bool Open(const char* name);
+	void Close();
+
+	bool IsOpen() const { return segment != nullptr; }
+
+	// Once per frame, never blocks
+	void Publish(const LiveMetrics& metrics);
+
+private:
+
+	LiveMetricsSegment* segment = nullptr;
+	char name[64] = {};
+
+#ifdef _WIN32
+	void* mapping = nullptr;
+#endif
+};
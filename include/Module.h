@@ -5,10 +5,41 @@
 class Application;
 class PhysBody;
 
+enum ModulePhase
+{
+	PHASE_PREUPDATE,
+	PHASE_UPDATE,
+	PHASE_POSTUPDATE,
+	PHASE_COUNT
+};
+
+// Shared state a module phase reads or writes. The scheduler runs phases whose
+// declarations don't conflict at the same time (see ModuleScheduler.h)
+enum ModuleResource
+{
+	RESOURCE_NONE			= 0,
+	RESOURCE_PHYSICS_WORLD	= 1 << 0,	// b2World, bodies and joints
+	RESOURCE_GAME_DATA		= 1 << 1,	// ModuleGame::gameData and the rest of the game state
+	RESOURCE_AUDIO			= 1 << 2,	// Mixer command queue, voices and audio stats
+	RESOURCE_EVENTS			= 1 << 3,	// Publishing to the event bus
+	RESOURCE_RENDER			= 1 << 4,	// raylib draw calls
+	RESOURCE_WINDOW			= 1 << 5,	// Window and input polling
+	RESOURCE_ALL			= 0xFFFF
+};
+
+struct ModuleAccess
+{
+	uint reads = RESOURCE_ALL;
+	uint writes = RESOURCE_ALL;
+	bool mainThread = true;		// raylib, perf counters and the other game-thread-only systems
+};
+
 class Module
 {
 private :
 	bool enabled;
+	const char* name = "Module";
+	ModuleAccess access[PHASE_COUNT];		// Undeclared phases touch everything, so they run in order
 
 public:
 	Application* App;
@@ -24,6 +55,30 @@ public:
 		return enabled;
 	}
 
+	// Label used by traces and profiling output, set by Application::AddModule
+	const char* GetName() const
+	{
+		return name;
+	}
+
+	void SetName(const char* module_name)
+	{
+		name = module_name;
+	}
+
+	const ModuleAccess& GetAccess(ModulePhase phase) const
+	{
+		return access[phase];
+	}
+
+	// Called from the constructor. Phases a module doesn't override declare nothing
+	void DeclareAccess(ModulePhase phase, uint reads, uint writes, bool mainThread = true)
+	{
+		access[phase].reads = reads;
+		access[phase].writes = writes;
+		access[phase].mainThread = mainThread;
+	}
+
 	void Enable()
 	{
 		if(enabled == false)
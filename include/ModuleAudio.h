@@ -1,11 +1,58 @@
 #pragma once
 
 #include "Module.h"
+#include "EventBus.h"
+#include "AudioMixer.h"
+#include "LatencyHistogram.h"
+#include "SfxSynth.h"
 #include "raylib.h"
 
 #define MAX_SOUNDS	16
 #define DEFAULT_MUSIC_FADE_TIME 2.0f
 
+#define DEFAULT_SFX_VOICES	16
+#define OFFLINE_AUDIO_FPS	60		// Offline output renders 1/60 s of audio per game frame
+#define MAX_FX_VARIANTS		16
+#define MAX_IMPACT_SOURCES	64
+#define BUMPER_TIMBRES		4		// Synthesised bumper voices, each bumper keeps one
+#define TIMBRE_VARIATION	0.8f
+
+// Collision sounds that get merged per frame and rate limited per source
+enum ImpactKind
+{
+	IMPACT_BUMPER = 0,
+	IMPACT_FLIPPER,
+	IMPACT_WALL,
+	IMPACT_KIND_COUNT
+};
+
+// Pre-rendered copies of one fx at evenly spaced pitch/volume steps,
+// variant i sits at t = i / (count - 1) between the min and max values
+struct FxVariantBank
+{
+	int samples[MAX_FX_VARIANTS];
+	int count = 0;
+	float minPitch = 1.0f, maxPitch = 1.0f;
+	float minVolume = 1.0f, maxVolume = 1.0f;
+};
+
+// All the hits one object took in a single event batch
+struct ImpactGroup
+{
+	PhysBody* source;
+	float impactForce;
+	double contactTime;		// Earliest contact of the group
+};
+
+// Collision sound latency, split at each hand-off
+enum LatencyStage
+{
+	LATENCY_CONTACT_TO_PLAY = 0,	// BeginContact -> Play() on the game thread
+	LATENCY_PLAY_TO_MIX,			// Play() -> mixed into a device buffer
+	LATENCY_CONTACT_TO_MIX,
+	LATENCY_STAGE_COUNT
+};
+
 class ModuleAudio : public Module
 {
 public:
@@ -16,6 +63,7 @@ public:
 	bool Init();
 	bool CleanUp();
 	update_status Update();
+	update_status PostUpdate();
 
 	// Play a music file
 	bool PlayMusic(const char* path, float fade_time = DEFAULT_MUSIC_FADE_TIME);
@@ -23,19 +71,47 @@ public:
 	// Load a sound in memory
 	unsigned int LoadFx(const char* path);
 
+	// Render a synth patch and load it like a sound file. The seed drives its noise
+	unsigned int LoadSynthFx(const SfxPatch& patch, uint32 seed = 1);
+
+	// Fx id of one of the synthesised game effects
+	unsigned int GetFx(int sfx) const { return (sfx >= 0 && sfx < SFX_COUNT) ? synthFx[sfx] : 0; }
+
 	// Play a previously loaded sound
-	bool PlayFx(unsigned int fx, int repeat = 0);
+	bool PlayFx(unsigned int fx, int repeat = 0, int priority = SFX_PRIORITY_NORMAL);
+
+	// Queue fx on a mixer voice. pan goes from -1 (left) to 1 (right).
+	// Voice allocation and stealing happen on the audio thread, so this only fails if the command queue is full
+	bool PlayFxVoice(unsigned int fx, float volume = 1.0f, float pitch = 1.0f, float pan = 0.0f, int priority = SFX_PRIORITY_NORMAL);
+
+	// Load-time step for hot effects: later variation/pitch plays pick the nearest variant
+	// instead of resampling in the mixer
+	bool BuildVariantBank(unsigned int fx, int count, float minPitch, float maxPitch, float minVolume, float maxVolume);
+
+	// Number of simultaneous effect voices, up to MAX_MIXER_VOICES
+	void SetVoiceCount(int count);
+	MixerStats GetMixerStats() const { return mixer.GetStats(); }
+
+	// Collision triggers that were merged into another hit or fell inside the retrigger interval
+	uint32 GetSuppressedImpacts(int kind) const { return impactsSuppressed[kind]; }
+	uint32 GetTriggeredImpacts(int kind) const { return impactsTriggered[kind]; }
+
+	// Rendered mix when running with the offline output and memory capture
+	const std::vector<float>& GetOfflineCapture() const { return mixer.GetCapture(); }
+
+	const LatencyHistogram& GetLatency(int stage) const { return latency[stage]; }
+	void PrintLatencyReport() const;
 
 	void PlayFlipperHit(float impactForce = 0.5f);
-	void PlayBumperHit(float impactForce = 0.5f);
+	void PlayBumperHit(float impactForce = 0.5f, float pan = 0.0f, int timbre = 0);
 	void PlayBonusSound();
 	void PlayComboComplete();
 	void PlayBallLost();
 
 	// Sound variation
-	void PlayFxWithPitch(unsigned int fx, float pitch);
-	void PlayFxWithVolume(unsigned int fx, float volume);
-	void PlayFxWithVariation(unsigned int fx, float impactForce);
+	void PlayFxWithPitch(unsigned int fx, float pitch, int priority = SFX_PRIORITY_HIGH);
+	void PlayFxWithVolume(unsigned int fx, float volume, int priority = SFX_PRIORITY_HIGH);
+	void PlayFxWithVariation(unsigned int fx, float impactForce, float pan = 0.0f, int priority = SFX_PRIORITY_NORMAL);
 
 	// Volume controls
 	void SetMasterVolume(float volume);
@@ -51,12 +127,51 @@ public:
 	void PlayExtraBallAward();
 	void PlayScoreMilestone(int score);
 
+	// Event bus listeners, called in batches at the Application dispatch points
+	void OnBumperHits(const BumperHitEvent* events, int count);
+	void OnFlipperHits(const FlipperHitEvent* events, int count);
+	void OnWallHits(const WallHitEvent* events, int count);
+	void OnTargetHits(const TargetHitEvent* events, int count);
+	void OnComboProgress(const ComboProgressEvent* events, int count);
+	void OnComboCompleted(const ComboCompletedEvent* events, int count);
+	void OnScoreChanged(const ScoreChangedEvent* events, int count);
+	void OnBallLost(const BallLostEvent* events, int count);
+
+private:
+
+	bool InitMixer();
+	unsigned int AddSynthFx(const SfxPatch& patch, uint32 seed, Wave& wave);
+	bool AllowImpact(int kind, const PhysBody* source, double now);
+	void CollectLatency();
 
 private:
 
-	Music music;
-	Sound fx[MAX_SOUNDS];
+	AudioMixer mixer;
+
+	// Contact time handed to the mixer by plays started from a collision listener
+	double impactContactTime = 0.0;
+	LatencyHistogram latency[LATENCY_STAGE_COUNT];
+	bool latencyReport = false;
+
+	// Last time each (kind, source) pair made a sound, small open-addressed table
+	struct ImpactSource
+	{
+		const PhysBody* source = nullptr;
+		int kind = 0;
+		double lastTrigger = 0.0;
+	};
+	ImpactSource impactSources[MAX_IMPACT_SOURCES];
+	uint32 impactsTriggered[IMPACT_KIND_COUNT];
+	uint32 impactsSuppressed[IMPACT_KIND_COUNT];
+
+	// Mixer sample ids, indexed by fx id - 1
+	int fx[MAX_SOUNDS];
     unsigned int fx_count;
+	FxVariantBank banks[MAX_SOUNDS];
+
+	unsigned int synthFx[SFX_COUNT];
+	unsigned int bumperTimbreFx[BUMPER_TIMBRES];
+	const char* exportSfxDir = nullptr;
 
 
 
@@ -2,15 +2,19 @@
 
 #include "Globals.h"
 #include "Module.h"
+#include "EventBus.h"
 #include "GameState.h"
 #include "p2Point.h"
+#include "OccupancyGrid.h"
+#include "PhysicsBackend.h"
+#include "RenderSnapshot.h"
 #include "raylib.h"
 #include <vector>
 #include <cstring>
 
 class PhysBody;
 class PhysicEntity;
-class b2RevoluteJoint;
+struct WorldSnapshot;
 
 enum CollisionType
 {
@@ -27,6 +31,7 @@ enum CollisionType
 
 struct StarLetter {
     PhysBody* body;
+    int x, y;           // Spawn position, pixels
     char letter;
     bool collected;
     float spawnTime;
@@ -54,25 +59,38 @@ public:
     ~ModuleGame();
 
     bool Start();
+    update_status PreUpdate();
     update_status Update();
+    update_status PostUpdate();
     bool CleanUp();
     void OnCollision(PhysBody* bodyA, PhysBody* bodyB) override;
 
     float CalculateImpactForce(PhysBody* body);
     CollisionType IdentifyCollision(PhysBody* bodyA, PhysBody* bodyB);
 
-    void DrawAudioSettings();
+    void DrawAudioSettings(const RenderSnapshot& snapshot);
     void UpdateAudioSettings();
     void SaveAudioSettings();
     void LoadAudioSettings();
 
-    void RenderMenuState();
-    void RenderPlayingState();
-    void RenderPausedState();
-    void RenderGameOverState();
-    void RenderYouWinState();
+    // Game logic for one frame, without drawing anything
+    update_status Simulate(float dt);
+    void CaptureSnapshot(RenderSnapshot& snapshot) const;
+    void DrawSnapshot(const RenderSnapshot& snapshot);
+
+    // Game data, timers, letters and targets. Runs before ModulePhysics::RestoreState(),
+    // so letters that came or went since the capture are already sorted out
+    void CaptureState(WorldSnapshot& snapshot) const;
+    void RestoreState(const WorldSnapshot& snapshot);
+
+    void RenderMenuState(const RenderSnapshot& snapshot);
+    void RenderPlayingState(const RenderSnapshot& snapshot);
+    void RenderPausedState(const RenderSnapshot& snapshot);
+    void RenderGameOverState(const RenderSnapshot& snapshot);
+    void RenderYouWinState(const RenderSnapshot& snapshot);
 
     void UpdateMenuState();
+    void ChangeState(GameState state);
     void UpdatePlayingState();
     void UpdatePausedState();
     void UpdateGameOverState();
@@ -83,10 +101,15 @@ public:
     void RespawnBall();
     void AddComboLetter(char letter);
     void SpawnStarLetter();
+    PhysBody* CreateStarLetterBody(int x, int y);
     void CollectStarLetter(char letter);
     void ResetStarCombo();
     void CompleteStarCombo();
 
+    // Event bus listeners (scoring side of gameplay events)
+    void OnBumperHits(const BumperHitEvent* events, int count);
+    void OnLettersCollected(const LetterCollectedEvent* events, int count);
+
     void AddScore(int points, const char* source);
     void SaveHighScore();
     void LoadHighScore();
@@ -112,8 +135,8 @@ public:
     PhysBody* kicker = nullptr;
     PhysBody* ballLossSensor = nullptr;
 
-    b2RevoluteJoint* leftFlipperJoint = nullptr;
-    b2RevoluteJoint* rightFlipperJoint = nullptr;
+    PhysHandle leftFlipperJoint = 0;
+    PhysHandle rightFlipperJoint = 0;
 
     std::vector<PhysBody*> bumpers;
     // Moving vertical targets (new feature) and special static targets
@@ -184,6 +207,13 @@ public:
     float ballLossTimer = 0.0f;
     float starLetterSpawnTimer = 0.0f;
     const float STAR_LETTER_SPAWN_INTERVAL = 5.0f;
+    const int MAX_STAR_LETTERS = 8;         // Capacity reserved up front, only one is live at a time
+
+    // Static geometry rasterised at table load, spawns sample free cells from it
+    OccupancyGrid spawnGrid;
+    int letterSpawnZone = -1;
+    const int SPAWN_GRID_CELL_SIZE = 8;     // pixels
+    const int STAR_LETTER_RADIUS = 20;      // pixels
 
     // Black hole teleportation tracking
     int currentBlackHoleIndex = -1;
@@ -198,10 +228,8 @@ public:
     const float SPAWN_EJECT_THRESHOLD_TIME = 3.0f; // seconds before auto-eject
     const float SPAWN_ZONE_RADIUS = 1.0f; // meters
 
-    float ballSavedPosX = 0.0f, ballSavedPosY = 0.0f;
-    float ballSavedVelX = 0.0f, ballSavedVelY = 0.0f;
-    float ballSavedAngularVel = 0.0f;
-    bool ballSavedAwake = false;
+    // Seconds the launched ball has sat at 0 m/s, ejected after 5
+    float ballZeroVelTime = 0.0f;
 
     bool isGamePaused = false;
 
@@ -209,4 +237,7 @@ public:
     float comboCompleteTimer = 0.0f;
     int comboCompleteFlashCount = 0;
     Color comboCompleteFlashColor = YELLOW;
+
+    // Drawing reads the front one, Update captures into the back one
+    RenderSnapshotBuffer snapshots;
 };
\ No newline at end of file
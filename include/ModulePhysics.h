@@ -1,15 +1,38 @@
 #pragma once
 #include "Module.h"
 #include "Globals.h"
-#include "box2d/box2d.h"
+#include "RollingHistogram.h"
+#include "PhysicsBackend.h"
 #include <vector>
 
 #define GRAVITY_X 0.0f
 #define GRAVITY_Y -10.0f
 
+#define PHYSICS_MAX_SUBSTEPS 8
+
 class PhysBody;
+struct WorldSnapshot;
+
+// Per-step world statistics kept as rolling histograms
+enum PhysStat
+{
+	PHYS_STAT_STEP,
+	PHYS_STAT_COLLIDE,
+	PHYS_STAT_SOLVE,
+	PHYS_STAT_SOLVE_TOI,
+	PHYS_STAT_BROADPHASE,
+	PHYS_STAT_BODIES,
+	PHYS_STAT_PROXIES,
+	PHYS_STAT_CONTACTS,
+	PHYS_STAT_TOUCHING,
+	PHYS_STAT_CHAIN_CONTACTS,
+	PHYS_STAT_SENSOR_CONTACTS,
+	PHYS_STAT_TOI_EVENTS,
+	PHYS_STAT_SUBSTEPS,
+	PHYS_STAT_COUNT
+};
 
-class ModulePhysics : public Module, public b2ContactListener
+class ModulePhysics : public Module
 {
 public:
 	ModulePhysics(Application* app, bool start_enabled = true);
@@ -20,26 +43,73 @@ public:
 	update_status PostUpdate();
 	bool CleanUp();
 
-	PhysBody* CreateCircle(int x, int y, int radius, b2BodyType type);
+	PhysBody* CreateCircle(int x, int y, int radius, PhysBodyType type);
 	// Sensor helper for static non-colliding circles (black holes, anchors, letters)
 	PhysBody* CreateCircleSensor(int x, int y, int radius);
-	PhysBody* CreateRectangle(int x, int y, int width, int height, b2BodyType type);
+	PhysBody* CreateRectangle(int x, int y, int width, int height, PhysBodyType type);
 	PhysBody* CreateRectangleSensor(int x, int y, int width, int height);
-	PhysBody* CreateChain(int x, int y, int* points, int point_count, b2BodyType type);
-	PhysBody* CreatePolygonLoop(int x, int y, int* points, int point_count, b2BodyType type, float angle_rad, float restitution = 0.5f);
+	PhysBody* CreateChain(int x, int y, int* points, int point_count, PhysBodyType type);
+	PhysBody* CreatePolygonLoop(int x, int y, int* points, int point_count, PhysBodyType type, float angle_rad, float restitution = 0.5f);
+
+
+	// Returns the revolute joint, 0 on failure
+	PhysHandle CreateFlipper(int x, int y, int width, int height, bool isLeft, PhysBody** flipperBody);
+	void SetMotorSpeed(PhysHandle joint, float speed);
+
+	// Destroys the engine body now and keeps the PhysBody for the next Create call
+	void DestroyBody(PhysBody* pbody);
+	PhysBody* FindBody(uint32 id) const;
+
+	// Body transforms, velocities and flags, and joint motors. Restore only moves the
+	// bodies both sides know; the game brings back the ones it spawns, see ModuleGame
+	void CaptureState(WorldSnapshot& snapshot) const;
+	void RestoreState(const WorldSnapshot& snapshot);
 
+	PhysicsBackend* GetBackend() { return backend; }
+	bool IsDebug() const { return debug; }
 
-	b2RevoluteJoint* CreateFlipper(int x, int y, int width, int height, bool isLeft, PhysBody** flipperBody);
+	// GetPerfTime() of the contact currently being reported to listeners
+	double GetContactTime() const { return contactTime; }
 
-	void BeginContact(b2Contact* contact) override;
-	b2World* GetWorld();
+	// Contacts that began during the last frame, all substeps
+	int GetContactCount() const { return contactCount; }
+
+	// Engine steps the last frame was split into, and their profile summed
+	int GetSubstepCount() const { return substeps; }
+	const PhysStepProfile& GetStepProfile() const { return backend->GetProfile(); }
+
+	// Counts after the last frame's steps
+	const PhysWorldStats& GetWorldStats() const { return worldStats; }
+
+	const RollingHistogram& GetStat(PhysStat stat) const { return stats[stat]; }
+	static const char* GetStatName(PhysStat stat);
+
+	// Whole-run and last-window summary of every stat through LOG
+	void PrintStats() const;
+
+private:
+	PhysBody* NewPhysBody();
+	PhysBody* Attach(PhysBody* pbody, PhysHandle body, int width, int height);
+	int ChooseSubsteps(float dt) const;
+	void DispatchContacts();
+	void CollectStats();
+	void DrawStats() const;
 
 private:
 	bool debug = false;
-	b2World* world = nullptr;
-	b2MouseJoint* mouseJoint = nullptr;
-	b2Body* ground = nullptr;
-	b2Body* mouseBody = nullptr;
+	double contactTime = 0.0;
+	int contactCount = 0;
+	int substeps = 1;
+	PhysicsBackend* backend = nullptr;
+	PhysHandle mouseJoint = 0;
+	PhysHandle mouseBody = 0;
+	PhysHandle ground = 0;
+
+	std::vector<PhysBody*> bodies;			// Every PhysBody with an engine body
+	std::vector<PhysBody*> freeBodies;
+	std::vector<PhysHandle> joints;			// Revolute joints, in creation order
+	uint32 nextBodyId = 1;
 
-	std::vector<PhysBody*> bodiesToDestroy;
+	RollingHistogram stats[PHYS_STAT_COUNT];
+	PhysWorldStats worldStats;
 };
\ No newline at end of file
@@ -22,6 +22,10 @@ public:
 	bool DrawCircle(int x, int y, int radius, Color color) const;
 	bool DrawLine(int x1, int y1, int x2, int y2, Color color) const;
 
+private:
+
+	void DrawDebugOverlay() const;
+
 public:
 
 	Color background;
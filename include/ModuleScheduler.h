@@ -0,0 +1,77 @@
+#pragma once
+
+#include "Globals.h"
+#include "Module.h"
+#include "JobSystem.h"
+
+#include <atomic>
+#include <vector>
+
+#define MAX_SCHEDULED_MODULES	16
+
+// Runs one phase (PreUpdate, Update or PostUpdate) of every enabled module. The task
+// graph is rebuilt from the modules' ModuleAccess declarations every phase: a module
+// waits for every earlier module whose reads or writes overlap its writes, or whose
+// writes overlap its reads. Main-thread phases run on the calling thread in module
+// order, the rest become jobs as soon as their dependencies are done.
+//
+// Without a job system (the default) phases simply run one after another in module
+// order. Enabled with --parallel-modules.
+class ModuleScheduler
+{
+public:
+
+	// Called for every scheduled module, from a job worker if the phase allows it
+	typedef update_status (*TaskFunction)(void* context, int index, ModulePhase phase);
+
+	ModuleScheduler();
+	~ModuleScheduler();
+
+	void Start(JobSystem* jobs);
+	void Stop();
+
+	bool IsParallel() const { return jobs != nullptr && jobs->GetWorkerCount() > 0; }
+
+	// Stops starting new phases once one returns something other than UPDATE_CONTINUE,
+	// like the serial loop did. Doesn't allocate
+	update_status RunPhase(const std::vector<Module*>& modules, ModulePhase phase, TaskFunction function, void* context);
+
+	// Milliseconds the module at index spent in the last RunPhase, 0 if it didn't run
+	float GetTaskMs(int index) const { return (index >= 0 && index < MAX_SCHEDULED_MODULES) ? taskMs[index] : 0.0f; }
+
+	// Phases of the last RunPhase that ran on a worker thread
+	int GetWorkerTasks() const { return workerTasks.load(std::memory_order_relaxed); }
+
+private:
+
+	struct Task
+	{
+		ModuleScheduler* scheduler;
+		int index;						// Position in the module list
+		ModuleAccess access;
+		std::atomic<int> pending;		// Earlier tasks still to finish
+		int dependents[MAX_SCHEDULED_MODULES];
+		int dependentCount;
+	};
+
+	static void TaskJob(void* data);
+
+	void BuildGraph(const std::vector<Module*>& modules, ModulePhase phase);
+	void Execute(Task& task);
+
+private:
+
+	JobSystem* jobs = nullptr;
+	JobFence fence;
+
+	Task tasks[MAX_SCHEDULED_MODULES];
+	int taskCount = 0;
+
+	ModulePhase currentPhase = PHASE_PREUPDATE;
+	TaskFunction function = nullptr;
+	void* context = nullptr;
+	std::atomic<int> result{ UPDATE_CONTINUE };
+
+	float taskMs[MAX_SCHEDULED_MODULES] = {};
+	std::atomic<int> workerTasks{ 0 };
+};
@@ -0,0 +1,140 @@
+#pragma once
+
+#include "Globals.h"
+#include "SpscQueue.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#define MUSIC_DECKS				2		// Outgoing and incoming track during a crossfade
+#define MUSIC_PREFETCH_MS		500
+#define MUSIC_DECODE_CHUNK		1024	// Source frames decoded per refill step
+#define MUSIC_MAX_CHANNELS		8		// Source channels the decode buffer holds, more are refused
+#define MUSIC_MAX_PATH			256
+
+// Who may move a deck out of each state:
+//   worker:       IDLE -> LOADING -> PRIMED,  RELEASED -> IDLE
+//   audio thread: PRIMED -> PLAYING,  PRIMED / PLAYING -> RELEASED
+enum MusicDeckState
+{
+	MUSIC_DECK_IDLE = 0,
+	MUSIC_DECK_LOADING,		// Decoder open, filling the ring for the first time
+	MUSIC_DECK_PRIMED,		// Enough audio buffered to start without an underrun
+	MUSIC_DECK_PLAYING,
+	MUSIC_DECK_RELEASED		// Audio thread is done with it, worker closes the decoder
+};
+
+// Lock-free ring of interleaved stereo float frames, one writer and one reader
+class FrameRing
+{
+public:
+
+	void Allocate(uint32 minFrames);
+
+	uint32 Write(const float* frames, uint32 count);
+	uint32 Read(float* frames, uint32 count);
+
+	uint32 Available() const;
+	uint32 Free() const { return capacity - Available(); }
+	uint32 Capacity() const { return capacity; }
+
+	// Only while the reader is guaranteed not to touch the ring
+	void Reset();
+
+private:
+
+	std::vector<float> data;
+	uint32 capacity = 0;
+	std::atomic<uint32> readPos{ 0 };
+	std::atomic<uint32> writePos{ 0 };
+};
+
+// Decodes music files (wav, ogg, mp3) on a worker thread into per-deck prefetch rings,
+// converted to the mixer format. The mixer reads the rings from the audio thread and
+// owns the crossfade, so neither the game thread nor the audio thread ever waits on file IO
+class MusicStreamer
+{
+public:
+
+	MusicStreamer();
+	~MusicStreamer();
+
+	// Game thread --------
+	// Without a worker thread, Pump() does the decoding on the caller's thread
+	bool Init(int prefetchMs, uint32 outputRate, bool threaded = true);
+	void CleanUp();
+
+	// One worker pass: take new requests, open/close decks and top up every ring
+	void Pump();
+
+	// Queue a file to be opened on a deck once that deck is idle. The token is published
+	// with the deck so the audio thread knows which request it is looking at
+	bool Request(int deck, const char* path, uint32 token);
+
+	// Audio thread --------
+	MusicDeckState GetState(int deck) const { return (MusicDeckState)decks[deck].state.load(std::memory_order_acquire); }
+	void SetState(int deck, MusicDeckState state) { decks[deck].state.store(state, std::memory_order_release); }
+	uint32 Read(int deck, float* frames, uint32 count) { return decks[deck].ring.Read(frames, count); }
+	bool IsEnded(int deck) const { return decks[deck].ended.load(std::memory_order_acquire); }
+	uint32 GetToken(int deck) const { return decks[deck].token.load(std::memory_order_acquire); }
+
+	// Either thread --------
+	uint32 GetBufferedFrames(int deck) const { return decks[deck].ring.Available(); }
+	uint32 GetPrefetchFrames() const { return decks[0].ring.Capacity(); }
+	uint32 GetFailedLoads() const { return failedLoads.load(std::memory_order_relaxed); }
+
+private:
+
+	struct Decoder;
+
+	struct Deck
+	{
+		FrameRing ring;
+		std::atomic<int> state{ MUSIC_DECK_IDLE };
+		std::atomic<bool> ended{ false };
+		std::atomic<uint32> token{ 0 };
+
+		// Worker only
+		Decoder* decoder = nullptr;
+		char pendingPath[MUSIC_MAX_PATH] = {};
+		uint32 pendingToken = 0;
+		double resamplePos = 1.0;
+		float prevFrame[2] = { 0.0f, 0.0f };
+	};
+
+	struct MusicRequest
+	{
+		int deck;
+		uint32 token;
+		char path[MUSIC_MAX_PATH];
+	};
+
+	void WorkerLoop();
+	void UpdateDeck(Deck& deck);
+	bool OpenDeck(Deck& deck);
+	void CloseDeck(Deck& deck);
+	void Refill(Deck& deck);
+
+private:
+
+	Deck decks[MUSIC_DECKS];
+	uint32 outputRate = 0;
+	int refillIntervalMs = 0;
+
+	SpscQueue<MusicRequest, 8> requests;
+
+	std::thread worker;
+	std::mutex wakeMutex;
+	std::condition_variable wake;
+	std::atomic<bool> running{ false };
+	bool threaded = true;
+	std::atomic<uint32> failedLoads{ 0 };
+
+	// Worker scratch, sized at Init
+	std::vector<float> decodeBuffer;
+	std::vector<float> stereoBuffer;
+	std::vector<float> outputBuffer;
+};
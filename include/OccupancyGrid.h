@@ -0,0 +1,58 @@
+#pragma once
+
+#include "Globals.h"
+#include <vector>
+
+class PhysicsBackend;
+struct PhysShapeView;
+
+// Packed bitmap of the screen, one bit per cell, set where static collision
+// geometry (plus a clearance margin) covers the cell centre.
+// Built once at table load so spawns never have to query the physics engine.
+class OccupancyGrid
+{
+public:
+
+	OccupancyGrid();
+
+	// Rasterise every shape of every static body. cellSize and clearance are in pixels
+	void Build(PhysicsBackend* physics, int cellSize, int clearance);
+	void Clear();
+
+	// Register a screen-space region, returns the zone id used by SampleFree()
+	int AddSpawnZone(const Rectangle& region);
+
+	// Pick a random free cell centre inside the zone. Returns false if the zone has no free cell
+	bool SampleFree(int zone, int& x, int& y) const;
+
+	bool IsOccupied(int x, int y) const;
+	int GetFreeCount(int zone) const;
+
+	int GetCols() const { return cols; }
+	int GetRows() const { return rows; }
+
+private:
+
+	void SetCell(int cx, int cy);
+	bool GetCell(int cx, int cy) const;
+
+	void MarkCircle(float x, float y, float radius);
+	void MarkSegment(float x1, float y1, float x2, float y2);
+	void MarkPolygon(const float* xs, const float* ys, int count);
+	static void MarkShape(void* context, const PhysShapeView& shape);
+
+private:
+
+	int cellSize = 0;
+	int clearance = 0;
+	int cols = 0;
+	int rows = 0;
+
+	std::vector<uint64> bits;
+	std::vector<std::vector<int>> zoneFreeCells;
+
+	// Build() scratch
+	int shapeCount = 0;
+	std::vector<float> polygonXs;
+	std::vector<float> polygonYs;
+};
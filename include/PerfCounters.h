@@ -0,0 +1,105 @@
+#pragma once
+
+#include "Globals.h"
+
+#include <thread>
+
+// Hardware counters read around each frame phase, Linux only (perf_event_open).
+// Enabled with --perf-counters; on other platforms, or when the kernel refuses
+// (perf_event_paranoid, containers, VMs without a PMU) every call is a no-op.
+
+enum PerfCounter
+{
+	PERF_CYCLES = 0,
+	PERF_INSTRUCTIONS,
+	PERF_CACHE_MISSES,		// Last level cache, as the kernel's generic event defines it
+	PERF_BRANCH_MISSES,
+	PERF_COUNTER_COUNT
+};
+
+enum PerfSection
+{
+	PERF_SECTION_PREUPDATE = 0,
+	PERF_SECTION_UPDATE,
+	PERF_SECTION_POSTUPDATE,
+	PERF_SECTION_PHYSICS_STEP,		// Nested inside PreUpdate
+	PERF_SECTION_COUNT
+};
+
+struct PerfValues
+{
+	uint64 counts[PERF_COUNTER_COUNT] = {};
+
+	double Ipc() const { return counts[PERF_CYCLES] ? (double)counts[PERF_INSTRUCTIONS] / counts[PERF_CYCLES] : 0.0; }
+	double CacheMissesPerKilo() const { return counts[PERF_INSTRUCTIONS] ? 1000.0 * counts[PERF_CACHE_MISSES] / counts[PERF_INSTRUCTIONS] : 0.0; }
+	double BranchMissesPerKilo() const { return counts[PERF_INSTRUCTIONS] ? 1000.0 * counts[PERF_BRANCH_MISSES] / counts[PERF_INSTRUCTIONS] : 0.0; }
+};
+
+class PerfCounters
+{
+public:
+
+	PerfCounters();
+	~PerfCounters();
+
+	// Opens one counter group for the calling thread, the only one whose sections are
+	// counted. Returns false if nothing could be opened
+	bool Open();
+	void Close();
+
+	bool IsOpen() const { return leader >= 0; }
+	bool HasCounter(int counter) const { return fds[counter] >= 0; }
+
+	void Begin(int section);
+	void End(int section);
+
+	// Publishes the frame that just finished and starts a new one
+	void EndFrame();
+
+	const PerfValues& GetLastFrame(int section) const { return lastFrame[section]; }
+	PerfValues GetAverage(int section) const;
+	uint32 GetFrames() const { return frames; }
+
+	// Per-frame averages of every section through LOG, for benchmark runs
+	void PrintReport() const;
+
+private:
+
+	bool Read(uint64* values);
+
+private:
+
+	int fds[PERF_COUNTER_COUNT];
+	int slot[PERF_COUNTER_COUNT];		// Position of each counter in the group read
+	int leader = -1;
+	int groupSize = 0;
+	std::thread::id owner;
+
+	uint64 startValues[PERF_SECTION_COUNT][PERF_COUNTER_COUNT];
+	PerfValues current[PERF_SECTION_COUNT];
+	PerfValues lastFrame[PERF_SECTION_COUNT];
+	PerfValues total[PERF_SECTION_COUNT];
+	uint32 frames = 0;
+};
+
+// Counts a section for as long as it is in scope
+class PerfScope
+{
+public:
+
+	PerfScope(PerfCounters* counters, int section) : counters(counters), section(section)
+	{
+		if (counters != nullptr && counters->IsOpen()) counters->Begin(section);
+		else this->counters = nullptr;
+	}
+
+	~PerfScope()
+	{
+		if (counters != nullptr) counters->End(section);
+	}
+
+private:
+
+	PerfCounters* counters;
+	int section;
+};
@@ -1,6 +1,6 @@
 #pragma once
 
-#include "box2d/box2d.h"
+#include "PhysicsBackend.h"
 
 class PhysBody
 {
@@ -12,8 +12,25 @@ public:
 	float GetRotation() const;
 	bool Contains(int x, int y) const;
 	int RayCast(int x1, int y1, int x2, int y2, float& normal_x, float& normal_y) const;
+
+	// Straight to the backend, in meters and radians
+	vec2f GetPosition() const { return backend->GetPosition(body); }
+	float GetAngle() const { return backend->GetAngle(body); }
+	void SetTransform(vec2f position, float angle) { backend->SetTransform(body, position, angle); }
+	vec2f GetLinearVelocity() const { return backend->GetLinearVelocity(body); }
+	void SetLinearVelocity(vec2f velocity) { backend->SetLinearVelocity(body, velocity); }
+	void SetAngularVelocity(float velocity) { backend->SetAngularVelocity(body, velocity); }
+	void ApplyLinearImpulseToCenter(vec2f impulse) { backend->ApplyLinearImpulse(body, impulse); }
+	void ApplyForceToCenter(vec2f force) { backend->ApplyForce(body, force); }
+	float GetMass() const { return backend->GetMass(body); }
+	void SetEnabled(bool enabled) { backend->SetEnabled(body, enabled); }
+	void SetLinearDamping(float damping) { backend->SetLinearDamping(body, damping); }
+	void SetRestitution(float restitution) { backend->SetRestitution(body, restitution); }
+	void SetSensor(bool sensor) { backend->SetSensor(body, sensor); }
 	
 	int width, height;
-	b2Body* body = nullptr;
+	uint32 id = 0;			// Unique for the run, table bodies get the same ones every run
+	PhysHandle body = 0;
+	PhysicsBackend* backend = nullptr;
 	void* listener = nullptr; // Module that will listen to collisions
 };
@@ -0,0 +1,202 @@
+#pragma once
+
+#include "Globals.h"
+#include "p2Point.h"
+
+// Everything ModulePhysics needs from a physics engine, so the engine is a build
+// choice (premake5 --physics=box2d|box2d3) instead of something gameplay code
+// includes. No engine header is visible from here.
+//
+// Units are the engine's: meters, y up, radians. Bodies and joints are opaque
+// handles, 0 is none. Each body carries a user pointer (the PhysBody) that queries,
+// contacts and shape views hand back.
+
+class PhysBody;
+class JobSystem;
+
+typedef uint64 PhysHandle;
+
+enum PhysBodyType
+{
+	PHYS_BODY_STATIC,
+	PHYS_BODY_KINEMATIC,
+	PHYS_BODY_DYNAMIC
+};
+
+enum PhysShapeKind
+{
+	PHYS_SHAPE_CIRCLE,
+	PHYS_SHAPE_POLYGON,		// Convex, closed
+	PHYS_SHAPE_CHAIN		// Open polyline of thin edges, loops repeat their first vertex
+};
+
+struct PhysBodyDef
+{
+	PhysBodyType type = PHYS_BODY_STATIC;
+	vec2f position = vec2f(0.0f, 0.0f);
+	float angle = 0.0f;
+	bool bullet = false;			// Continuous collision against dynamic bodies too
+	PhysBody* user = nullptr;
+};
+
+struct PhysMaterial
+{
+	float density = 1.0f;
+	float friction = 0.3f;
+	float restitution = 0.0f;
+	bool sensor = false;
+};
+
+struct PhysRevoluteDef
+{
+	PhysHandle bodyA = 0;
+	PhysHandle bodyB = 0;
+	vec2f anchorA = vec2f(0.0f, 0.0f);		// Local to each body
+	vec2f anchorB = vec2f(0.0f, 0.0f);
+	bool enableLimit = false;
+	float lowerAngle = 0.0f;
+	float upperAngle = 0.0f;
+	bool enableMotor = false;
+	float maxMotorTorque = 0.0f;
+	float motorSpeed = 0.0f;
+};
+
+// A contact that began during the last Step(). time is GetPerfTime() when the
+// engine found it, or the end of the step for engines that report afterwards
+struct PhysContactEvent
+{
+	PhysBody* a;
+	PhysBody* b;
+	double time;
+};
+
+// What a query found. Reported once per shape, so a chain reports every edge near the box
+struct PhysQueryHit
+{
+	PhysBody* body;
+	PhysShapeKind shape;
+	PhysBodyType type;
+	bool sensor;
+	bool bullet;
+};
+
+// Return false to stop the query
+typedef bool (*PhysQueryFunction)(void* context, const PhysQueryHit& hit);
+
+// One shape in world space. vertices is only valid during the callback
+struct PhysShapeView
+{
+	PhysShapeKind kind;
+	PhysBodyType type;
+	bool sensor;
+	PhysBody* body;
+
+	vec2f center;				// Circles
+	float radius;
+
+	const vec2f* vertices;		// Polygons and chains
+	int count;
+};
+
+typedef void (*PhysShapeFunction)(void* context, const PhysShapeView& shape);
+
+// Summed over the Step() calls since the last ResetProfile(). Times in ms
+struct PhysStepProfile
+{
+	float step = 0.0f;
+	float collide = 0.0f;
+	float solve = 0.0f;
+	float solveTOI = 0.0f;
+	float broadphase = 0.0f;
+};
+
+// World counts after the last step. Engines that can't count something leave it at 0
+struct PhysWorldStats
+{
+	int bodies = 0;
+	int proxies = 0;
+	int contacts = 0;
+	int touching = 0;
+	int chainContacts = 0;
+	int sensorContacts = 0;
+	int toiEvents = 0;			// Since the previous GetStats()
+
+	// Broad-phase proxies by the kind of shape that owns them
+	int chainProxies = 0;
+	int sensorProxies = 0;
+	int otherProxies = 0;
+};
+
+class PhysicsBackend
+{
+public:
+
+	virtual ~PhysicsBackend() {}
+
+	virtual const char* GetName() const = 0;
+
+	virtual bool CreateWorld(vec2f gravity) = 0;
+	virtual void DestroyWorld() = 0;
+	virtual bool HasWorld() const = 0;
+
+	// Forces from ApplyForce() act on every Step() until ClearForces(), so a frame
+	// split into substeps pushes as hard as a single step
+	virtual void Step(float dt) = 0;
+	virtual void ClearForces() = 0;
+
+	// Begin-contact events of the last Step(), valid until the next one
+	virtual int GetContactEvents(const PhysContactEvent** events) const = 0;
+
+	virtual void ResetProfile() = 0;
+	virtual const PhysStepProfile& GetProfile() const = 0;
+	virtual void GetStats(PhysWorldStats& stats) = 0;
+
+	// Bodies with one shape each, except chains: both windings, so they collide from either side
+	virtual PhysHandle CreateCircle(const PhysBodyDef& def, float radius, const PhysMaterial& material) = 0;
+	virtual PhysHandle CreateBox(const PhysBodyDef& def, float halfWidth, float halfHeight, vec2f center, const PhysMaterial& material) = 0;
+	virtual PhysHandle CreateChain(const PhysBodyDef& def, const vec2f* points, int count, bool loop, const PhysMaterial& material) = 0;
+	virtual void DestroyBody(PhysHandle body) = 0;
+
+	virtual vec2f GetPosition(PhysHandle body) const = 0;
+	virtual float GetAngle(PhysHandle body) const = 0;
+	virtual void SetTransform(PhysHandle body, vec2f position, float angle) = 0;
+	virtual vec2f GetLinearVelocity(PhysHandle body) const = 0;
+	virtual void SetLinearVelocity(PhysHandle body, vec2f velocity) = 0;
+	virtual float GetAngularVelocity(PhysHandle body) const = 0;
+	virtual void SetAngularVelocity(PhysHandle body, float velocity) = 0;
+	virtual void ApplyLinearImpulse(PhysHandle body, vec2f impulse) = 0;
+	virtual void ApplyForce(PhysHandle body, vec2f force) = 0;
+	virtual float GetMass(PhysHandle body) const = 0;
+	virtual PhysBodyType GetType(PhysHandle body) const = 0;
+	virtual bool IsBullet(PhysHandle body) const = 0;
+	virtual bool IsEnabled(PhysHandle body) const = 0;
+	virtual void SetEnabled(PhysHandle body, bool enabled) = 0;
+	virtual bool IsAwake(PhysHandle body) const = 0;
+	virtual void SetAwake(PhysHandle body, bool awake) = 0;
+	virtual void SetLinearDamping(PhysHandle body, float damping) = 0;
+	virtual void SetRestitution(PhysHandle body, float restitution) = 0;
+	virtual void SetSensor(PhysHandle body, bool sensor) = 0;
+	virtual float GetRadius(PhysHandle body) const = 0;		// First circle shape, 0 without one
+
+	virtual bool TestPoint(PhysHandle body, vec2f point) const = 0;
+	// First shape of the body the ray p1-p2 hits: fraction along it and the surface normal
+	virtual bool RayCast(PhysHandle body, vec2f p1, vec2f p2, float& fraction, vec2f& normal) const = 0;
+
+	virtual PhysHandle CreateRevoluteJoint(const PhysRevoluteDef& def) = 0;
+	virtual float GetJointAngle(PhysHandle joint) const = 0;
+	virtual float GetMotorSpeed(PhysHandle joint) const = 0;
+	virtual void SetMotorSpeed(PhysHandle joint, float speed) = 0;
+	// Drags body towards a target on a soft spring, for the debug mouse
+	virtual PhysHandle CreateMouseJoint(PhysHandle ground, PhysHandle body, vec2f target, float maxForce) = 0;
+	virtual void SetMouseTarget(PhysHandle joint, vec2f target) = 0;
+	virtual void DestroyJoint(PhysHandle joint) = 0;
+
+	virtual void QueryAABB(vec2f lower, vec2f upper, PhysQueryFunction function, void* context) const = 0;
+
+	// Every shape, or only those of static bodies
+	virtual void VisitShapes(bool staticOnly, PhysShapeFunction function, void* context) const = 0;
+};
+
+// Defined by the backend compiled in. jobs may be null; engines with their own task
+// system use it to spread a step over the job workers
+PhysicsBackend* CreatePhysicsBackend(JobSystem* jobs);
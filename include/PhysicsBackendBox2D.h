@@ -0,0 +1,85 @@
+#pragma once
+
+#include "PhysicsBackend.h"
+#include "box2d/box2d.h"
+#include <vector>
+
+// Box2D 2.4: handles are the b2Body* / b2Joint* themselves, the user pointer
+// lives in the body's user data. Contacts are recorded from the listener as
+// the step finds them
+class PhysicsBackendBox2D : public PhysicsBackend, public b2ContactListener
+{
+public:
+
+	PhysicsBackendBox2D();
+	~PhysicsBackendBox2D();
+
+	const char* GetName() const override { return "Box2D 2.4"; }
+
+	bool CreateWorld(vec2f gravity) override;
+	void DestroyWorld() override;
+	bool HasWorld() const override { return world != nullptr; }
+
+	void Step(float dt) override;
+	void ClearForces() override;
+	int GetContactEvents(const PhysContactEvent** events) const override;
+
+	void ResetProfile() override;
+	const PhysStepProfile& GetProfile() const override { return profile; }
+	void GetStats(PhysWorldStats& stats) override;
+
+	PhysHandle CreateCircle(const PhysBodyDef& def, float radius, const PhysMaterial& material) override;
+	PhysHandle CreateBox(const PhysBodyDef& def, float halfWidth, float halfHeight, vec2f center, const PhysMaterial& material) override;
+	PhysHandle CreateChain(const PhysBodyDef& def, const vec2f* points, int count, bool loop, const PhysMaterial& material) override;
+	void DestroyBody(PhysHandle body) override;
+
+	vec2f GetPosition(PhysHandle body) const override;
+	float GetAngle(PhysHandle body) const override;
+	void SetTransform(PhysHandle body, vec2f position, float angle) override;
+	vec2f GetLinearVelocity(PhysHandle body) const override;
+	void SetLinearVelocity(PhysHandle body, vec2f velocity) override;
+	float GetAngularVelocity(PhysHandle body) const override;
+	void SetAngularVelocity(PhysHandle body, float velocity) override;
+	void ApplyLinearImpulse(PhysHandle body, vec2f impulse) override;
+	void ApplyForce(PhysHandle body, vec2f force) override;
+	float GetMass(PhysHandle body) const override;
+	PhysBodyType GetType(PhysHandle body) const override;
+	bool IsBullet(PhysHandle body) const override;
+	bool IsEnabled(PhysHandle body) const override;
+	void SetEnabled(PhysHandle body, bool enabled) override;
+	bool IsAwake(PhysHandle body) const override;
+	void SetAwake(PhysHandle body, bool awake) override;
+	void SetLinearDamping(PhysHandle body, float damping) override;
+	void SetRestitution(PhysHandle body, float restitution) override;
+	void SetSensor(PhysHandle body, bool sensor) override;
+	float GetRadius(PhysHandle body) const override;
+
+	bool TestPoint(PhysHandle body, vec2f point) const override;
+	bool RayCast(PhysHandle body, vec2f p1, vec2f p2, float& fraction, vec2f& normal) const override;
+
+	PhysHandle CreateRevoluteJoint(const PhysRevoluteDef& def) override;
+	float GetJointAngle(PhysHandle joint) const override;
+	float GetMotorSpeed(PhysHandle joint) const override;
+	void SetMotorSpeed(PhysHandle joint, float speed) override;
+	PhysHandle CreateMouseJoint(PhysHandle ground, PhysHandle body, vec2f target, float maxForce) override;
+	void SetMouseTarget(PhysHandle joint, vec2f target) override;
+	void DestroyJoint(PhysHandle joint) override;
+
+	void QueryAABB(vec2f lower, vec2f upper, PhysQueryFunction function, void* context) const override;
+	void VisitShapes(bool staticOnly, PhysShapeFunction function, void* context) const override;
+
+	void BeginContact(b2Contact* contact) override;
+
+private:
+
+	b2Body* CreateBody(const PhysBodyDef& def);
+
+private:
+
+	b2World* world = nullptr;
+	std::vector<PhysContactEvent> contacts;
+	PhysStepProfile profile;
+	int lastToiCalls = 0;
+
+	mutable std::vector<vec2f> shapeVertices;		// Scratch for VisitShapes
+};
@@ -0,0 +1,131 @@
+#pragma once
+
+#include "PhysicsBackend.h"
+#include "JobSystem.h"
+#include "box2d/box2d.h"
+#include <vector>
+
+#define BOX2D3_MAX_TASKS		128		// Per step. More than that run inline
+#define BOX2D3_SUBSTEPS			4		// Solver substeps inside every Step()
+
+// Box2D 3.x: handles are the stored b2BodyId / b2JointId. The world can't list its
+// bodies, so the backend keeps them for the shape walk and the stats. Chains are
+// two-sided segments, and events are read back after every step.
+//
+// With a JobSystem the solver runs on it: each Box2D task is cut into up to
+// workers + 1 batches, one job each, and the batch number is Box2D's worker index
+class PhysicsBackendBox2D3 : public PhysicsBackend
+{
+public:
+
+	PhysicsBackendBox2D3(JobSystem* jobs);
+	~PhysicsBackendBox2D3();
+
+	const char* GetName() const override { return "Box2D 3"; }
+
+	bool CreateWorld(vec2f gravity) override;
+	void DestroyWorld() override;
+	bool HasWorld() const override { return B2_IS_NON_NULL(world); }
+
+	void Step(float dt) override;
+	void ClearForces() override;
+	int GetContactEvents(const PhysContactEvent** events) const override;
+
+	void ResetProfile() override;
+	const PhysStepProfile& GetProfile() const override { return profile; }
+	void GetStats(PhysWorldStats& stats) override;
+
+	PhysHandle CreateCircle(const PhysBodyDef& def, float radius, const PhysMaterial& material) override;
+	PhysHandle CreateBox(const PhysBodyDef& def, float halfWidth, float halfHeight, vec2f center, const PhysMaterial& material) override;
+	PhysHandle CreateChain(const PhysBodyDef& def, const vec2f* points, int count, bool loop, const PhysMaterial& material) override;
+	void DestroyBody(PhysHandle body) override;
+
+	vec2f GetPosition(PhysHandle body) const override;
+	float GetAngle(PhysHandle body) const override;
+	void SetTransform(PhysHandle body, vec2f position, float angle) override;
+	vec2f GetLinearVelocity(PhysHandle body) const override;
+	void SetLinearVelocity(PhysHandle body, vec2f velocity) override;
+	float GetAngularVelocity(PhysHandle body) const override;
+	void SetAngularVelocity(PhysHandle body, float velocity) override;
+	void ApplyLinearImpulse(PhysHandle body, vec2f impulse) override;
+	void ApplyForce(PhysHandle body, vec2f force) override;
+	float GetMass(PhysHandle body) const override;
+	PhysBodyType GetType(PhysHandle body) const override;
+	bool IsBullet(PhysHandle body) const override;
+	bool IsEnabled(PhysHandle body) const override;
+	void SetEnabled(PhysHandle body, bool enabled) override;
+	bool IsAwake(PhysHandle body) const override;
+	void SetAwake(PhysHandle body, bool awake) override;
+	void SetLinearDamping(PhysHandle body, float damping) override;
+	void SetRestitution(PhysHandle body, float restitution) override;
+	void SetSensor(PhysHandle body, bool sensor) override;
+	float GetRadius(PhysHandle body) const override;
+
+	bool TestPoint(PhysHandle body, vec2f point) const override;
+	bool RayCast(PhysHandle body, vec2f p1, vec2f p2, float& fraction, vec2f& normal) const override;
+
+	PhysHandle CreateRevoluteJoint(const PhysRevoluteDef& def) override;
+	float GetJointAngle(PhysHandle joint) const override;
+	float GetMotorSpeed(PhysHandle joint) const override;
+	void SetMotorSpeed(PhysHandle joint, float speed) override;
+	PhysHandle CreateMouseJoint(PhysHandle ground, PhysHandle body, vec2f target, float maxForce) override;
+	void SetMouseTarget(PhysHandle joint, vec2f target) override;
+	void DestroyJoint(PhysHandle joint) override;
+
+	void QueryAABB(vec2f lower, vec2f upper, PhysQueryFunction function, void* context) const override;
+	void VisitShapes(bool staticOnly, PhysShapeFunction function, void* context) const override;
+
+private:
+
+	struct Task;
+	struct TaskBatch
+	{
+		Task* task;
+		int begin;
+		int end;
+		uint32_t worker;
+	};
+
+	struct Task
+	{
+		b2TaskCallback* callback;
+		void* context;
+		JobFence fence;
+		TaskBatch batches[MAX_JOB_WORKERS + 1];
+	};
+
+	static void* EnqueueTask(b2TaskCallback* callback, int itemCount, int minRange, void* taskContext, void* userContext);
+	static void FinishTask(void* userTask, void* userContext);
+	static void RunBatch(void* data);
+
+	b2BodyId CreateBody(const PhysBodyDef& def);
+	int GetShapes(PhysHandle body) const;
+	void ReadEvents();
+
+private:
+
+	JobSystem* jobs = nullptr;
+	b2WorldId world = b2_nullWorldId;
+
+	std::vector<b2BodyId> bodies;
+	std::vector<PhysContactEvent> contacts;
+
+	// b2World_Step always clears forces, so ApplyForce() keeps them here and Step()
+	// applies them again until ClearForces()
+	struct HeldForce
+	{
+		b2BodyId body;
+		b2Vec2 force;
+	};
+	std::vector<HeldForce> forces;
+	PhysStepProfile profile;
+
+	Task tasks[BOX2D3_MAX_TASKS];
+	int taskCount = 0;				// Reset every Step()
+	int workerCount = 1;
+
+	// Scratch for the shape and contact walks
+	mutable std::vector<b2ShapeId> shapes;
+	mutable std::vector<vec2f> shapeVertices;
+	std::vector<b2ContactData> contactData;
+};
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "Globals.h"
+#include "GameState.h"
+#include "raylib.h"
+
+#define SNAPSHOT_MAX_BODIES		256		// All kinds together, more than any table has
+#define SNAPSHOT_MAX_LETTERS	8
+
+// Drawable bodies by kind. Each kind is one run of the transform arrays, in the
+// order ModuleGame keeps them, so indices still match the TMX lists
+enum SnapshotKind
+{
+	SNAPSHOT_BALL,
+	SNAPSHOT_LEFT_FLIPPER,
+	SNAPSHOT_RIGHT_FLIPPER,
+	SNAPSHOT_BALL_LOSS_SENSOR,
+	SNAPSHOT_BUMPERS,
+	SNAPSHOT_BLACK_HOLES,
+	SNAPSHOT_SPECIAL_POLYGONS,
+	SNAPSHOT_FLIPPER_BASES,
+	SNAPSHOT_STAR_LETTERS,
+	SNAPSHOT_KIND_COUNT
+};
+
+// Body transforms as arrays rather than structs, read once from Box2D per step, so
+// drawing walks packed floats and never touches a b2Body. Positions are screen
+// pixels, angles Box2D radians. A missing body keeps its slot, inactive
+struct SnapshotTransforms
+{
+	float x[SNAPSHOT_MAX_BODIES];
+	float y[SNAPSHOT_MAX_BODIES];
+	float angle[SNAPSHOT_MAX_BODIES];
+	float width[SNAPSHOT_MAX_BODIES];
+	float height[SNAPSHOT_MAX_BODIES];
+	bool active[SNAPSHOT_MAX_BODIES];
+
+	int first[SNAPSHOT_KIND_COUNT] = {};
+	int count[SNAPSHOT_KIND_COUNT] = {};
+	int size = 0;
+
+	// Slot of a one-body kind (the ball, a flipper), -1 when it's missing
+	int Find(int kind) const { return (count[kind] > 0 && active[first[kind]]) ? first[kind] : -1; }
+};
+
+// Everything ModuleGame draws, copied out of the world and the game state once the
+// frame has simulated. Drawing reads nothing else that simulation writes, so with
+// --pipelined it can draw one frame while the next one steps on a worker
+struct RenderSnapshot
+{
+	GameData game = {};
+
+	bool comboCompleteEffect = false;
+	float comboCompleteTimer = 0.0f;
+	int comboCompleteFlashCount = 0;
+	Color comboCompleteFlashColor = YELLOW;
+
+	bool scoreFlashActive = false;
+	float scoreFlashTimer = 0.0f;
+	int lastScoreIncrease = 0;
+
+	bool charging = false;
+	float chargePercent = 0.0f;
+
+	bool showDebug = false;
+	bool showAudioSettings = false;
+	bool settingsSavedMessage = false;
+	float masterVolume = 0.0f;
+	float musicVolume = 0.0f;
+	float sfxVolume = 0.0f;
+
+	SnapshotTransforms bodies;
+	char letters[SNAPSHOT_MAX_LETTERS] = {};		// One per SNAPSHOT_STAR_LETTERS body
+};
+
+// Simulation fills the back snapshot while the front one is drawn. Frames are joined
+// before Swap(), so two are enough and neither side ever waits on the other
+class RenderSnapshotBuffer
+{
+public:
+
+	RenderSnapshot& GetBack() { return snapshots[1 - front]; }
+	const RenderSnapshot& GetFront() const { return snapshots[front]; }
+
+	void Swap() { front = 1 - front; }
+
+private:
+
+	RenderSnapshot snapshots[2];
+	int front = 0;
+};
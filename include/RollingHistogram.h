@@ -0,0 +1,54 @@
+#pragma once
+
+#include "Globals.h"
+
+#define ROLLING_WINDOW		600		// Samples, about 10 s of physics steps
+#define ROLLING_MAX_BINS	128
+
+// Histogram over the last ROLLING_WINDOW samples, plus whole-run mean and peak.
+// Fixed storage and O(1) Add(), so it can be fed every step
+class RollingHistogram
+{
+public:
+
+	RollingHistogram(float binWidth = 1.0f, int binCount = ROLLING_MAX_BINS);
+
+	void Add(float value);
+	void Reset();
+
+	uint32 GetCount() const { return count; }
+	float GetLast() const { return count > 0 ? samples[(next + ROLLING_WINDOW - 1) % ROLLING_WINDOW] : 0.0f; }
+	float GetMean() const { return count > 0 ? (float)(windowSum / count) : 0.0f; }
+	float GetMax() const;
+
+	// Upper edge of the bin holding the given fraction (0 - 1) of the window
+	float GetPercentile(float fraction) const;
+
+	float GetRunMean() const { return runCount > 0 ? (float)(runSum / runCount) : 0.0f; }
+	float GetRunMax() const { return runMax; }
+	uint64 GetRunCount() const { return runCount; }
+
+	int GetBinCount() const { return binCount; }
+	float GetBinWidth() const { return binWidth; }
+	uint32 GetBin(int bin) const { return bins[bin]; }
+	uint32 GetLargestBin() const;
+
+private:
+
+	int BinOf(float value) const;
+
+private:
+
+	float binWidth;
+	int binCount;
+
+	float samples[ROLLING_WINDOW];
+	uint32 bins[ROLLING_MAX_BINS];
+	uint32 next = 0;
+	uint32 count = 0;
+	double windowSum = 0.0;
+
+	double runSum = 0.0;
+	uint64 runCount = 0;
+	float runMax = 0.0f;
+};
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "Globals.h"
+#include "raylib.h"
+
+#define SYNTH_SAMPLE_RATE		44100
+#define SYNTH_MAX_PARTIALS		4
+#define SYNTH_MAX_NOTES			8
+
+enum SynthWave
+{
+	SYNTH_SINE = 0,
+	SYNTH_TRIANGLE,
+	SYNTH_SQUARE,
+	SYNTH_SAW
+};
+
+// Every effect the game plays, generated at startup instead of loaded from WAVs
+enum SfxId
+{
+	SFX_FLIPPER = 0,
+	SFX_BUMPER,
+	SFX_BALL_LOST,
+	SFX_BONUS,
+	SFX_COMBO_COMPLETE,
+	SFX_LAUNCH,
+	SFX_TARGET,
+	SFX_SPECIAL,
+	SFX_LETTER,
+	SFX_COUNT
+};
+
+struct SynthPartial
+{
+	float ratio;		// Multiple of the note frequency, 0 ends the list
+	float gain;
+};
+
+// Compact description of one effect: an oscillator with a pitch sweep, a few partials,
+// an optional arpeggio and a noise burst, all under an exponential decay
+struct SfxPatch
+{
+	const char* name;
+	SynthWave wave;
+	float frequency;		// Hz at the start of the first note
+	float sweep;			// Frequency multiplier reached by the end, 1 for a steady pitch
+	float duration;			// Seconds
+	float attack;			// Seconds
+	float decay;			// Exponential decay rate per second, restarted on every note
+	SynthPartial partials[SYNTH_MAX_PARTIALS];
+	float noise;			// 0 - 1 noise level, for clicks and thumps
+	float noiseDecay;		// Per second, usually much faster than the tone
+	int noteCount;			// Arpeggio steps, 0 or 1 for a single note
+	float notes[SYNTH_MAX_NOTES];	// Semitones above frequency
+	float noteLength;		// Seconds per arpeggio step
+	float volume;			// Peak level after normalisation
+};
+
+const SfxPatch& GetSfxPatch(int id);
+
+// Same patch with its timbre nudged: detuned partials, brightness, decay and pitch.
+// The seed picks the variation, so the same object always sounds the same
+SfxPatch VarySfxPatch(const SfxPatch& patch, uint32 seed, float amount);
+
+// Render a patch into a mono 32-bit float wave at SYNTH_SAMPLE_RATE.
+// The wave owns RL_MALLOC memory, release it with UnloadWave
+Wave SynthesizeSfx(const SfxPatch& patch, uint32 seed);
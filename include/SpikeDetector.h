@@ -0,0 +1,102 @@
+#pragma once
+
+#include "Globals.h"
+
+// Keeps a timeline of the last frames (time per module phase, physics step, contacts,
+// allocations). When a frame goes over budget, the spike frame and the frames before it
+// are written to spike_<frame>.txt, with the section that grew the most over its
+// median named as the likely cause. Enabled with --spike-budget [ms]. Game thread only.
+
+#define SPIKE_HISTORY_FRAMES		128		// Medians come from this many frames, a power of two
+#define SPIKE_CONTEXT_FRAMES		6		// Frames before the spike included in a report
+#define SPIKE_MAX_SECTIONS			24
+#define SPIKE_WARMUP_FRAMES			30		// Loading frames are never reported
+#define SPIKE_COOLDOWN_FRAMES		30		// One report per burst of slow frames
+#define SPIKE_MAX_REPORTS			50
+#define SPIKE_DEFAULT_BUDGET_MS		33.3f
+
+enum SpikeFixedSection
+{
+	SPIKE_SECTION_PHYSICS_STEP = 0,		// Nested in the physics PreUpdate
+	SPIKE_SECTION_EVENTS,
+	SPIKE_SECTION_UNTRACKED,			// Frame time no section accounts for (main loop, OS)
+	SPIKE_FIXED_SECTIONS
+};
+
+struct SpikeFrame
+{
+	uint32 frame = 0;
+	float totalMs = 0.0f;
+	float sectionMs[SPIKE_MAX_SECTIONS] = {};
+	int contacts = 0;
+	uint32 allocations = 0;
+	uint32 allocatedBytes = 0;
+};
+
+class SpikeDetector
+{
+public:
+
+	SpikeDetector();
+
+	void Enable(float budgetMs);
+	bool IsEnabled() const { return enabled; }
+	float GetBudget() const { return budgetMs; }
+
+	// Nested sections are already counted inside another one. Returns -1 when full
+	int AddSection(const char* name, bool nested = false);
+
+	// A frame lasts until the next BeginFrame, so the previous one is judged here and
+	// reported if it went over budget. Returns true when it did
+	bool BeginFrame(uint32 frame);
+	void AddTime(int section, float ms);
+	void SetContacts(int count) { current.contacts = count; }
+	void SetAllocations(uint32 count, uint64 bytes) { current.allocations = count; current.allocatedBytes = (uint32)bytes; }
+
+	uint32 GetSpikes() const { return spikes; }
+	uint32 GetReports() const { return reports; }
+	const SpikeFrame& GetLastSpike() const { return lastSpike; }
+	int GetLastCause() const { return lastCause; }
+	const char* GetSectionName(int section) const { return (section >= 0 && section < sectionCount) ? names[section] : ""; }
+
+private:
+
+	float Median(int section) const;
+	bool CloseFrame(double now);
+	void WriteReport(const SpikeFrame& spike, int cause, const float* typical);
+
+private:
+
+	bool enabled = false;
+	float budgetMs = SPIKE_DEFAULT_BUDGET_MS;
+
+	char names[SPIKE_MAX_SECTIONS][32];
+	bool nested[SPIKE_MAX_SECTIONS];
+	int sectionCount = 0;
+
+	SpikeFrame history[SPIKE_HISTORY_FRAMES];
+	uint32 recorded = 0;
+	SpikeFrame current;
+	double frameStart = 0.0;
+
+	uint32 spikes = 0;
+	uint32 reports = 0;
+	uint32 lastReportFrame = 0;
+	SpikeFrame lastSpike;
+	int lastCause = -1;
+};
+
+// Adds the time spent in scope to a section
+class SpikeScope
+{
+public:
+
+	SpikeScope(SpikeDetector* detector, int section);
+	~SpikeScope();
+
+private:
+
+	SpikeDetector* detector;
+	int section;
+	double start;
+};
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <atomic>
+
+// Bounded lock-free queue for exactly one producer thread and one consumer thread.
+// Capacity must be a power of two. Push/Pop never block or allocate
+template<typename T, int Capacity>
+class SpscQueue
+{
+	static_assert((Capacity & (Capacity - 1)) == 0, "SpscQueue capacity must be a power of two");
+
+public:
+
+	// Producer side. Returns false if the queue is full
+	bool Push(const T& item)
+	{
+		unsigned int tail = this->tail.load(std::memory_order_relaxed);
+		if (tail - head.load(std::memory_order_acquire) >= (unsigned int)Capacity)
+			return false;
+
+		items[tail & (Capacity - 1)] = item;
+		this->tail.store(tail + 1, std::memory_order_release);
+		return true;
+	}
+
+	// Consumer side. Returns false if the queue is empty
+	bool Pop(T& item)
+	{
+		unsigned int head = this->head.load(std::memory_order_relaxed);
+		if (head == tail.load(std::memory_order_acquire))
+			return false;
+
+		item = items[head & (Capacity - 1)];
+		this->head.store(head + 1, std::memory_order_release);
+		return true;
+	}
+
+	// Approximate when called from either side while the other one is running
+	int Size() const
+	{
+		return (int)(tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire));
+	}
+
+private:
+
+	T items[Capacity];
+
+	// Kept on separate cache lines so producer and consumer don't false-share
+	alignas(64) std::atomic<unsigned int> head{ 0 };
+	alignas(64) std::atomic<unsigned int> tail{ 0 };
+};
@@ -17,4 +17,7 @@ private:
 
     // Start time in seconds
 	double started_at;   
-};
\ No newline at end of file
+};
+
+// Monotonic high resolution clock in seconds, safe to call from any thread
+double GetPerfTime();
\ No newline at end of file
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "Globals.h"
+
+// Scoped trace events, written to per-thread rings and exported as Chrome trace-event
+// JSON (chrome://tracing, ui.perfetto.dev). Build with PINBALL_TRACE defined
+// (premake5 --trace) to enable them; otherwise every macro expands to nothing.
+//
+// Names and categories must be string literals or otherwise outlive the next flush.
+
+#define TRACE_EVENTS_PER_THREAD		(1 << 16)	// Ring size, the oldest events are overwritten
+#define TRACE_MAX_THREADS			16
+
+#ifdef PINBALL_TRACE
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+
+#define TRACE_SCOPE(name)					TraceScope TRACE_CONCAT(traceScope, __LINE__)(name, "game")
+#define TRACE_SCOPE_CAT(name, category)		TraceScope TRACE_CONCAT(traceScope, __LINE__)(name, category)
+#define TRACE_INSTANT(name)					Trace::Instant(name, "game")
+#define TRACE_COUNTER(name, value)			Trace::Counter(name, (double)(value))
+#define TRACE_THREAD_NAME(name)				Trace::SetThreadName(name)
+#define TRACE_FLUSH(path)					Trace::Flush(path)
+
+#else
+
+#define TRACE_SCOPE(name)					((void)0)
+#define TRACE_SCOPE_CAT(name, category)		((void)0)
+#define TRACE_INSTANT(name)					((void)0)
+#define TRACE_COUNTER(name, value)			((void)0)
+#define TRACE_THREAD_NAME(name)				((void)0)
+#define TRACE_FLUSH(path)					((void)0)
+
+#endif
+
+namespace Trace
+{
+	// Nanoseconds on the trace clock
+	uint64 Now();
+
+	void Complete(const char* name, const char* category, uint64 start, uint64 end);
+	void Instant(const char* name, const char* category);
+	void Counter(const char* name, double value);
+	void SetThreadName(const char* name);
+
+	// Write every thread's buffered events to path. Safe while other threads keep tracing
+	bool Flush(const char* path);
+}
+
+class TraceScope
+{
+public:
+
+	TraceScope(const char* name, const char* category) : name(name), category(category), start(Trace::Now()) {}
+	~TraceScope() { Trace::Complete(name, category, start, Trace::Now()); }
+
+private:
+
+	const char* name;
+	const char* category;
+	uint64 start;
+};
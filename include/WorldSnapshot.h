@@ -0,0 +1,108 @@
+#pragma once
+
+#include "Globals.h"
+#include "GameState.h"
+
+#define WORLD_SNAPSHOT_MAX_BODIES	256		// Same budget as the render snapshot
+#define WORLD_SNAPSHOT_MAX_JOINTS	8
+#define WORLD_SNAPSHOT_MAX_LETTERS	8
+#define WORLD_SNAPSHOT_MAX_TARGETS	32
+#define WORLD_SNAPSHOT_VERSION		1
+
+// One engine body, found again by PhysBody::id. Meters and radians
+struct BodySnapshot
+{
+	uint32 id;
+	float x, y, angle;
+	float vx, vy, angularVelocity;
+	uchar enabled;
+	uchar awake;
+	uchar pad[2];
+};
+
+// Revolute joints in creation order. The angle follows from the two bodies, only
+// the motor speed has to be put back
+struct JointSnapshot
+{
+	float angle;
+	float motorSpeed;
+};
+
+struct LetterSnapshot
+{
+	uint32 body;			// PhysBody::id, recreated at x, y when it's gone
+	int x, y;				// Spawn position, pixels
+	float spawnTime;
+	char letter;
+	bool collected;
+	uchar pad[2];
+};
+
+// ModuleGame's own state: the game data and every timer that drives play
+struct GameSnapshot
+{
+	GameData data;
+
+	float kickerForce;
+	float kickerChargeTime;
+	float ballLossTimer;
+	float starLetterSpawnTimer;
+	float scoreFlashTimer;
+	float comboCompleteTimer;
+	float blackHoleDwellTime;
+	float teleportCooldown;
+	float spawnZoneDwellTime;
+	float ballZeroVelTime;
+
+	int lastScoreIncrease;
+	int comboCompleteFlashCount;
+	int currentBlackHoleIndex;
+	int nextLetterIndex;
+	uchar comboCompleteFlashColor[4];		// RGBA
+
+	bool ballLaunched;
+	bool scoreFlashActive;
+	bool comboCompleteEffect;
+	bool isGamePaused;
+};
+
+// The whole simulation at a frame boundary, as plain fixed-size data: copying one is
+// a memcpy, so rewind buffers and AI lookahead can keep as many as they like, and the
+// file is the struct itself. Restoring moves the existing bodies, it never rebuilds
+// the world. Contacts and solver warm starts aren't kept, so a restored run can drift
+// from the original after a while
+//
+// File layout: WorldSnapshotHeader, then the WorldSnapshot. Only the same build reads it back
+struct WorldSnapshot
+{
+	uint32 frame = 0;
+	bool valid = false;
+
+	BodySnapshot bodies[WORLD_SNAPSHOT_MAX_BODIES];		// Sorted by id
+	int bodyCount = 0;
+
+	JointSnapshot joints[WORLD_SNAPSHOT_MAX_JOINTS];
+	int jointCount = 0;
+
+	LetterSnapshot letters[WORLD_SNAPSHOT_MAX_LETTERS];
+	int letterCount = 0;
+
+	bool targetsMovingDown[WORLD_SNAPSHOT_MAX_TARGETS];
+	int targetCount = 0;
+
+	GameSnapshot game;
+
+	// nullptr when the body wasn't in the world at capture time
+	const BodySnapshot* FindBody(uint32 id) const;
+
+	bool Save(const char* path) const;
+	bool Load(const char* path);
+};
+
+struct WorldSnapshotHeader
+{
+	char magic[4];			// "PBWS"
+	uint32 version;
+	uint32 size;			// sizeof(WorldSnapshot)
+	uint32 frame;
+};
@@ -0,0 +1,198 @@
+#include "Globals.h"
+#include "AllocTracker.h"
+
+#include <atomic>
+#include <mutex>
+#include <new>
+#include <stdlib.h>
+#include <string.h>
+
+// Nothing in here may allocate through operator new
+
+static std::atomic<uint64> counts[ALLOC_PHASE_COUNT][ALLOC_MAX_TAGS];
+static std::atomic<uint64> bytes[ALLOC_PHASE_COUNT][ALLOC_MAX_TAGS];
+static std::atomic<uint64> frees{ 0 };
+
+static const char* tagNames[ALLOC_MAX_TAGS] = { "untagged" };
+static std::atomic<int> tagCount{ 1 };
+static std::mutex tagMutex;
+
+// Constant initialised, so reading them never runs TLS constructors
+static thread_local int currentTag = 0;
+static thread_local int currentPhase = ALLOC_PHASE_OTHER;
+
+// Game thread only
+static AllocCount lastTotals[ALLOC_PHASE_COUNT][ALLOC_MAX_TAGS];
+static AllocCount frameEntries[ALLOC_PHASE_COUNT][ALLOC_MAX_TAGS];
+static AllocCount framePhases[ALLOC_PHASE_COUNT];
+static AllocCount frameTags[ALLOC_MAX_TAGS];
+static AllocCount frameTotal;
+
+static inline void Count(size_t size)
+{
+	counts[currentPhase][currentTag].fetch_add(1, std::memory_order_relaxed);
+	bytes[currentPhase][currentTag].fetch_add(size, std::memory_order_relaxed);
+}
+
+int AllocTracker::RegisterTag(const char* name)
+{
+	// Scopes usually pass the same literal every time
+	int count = tagCount.load(std::memory_order_acquire);
+	for (int i = 0; i < count; ++i)
+	{
+		if (tagNames[i] == name) return i;
+	}
+
+	std::lock_guard<std::mutex> lock(tagMutex);
+	count = tagCount.load(std::memory_order_relaxed);
+	for (int i = 0; i < count; ++i)
+	{
+		if (strcmp(tagNames[i], name) == 0) return i;
+	}
+
+	if (count >= ALLOC_MAX_TAGS) return 0;
+
+	tagNames[count] = name;
+	tagCount.store(count + 1, std::memory_order_release);
+	return count;
+}
+
+int AllocTracker::GetTagCount()
+{
+	return tagCount.load(std::memory_order_acquire);
+}
+
+const char* AllocTracker::GetTagName(int tag)
+{
+	return (tag >= 0 && tag < GetTagCount()) ? tagNames[tag] : "";
+}
+
+int AllocTracker::SetTag(int tag)
+{
+	int previous = currentTag;
+	currentTag = (tag >= 0 && tag < ALLOC_MAX_TAGS) ? tag : 0;
+	return previous;
+}
+
+int AllocTracker::SetPhase(int phase)
+{
+	int previous = currentPhase;
+	currentPhase = (phase >= 0 && phase < ALLOC_PHASE_COUNT) ? phase : ALLOC_PHASE_OTHER;
+	return previous;
+}
+
+void AllocTracker::EndFrame()
+{
+	frameTotal = AllocCount();
+	for (int p = 0; p < ALLOC_PHASE_COUNT; ++p) framePhases[p] = AllocCount();
+	for (int t = 0; t < ALLOC_MAX_TAGS; ++t) frameTags[t] = AllocCount();
+
+	for (int p = 0; p < ALLOC_PHASE_COUNT; ++p)
+	{
+		for (int t = 0; t < ALLOC_MAX_TAGS; ++t)
+		{
+			uint64 count = counts[p][t].load(std::memory_order_relaxed);
+			uint64 size = bytes[p][t].load(std::memory_order_relaxed);
+
+			AllocCount& entry = frameEntries[p][t];
+			entry.count = count - lastTotals[p][t].count;
+			entry.bytes = size - lastTotals[p][t].bytes;
+			lastTotals[p][t].count = count;
+			lastTotals[p][t].bytes = size;
+
+			framePhases[p].count += entry.count;
+			framePhases[p].bytes += entry.bytes;
+			frameTags[t].count += entry.count;
+			frameTags[t].bytes += entry.bytes;
+			frameTotal.count += entry.count;
+			frameTotal.bytes += entry.bytes;
+		}
+	}
+}
+
+const AllocCount& AllocTracker::GetFrame()
+{
+	return frameTotal;
+}
+
+const AllocCount& AllocTracker::GetFramePhase(int phase)
+{
+	return framePhases[(phase >= 0 && phase < ALLOC_PHASE_COUNT) ? phase : 0];
+}
+
+const AllocCount& AllocTracker::GetFrameTag(int tag)
+{
+	return frameTags[(tag >= 0 && tag < ALLOC_MAX_TAGS) ? tag : 0];
+}
+
+AllocCount AllocTracker::GetFrameEntry(int phase, int tag)
+{
+	if (phase < 0 || phase >= ALLOC_PHASE_COUNT || tag < 0 || tag >= ALLOC_MAX_TAGS) return AllocCount();
+	return frameEntries[phase][tag];
+}
+
+AllocCount AllocTracker::GetTotal()
+{
+	AllocCount total;
+	for (int p = 0; p < ALLOC_PHASE_COUNT; ++p)
+	{
+		for (int t = 0; t < ALLOC_MAX_TAGS; ++t)
+		{
+			total.count += counts[p][t].load(std::memory_order_relaxed);
+			total.bytes += bytes[p][t].load(std::memory_order_relaxed);
+		}
+	}
+	return total;
+}
+
+uint64 AllocTracker::GetTotalFrees()
+{
+	return frees.load(std::memory_order_relaxed);
+}
+
+// Global allocation hooks ---------------------------------------------------
+// Over-aligned new/delete keep the library versions; nothing in the game uses them
+
+static void* Allocate(size_t size)
+{
+	Count(size);
+	return malloc(size > 0 ? size : 1);
+}
+
+static void Release(void* ptr)
+{
+	if (ptr == nullptr) return;
+	frees.fetch_add(1, std::memory_order_relaxed);
+	free(ptr);
+}
+
+void* operator new(size_t size)
+{
+	void* ptr = Allocate(size);
+	if (ptr == nullptr) throw std::bad_alloc();
+	return ptr;
+}
+
+void* operator new[](size_t size)
+{
+	void* ptr = Allocate(size);
+	if (ptr == nullptr) throw std::bad_alloc();
+	return ptr;
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+	return Allocate(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+	return Allocate(size);
+}
+
+void operator delete(void* ptr) noexcept { Release(ptr); }
+void operator delete[](void* ptr) noexcept { Release(ptr); }
+void operator delete(void* ptr, size_t) noexcept { Release(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { Release(ptr); }
+void operator delete(void* ptr, const std::nothrow_t&) noexcept { Release(ptr); }
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept { Release(ptr); }
@@ -5,11 +5,39 @@
 #include "ModuleAudio.h"
 #include "ModulePhysics.h"
 #include "ModuleGame.h"
+#include "EventBus.h"
+#include "InputScript.h"
+#include "Trace.h"
+#include "PerfCounters.h"
+#include "AllocTracker.h"
+#include "FrameArena.h"
+#include "FlightRecorder.h"
+#include "SpikeDetector.h"
+#include "MetricsExport.h"
+#include "JobSystem.h"
+#include "ModuleScheduler.h"
+#include "WorldSnapshot.h"
 
 #include "Application.h"
 
-Application::Application()
+#include <algorithm>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+
+Application::Application(int argc, char** argv) : argc(argc), argv(argv)
 {
+	events = new EventBus();
+	perf = new PerfCounters();
+	frame_arena = new FrameArena();
+	recorder = new FlightRecorder();
+	spikes = new SpikeDetector();
+	metrics = new MetricsExport();
+	input = new InputScript();
+	jobs = new JobSystem();
+	scheduler = new ModuleScheduler();
+	quick_save = new WorldSnapshot();
+
 	window = new ModuleWindow(this);
 	renderer = new ModuleRender(this);
 	audio = new ModuleAudio(this, true);
@@ -21,15 +49,15 @@ Application::Application()
 	// They will CleanUp() in reverse order
 
 	// Main Modules
-	AddModule(window);
-	AddModule(physics);
-	AddModule(audio);
+	AddModule(window, "Window");
+	AddModule(physics, "Physics");
+	AddModule(audio, "Audio");
 	
 	// Scenes
-	AddModule(scene_intro);
+	AddModule(scene_intro, "Game");
 
 	// Rendering happens at the end
-	AddModule(renderer);
+	AddModule(renderer, "Renderer");
 }
 
 Application::~Application()
@@ -40,28 +68,158 @@ Application::~Application()
 		delete item;
 	}
 	list_modules.clear();
-	
+
+	delete events;
+	events = nullptr;
+
+	delete perf;
+	perf = nullptr;
+
+	delete frame_arena;
+	frame_arena = nullptr;
+
+	delete recorder;
+	recorder = nullptr;
+
+	delete spikes;
+	spikes = nullptr;
+
+	delete metrics;
+	metrics = nullptr;
+
+	delete input;
+	input = nullptr;
+
+	delete scheduler;
+	scheduler = nullptr;
+
+	delete jobs;
+	jobs = nullptr;
+
+	delete quick_save;
+	quick_save = nullptr;
 }
 
 bool Application::Init()
 {
 	bool ret = true;
 
+	TRACE_THREAD_NAME("Main");
+	TRACE_SCOPE("Application::Init");
+	trace_path = GetArgument("--trace", trace_path);
+	snapshot_path = GetArgument("--snapshot", snapshot_path);
+
+	// Counters are per thread, so they are opened here on the game thread
+	if (HasArgument("--perf-counters"))
+	{
+		perf->Open();
+	}
+
+	// Crashes, F4 and a normal exit all leave the last seconds of play on disk
+	recorder->Install(GetArgument("--flight-recorder", "flight.bin"));
+	events->Subscribe<ScoreChangedEvent, FlightRecorder, &FlightRecorder::OnScoreChanged>(recorder);
+	events->Subscribe<BallLostEvent, FlightRecorder, &FlightRecorder::OnBallLost>(recorder);
+
+	// One timeline section per module and phase, in module order
+	static const char* phases[PHASE_COUNT] = { "PreUpdate", "Update", "PostUpdate" };
+	for (size_t i = 0; i < list_modules.size(); ++i)
+	{
+		for (int phase = 0; phase < PHASE_COUNT; ++phase)
+		{
+			int section = spikes->AddSection(TextFormat("%s %s", list_modules[i]->GetName(), phases[phase]));
+			if (i == 0 && phase == 0) spike_first_section = section;
+		}
+	}
+
+	if (HasArgument("--spike-budget"))
+	{
+		spikes->Enable((float)atof(GetArgument("--spike-budget", "0")));
+	}
+
+	if (HasArgument("--metrics-shm"))
+	{
+		metrics->Open(GetArgument("--metrics-shm", LIVE_METRICS_DEFAULT_NAME));
+	}
+
+	// Fail the run if gameplay still allocates once the warm-up frames are over
+	if (HasArgument("--alloc-check"))
+	{
+		alloc_check_warmup = atoi(GetArgument("--alloc-check", "300"));
+		LOG("Allocation check enabled after %d warm-up frames", alloc_check_warmup);
+	}
+
+	// One worker per spare core unless --jobs says otherwise, 0 runs every job inline
+	int workers = atoi(GetArgument("--jobs", "-1"));
+	if (workers < 0) workers = MAX((int)std::thread::hardware_concurrency() - 1, 0);
+	jobs->Start(workers);
+
+	// Simulation a frame ahead of drawing, see UpdatePipelined()
+	pipelined = HasArgument("--pipelined");
+
+	// Replays and offline renders step by frame, not by wall clock
+	fixed_step = HasArgument("--script") || HasArgument("--audio-wav");
+	stage_ms.assign(list_modules.size() * PHASE_COUNT, 0.0f);
+
+	// Module phases with no conflicting data run side by side as jobs
+	if (HasArgument("--parallel-modules"))
+	{
+		if (pipelined)
+		{
+			LOG("--parallel-modules has no effect with --pipelined");
+		}
+		else
+		{
+			scheduler->Start(jobs);
+		}
+	}
+
+	// Replayed or generated input, so timing runs are repeatable
+	if (HasArgument("--script"))
+	{
+		ret = input->Load(GetArgument("--script", ""));
+	}
+	else if (HasArgument("--latency-test"))
+	{
+		input->GenerateLatencyRun(atoi(GetArgument("--latency-test", "60")));
+	}
+	else if (HasArgument("--record-input"))
+	{
+		input->StartRecording(GetArgument("--record-input", "input.txt"));
+	}
+
 	// Call Init() in all modules
 	for (auto it = list_modules.begin(); it != list_modules.end() && ret; ++it)
 	{
 		Module* module = *it;
+		TRACE_SCOPE_CAT(module->GetName(), "Init");
 		ret = module->Init();
 	}
 
+	// InitWindow() seeds raylib's RNG from the time, so this goes after Init
+	if (fixed_step)
+	{
+		SetRandomSeed(FIXED_STEP_RANDOM_SEED);
+		LOG("Fixed step: 1/%d s per frame, random seed %d", OFFLINE_AUDIO_FPS, FIXED_STEP_RANDOM_SEED);
+	}
+
 	// After all Init calls we call Start() in all modules
 	LOG("Application Start --------------");
 
 	for (auto it = list_modules.begin(); it != list_modules.end() && ret; ++it)
 	{
 		Module* module = *it;
+		TRACE_SCOPE_CAT(module->GetName(), "Start");
 		ret = module->Start();
 	}
+
+	// Pick up where a previous session's F5 left off
+	if (ret && HasArgument("--resume"))
+	{
+		if (quick_save->Load(snapshot_path) && RestoreWorld(*quick_save))
+		{
+			LOG("Resumed from %s, saved at frame %u", snapshot_path, quick_save->frame);
+		}
+	}
 	
 	return ret;
 }
@@ -69,53 +227,424 @@ bool Application::Init()
 // Call PreUpdate, Update and PostUpdate on all modules
 update_status Application::Update()
 {
+	TRACE_SCOPE("Frame");
 	update_status ret = UPDATE_CONTINUE;
+	double frameStart = GetPerfTime();
 
-	for (auto it = list_modules.begin(); it != list_modules.end() && ret == UPDATE_CONTINUE; ++it)
+	spikes->BeginFrame((uint32)frame_count);
+
+	// Whatever the previous frame left in the arena is gone from here on
+	frame_arena->Reset();
+
+	// Raylib work other threads handed over since the last frame
+	jobs->RunMainThreadJobs();
+
+	if (fixed_step)
 	{
-		Module* module = *it;
-		if (module->IsEnabled())
-		{
-			ret = module->PreUpdate();
-		}
+		frame_delta = 1.0f / OFFLINE_AUDIO_FPS;
+		sim_time = (double)frame_count / OFFLINE_AUDIO_FPS;
 	}
-
-	for (auto it = list_modules.begin(); it != list_modules.end() && ret == UPDATE_CONTINUE; ++it)
+	else
 	{
-		Module* module = *it;
-		if (module->IsEnabled())
-		{
-			ret = module->Update();
-		}
+		frame_delta = GetFrameTime();
+		sim_time = GetTime();
 	}
 
-	for (auto it = list_modules.begin(); it != list_modules.end() && ret == UPDATE_CONTINUE; ++it)
+	recorder->BeginFrame((uint32)frame_count);
+	input->BeginFrame((uint32)frame_count++);
+	for (int i = 0; i < input->GetTransitionCount(); ++i)
 	{
-		Module* module = *it;
-		if (module->IsEnabled())
-		{
-			ret = module->PostUpdate();
-		}
+		const InputEvent& transition = input->GetTransition(i);
+		recorder->Input(transition.key, transition.down);
 	}
 
+	ret = pipelined ? UpdatePipelined() : UpdateModules();
+
 	if (WindowShouldClose()) ret = UPDATE_STOP;
 
+	if (input->IsFinished())
+	{
+		LOG("Input script finished after %d frames", (int)frame_count);
+		ret = UPDATE_STOP;
+	}
+
+	perf->EndFrame();
+	AllocTracker::EndFrame();
+	spikes->SetContacts(physics->GetContactCount());
+	spikes->SetAllocations((uint32)AllocTracker::GetFrame().count, AllocTracker::GetFrame().bytes);
+	recorder->Frame(GetFrameTime() * 1000.0f, (float)((GetPerfTime() - frameStart) * 1000.0), (int)AllocTracker::GetFrame().count);
+	if (metrics->IsOpen()) PublishMetrics(frameStart);
+
+	if (IsKeyPressed(KEY_F4))
+	{
+		bool saved = recorder->Dump(FLIGHT_DUMP_HOTKEY);
+		LOG("Flight recorder %s %s", saved ? "saved to" : "could not be saved to", recorder->GetDumpPath());
+	}
+
+	// F5 keeps the world in memory and on disk, F9 goes back to it
+	if (IsKeyPressed(KEY_F5))
+	{
+		CaptureWorld(*quick_save);
+		bool saved = quick_save->Save(snapshot_path);
+		LOG("World saved at frame %u%s", quick_save->frame, saved ? "" : ", only in memory");
+	}
+	if (IsKeyPressed(KEY_F9))
+	{
+		if (quick_save->valid || quick_save->Load(snapshot_path)) RestoreWorld(*quick_save);
+	}
+	if (alloc_check_warmup >= 0 && frame_count > (uint64)alloc_check_warmup) CheckAllocations();
+
+#ifdef PINBALL_TRACE
+	// F3 saves everything traced so far without stopping the game
+	if (IsKeyPressed(KEY_F3)) TRACE_FLUSH(trace_path);
+#endif
+
 	return ret;
 }
 
 bool Application::CleanUp()
 {
 	bool ret = true;
+
+	// Saved before the modules clean up; a crash in there replaces it with its own dump
+	if (!recorder->Dump(FLIGHT_DUMP_EXIT)) LOG("ERROR: Cannot write the flight recorder dump");
+
+	scheduler->Stop();
+
 	for (auto it = list_modules.rbegin(); it != list_modules.rend() && ret; ++it)
 	{
 		Module* item = *it;
 		ret = item->CleanUp();
 	}
+
+	input->Finish();
+
+	perf->PrintReport();
+	perf->Close();
+
+	LOG("Frame arena: %u KB high-water of %u KB, %u overflows",
+		(uint32)(frame_arena->GetHighWater() / 1024), (uint32)(frame_arena->GetCapacity() / 1024), frame_arena->GetOverflows());
+
+	if (alloc_check_warmup >= 0)
+	{
+		if (alloc_check_failures > 0)
+		{
+			LOG("Allocation check FAILED: %u of %d checked frames allocated", alloc_check_failures, (int)frame_count - alloc_check_warmup);
+			ret = false;
+		}
+		else
+		{
+			LOG("Allocation check passed: no allocations in %d frames after warm-up", MAX((int)frame_count - alloc_check_warmup, 0));
+		}
+	}
+
+	metrics->Close();
+	jobs->Stop();
+
+	TRACE_FLUSH(trace_path);
 	
 	return ret;
 }
 
-void Application::AddModule(Module* mod)
+void Application::CaptureWorld(WorldSnapshot& snapshot)
+{
+	TRACE_SCOPE("CaptureWorld");
+	snapshot.frame = (uint32)frame_count;
+	physics->CaptureState(snapshot);
+	scene_intro->CaptureState(snapshot);
+	snapshot.valid = true;
+}
+
+// Game first, it spawns or removes the letters the bodies below refer to
+bool Application::RestoreWorld(const WorldSnapshot& snapshot)
+{
+	if (!snapshot.valid) return false;
+
+	TRACE_SCOPE("RestoreWorld");
+	double start = GetPerfTime();
+	scene_intro->RestoreState(snapshot);
+	physics->RestoreState(snapshot);
+
+	LOG("World restored to frame %u in %.1f us", snapshot.frame, (GetPerfTime() - start) * 1000000.0);
+	return true;
+}
+
+bool Application::HasArgument(const char* name) const
+{
+	for (int i = 1; i < argc; ++i)
+	{
+		if (strcmp(argv[i], name) == 0) return true;
+	}
+	return false;
+}
+
+const char* Application::GetArgument(const char* name, const char* fallback) const
+{
+	for (int i = 1; i + 1 < argc; ++i)
+	{
+		if (strcmp(argv[i], name) == 0 && strncmp(argv[i + 1], "--", 2) != 0) return argv[i + 1];
+	}
+	return fallback;
+}
+
+// Logs where a steady-state frame allocated; the first few offending frames only
+void Application::CheckAllocations()
+{
+	const AllocCount& frame = AllocTracker::GetFrame();
+	if (frame.count == 0) return;
+
+	if (alloc_check_failures++ >= MAX_ALLOC_CHECK_REPORTS) return;
+
+	static const char* phases[ALLOC_PHASE_COUNT] = { "Other", "PreUpdate", "Update", "PostUpdate" };
+
+	LOG("Allocation check: frame %d allocated %llu times, %llu bytes",
+		(int)frame_count, (unsigned long long)frame.count, (unsigned long long)frame.bytes);
+	for (int p = 0; p < ALLOC_PHASE_COUNT; ++p)
+	{
+		for (int t = 0; t < AllocTracker::GetTagCount(); ++t)
+		{
+			AllocCount entry = AllocTracker::GetFrameEntry(p, t);
+			if (entry.count > 0)
+			{
+				LOG("    %s / %s: %llu allocations, %llu bytes", phases[p], AllocTracker::GetTagName(t),
+					(unsigned long long)entry.count, (unsigned long long)entry.bytes);
+			}
+		}
+	}
+}
+
+void Application::PublishMetrics(double frameStart)
+{
+	LiveMetrics live = {};
+	live.frame = frame_count;
+	live.time = startup_time.ReadSec();
+	live.frameMs = GetFrameTime() * 1000.0f;
+	live.updateMs = (float)((GetPerfTime() - frameStart) * 1000.0);
+
+	PhysicsBackend* backend = physics->GetBackend();
+	if (backend != nullptr && backend->HasWorld())
+	{
+		const PhysWorldStats& world = physics->GetWorldStats();
+		live.physicsStepMs = physics->GetStepProfile().step;
+		live.bodies = world.bodies;
+		live.contacts = world.contacts;
+	}
+	live.contactsBegun = physics->GetContactCount();
+	live.physicsSubsteps = physics->GetSubstepCount();
+
+	MixerStats mixer = audio->GetMixerStats();
+	live.activeVoices = mixer.activeVoices;
+	live.voiceCount = mixer.voiceCount;
+
+	live.gameState = scene_intro->gameData.currentState;
+	live.score = scene_intro->gameData.currentScore;
+	live.ballsLeft = scene_intro->gameData.ballsLeft;
+
+	metrics->Publish(live);
+}
+
+// Every module's phases back to back on this thread, or through the scheduler
+update_status Application::UpdateModules()
+{
+	update_status ret = UPDATE_CONTINUE;
+
+	if (ret == UPDATE_CONTINUE)
+	{
+		TRACE_SCOPE("PreUpdate");
+		PerfScope perfScope(perf, PERF_SECTION_PREUPDATE);
+		ret = RunPhase(PHASE_PREUPDATE);
+	}
+
+	// Contacts reported during the physics step reach their listeners here
+	if (ret == UPDATE_CONTINUE)
+	{
+		TRACE_SCOPE("Dispatch events");
+		ALLOC_TAG("Events");
+		SpikeScope spikeScope(spikes, SPIKE_SECTION_EVENTS);
+		events->Dispatch();
+	}
+
+	if (ret == UPDATE_CONTINUE)
+	{
+		TRACE_SCOPE("Update");
+		PerfScope perfScope(perf, PERF_SECTION_UPDATE);
+		ret = RunPhase(PHASE_UPDATE);
+	}
+
+	// Gameplay events raised this frame (score, ball lost...) before anything is presented
+	if (ret == UPDATE_CONTINUE)
+	{
+		TRACE_SCOPE("Dispatch events");
+		ALLOC_TAG("Events");
+		SpikeScope spikeScope(spikes, SPIKE_SECTION_EVENTS);
+		events->Dispatch();
+	}
+
+	if (ret == UPDATE_CONTINUE)
+	{
+		TRACE_SCOPE("PostUpdate");
+		PerfScope perfScope(perf, PERF_SECTION_POSTUPDATE);
+		ret = RunPhase(PHASE_POSTUPDATE);
+	}
+
+	return ret;
+}
+
+// Frame N simulates on a job (physics step, audio, game logic and the events between
+// them) while this thread draws frame N-1 from the snapshot it left behind, so drawing
+// hides the simulation cost at the price of one frame of latency. Both are joined
+// before PostUpdate: debug drawing reads the world, and EndDrawing polls input
+update_status Application::UpdatePipelined()
+{
+	std::fill(stage_ms.begin(), stage_ms.end(), 0.0f);
+	simulation_status = UPDATE_CONTINUE;
+
+	JobFence simulation;
+	jobs->Run(&Application::SimulateJob, this, &simulation);
+
+	update_status ret = UPDATE_CONTINUE;
+	{
+		TRACE_SCOPE("PreUpdate");
+		PerfScope perfScope(perf, PERF_SECTION_PREUPDATE);
+		ret = RunStage(false, PHASE_PREUPDATE);
+	}
+
+	if (ret == UPDATE_CONTINUE)
+	{
+		TRACE_SCOPE("Update");
+		PerfScope perfScope(perf, PERF_SECTION_UPDATE);
+		ret = RunStage(false, PHASE_UPDATE);
+	}
+
+	{
+		TRACE_SCOPE("Wait for simulation");
+		jobs->Wait(&simulation);
+	}
+	if (ret == UPDATE_CONTINUE) ret = simulation_status;
+
+	if (ret == UPDATE_CONTINUE)
+	{
+		TRACE_SCOPE("PostUpdate");
+		PerfScope perfScope(perf, PERF_SECTION_POSTUPDATE);
+		ret = RunStage(false, PHASE_POSTUPDATE);
+	}
+
+	// The simulation job is done with the detector's frame by now
+	if (spikes->IsEnabled())
+	{
+		for (int i = 0; i < (int)list_modules.size(); ++i)
+		{
+			for (int phase = 0; phase < PHASE_COUNT; ++phase)
+			{
+				spikes->AddTime(ModuleSection(i, phase), stage_ms[i * PHASE_COUNT + phase]);
+			}
+		}
+	}
+
+	return ret;
+}
+
+void Application::SimulateJob(void* data)
+{
+	Application* app = (Application*)data;
+	TRACE_SCOPE("Simulation");
+
+	update_status ret = app->RunStage(true, PHASE_PREUPDATE);
+
+	if (ret == UPDATE_CONTINUE)
+	{
+		TRACE_SCOPE("Dispatch events");
+		ALLOC_TAG("Events");
+		SpikeScope spikeScope(app->spikes, SPIKE_SECTION_EVENTS);
+		app->events->Dispatch();
+	}
+
+	if (ret == UPDATE_CONTINUE) ret = app->RunStage(true, PHASE_UPDATE);
+
+	if (ret == UPDATE_CONTINUE)
+	{
+		TRACE_SCOPE("Dispatch events");
+		ALLOC_TAG("Events");
+		SpikeScope spikeScope(app->spikes, SPIKE_SECTION_EVENTS);
+		app->events->Dispatch();
+	}
+
+	if (ret == UPDATE_CONTINUE) ret = app->RunStage(true, PHASE_POSTUPDATE);
+
+	app->simulation_status = ret;
+}
+
+// One phase of the modules on one side of the pipeline, in module order. Phases that
+// draw or touch the window are presentation and stay on the main thread
+update_status Application::RunStage(bool simulation, ModulePhase phase)
+{
+	update_status ret = UPDATE_CONTINUE;
+	for (int i = 0; i < (int)list_modules.size() && ret == UPDATE_CONTINUE; ++i)
+	{
+		Module* module = list_modules[i];
+		bool presentation = (module->GetAccess(phase).writes & (RESOURCE_RENDER | RESOURCE_WINDOW)) != 0;
+		if (!module->IsEnabled() || presentation == simulation) continue;
+
+		double start = GetPerfTime();
+		ret = RunModulePhase(this, i, phase);
+		stage_ms[i * PHASE_COUNT + phase] = (float)((GetPerfTime() - start) * 1000.0);
+	}
+	return ret;
+}
+
+int Application::ModuleSection(int module, int phase) const
+{
+	return spike_first_section + module * PHASE_COUNT + phase;
+}
+
+// Every enabled module's phase through the scheduler. Spike timings are added here,
+// on the game thread, since the detector isn't shared with the workers
+update_status Application::RunPhase(ModulePhase phase)
+{
+	update_status ret = scheduler->RunPhase(list_modules, phase, &Application::RunModulePhase, this);
+
+	if (spikes->IsEnabled())
+	{
+		for (int i = 0; i < (int)list_modules.size(); ++i)
+		{
+			spikes->AddTime(ModuleSection(i, phase), scheduler->GetTaskMs(i));
+		}
+	}
+
+	return ret;
+}
+
+// Runs on a worker thread when the module declared the phase can
+update_status Application::RunModulePhase(void* context, int index, ModulePhase phase)
+{
+	Module* module = ((Application*)context)->list_modules[index];
+	AllocPhaseScope allocPhase(ALLOC_PHASE_PREUPDATE + phase);
+	ALLOC_TAG(module->GetName());
+
+	switch (phase)
+	{
+	case PHASE_PREUPDATE:
+	{
+		TRACE_SCOPE_CAT(module->GetName(), "PreUpdate");
+		return module->PreUpdate();
+	}
+	case PHASE_UPDATE:
+	{
+		TRACE_SCOPE_CAT(module->GetName(), "Update");
+		return module->Update();
+	}
+	case PHASE_POSTUPDATE:
+	{
+		TRACE_SCOPE_CAT(module->GetName(), "PostUpdate");
+		return module->PostUpdate();
+	}
+	default:
+		return UPDATE_CONTINUE;
+	}
+}
+
+void Application::AddModule(Module* mod, const char* name)
 {
+	mod->SetName(name);
 	list_modules.emplace_back(mod);
 }
\ No newline at end of file
@@ -0,0 +1,817 @@
+#include "Globals.h"
+#include "AudioMixer.h"
+#include "Timer.h"
+#include "Trace.h"
+
+// Declarations only, the implementation is compiled into raylib with these same options
+#define MA_NO_JACK
+#define MA_NO_WAV
+#define MA_NO_FLAC
+#define MA_NO_MP3
+#define MA_NO_RESOURCE_MANAGER
+#define MA_NO_NODE_GRAPH
+#define MA_NO_ENGINE
+#define MA_NO_GENERATION
+#include "miniaudio.h"
+
+#include <chrono>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MIXER_SSE 1
+#include <emmintrin.h>
+#else
+#define MIXER_SSE 0
+#endif
+
+AudioMixer* AudioMixer::instance = nullptr;
+
+// Kernels -----------
+
+// acc += src * gain, with the left/right gains ramping linearly across the block
+static void MixStereoRamp(float* acc, const float* src, int frames, float l0, float r0, float l1, float r1)
+{
+	float dl = (l1 - l0) / frames;
+	float dr = (r1 - r0) / frames;
+	int i = 0;
+
+#if MIXER_SSE
+	// Two stereo frames per vector: L0 R0 L1 R1
+	__m128 gain = _mm_setr_ps(l0, r0, l0 + dl, r0 + dr);
+	__m128 step = _mm_setr_ps(2.0f * dl, 2.0f * dr, 2.0f * dl, 2.0f * dr);
+	for (; i + 2 <= frames; i += 2)
+	{
+		__m128 a = _mm_load_ps(acc + i * 2);
+		__m128 s = _mm_loadu_ps(src + i * 2);
+		_mm_store_ps(acc + i * 2, _mm_add_ps(a, _mm_mul_ps(s, gain)));
+		gain = _mm_add_ps(gain, step);
+	}
+#endif
+
+	for (; i < frames; ++i)
+	{
+		acc[i * 2] += src[i * 2] * (l0 + dl * i);
+		acc[i * 2 + 1] += src[i * 2 + 1] * (r0 + dr * i);
+	}
+}
+
+// out = clamp(acc * gain, -1, 1), gain ramping across the block
+static void WriteOutput(float* out, const float* acc, int frames, float g0, float g1)
+{
+	float dg = (g1 - g0) / frames;
+	int i = 0;
+
+#if MIXER_SSE
+	__m128 gain = _mm_setr_ps(g0, g0, g0 + dg, g0 + dg);
+	__m128 step = _mm_set1_ps(2.0f * dg);
+	__m128 lo = _mm_set1_ps(-1.0f);
+	__m128 hi = _mm_set1_ps(1.0f);
+	for (; i + 2 <= frames; i += 2)
+	{
+		__m128 v = _mm_mul_ps(_mm_load_ps(acc + i * 2), gain);
+		_mm_storeu_ps(out + i * 2, _mm_min_ps(_mm_max_ps(v, lo), hi));
+		gain = _mm_add_ps(gain, step);
+	}
+#endif
+
+	for (; i < frames; ++i)
+	{
+		float g = g0 + dg * i;
+		for (int c = 0; c < 2; ++c)
+		{
+			float v = acc[i * 2 + c] * g;
+			out[i * 2 + c] = v < -1.0f ? -1.0f : (v > 1.0f ? 1.0f : v);
+		}
+	}
+}
+
+static void PanGains(float volume, float pan, float& left, float& right)
+{
+	left = volume * (pan > 0.0f ? 1.0f - pan : 1.0f);
+	right = volume * (pan < 0.0f ? 1.0f + pan : 1.0f);
+}
+
+// Game thread -----------
+
+AudioMixer::AudioMixer()
+{
+	for (int i = 0; i < MIXER_BUS_COUNT; ++i)
+	{
+		busGain[i] = busTarget[i] = 1.0f;
+	}
+
+	for (int i = 0; i < MUSIC_DECKS; ++i)
+	{
+		deckWanted[i] = 0;
+		deckFadeFrames[i] = 1;
+		deckGain[i] = 0.0f;
+		deckFadeStep[i] = 0.0f;
+	}
+}
+
+bool AudioMixer::Init(int voice_count, MixerOutput output, int buffer_frames)
+{
+	if (instance != nullptr)
+	{
+		LOG("ERROR: Only one AudioMixer can drive the audio device");
+		return false;
+	}
+
+	voiceCount = MIN(MAX(voice_count, 1), MAX_MIXER_VOICES);
+	statVoiceCount.store(voiceCount);
+	bufferFrames = MAX(buffer_frames, 32);
+	this->output = output;
+
+	if (output == MIXER_OUTPUT_DEVICE)
+	{
+		// Own playback device so the period is ours to choose, raylib's stays closed
+		ma_device_config config = ma_device_config_init(ma_device_type_playback);
+		config.playback.format = ma_format_f32;
+		config.playback.channels = MIXER_CHANNELS;
+		config.sampleRate = MIXER_SAMPLE_RATE;
+		config.periodSizeInFrames = bufferFrames;
+		config.periods = MIXER_DEVICE_PERIODS;
+		config.performanceProfile = ma_performance_profile_low_latency;
+		config.noPreSilencedOutputBuffer = MA_TRUE;
+		config.noClip = MA_TRUE;
+		config.dataCallback = DeviceCallback;
+		config.pUserData = this;
+
+		device = new ma_device();
+		if (ma_device_init(NULL, &config, device) != MA_SUCCESS)
+		{
+			LOG("ERROR: Could not open the low-latency audio device");
+			delete device;
+			device = nullptr;
+			return false;
+		}
+	}
+	else if (output == MIXER_OUTPUT_STREAM)
+	{
+		// Small device buffers: the callback does all the work, nothing waits on the game thread
+		SetAudioStreamBufferSizeDefault(bufferFrames);
+		stream = LoadAudioStream(MIXER_SAMPLE_RATE, 32, MIXER_CHANNELS);
+		SetAudioStreamBufferSizeDefault(0);
+
+		if (!IsAudioStreamValid(stream))
+		{
+			LOG("ERROR: Could not create the mixer audio stream");
+			return false;
+		}
+	}
+
+	// Offline renders decode music inline so the result doesn't depend on thread timing
+	streamer.Init(MUSIC_PREFETCH_MS, MIXER_SAMPLE_RATE, output != MIXER_OUTPUT_OFFLINE);
+
+	instance = this;
+	if (device != nullptr)
+	{
+		if (ma_device_start(device) != MA_SUCCESS)
+		{
+			LOG("ERROR: Could not start the low-latency audio device");
+			CleanUp();
+			return false;
+		}
+	}
+	else if (output == MIXER_OUTPUT_STREAM)
+	{
+		SetAudioStreamCallback(stream, AudioCallback);
+		PlayAudioStream(stream);
+	}
+	ready = true;
+
+	static const char* OUTPUT_NAMES[] = { "raylib stream", "low-latency device", "offline" };
+	LOG("Audio mixer running: %s, %d Hz, %d frame buffers, %d voices, %s kernels",
+		OUTPUT_NAMES[output], MIXER_SAMPLE_RATE, bufferFrames, voiceCount, MIXER_SSE ? "SSE2" : "scalar");
+
+	return true;
+}
+
+void AudioMixer::CleanUp()
+{
+	// Once the stream or device is gone the callback can't run again
+	if (device != nullptr)
+	{
+		ma_device_uninit(device);
+		delete device;
+		device = nullptr;
+	}
+	else if (ready && output == MIXER_OUTPUT_STREAM)
+	{
+		StopAudioStream(stream);
+		UnloadAudioStream(stream);
+	}
+	ready = false;
+	instance = nullptr;
+
+	streamer.CleanUp();
+	CloseCapture();
+	std::vector<float>().swap(capture);
+
+	MixerCommand command;
+	while (commands.Pop(command)) {}
+
+	LatencySample latency;
+	while (latencies.Pop(latency)) {}
+	pendingLatencyCount = 0;
+
+	for (int i = 0; i < sampleCount; ++i)
+	{
+		RL_FREE(samples[i].data);
+		samples[i] = Sample();
+	}
+	sampleCount = 0;
+
+	LOG("Audio mixer stopped: %d voices stolen, %d dropped, %d commands dropped, %d music underruns",
+		statStolen.load(), statDropped.load(), commandsDropped, statUnderruns.load());
+}
+
+int AudioMixer::AddSample(Wave& wave)
+{
+	if (sampleCount >= MAX_MIXER_SAMPLES)
+	{
+		LOG("ERROR: Mixer sample table is full (%d)", MAX_MIXER_SAMPLES);
+		UnloadWave(wave);
+		wave.data = nullptr;
+		return 0;
+	}
+
+	WaveFormat(&wave, MIXER_SAMPLE_RATE, 32, MIXER_CHANNELS);
+	if (wave.data == nullptr || wave.frameCount == 0)
+	{
+		UnloadWave(wave);
+		wave.data = nullptr;
+		return 0;
+	}
+
+	samples[sampleCount].data = (float*)wave.data;
+	samples[sampleCount].frames = wave.frameCount;
+	samples[sampleCount].group = sampleCount + 1;
+	wave.data = nullptr;
+
+	return ++sampleCount;
+}
+
+int AudioMixer::AddVariant(int sample, float pitch, float volume)
+{
+	if (sample <= 0 || sample > sampleCount || pitch <= 0.0f)
+		return 0;
+
+	if (sampleCount >= MAX_MIXER_SAMPLES)
+	{
+		LOG("ERROR: Mixer sample table is full (%d)", MAX_MIXER_SAMPLES);
+		return 0;
+	}
+
+	const Sample& source = samples[sample - 1];
+	uint32 frames = (uint32)((source.frames - 1) / pitch) + 1;
+	float* data = (float*)RL_MALLOC(frames * MIXER_CHANNELS * sizeof(float));
+	if (data == nullptr)
+		return 0;
+
+	// Same linear interpolation the pitched voice path uses, done once here
+	for (uint32 i = 0; i < frames; ++i)
+	{
+		double position = (double)i * pitch;
+		uint32 index = (uint32)position;
+		float t = (float)(position - index);
+		const float* a = source.data + index * MIXER_CHANNELS;
+		const float* b = index + 1 < source.frames ? a + MIXER_CHANNELS : a;
+
+		data[i * 2] = (a[0] + (b[0] - a[0]) * t) * volume;
+		data[i * 2 + 1] = (a[1] + (b[1] - a[1]) * t) * volume;
+	}
+
+	samples[sampleCount].data = data;
+	samples[sampleCount].frames = frames;
+	samples[sampleCount].group = source.group;
+
+	return ++sampleCount;
+}
+
+bool AudioMixer::Post(const MixerCommand& command)
+{
+	if (!ready || !commands.Push(command))
+	{
+		commandsDropped++;
+		return false;
+	}
+
+	return true;
+}
+
+bool AudioMixer::Play(int sample, float volume, float pitch, float pan, int priority, double contactTime)
+{
+	if (sample <= 0 || sample > sampleCount)
+		return false;
+
+	MixerCommand command = {};
+	command.type = MIXER_CMD_PLAY;
+	command.id = sample;
+	command.volume = volume;
+	command.pitch = pitch;
+	command.pan = pan;
+	command.priority = priority;
+	command.contactTime = contactTime;
+	command.postTime = contactTime > 0.0 ? GetPerfTime() : 0.0;
+
+	return Post(command);
+}
+
+void AudioMixer::StopAll()
+{
+	MixerCommand command = {};
+	command.type = MIXER_CMD_STOP_ALL;
+	Post(command);
+}
+
+void AudioMixer::SetBusGain(int bus, float gain)
+{
+	if (bus < 0 || bus >= MIXER_BUS_COUNT)
+		return;
+
+	MixerCommand command = {};
+	command.type = MIXER_CMD_SET_GAIN;
+	command.id = bus;
+	command.volume = gain;
+	Post(command);
+}
+
+void AudioMixer::SetVoiceCount(int count)
+{
+	MixerCommand command = {};
+	command.type = MIXER_CMD_SET_VOICE_COUNT;
+	command.id = MIN(MAX(count, 1), MAX_MIXER_VOICES);
+	Post(command);
+}
+
+static uint32 FadeFrames(float seconds)
+{
+	return MAX((uint32)(seconds * MIXER_SAMPLE_RATE), 1u);
+}
+
+bool AudioMixer::PlayMusic(const char* path, float fadeSeconds)
+{
+	if (!ready)
+		return false;
+
+	// The command goes first: by the time the streamer primes the deck the audio
+	// thread can already tell a pending start from a cancelled one
+	MixerCommand command = {};
+	command.type = MIXER_CMD_PLAY_MUSIC;
+	command.id = musicDeck ^ 1;
+	command.token = ++musicToken;
+	command.fadeFrames = FadeFrames(fadeSeconds);
+
+	if (!Post(command))
+		return false;
+
+	musicDeck = command.id;
+	return streamer.Request(command.id, path, command.token);
+}
+
+void AudioMixer::StopMusic(float fadeSeconds)
+{
+	MixerCommand command = {};
+	command.type = MIXER_CMD_STOP_MUSIC;
+	command.token = ++musicToken;
+	command.fadeFrames = FadeFrames(fadeSeconds);
+	Post(command);
+}
+
+MixerStats AudioMixer::GetStats() const
+{
+	MixerStats stats;
+	stats.callbacks = statCallbacks.load(std::memory_order_relaxed);
+	stats.framesMixed = statFrames.load(std::memory_order_relaxed);
+	stats.activeVoices = statActiveVoices.load(std::memory_order_relaxed);
+	stats.voiceCount = statVoiceCount.load(std::memory_order_relaxed);
+	stats.voicesStolen = statStolen.load(std::memory_order_relaxed);
+	stats.voicesDropped = statDropped.load(std::memory_order_relaxed);
+	stats.commandsDropped = commandsDropped;
+	stats.lastMixMs = statLastMs.load(std::memory_order_relaxed);
+	stats.peakMixMs = statPeakMs.load(std::memory_order_relaxed);
+	stats.averageMixMs = statAverageMs.load(std::memory_order_relaxed);
+	stats.bufferMs = 1000.0f * bufferFrames / MIXER_SAMPLE_RATE;
+	stats.outputLatencyMs = device ? stats.bufferMs * MIXER_DEVICE_PERIODS : (output == MIXER_OUTPUT_STREAM ? MIXER_STREAM_OUTPUT_MS : 0.0f);
+	stats.lowLatency = device != nullptr;
+	stats.offlineFrames = offlineFrames;
+	stats.musicUnderruns = statUnderruns.load(std::memory_order_relaxed);
+	stats.musicFailedLoads = streamer.GetFailedLoads();
+	stats.musicBufferedMs = 1000.0f * streamer.GetBufferedFrames(musicDeck) / MIXER_SAMPLE_RATE;
+	stats.musicPrefetchMs = 1000.0f * streamer.GetPrefetchFrames() / MIXER_SAMPLE_RATE;
+	return stats;
+}
+
+// Offline output -----------
+
+// RIFF header for 32-bit float stereo. Sizes are patched by CloseCapture once the length is known
+static void WriteWavHeader(FILE* file, uint64 frames)
+{
+	uint32 dataBytes = (uint32)MIN(frames * MIXER_CHANNELS * sizeof(float), (uint64)0xFFFFFF00u);
+	uint32 rate = MIXER_SAMPLE_RATE;
+	uint32 byteRate = MIXER_SAMPLE_RATE * MIXER_CHANNELS * sizeof(float);
+	uint32 riffBytes = 4 + 26 + 12 + 8 + dataBytes;
+	uint32 fmtBytes = 18;
+	uint32 factBytes = 4;
+	uint32 frameCount = (uint32)MIN(frames, (uint64)0xFFFFFFFFu);
+	unsigned short format = 3;		// WAVE_FORMAT_IEEE_FLOAT
+	unsigned short channels = MIXER_CHANNELS;
+	unsigned short blockAlign = MIXER_CHANNELS * sizeof(float);
+	unsigned short bits = 32;
+	unsigned short extension = 0;
+
+	fwrite("RIFF", 1, 4, file); fwrite(&riffBytes, 4, 1, file);
+	fwrite("WAVE", 1, 4, file);
+	fwrite("fmt ", 1, 4, file); fwrite(&fmtBytes, 4, 1, file);
+	fwrite(&format, 2, 1, file); fwrite(&channels, 2, 1, file);
+	fwrite(&rate, 4, 1, file); fwrite(&byteRate, 4, 1, file);
+	fwrite(&blockAlign, 2, 1, file); fwrite(&bits, 2, 1, file); fwrite(&extension, 2, 1, file);
+	fwrite("fact", 1, 4, file); fwrite(&factBytes, 4, 1, file); fwrite(&frameCount, 4, 1, file);
+	fwrite("data", 1, 4, file); fwrite(&dataBytes, 4, 1, file);
+}
+
+bool AudioMixer::SetCapture(bool memory, const char* wavPath)
+{
+	CloseCapture();
+	captureMemory = memory;
+
+	if (wavPath != nullptr && wavPath[0] != '\0')
+	{
+		captureFile = fopen(wavPath, "wb");
+		if (captureFile == nullptr)
+		{
+			LOG("ERROR: Cannot write audio capture %s", wavPath);
+			return false;
+		}
+		WriteWavHeader(captureFile, 0);
+		LOG("Writing the audio mix to %s", wavPath);
+	}
+
+	return true;
+}
+
+void AudioMixer::CloseCapture()
+{
+	if (captureFile != nullptr)
+	{
+		fseek(captureFile, 0, SEEK_SET);
+		WriteWavHeader(captureFile, captureFileFrames);
+		fclose(captureFile);
+		captureFile = nullptr;
+
+		LOG("Audio capture closed: %.1f s", (double)captureFileFrames / MIXER_SAMPLE_RATE);
+	}
+	captureFileFrames = 0;
+}
+
+void AudioMixer::Render(uint32 frames)
+{
+	if (!ready || output != MIXER_OUTPUT_OFFLINE)
+		return;
+
+	while (frames > 0)
+	{
+		uint32 count = MIN(frames, (uint32)MIXER_BUFFER_FRAMES);
+
+		streamer.Pump();
+		Mix(renderBuffer, count);
+
+		if (captureMemory) capture.insert(capture.end(), renderBuffer, renderBuffer + count * MIXER_CHANNELS);
+		if (captureFile != nullptr) captureFileFrames += fwrite(renderBuffer, sizeof(float) * MIXER_CHANNELS, count, captureFile);
+
+		offlineFrames += count;
+		frames -= count;
+	}
+}
+
+// Audio thread -----------
+
+void AudioMixer::AudioCallback(void* buffer, unsigned int frames)
+{
+	TRACE_THREAD_NAME("Audio");
+
+	if (instance != nullptr)
+	{
+		instance->Mix((float*)buffer, frames);
+	}
+	else
+	{
+		memset(buffer, 0, frames * MIXER_CHANNELS * sizeof(float));
+	}
+}
+
+void AudioMixer::DeviceCallback(ma_device* device, void* output, const void* input, unsigned int frames)
+{
+	AudioCallback(output, frames);
+}
+
+void AudioMixer::Mix(float* out, unsigned int frames)
+{
+	TRACE_SCOPE_CAT("Mix", "audio");
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	ProcessCommands();
+
+	unsigned int done = 0;
+	while (done < frames)
+	{
+		int block = (int)MIN(frames - done, (unsigned int)MIXER_BLOCK_FRAMES);
+		MixBlock(out + done * MIXER_CHANNELS, block);
+		done += block;
+	}
+
+	// New voices have their first frames in this buffer now
+	if (pendingLatencyCount > 0)
+	{
+		double now = GetPerfTime();
+		for (int i = 0; i < pendingLatencyCount; ++i)
+		{
+			pendingLatency[i].mixTime = now;
+			latencies.Push(pendingLatency[i]);
+		}
+		pendingLatencyCount = 0;
+	}
+
+	int active = 0;
+	for (int i = 0; i < voiceCount; ++i)
+	{
+		if (voices[i].active) active++;
+	}
+
+	float ms = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+	float average = statAverageMs.load(std::memory_order_relaxed);
+
+	statActiveVoices.store(active, std::memory_order_relaxed);
+	statLastMs.store(ms, std::memory_order_relaxed);
+	statAverageMs.store(average + (ms - average) * 0.05f, std::memory_order_relaxed);
+	if (ms > statPeakMs.load(std::memory_order_relaxed)) statPeakMs.store(ms, std::memory_order_relaxed);
+	statFrames.fetch_add(frames, std::memory_order_relaxed);
+	statCallbacks.fetch_add(1, std::memory_order_relaxed);
+}
+
+void AudioMixer::MixBlock(float* out, int frames)
+{
+	int samples = frames * MIXER_CHANNELS;
+	memset(accumulator, 0, samples * sizeof(float));
+	memset(sfxBus, 0, samples * sizeof(float));
+
+	// Music pre-mix straight into the accumulator, effects on their own bus
+	float music0 = busGain[MIXER_BUS_MUSIC];
+	float music1 = busTarget[MIXER_BUS_MUSIC];
+	if (MixMusic(scratch, frames))
+	{
+		MixStereoRamp(accumulator, scratch, frames, music0, music0, music1, music1);
+	}
+
+	for (int i = 0; i < voiceCount; ++i)
+	{
+		if (voices[i].active) MixVoice(voices[i], sfxBus, frames);
+	}
+
+	float sfx0 = busGain[MIXER_BUS_SFX];
+	float sfx1 = busTarget[MIXER_BUS_SFX];
+	MixStereoRamp(accumulator, sfxBus, frames, sfx0, sfx0, sfx1, sfx1);
+
+	WriteOutput(out, accumulator, frames, busGain[MIXER_BUS_MASTER], busTarget[MIXER_BUS_MASTER]);
+
+	// Gain changes take one block to settle, which is enough to avoid zipper clicks
+	for (int i = 0; i < MIXER_BUS_COUNT; ++i)
+	{
+		busGain[i] = busTarget[i];
+	}
+}
+
+void AudioMixer::ProcessCommands()
+{
+	MixerCommand command;
+	while (commands.Pop(command))
+	{
+		switch (command.type)
+		{
+		case MIXER_CMD_PLAY:
+			StartVoice(command);
+			break;
+
+		case MIXER_CMD_STOP_ALL:
+			for (int i = 0; i < MAX_MIXER_VOICES; ++i) voices[i].active = false;
+			break;
+
+		case MIXER_CMD_SET_GAIN:
+			busTarget[command.id] = command.volume;
+			break;
+
+		case MIXER_CMD_SET_VOICE_COUNT:
+			for (int i = command.id; i < voiceCount; ++i) voices[i].active = false;
+			voiceCount = command.id;
+			statVoiceCount.store(voiceCount, std::memory_order_relaxed);
+			break;
+
+		case MIXER_CMD_PLAY_MUSIC:
+		case MIXER_CMD_STOP_MUSIC:
+			lastMusicToken = command.token;
+			for (int i = 0; i < MUSIC_DECKS; ++i)
+			{
+				deckWanted[i] = 0;
+				if (streamer.GetState(i) == MUSIC_DECK_PLAYING)
+				{
+					deckFadeStep[i] = -1.0f / command.fadeFrames;
+				}
+			}
+
+			if (command.type == MIXER_CMD_PLAY_MUSIC)
+			{
+				deckWanted[command.id] = command.token;
+				deckFadeFrames[command.id] = command.fadeFrames;
+			}
+			break;
+		}
+	}
+}
+
+void AudioMixer::StartVoice(const MixerCommand& command)
+{
+	int index = AcquireVoice(samples[command.id - 1].group, command.priority);
+	if (index < 0)
+	{
+		statDropped.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	Voice& voice = voices[index];
+	voice.sample = command.id;
+	voice.group = samples[command.id - 1].group;
+	voice.position = 0.0;
+	voice.step = command.pitch;
+	voice.priority = command.priority;
+	voice.startedAt = ++voiceSequence;
+	voice.active = true;
+	PanGains(command.volume, command.pan, voice.gainL, voice.gainR);
+
+	if (command.contactTime > 0.0 && pendingLatencyCount < MIXER_COMMAND_QUEUE)
+	{
+		pendingLatency[pendingLatencyCount++] = { command.contactTime, command.postTime, 0.0 };
+	}
+}
+
+// Once the group reaches MAX_VOICES_PER_SAMPLE, its lowest priority / oldest voice that isn't
+// above the requested priority, or nothing. Otherwise a free voice, then the lowest priority /
+// oldest voice that isn't above the requested priority
+int AudioMixer::AcquireVoice(int group, int priority)
+{
+	int freeVoice = -1;
+	int sameVictim = -1;
+	int sameCount = 0;
+	int victim = -1;
+
+	for (int i = 0; i < voiceCount; ++i)
+	{
+		Voice& voice = voices[i];
+
+		if (!voice.active)
+		{
+			if (freeVoice < 0) freeVoice = i;
+			continue;
+		}
+
+		if (voice.group == group)
+		{
+			sameCount++;
+			if (sameVictim < 0 ||
+				voice.priority < voices[sameVictim].priority ||
+				(voice.priority == voices[sameVictim].priority && voice.startedAt < voices[sameVictim].startedAt))
+			{
+				sameVictim = i;
+			}
+		}
+
+		if (victim < 0 ||
+			voice.priority < voices[victim].priority ||
+			(voice.priority == voices[victim].priority && voice.startedAt < voices[victim].startedAt))
+		{
+			victim = i;
+		}
+	}
+
+	if (sameCount >= MAX_VOICES_PER_SAMPLE)
+	{
+		if (voices[sameVictim].priority > priority) return -1;
+
+		statStolen.fetch_add(1, std::memory_order_relaxed);
+		return sameVictim;
+	}
+
+	if (freeVoice >= 0)
+		return freeVoice;
+
+	if (victim >= 0 && voices[victim].priority <= priority)
+	{
+		statStolen.fetch_add(1, std::memory_order_relaxed);
+		return victim;
+	}
+
+	return -1;
+}
+
+void AudioMixer::MixVoice(Voice& voice, float* acc, int frames)
+{
+	const Sample& sample = samples[voice.sample - 1];
+	int count = 0;
+
+	if (voice.step == 1.0f)
+	{
+		// Unpitched voices mix straight from the sample data
+		uint32 position = (uint32)voice.position;
+		count = (int)MIN((uint32)frames, sample.frames - position);
+		MixStereoRamp(acc, sample.data + position * MIXER_CHANNELS, count, voice.gainL, voice.gainR, voice.gainL, voice.gainR);
+		voice.position += count;
+	}
+	else
+	{
+		// Linear interpolation into scratch, then the same kernel
+		double position = voice.position;
+		uint32 last = sample.frames - 1;
+		for (; count < frames; ++count)
+		{
+			uint32 index = (uint32)position;
+			if (index >= last) break;
+
+			float t = (float)(position - index);
+			const float* a = sample.data + index * MIXER_CHANNELS;
+			scratch[count * 2] = a[0] + (a[2] - a[0]) * t;
+			scratch[count * 2 + 1] = a[1] + (a[3] - a[1]) * t;
+			position += voice.step;
+		}
+
+		if (count > 0)
+		{
+			MixStereoRamp(acc, scratch, count, voice.gainL, voice.gainR, voice.gainL, voice.gainR);
+		}
+		voice.position = position;
+		if (count < frames) voice.position = sample.frames;
+	}
+
+	if (voice.position >= sample.frames)
+	{
+		voice.active = false;
+	}
+}
+
+// Sum every playing deck into dst with its crossfade gain. Returns false if nothing was playing
+bool AudioMixer::MixMusic(float* dst, int frames)
+{
+	bool any = false;
+	memset(dst, 0, frames * MIXER_CHANNELS * sizeof(float));
+
+	for (int i = 0; i < MUSIC_DECKS; ++i)
+	{
+		MusicDeckState state = streamer.GetState(i);
+
+		if (state == MUSIC_DECK_PRIMED)
+		{
+			uint32 token = streamer.GetToken(i);
+
+			if (token != 0 && token == deckWanted[i])
+			{
+				deckGain[i] = 0.0f;
+				deckFadeStep[i] = 1.0f / deckFadeFrames[i];
+				streamer.SetState(i, MUSIC_DECK_PLAYING);
+				state = MUSIC_DECK_PLAYING;
+			}
+			else if (token <= lastMusicToken)
+			{
+				// Superseded before it ever started
+				streamer.SetState(i, MUSIC_DECK_RELEASED);
+				continue;
+			}
+		}
+
+		if (state != MUSIC_DECK_PLAYING)
+			continue;
+
+		uint32 got = streamer.Read(i, deckBuffer, frames);
+		if (got < (uint32)frames)
+		{
+			if (!streamer.IsEnded(i)) statUnderruns.fetch_add(1, std::memory_order_relaxed);
+			memset(deckBuffer + got * MIXER_CHANNELS, 0, (frames - got) * MIXER_CHANNELS * sizeof(float));
+		}
+
+		float g0 = deckGain[i];
+		float g1 = g0 + deckFadeStep[i] * frames;
+		if (g1 >= 1.0f) { g1 = 1.0f; deckFadeStep[i] = 0.0f; }
+		if (g1 < 0.0f) g1 = 0.0f;
+
+		MixStereoRamp(dst, deckBuffer, frames, g0, g0, g1, g1);
+		deckGain[i] = g1;
+		any = true;
+
+		// Faded out, or a one-shot file that ran dry
+		if ((g1 <= 0.0f && deckFadeStep[i] < 0.0f) || (got == 0 && streamer.IsEnded(i)))
+		{
+			deckFadeStep[i] = 0.0f;
+			streamer.SetState(i, MUSIC_DECK_RELEASED);
+		}
+	}
+
+	return any;
+}
@@ -0,0 +1,226 @@
+#include "Globals.h"
+#include "FlightRecorder.h"
+#include "Timer.h"
+
+#include <signal.h>
+#include <string.h>
+#include <fcntl.h>
+
+#ifdef _WIN32
+#include <io.h>
+#include <sys/stat.h>
+#define FLIGHT_OPEN(path)			_open(path, _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, _S_IREAD | _S_IWRITE)
+#define FLIGHT_WRITE(fd, data, size)	_write(fd, data, (unsigned int)(size))
+#define FLIGHT_CLOSE(fd)			_close(fd)
+#else
+#include <unistd.h>
+#define FLIGHT_OPEN(path)			open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644)
+#define FLIGHT_WRITE(fd, data, size)	write(fd, data, size)
+#define FLIGHT_CLOSE(fd)			close(fd)
+#endif
+
+static FlightRecorder* crashRecorder = nullptr;
+
+static void OnCrashSignal(int sig)
+{
+	if (crashRecorder != nullptr)
+	{
+		crashRecorder->Dump(sig == SIGSEGV ? FLIGHT_DUMP_SIGSEGV : FLIGHT_DUMP_SIGABRT);
+		crashRecorder = nullptr;
+	}
+
+	// Let the default action produce the usual crash
+	signal(sig, SIG_DFL);
+	raise(sig);
+}
+
+FlightRecorder::FlightRecorder()
+{
+	records = new FlightRecord[FLIGHT_RECORDER_CAPACITY];
+	memset(records, 0, sizeof(FlightRecord) * FLIGHT_RECORDER_CAPACITY);
+}
+
+FlightRecorder::~FlightRecorder()
+{
+	Uninstall();
+	delete[] records;
+	records = nullptr;
+}
+
+void FlightRecorder::Install(const char* dumpPath)
+{
+	strncpy(path, dumpPath, sizeof(path) - 1);
+	path[sizeof(path) - 1] = '\0';
+
+	crashRecorder = this;
+	signal(SIGSEGV, OnCrashSignal);
+	signal(SIGABRT, OnCrashSignal);
+}
+
+void FlightRecorder::Uninstall()
+{
+	if (crashRecorder != this) return;
+
+	crashRecorder = nullptr;
+	signal(SIGSEGV, SIG_DFL);
+	signal(SIGABRT, SIG_DFL);
+}
+
+FlightRecord& FlightRecorder::Push(int type, int code)
+{
+	FlightRecord& record = records[written & (FLIGHT_RECORDER_CAPACITY - 1)];
+	record.time = GetPerfTime();
+	record.frame = currentFrame;
+	record.type = (unsigned short)type;
+	record.code = (unsigned short)code;
+	written++;
+	return record;
+}
+
+void FlightRecorder::Frame(float dtMs, float updateMs, int allocations)
+{
+	FlightRecord& record = Push(FLIGHT_FRAME, 0);
+	record.i[0] = allocations;
+	record.f[1] = dtMs;
+	record.f[2] = updateMs;
+	record.f[3] = 0.0f;
+}
+
+void FlightRecorder::Ball(float x, float y, float vx, float vy)
+{
+	FlightRecord& record = Push(FLIGHT_BALL, 0);
+	record.f[0] = x;
+	record.f[1] = y;
+	record.f[2] = vx;
+	record.f[3] = vy;
+}
+
+void FlightRecorder::Contact(int type, float x, float y, float force)
+{
+	FlightRecord& record = Push(FLIGHT_CONTACT, type);
+	record.f[0] = x;
+	record.f[1] = y;
+	record.f[2] = force;
+	record.f[3] = 0.0f;
+}
+
+void FlightRecorder::Input(int key, bool down)
+{
+	FlightRecord& record = Push(FLIGHT_INPUT, key);
+	record.i[0] = down ? 1 : 0;
+	record.i[1] = record.i[2] = record.i[3] = 0;
+}
+
+void FlightRecorder::State(int previous, int current)
+{
+	FlightRecord& record = Push(FLIGHT_STATE, current);
+	record.i[0] = previous;
+	record.i[1] = record.i[2] = record.i[3] = 0;
+}
+
+void FlightRecorder::OnScoreChanged(const ScoreChangedEvent* events, int count)
+{
+	for (int n = 0; n < count; ++n)
+	{
+		FlightRecord& record = Push(FLIGHT_SCORE, 0);
+		record.i[0] = events[n].previousScore;
+		record.i[1] = events[n].currentScore;
+		record.i[2] = record.i[3] = 0;
+	}
+}
+
+void FlightRecorder::OnBallLost(const BallLostEvent* events, int count)
+{
+	for (int n = 0; n < count; ++n)
+	{
+		FlightRecord& record = Push(FLIGHT_BALL_LOST, 0);
+		record.i[0] = events[n].ballsLeft;
+		record.i[1] = record.i[2] = record.i[3] = 0;
+	}
+}
+
+// "_<frame>" goes before the extension of a hotkey dump, the other reasons use path as is
+void FlightRecorder::MakeDumpPath(int reason)
+{
+	int length = 0;
+	while (path[length] != '\0') length++;
+
+	int extension = length;
+	for (int i = length - 1; i >= 0 && path[i] != '/' && path[i] != '\\'; --i)
+	{
+		if (path[i] == '.')
+		{
+			extension = i;
+			break;
+		}
+	}
+
+	int out = 0;
+	for (int i = 0; i < extension; ++i) dumpPath[out++] = path[i];
+
+	if (reason == FLIGHT_DUMP_HOTKEY)
+	{
+		char digits[10];
+		int digitCount = 0;
+		uint32 frame = currentFrame;
+		do
+		{
+			digits[digitCount++] = (char)('0' + frame % 10);
+			frame /= 10;
+		} while (frame > 0);
+
+		dumpPath[out++] = '_';
+		while (digitCount > 0) dumpPath[out++] = digits[--digitCount];
+	}
+
+	for (int i = extension; i < length; ++i) dumpPath[out++] = path[i];
+	dumpPath[out] = '\0';
+}
+
+// Only open/write/close and plain loops in here, it runs inside signal handlers
+bool FlightRecorder::Dump(int reason)
+{
+	FlightRecord& mark = Push(FLIGHT_MARK, reason);
+	mark.i[0] = mark.i[1] = mark.i[2] = mark.i[3] = 0;
+
+	uint64 end = written;
+	uint64 begin = end > FLIGHT_RECORDER_CAPACITY ? end - FLIGHT_RECORDER_CAPACITY : 0;
+
+	double newest = records[(end - 1) & (FLIGHT_RECORDER_CAPACITY - 1)].time;
+	while (begin < end && records[begin & (FLIGHT_RECORDER_CAPACITY - 1)].time < newest - FLIGHT_RECORDER_SECONDS)
+	{
+		begin++;
+	}
+
+	MakeDumpPath(reason);
+	int fd = FLIGHT_OPEN(dumpPath);
+	if (fd < 0) return false;
+
+	FlightFileHeader header;
+	memcpy(header.magic, "PBFR", 4);
+	header.version = FLIGHT_RECORDER_VERSION;
+	header.recordSize = sizeof(FlightRecord);
+	header.count = (uint32)(end - begin);
+	header.reason = (uint32)reason;
+	header.lastFrame = currentFrame;
+	header.dumpTime = newest;
+
+	bool ok = FLIGHT_WRITE(fd, &header, sizeof(header)) == (int)sizeof(header);
+
+	// The live range wraps at most once
+	uint32 first = (uint32)(begin & (FLIGHT_RECORDER_CAPACITY - 1));
+	uint32 firstCount = MIN(header.count, FLIGHT_RECORDER_CAPACITY - first);
+	if (ok && firstCount > 0)
+	{
+		ok = FLIGHT_WRITE(fd, records + first, sizeof(FlightRecord) * firstCount) == (int)(sizeof(FlightRecord) * firstCount);
+	}
+	if (ok && header.count > firstCount)
+	{
+		uint32 rest = header.count - firstCount;
+		ok = FLIGHT_WRITE(fd, records, sizeof(FlightRecord) * rest) == (int)(sizeof(FlightRecord) * rest);
+	}
+
+	FLIGHT_CLOSE(fd);
+	dumps++;
+	return ok;
+}
@@ -0,0 +1,55 @@
+#include "Globals.h"
+#include "FrameArena.h"
+
+#include <stdlib.h>
+
+FrameArena::FrameArena(size_t capacity) : capacity(capacity)
+{
+	memory = (char*)malloc(capacity);
+	if (memory == nullptr)
+	{
+		LOG("ERROR: Cannot allocate %u KB frame arena, every frame allocation will use the heap", (uint32)(capacity / 1024));
+		this->capacity = 0;
+	}
+}
+
+FrameArena::~FrameArena()
+{
+	free(memory);
+	memory = nullptr;
+}
+
+void* FrameArena::Allocate(size_t size, size_t alignment)
+{
+	size_t start = (used + alignment - 1) & ~(alignment - 1);
+	if (start + size <= capacity)
+	{
+		used = start + size;
+		return memory + start;
+	}
+
+	// Overflow: still works, but through the heap. Logged once per frame
+	if (frameOverflows++ == 0)
+	{
+		LOG("Frame arena overflow: %u bytes requested with %u of %u bytes used",
+			(uint32)size, (uint32)used, (uint32)capacity);
+	}
+	overflows++;
+	return malloc(size > 0 ? size : 1);
+}
+
+void FrameArena::Free(void* ptr)
+{
+	// Arena memory goes away on Reset(); only overflow blocks are real heap blocks
+	if (ptr != nullptr && !Owns(ptr)) free(ptr);
+}
+
+void FrameArena::Reset()
+{
+	lastFrameUsed = used;
+	highWater = MAX(highWater, used);
+	lastFrameOverflows = frameOverflows;
+
+	used = 0;
+	frameOverflows = 0;
+}
@@ -0,0 +1,234 @@
+#include "Globals.h"
+#include "InputScript.h"
+
+#include "raylib.h"
+
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct KeyName
+{
+	const char* name;
+	int key;
+};
+
+// Keys the game reacts to, anything else is written as its raylib key code
+static const KeyName KEY_NAMES[] = {
+	{ "LEFT", KEY_LEFT }, { "RIGHT", KEY_RIGHT }, { "DOWN", KEY_DOWN }, { "UP", KEY_UP },
+	{ "SPACE", KEY_SPACE }, { "ESCAPE", KEY_ESCAPE }, { "ENTER", KEY_ENTER },
+	{ "P", KEY_P }, { "M", KEY_M }, { "R", KEY_R }, { "S", KEY_S },
+	{ "F1", KEY_F1 }, { "F2", KEY_F2 },
+	{ "1", KEY_ONE }, { "2", KEY_TWO }, { "3", KEY_THREE }, { "4", KEY_FOUR }, { "5", KEY_FIVE }, { "6", KEY_SIX }
+};
+
+static int ParseKey(const char* text)
+{
+	for (const KeyName& entry : KEY_NAMES)
+	{
+		if (strcmp(entry.name, text) == 0) return entry.key;
+	}
+
+	char* end = nullptr;
+	long key = strtol(text, &end, 10);
+	return (end != text && *end == '\0' && key > 0 && key < MAX_INPUT_KEYS) ? (int)key : -1;
+}
+
+static void WriteKey(FILE* file, int key)
+{
+	for (const KeyName& entry : KEY_NAMES)
+	{
+		if (entry.key == key)
+		{
+			fprintf(file, "%s", entry.name);
+			return;
+		}
+	}
+	fprintf(file, "%d", key);
+}
+
+InputScript::InputScript()
+{
+	memset(down, 0, sizeof(down));
+	memset(previous, 0, sizeof(previous));
+}
+
+InputScript::~InputScript()
+{
+	Finish();
+}
+
+bool InputScript::Load(const char* path)
+{
+	FILE* file = fopen(path, "r");
+	if (file == nullptr)
+	{
+		LOG("ERROR: Cannot open input script %s", path);
+		return false;
+	}
+
+	events.clear();
+	char line[128];
+	int lineNumber = 0;
+
+	while (fgets(line, sizeof(line), file))
+	{
+		lineNumber++;
+		char* comment = strchr(line, '#');
+		if (comment) *comment = '\0';
+
+		unsigned int frame = 0;
+		char key[32] = {};
+		char state[8] = {};
+		int fields = sscanf(line, "%u %31s %7s", &frame, key, state);
+		if (fields <= 0)
+			continue;
+
+		int code = fields == 3 ? ParseKey(key) : -1;
+		if (code < 0 || (strcmp(state, "down") != 0 && strcmp(state, "up") != 0))
+		{
+			LOG("Input script %s:%d: ignoring '%s'", path, lineNumber, line);
+			continue;
+		}
+
+		events.push_back({ frame, code, strcmp(state, "down") == 0 });
+	}
+	fclose(file);
+
+	std::stable_sort(events.begin(), events.end(), [](const InputEvent& a, const InputEvent& b) { return a.frame < b.frame; });
+
+	next = 0;
+	lastFrame = events.empty() ? 0 : events.back().frame;
+	playing = true;
+
+	LOG("Loaded input script %s: %d transitions over %u frames", path, (int)events.size(), lastFrame);
+	return true;
+}
+
+void InputScript::AddPress(uint32 frame, int key, uint32 holdFrames)
+{
+	events.push_back({ frame, key, true });
+	events.push_back({ frame + holdFrames, key, false });
+}
+
+void InputScript::GenerateLatencyRun(int seconds)
+{
+	const uint32 fps = 60;
+	const uint32 end = (uint32)MAX(seconds, 1) * fps;
+
+	events.clear();
+
+	// Leave the menu, then every few seconds restart if the game ended and launch a ball
+	AddPress(30, KEY_SPACE, 2);
+	for (uint32 frame = 60; frame + 5 * fps < end; frame += 5 * fps)
+	{
+		AddPress(frame, KEY_R, 2);
+		AddPress(frame + 10, KEY_DOWN, 45);
+	}
+
+	// Alternate short flips so the ball keeps hitting flippers, walls and bumpers
+	int side = 0;
+	for (uint32 frame = 90; frame + 8 < end; frame += 17)
+	{
+		AddPress(frame, side ? KEY_RIGHT : KEY_LEFT, 8);
+		side ^= 1;
+	}
+
+	std::stable_sort(events.begin(), events.end(), [](const InputEvent& a, const InputEvent& b) { return a.frame < b.frame; });
+
+	next = 0;
+	lastFrame = end;
+	playing = true;
+
+	LOG("Generated latency input run: %d transitions over %u frames", (int)events.size(), lastFrame);
+}
+
+bool InputScript::StartRecording(const char* path)
+{
+	if (path == nullptr || path[0] == '\0')
+		return false;
+
+	recordPath = path;
+	recorded.clear();
+	recording = true;
+
+	LOG("Recording input to %s", path);
+	return true;
+}
+
+void InputScript::Finish()
+{
+	if (!recording)
+		return;
+
+	recording = false;
+
+	FILE* file = fopen(recordPath.c_str(), "w");
+	if (file == nullptr)
+	{
+		LOG("ERROR: Cannot write input recording %s", recordPath.c_str());
+		return;
+	}
+
+	fprintf(file, "# frame key down|up\n");
+	for (const InputEvent& event : recorded)
+	{
+		fprintf(file, "%u ", event.frame);
+		WriteKey(file, event.key);
+		fprintf(file, " %s\n", event.down ? "down" : "up");
+	}
+	fclose(file);
+
+	LOG("Saved %d input transitions to %s", (int)recorded.size(), recordPath.c_str());
+}
+
+void InputScript::BeginFrame(uint32 frame)
+{
+	currentFrame = frame;
+	memcpy(previous, down, sizeof(down));
+
+	if (playing)
+	{
+		while (next < events.size() && events[next].frame <= frame)
+		{
+			down[events[next].key] = events[next].down;
+			next++;
+		}
+	}
+	else
+	{
+		// Polled every frame so transitions are known even when nothing is recorded
+		for (int key = 1; key < MAX_INPUT_KEYS; ++key)
+		{
+			down[key] = ::IsKeyDown(key);
+		}
+	}
+
+	transitionCount = 0;
+	for (int key = 1; key < MAX_INPUT_KEYS; ++key)
+	{
+		if (down[key] == previous[key]) continue;
+
+		if (recording) recorded.push_back({ frame, key, down[key] });
+		if (transitionCount < MAX_INPUT_TRANSITIONS) transitions[transitionCount++] = { frame, key, down[key] };
+	}
+}
+
+bool InputScript::IsKeyDown(int key) const
+{
+	if (!playing && !recording) return ::IsKeyDown(key);
+	return key > 0 && key < MAX_INPUT_KEYS && down[key];
+}
+
+bool InputScript::IsKeyPressed(int key) const
+{
+	if (!playing && !recording) return ::IsKeyPressed(key);
+	return key > 0 && key < MAX_INPUT_KEYS && down[key] && !previous[key];
+}
+
+bool InputScript::IsKeyReleased(int key) const
+{
+	if (!playing && !recording) return ::IsKeyReleased(key);
+	return key > 0 && key < MAX_INPUT_KEYS && !down[key] && previous[key];
+}
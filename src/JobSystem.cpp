@@ -0,0 +1,334 @@
+#include "Globals.h"
+#include "JobSystem.h"
+#include "Trace.h"
+
+#define JOB_SPIN_ROUNDS		64		// Failed steal rounds before a worker goes to sleep
+
+// Deque index of the current thread: 0 for anything that isn't a worker
+static thread_local int currentQueue = 0;
+
+// Short critical sections only, so a spin lock beats a mutex here
+class SpinLock
+{
+public:
+
+	void Lock()
+	{
+		while (flag.test_and_set(std::memory_order_acquire))
+		{
+			std::this_thread::yield();
+		}
+	}
+
+	void Unlock() { flag.clear(std::memory_order_release); }
+
+private:
+
+	std::atomic_flag flag = ATOMIC_FLAG_INIT;
+};
+
+// Cache-line aligned so neighbouring workers don't share their hot counters
+struct alignas(64) JobSystem::WorkQueue
+{
+	SpinLock lock;
+	Job jobs[JOB_QUEUE_SIZE];
+	uint32 front = 0;		// Oldest job, taken by thieves
+	uint32 back = 0;		// Newest job, taken by the owner
+	std::atomic<uint64> executed{ 0 };
+	std::atomic<uint64> stolen{ 0 };
+};
+
+static void ParallelForJob(void* data);
+
+struct ParallelForState
+{
+	ParallelForFunction function;
+	void* data;
+	int count;
+	int batchSize;
+	std::atomic<int> next{ 0 };
+};
+
+// Every participant keeps taking the next batch until none are left,
+// so uneven batches balance themselves
+static void ParallelForJob(void* data)
+{
+	ParallelForState* state = (ParallelForState*)data;
+	while (true)
+	{
+		int begin = state->next.fetch_add(state->batchSize, std::memory_order_relaxed);
+		if (begin >= state->count) break;
+		state->function(state->data, begin, MIN(begin + state->batchSize, state->count));
+	}
+}
+
+JobSystem::JobSystem()
+{
+}
+
+JobSystem::~JobSystem()
+{
+	Stop();
+}
+
+bool JobSystem::Start(int workerCount)
+{
+	Stop();
+
+	workerCount = MIN(MAX(workerCount, 0), MAX_JOB_WORKERS);
+	mainThread = std::this_thread::get_id();
+	currentQueue = 0;
+
+	queueCount = workerCount + 1;
+	queues = new WorkQueue[queueCount];
+	mainQueue = new WorkQueue();
+
+	quit.store(false);
+	workers.reserve(workerCount);
+	for (int i = 0; i < workerCount; ++i)
+	{
+		workers.emplace_back(&JobSystem::WorkerLoop, this, i + 1);
+	}
+
+	LOG("Job system: %d worker threads", workerCount);
+	return true;
+}
+
+void JobSystem::Stop()
+{
+	if (queues == nullptr) return;
+
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+		quit.store(true);
+	}
+	wake.notify_all();
+
+	for (std::thread& worker : workers)
+	{
+		worker.join();
+	}
+	workers.clear();
+
+	// Whatever is left still has fences waiting on it
+	RunMainThreadJobs();
+	while (RunOne()) {}
+
+	delete[] queues;
+	queues = nullptr;
+	delete mainQueue;
+	mainQueue = nullptr;
+	queueCount = 0;
+}
+
+bool JobSystem::IsMainThread() const
+{
+	return std::this_thread::get_id() == mainThread;
+}
+
+void JobSystem::Run(JobFunction function, void* data, JobFence* fence)
+{
+	Job job = { function, data, fence };
+	if (fence != nullptr) fence->pending.fetch_add(1, std::memory_order_relaxed);
+
+	if (workers.empty() || !Push(queues[currentQueue], job))
+	{
+		Execute(job, currentQueue);
+		return;
+	}
+
+	queued.fetch_add(1);
+	WakeWorker();
+}
+
+void JobSystem::RunOnMainThread(JobFunction function, void* data, JobFence* fence)
+{
+	Job job = { function, data, fence };
+	if (fence != nullptr) fence->pending.fetch_add(1, std::memory_order_relaxed);
+
+	if (mainQueue == nullptr || IsMainThread())
+	{
+		Execute(job, 0);
+		return;
+	}
+
+	// A full main queue has to wait for the next frame's RunMainThreadJobs()
+	while (!Push(*mainQueue, job))
+	{
+		std::this_thread::yield();
+	}
+}
+
+void JobSystem::Wait(JobFence* fence)
+{
+	while (!fence->IsDone())
+	{
+		if (!RunOne()) std::this_thread::yield();
+	}
+}
+
+void JobSystem::ParallelFor(int count, int batchSize, ParallelForFunction function, void* data)
+{
+	if (count <= 0) return;
+	if (batchSize < 1) batchSize = 1;
+
+	ParallelForState state;
+	state.function = function;
+	state.data = data;
+	state.count = count;
+	state.batchSize = batchSize;
+
+	// One helper per worker at most, the caller is a participant too
+	int batches = (count + batchSize - 1) / batchSize;
+	int helpers = MIN(batches - 1, (int)workers.size());
+
+	JobFence fence;
+	for (int i = 0; i < helpers; ++i)
+	{
+		Run(&ParallelForJob, &state, &fence);
+	}
+
+	ParallelForJob(&state);
+	Wait(&fence);
+}
+
+void JobSystem::RunMainThreadJobs()
+{
+	Job job;
+	while (mainQueue != nullptr && PopFront(*mainQueue, job))
+	{
+		Execute(job, 0);
+	}
+}
+
+bool JobSystem::RunOne()
+{
+	if (queues == nullptr) return false;
+
+	Job job;
+	if (IsMainThread() && PopFront(*mainQueue, job))
+	{
+		Execute(job, 0);
+		return true;
+	}
+
+	if (!FindJob(currentQueue, job)) return false;
+
+	Execute(job, currentQueue);
+	return true;
+}
+
+uint64 JobSystem::GetJobsRun() const
+{
+	uint64 total = 0;
+	for (int i = 0; i < queueCount; ++i) total += queues[i].executed.load(std::memory_order_relaxed);
+	return total;
+}
+
+uint64 JobSystem::GetSteals() const
+{
+	uint64 total = 0;
+	for (int i = 0; i < queueCount; ++i) total += queues[i].stolen.load(std::memory_order_relaxed);
+	return total;
+}
+
+bool JobSystem::Push(WorkQueue& queue, const Job& job)
+{
+	queue.lock.Lock();
+	bool pushed = queue.back - queue.front < JOB_QUEUE_SIZE;
+	if (pushed) queue.jobs[queue.back++ % JOB_QUEUE_SIZE] = job;
+	queue.lock.Unlock();
+	return pushed;
+}
+
+bool JobSystem::PopBack(WorkQueue& queue, Job& job)
+{
+	queue.lock.Lock();
+	bool popped = queue.back != queue.front;
+	if (popped) job = queue.jobs[--queue.back % JOB_QUEUE_SIZE];
+	queue.lock.Unlock();
+	return popped;
+}
+
+bool JobSystem::PopFront(WorkQueue& queue, Job& job)
+{
+	queue.lock.Lock();
+	bool popped = queue.back != queue.front;
+	if (popped) job = queue.jobs[queue.front++ % JOB_QUEUE_SIZE];
+	queue.lock.Unlock();
+	return popped;
+}
+
+// Own deque newest first, then the oldest job of any other, starting next door
+bool JobSystem::FindJob(int queueIndex, Job& job)
+{
+	if (queued.load(std::memory_order_relaxed) == 0) return false;
+
+	if (PopBack(queues[queueIndex], job))
+	{
+		queued.fetch_sub(1);
+		return true;
+	}
+
+	for (int i = 1; i < queueCount; ++i)
+	{
+		int victim = (queueIndex + i) % queueCount;
+		if (PopFront(queues[victim], job))
+		{
+			queued.fetch_sub(1);
+			queues[queueIndex].stolen.fetch_add(1, std::memory_order_relaxed);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void JobSystem::Execute(const Job& job, int queueIndex)
+{
+	job.function(job.data);
+	if (job.fence != nullptr) job.fence->pending.fetch_sub(1, std::memory_order_release);
+
+	if (queues != nullptr) queues[queueIndex].executed.fetch_add(1, std::memory_order_relaxed);
+}
+
+// Pairs with the check in WorkerLoop: either the worker sees the new job or we see it asleep
+void JobSystem::WakeWorker()
+{
+	if (sleeping.load() == 0) return;
+
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+	}
+	wake.notify_one();
+}
+
+void JobSystem::WorkerLoop(int queueIndex)
+{
+	TRACE_THREAD_NAME("Job worker");
+	currentQueue = queueIndex;
+
+	int idleRounds = 0;
+	while (!quit.load(std::memory_order_relaxed))
+	{
+		Job job;
+		if (FindJob(queueIndex, job))
+		{
+			Execute(job, queueIndex);
+			idleRounds = 0;
+			continue;
+		}
+
+		if (++idleRounds < JOB_SPIN_ROUNDS)
+		{
+			std::this_thread::yield();
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(sleepMutex);
+		sleeping.fetch_add(1);
+		wake.wait(lock, [this] { return quit.load() || queued.load() > 0; });
+		sleeping.fetch_sub(1);
+		idleRounds = 0;
+	}
+}
@@ -0,0 +1,86 @@
+#include "Globals.h"
+#include "LatencyHistogram.h"
+
+#include <string.h>
+
+#define HISTOGRAM_ROWS		16
+#define HISTOGRAM_BAR		40
+
+LatencyHistogram::LatencyHistogram()
+{
+	Reset();
+}
+
+void LatencyHistogram::Reset()
+{
+	memset(bins, 0, sizeof(bins));
+	count = 0;
+	minMs = 0.0f;
+	maxMs = 0.0f;
+	sumMs = 0.0;
+}
+
+void LatencyHistogram::Add(float ms)
+{
+	if (ms < 0.0f) ms = 0.0f;
+
+	int bin = (int)(ms / LATENCY_BIN_MS);
+	bins[MIN(bin, LATENCY_BINS - 1)]++;
+
+	if (count == 0 || ms < minMs) minMs = ms;
+	if (ms > maxMs) maxMs = ms;
+	sumMs += ms;
+	count++;
+}
+
+float LatencyHistogram::GetPercentile(float fraction) const
+{
+	if (count == 0)
+		return 0.0f;
+
+	uint32 target = (uint32)(fraction * count);
+	if (target >= count) target = count - 1;
+
+	uint32 seen = 0;
+	for (int i = 0; i < LATENCY_BINS; ++i)
+	{
+		seen += bins[i];
+		if (seen > target)
+			return MIN((i + 1) * LATENCY_BIN_MS, maxMs);
+	}
+	return maxMs;
+}
+
+void LatencyHistogram::Print(const char* title) const
+{
+	LOG("%s: %u samples, min %.2f ms, mean %.2f ms, p50 %.2f ms, p90 %.2f ms, p99 %.2f ms, max %.2f ms",
+		title, count, GetMin(), GetMean(), GetPercentile(0.5f), GetPercentile(0.9f), GetPercentile(0.99f), GetMax());
+
+	if (count == 0)
+		return;
+
+	// Merge bins so the occupied range fits in HISTOGRAM_ROWS lines
+	int first = MIN((int)(minMs / LATENCY_BIN_MS), LATENCY_BINS - 1);
+	int last = MIN((int)(maxMs / LATENCY_BIN_MS), LATENCY_BINS - 1);
+	int perRow = (last - first) / HISTOGRAM_ROWS + 1;
+
+	uint32 rows[HISTOGRAM_ROWS + 1] = {};
+	uint32 peak = 1;
+	for (int i = first; i <= last; ++i)
+	{
+		uint32& row = rows[(i - first) / perRow];
+		row += bins[i];
+		peak = MAX(peak, row);
+	}
+
+	char bar[HISTOGRAM_BAR + 1];
+	for (int r = 0; r * perRow + first <= last; ++r)
+	{
+		int width = (int)((uint64)rows[r] * HISTOGRAM_BAR / peak);
+		memset(bar, '#', width);
+		bar[width] = '\0';
+
+		float from = (first + r * perRow) * LATENCY_BIN_MS;
+		LOG("  %6.2f - %6.2f ms | %-40s %u", from, from + perRow * LATENCY_BIN_MS, bar, rows[r]);
+	}
+}
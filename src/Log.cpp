@@ -5,9 +5,10 @@
 
 void log(const char file[], int line, const char* format, ...)
 {
-	static char tmp_string[4096];
-	static char tmp_string2[4096];
-	static va_list  ap;
+	// Locals, so the music streamer thread can log alongside the game thread
+	char tmp_string[4096];
+	char tmp_string2[4096];
+	va_list  ap;
 
 	// Construct the string from variable arguments
 	va_start(ap, format);
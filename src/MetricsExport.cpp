@@ -0,0 +1,122 @@
+#ifdef _WIN32
+// Keep windows.h away from the raylib names it would clash with
+#define WIN32_LEAN_AND_MEAN
+#define NOGDI
+#define NOUSER
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include "Globals.h"
+#include "MetricsExport.h"
+
+#include <new>
+#include <stdio.h>
+#include <string.h>
+
+MetricsExport::MetricsExport()
+{
+}
+
+MetricsExport::~MetricsExport()
+{
+	Close();
+}
+
+bool MetricsExport::Open(const char* segmentName)
+{
+	Close();
+
+	void* memory = nullptr;
+
+#ifdef _WIN32
+	snprintf(name, sizeof(name), "Local\\%s", segmentName);
+	HANDLE handle = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0, sizeof(LiveMetricsSegment), name);
+	if (handle == NULL)
+	{
+		LOG("ERROR: Cannot create metrics segment %s (%lu)", name, GetLastError());
+		return false;
+	}
+
+	memory = MapViewOfFile(handle, FILE_MAP_WRITE, 0, 0, sizeof(LiveMetricsSegment));
+	if (memory == nullptr)
+	{
+		LOG("ERROR: Cannot map metrics segment %s (%lu)", name, GetLastError());
+		CloseHandle(handle);
+		return false;
+	}
+	mapping = handle;
+#else
+	snprintf(name, sizeof(name), "/%s", segmentName);
+	int fd = shm_open(name, O_CREAT | O_RDWR, 0644);
+	if (fd < 0)
+	{
+		LOG("ERROR: Cannot create metrics segment %s", name);
+		return false;
+	}
+
+	if (ftruncate(fd, sizeof(LiveMetricsSegment)) != 0)
+	{
+		LOG("ERROR: Cannot size metrics segment %s", name);
+		close(fd);
+		shm_unlink(name);
+		return false;
+	}
+
+	memory = mmap(nullptr, sizeof(LiveMetricsSegment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (memory == MAP_FAILED)
+	{
+		LOG("ERROR: Cannot map metrics segment %s", name);
+		shm_unlink(name);
+		return false;
+	}
+#endif
+
+	// Zero the payload, then publish the header readers check before trusting it
+	segment = new (memory) LiveMetricsSegment();
+	segment->sequence.store(0, std::memory_order_relaxed);
+	memset(&segment->metrics, 0, sizeof(segment->metrics));
+	segment->size = sizeof(LiveMetricsSegment);
+	segment->version = LIVE_METRICS_VERSION;
+	std::atomic_thread_fence(std::memory_order_release);
+	segment->magic = LIVE_METRICS_MAGIC;
+
+	LOG("Publishing live metrics to shared memory %s", name);
+	return true;
+}
+
+void MetricsExport::Close()
+{
+	if (segment == nullptr) return;
+
+	// Readers still attached see the magic go away
+	segment->magic = 0;
+
+#ifdef _WIN32
+	UnmapViewOfFile(segment);
+	CloseHandle((HANDLE)mapping);
+	mapping = nullptr;
+#else
+	munmap(segment, sizeof(LiveMetricsSegment));
+	shm_unlink(name);
+#endif
+	segment = nullptr;
+}
+
+void MetricsExport::Publish(const LiveMetrics& metrics)
+{
+	if (segment == nullptr) return;
+
+	// Single writer: odd while the payload changes, even again once it is complete
+	uint32 sequence = segment->sequence.load(std::memory_order_relaxed);
+	segment->sequence.store(sequence + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	segment->metrics = metrics;
+
+	segment->sequence.store(sequence + 2, std::memory_order_release);
+}
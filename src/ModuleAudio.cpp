@@ -1,15 +1,88 @@
 #include "Globals.h"
 #include "Application.h"
 #include "ModuleAudio.h"
+#include "PhysBody.h"
+#include "Timer.h"
+#include "Trace.h"
+#include "JobSystem.h"
 
 #include "raylib.h"
 
+#include <string.h>
+
 #define MAX_FX_SOUNDS   64
 
+// Impact variation range shared by PlayFxWithVariation and the hit banks
+#define VARIATION_MIN_PITCH		0.8f
+#define VARIATION_MAX_PITCH		1.2f
+#define VARIATION_MIN_VOLUME	0.6f
+#define VARIATION_MAX_VOLUME	1.0f
+
+// Minimum time between two sounds from the same object, per impact kind
+static const double IMPACT_RETRIGGER_INTERVAL[IMPACT_KIND_COUNT] = {
+	0.05,	// IMPACT_BUMPER
+	0.06,	// IMPACT_FLIPPER
+	0.08	// IMPACT_WALL
+};
+
+// Merge the hits of one batch by source, keeping the strongest one.
+// With mergeAll every event collapses into a single group
+template<typename T>
+static int GroupImpacts(const T* events, int count, ImpactGroup* groups, bool mergeAll)
+{
+	int groupCount = 0;
+
+	for (int i = 0; i < count; ++i)
+	{
+		int g = 0;
+		while (g < groupCount && !mergeAll && groups[g].source != events[i].source) ++g;
+
+		if (g == groupCount)
+		{
+			groups[groupCount++] = { events[i].source, events[i].impactForce, events[i].contactTime };
+			continue;
+		}
+
+		if (events[i].impactForce > groups[g].impactForce) groups[g].impactForce = events[i].impactForce;
+		if (events[i].contactTime < groups[g].contactTime) groups[g].contactTime = events[i].contactTime;
+	}
+
+	return groupCount;
+}
+
+struct SynthRequest
+{
+	SfxPatch patch;
+	uint32 seed;
+	Wave wave = { 0 };
+};
+
+static void SynthesizeBatch(void* data, int begin, int end)
+{
+	SynthRequest* requests = (SynthRequest*)data;
+	for (int i = begin; i < end; ++i)
+	{
+		requests[i].wave = SynthesizeSfx(requests[i].patch, requests[i].seed);
+	}
+}
+
 ModuleAudio::ModuleAudio(Application* app, bool start_enabled) : Module(app, start_enabled)
 {
 	fx_count = 0;
-	music = Music{ 0 };
+
+	// Latency collection, queued sound sequences and offline mixing don't need the game thread
+	DeclareAccess(PHASE_PREUPDATE, RESOURCE_NONE, RESOURCE_NONE);
+	DeclareAccess(PHASE_UPDATE, RESOURCE_NONE, RESOURCE_AUDIO, false);
+	DeclareAccess(PHASE_POSTUPDATE, RESOURCE_NONE, RESOURCE_AUDIO, false);
+
+	for (int i = 0; i < SFX_COUNT; ++i) synthFx[i] = 0;
+	for (int i = 0; i < BUMPER_TIMBRES; ++i) bumperTimbreFx[i] = 0;
+
+	for (int i = 0; i < IMPACT_KIND_COUNT; ++i)
+	{
+		impactsTriggered[i] = 0;
+		impactsSuppressed[i] = 0;
+	}
 		
 	flipperHitFx = 0;
 	bumperHitFx = 0;
@@ -33,35 +106,139 @@ ModuleAudio::~ModuleAudio()
 // Called before render is available
 bool ModuleAudio::Init()
 {
+	TRACE_SCOPE("Load audio");
 	LOG("Loading Audio Mixer");
 	bool ret = true;
 
-    LOG("Loading raylib audio system");
+	latencyReport = App->HasArgument("--latency-test") || App->HasArgument("--latency-report");
+
+	if (!InitMixer())
+	{
+		LOG("Audio mixer unavailable, the game will run without sound");
+	}
+
+	mixer.SetBusGain(MIXER_BUS_MASTER, masterVolume);
+	mixer.SetBusGain(MIXER_BUS_SFX, sfxVolume);
+	mixer.SetBusGain(MIXER_BUS_MUSIC, musicVolume);
+
+	// Pinball SFX are synthesised, --export-sfx <dir> also writes them out as WAVs.
+	// Rendering runs on the job workers, the mixer gets them in order so fx ids stay fixed
+	exportSfxDir = App->GetArgument("--export-sfx");
+
+	SynthRequest synth[SFX_COUNT + BUMPER_TIMBRES - 1];
+	for (int i = 0; i < SFX_COUNT; ++i)
+	{
+		synth[i].patch = GetSfxPatch(i);
+		synth[i].seed = 1;
+	}
+	for (int i = 1; i < BUMPER_TIMBRES; ++i)
+	{
+		synth[SFX_COUNT + i - 1].patch = VarySfxPatch(GetSfxPatch(SFX_BUMPER), i, TIMBRE_VARIATION);
+		synth[SFX_COUNT + i - 1].seed = i + 1;
+	}
 
-    InitAudioDevice();
+	if (IsEnabled())
+	{
+		TRACE_SCOPE("Synthesize fx");
+		App->jobs->ParallelFor(SFX_COUNT + BUMPER_TIMBRES - 1, 1, &SynthesizeBatch, synth);
+	}
+
+	for (int i = 0; i < SFX_COUNT; ++i)
+	{
+		synthFx[i] = AddSynthFx(synth[i].patch, synth[i].seed, synth[i].wave);
+	}
+
+	flipperHitFx = synthFx[SFX_FLIPPER];
+	bumperHitFx = synthFx[SFX_BUMPER];
+	ballLostFx = synthFx[SFX_BALL_LOST];
+	bonusFx = synthFx[SFX_BONUS];
+	comboCompleteFx = synthFx[SFX_COMBO_COMPLETE];
+
+	bumperTimbreFx[0] = bumperHitFx;
+	for (int i = 1; i < BUMPER_TIMBRES; ++i)
+	{
+		SynthRequest& request = synth[SFX_COUNT + i - 1];
+		bumperTimbreFx[i] = AddSynthFx(request.patch, request.seed, request.wave);
+	}
+
+	// Hottest effects get pre-rendered variants. The bonus bank covers every pitch the
+	// combo, extra ball and milestone cues ask for (0.8 - 2.0) in 0.1 steps
+	BuildVariantBank(flipperHitFx, 8, VARIATION_MIN_PITCH, VARIATION_MAX_PITCH, VARIATION_MIN_VOLUME, VARIATION_MAX_VOLUME);
+	for (int i = 0; i < BUMPER_TIMBRES; ++i)
+	{
+		BuildVariantBank(bumperTimbreFx[i], 8, VARIATION_MIN_PITCH, VARIATION_MAX_PITCH, VARIATION_MIN_VOLUME, VARIATION_MAX_VOLUME);
+	}
+	BuildVariantBank(bonusFx, 13, 0.8f, 2.0f, 1.0f, 1.0f);
 
-	// Load pinball SFX
-	flipperHitFx = LoadFx("assets/audio/flipper_hit.wav");
-	bumperHitFx = LoadFx("assets/audio/bumper_hit.wav");
-	ballLostFx = LoadFx("assets/audio/ball_lost.wav");
-	bonusFx = LoadFx("assets/audio/bonus.wav");
-	comboCompleteFx = LoadFx("assets/audio/combo_complete.wav");
+	// Compressed theme when available, the music streamer decodes it off the game thread
+	if (FileExists("assets/audio/pinball_theme.ogg"))
+		PlayMusic("assets/audio/pinball_theme.ogg");
+	else
+		PlayMusic("assets/audio/pinball_theme.wav");
 
-	PlayMusic("assets/audio/pinball_theme.wav");
+	App->events->Subscribe<BumperHitEvent, ModuleAudio, &ModuleAudio::OnBumperHits>(this);
+	App->events->Subscribe<FlipperHitEvent, ModuleAudio, &ModuleAudio::OnFlipperHits>(this);
+	App->events->Subscribe<WallHitEvent, ModuleAudio, &ModuleAudio::OnWallHits>(this);
+	App->events->Subscribe<TargetHitEvent, ModuleAudio, &ModuleAudio::OnTargetHits>(this);
+	App->events->Subscribe<ComboProgressEvent, ModuleAudio, &ModuleAudio::OnComboProgress>(this);
+	App->events->Subscribe<ComboCompletedEvent, ModuleAudio, &ModuleAudio::OnComboCompleted>(this);
+	App->events->Subscribe<ScoreChangedEvent, ModuleAudio, &ModuleAudio::OnScoreChanged>(this);
+	App->events->Subscribe<BallLostEvent, ModuleAudio, &ModuleAudio::OnBallLost>(this);
 
 	return ret;
 }
 
-update_status ModuleAudio::Update()
+// Output chosen on the command line:
+//   --audio stream     raylib's device and an AudioStream (default)
+//   --audio device     dedicated low-latency device, same as --low-latency
+//   --audio offline    no device, the mix is kept in memory
+//   --audio null       no device, the mix is discarded
+//   --audio-wav <path> offline, streaming the mix to a WAV file
+bool ModuleAudio::InitMixer()
 {
-	if (IsMusicValid(music))
+	const char* backend = App->GetArgument("--audio", "stream");
+	const char* wavPath = App->GetArgument("--audio-wav");
+
+	if (App->HasArgument("--low-latency")) backend = "device";
+	if (wavPath != nullptr) backend = "offline";
+
+	if (strcmp(backend, "offline") == 0 || strcmp(backend, "null") == 0)
 	{
-		UpdateMusicStream(music);
+		if (!mixer.Init(DEFAULT_SFX_VOICES, MIXER_OUTPUT_OFFLINE))
+			return false;
+
+		if (!mixer.SetCapture(strcmp(backend, "offline") == 0 && wavPath == nullptr, wavPath))
+			LOG("The offline mix will not be saved");
+		return true;
 	}
 
+	// Low-latency mode skips raylib's device and lets the mixer open one with a short period
+	if (strcmp(backend, "device") == 0)
+	{
+		if (mixer.Init(DEFAULT_SFX_VOICES, MIXER_OUTPUT_DEVICE, MIXER_LOW_LATENCY_FRAMES))
+			return true;
+
+		LOG("Low-latency audio unavailable, falling back to the raylib stream");
+	}
+	else if (strcmp(backend, "stream") != 0)
+	{
+		LOG("Unknown audio output '%s', using the raylib stream", backend);
+	}
+
+	LOG("Loading raylib audio system");
+	InitAudioDevice();
+
+	return mixer.Init(DEFAULT_SFX_VOICES);
+}
+
+update_status ModuleAudio::Update()
+{
+	CollectLatency();
+	TRACE_COUNTER("Active voices", mixer.GetStats().activeVoices);
+
 	if (isPlayingComboSequence)
 	{
-		float dt = GetFrameTime();
+		float dt = App->GetFrameDelta();
 		comboSequenceTimer += dt;
 
 		float stageInterval = 0.15f;
@@ -89,25 +266,48 @@ update_status ModuleAudio::Update()
 	return UPDATE_CONTINUE;
 }
 
+// Everything queued this frame, game events included, is in the mixer by now
+update_status ModuleAudio::PostUpdate()
+{
+	if (mixer.GetOutput() == MIXER_OUTPUT_OFFLINE)
+	{
+		mixer.Render(MIXER_SAMPLE_RATE / OFFLINE_AUDIO_FPS);
+	}
+
+	return UPDATE_CONTINUE;
+}
+
 // Called before quitting
 bool ModuleAudio::CleanUp()
 {
 	LOG("Freeing sound FX, closing Mixer and Audio subsystem");
 
-    // Unload sounds
-	for (unsigned int i = 0; i < fx_count; i++)
+	LOG("Collision sounds: bumper %d played / %d suppressed, flipper %d / %d, wall %d / %d",
+		impactsTriggered[IMPACT_BUMPER], impactsSuppressed[IMPACT_BUMPER],
+		impactsTriggered[IMPACT_FLIPPER], impactsSuppressed[IMPACT_FLIPPER],
+		impactsTriggered[IMPACT_WALL], impactsSuppressed[IMPACT_WALL]);
+
+	CollectLatency();
+	if (latencyReport)
 	{
-		UnloadSound(fx[i]);
+		PrintLatencyReport();
+	}
+	else if (latency[LATENCY_CONTACT_TO_MIX].GetCount() > 0)
+	{
+		LOG("Collision sound latency: p50 %.2f ms, p99 %.2f ms contact to mix (--latency-report for details)",
+			latency[LATENCY_CONTACT_TO_MIX].GetPercentile(0.5f), latency[LATENCY_CONTACT_TO_MIX].GetPercentile(0.99f));
 	}
 
-    // Unload music
-	if (IsMusicValid(music))
+	MixerStats stats = mixer.GetStats();
+	if (mixer.GetOutput() == MIXER_OUTPUT_OFFLINE)
 	{
-		StopMusicStream(music);
-		UnloadMusicStream(music);
+		LOG("Offline audio: rendered %.1f s of mix", (double)stats.offlineFrames / MIXER_SAMPLE_RATE);
 	}
 
-    CloseAudioDevice();
+	// Stops the mixer stream before any sample memory is released
+	mixer.CleanUp();
+
+	if (IsAudioDeviceReady()) CloseAudioDevice();
 
 	return true;
 }
@@ -119,19 +319,14 @@ bool ModuleAudio::PlayMusic(const char* path, float fade_time)
 		return false;
 
 	bool ret = true;
-	
-	StopMusicStream(music);
-	music = LoadMusicStream(path);
-    
-	if (IsMusicValid(music))
+
+	if (mixer.PlayMusic(path, fade_time))
 	{
-		::SetMusicVolume(music, musicVolume * masterVolume);
-		PlayMusicStream(music);
-		LOG("Successfully playing %s", path);
+		LOG("Queued music %s (%.1fs crossfade)", path, fade_time);
 	}
 	else
 	{
-		LOG("Failed to load music: %s", path);
+		LOG("Failed to queue music: %s", path);
 		ret = false;
 	}
 
@@ -146,39 +341,131 @@ unsigned int ModuleAudio::LoadFx(const char* path)
 
 	unsigned int ret = 0;
 
-	Sound sound = LoadSound(path);
+	if (fx_count >= MAX_SOUNDS)
+	{
+		LOG("Cannot load sound: %s, all %d fx slots are in use", path, MAX_SOUNDS);
+		return 0;
+	}
+
+	TRACE_SCOPE("Load fx");
+	Wave wave = LoadWave(path);
+	int sample = mixer.AddSample(wave);
 
-	if(sound.stream.buffer == NULL)
+	if(sample == 0)
 	{
 		LOG("Cannot load sound: %s", path);
 	}
 	else
 	{
-        fx[fx_count++] = sound;
+        fx[fx_count++] = sample;
 		ret = fx_count;
 	}
 
 	return ret;
 }
 
-// Play WAV
-bool ModuleAudio::PlayFx(unsigned int id, int repeat)
+unsigned int ModuleAudio::LoadSynthFx(const SfxPatch& patch, uint32 seed)
 {
-	if (IsEnabled() == false)
+	if(IsEnabled() == false)
+		return 0;
+
+	if (fx_count >= MAX_SOUNDS)
 	{
-		return false;
+		LOG("Cannot synthesise sound: %s, all %d fx slots are in use", patch.name, MAX_SOUNDS);
+		return 0;
+	}
+
+	TRACE_SCOPE("Synthesize fx");
+	Wave wave = SynthesizeSfx(patch, seed);
+	return AddSynthFx(patch, seed, wave);
+}
+
+// The mixer takes the wave's memory, or it is released here
+unsigned int ModuleAudio::AddSynthFx(const SfxPatch& patch, uint32 seed, Wave& wave)
+{
+	if (wave.data == nullptr)
+		return 0;
+
+	if (fx_count >= MAX_SOUNDS)
+	{
+		LOG("Cannot synthesise sound: %s, all %d fx slots are in use", patch.name, MAX_SOUNDS);
+		UnloadWave(wave);
+		wave.data = nullptr;
+		return 0;
 	}
 
-	bool ret = false;
+	if (exportSfxDir != nullptr && wave.data != nullptr)
+	{
+		ExportWave(wave, TextFormat("%s/%s_%u.wav", exportSfxDir, patch.name, seed));
+	}
 
-	if (id > 0 && id <= fx_count)
+	int sample = mixer.AddSample(wave);
+	if (sample == 0)
 	{
-		SetSoundVolume(fx[id - 1], sfxVolume * masterVolume);
-		PlaySound(fx[id - 1]);
-		ret = true;
+		LOG("Cannot synthesise sound: %s", patch.name);
+		return 0;
 	}
 
-	return ret;
+	fx[fx_count++] = sample;
+	return fx_count;
+}
+
+// Play WAV
+bool ModuleAudio::PlayFx(unsigned int id, int repeat, int priority)
+{
+	return PlayFxVoice(id, 1.0f, 1.0f, 0.0f, priority);
+}
+
+bool ModuleAudio::PlayFxVoice(unsigned int id, float volume, float pitch, float pan, int priority)
+{
+	if (IsEnabled() == false || id == 0 || id > fx_count)
+		return false;
+
+	if (volume < 0.0f) volume = 0.0f;
+	if (volume > 1.0f) volume = 1.0f;
+	if (pitch < 0.1f) pitch = 0.1f;
+	if (pitch > 2.0f) pitch = 2.0f;
+	if (pan < -1.0f) pan = -1.0f;
+	if (pan > 1.0f) pan = 1.0f;
+
+	return mixer.Play(fx[id - 1], volume, pitch, pan, priority, impactContactTime);
+}
+
+bool ModuleAudio::BuildVariantBank(unsigned int id, int count, float minPitch, float maxPitch, float minVolume, float maxVolume)
+{
+	if (id == 0 || id > fx_count || count < 2 || count > MAX_FX_VARIANTS)
+		return false;
+
+	TRACE_SCOPE("Build variant bank");
+	FxVariantBank& bank = banks[id - 1];
+	bank.count = 0;
+
+	for (int i = 0; i < count; ++i)
+	{
+		float t = (float)i / (count - 1);
+		int sample = mixer.AddVariant(fx[id - 1], minPitch + (maxPitch - minPitch) * t, minVolume + (maxVolume - minVolume) * t);
+		if (sample == 0)
+		{
+			LOG("Cannot build variant bank for fx %d, keeping runtime resampling", id);
+			return false;
+		}
+		bank.samples[i] = sample;
+	}
+
+	bank.count = count;
+	bank.minPitch = minPitch;
+	bank.maxPitch = maxPitch;
+	bank.minVolume = minVolume;
+	bank.maxVolume = maxVolume;
+
+	LOG("Built %d variants for fx %d (pitch %.2f - %.2f)", count, id, minPitch, maxPitch);
+	return true;
+}
+
+void ModuleAudio::SetVoiceCount(int count)
+{
+	mixer.SetVoiceCount(count);
+	LOG("SFX voice count set to %d", MIN(MAX(count, 1), MAX_MIXER_VOICES));
 }
 
 void ModuleAudio::PlayFlipperHit(float impactForce)
@@ -186,70 +473,73 @@ void ModuleAudio::PlayFlipperHit(float impactForce)
 	PlayFxWithVariation(flipperHitFx, impactForce); 
 }
 
-void ModuleAudio::PlayBumperHit(float impactForce)
+void ModuleAudio::PlayBumperHit(float impactForce, float pan, int timbre)
 {
-	PlayFxWithVariation(bumperHitFx, impactForce);
+	unsigned int id = bumperTimbreFx[timbre >= 0 && timbre < BUMPER_TIMBRES ? timbre : 0];
+	PlayFxWithVariation(id != 0 ? id : bumperHitFx, impactForce, pan);
 }
 
 void ModuleAudio::PlayBonusSound()
 {
-	PlayFx(bonusFx);
+	PlayFx(bonusFx, 0, SFX_PRIORITY_HIGH);
 }
 
 void ModuleAudio::PlayComboComplete()
 {
-	PlayFx(comboCompleteFx);
+	PlayFx(comboCompleteFx, 0, SFX_PRIORITY_HIGH);
 }
 
 void ModuleAudio::PlayBallLost()
 {
-	PlayFx(ballLostFx);
+	PlayFx(ballLostFx, 0, SFX_PRIORITY_CRITICAL);
 }
 
-void ModuleAudio::PlayFxWithPitch(unsigned int id, float pitch)
+void ModuleAudio::PlayFxWithPitch(unsigned int id, float pitch, int priority)
 {
-	if (IsEnabled() == false || id == 0 || id > fx_count)
-		return;
-
-	if (pitch < 0.1f) pitch = 0.1f;
-	if (pitch > 2.0f) pitch = 2.0f;
+	if (IsEnabled() && id > 0 && id <= fx_count && banks[id - 1].count > 0)
+	{
+		const FxVariantBank& bank = banks[id - 1];
+		if (pitch >= bank.minPitch && pitch <= bank.maxPitch)
+		{
+			// Nearest variant, undoing the volume baked into it
+			int i = (int)((pitch - bank.minPitch) / (bank.maxPitch - bank.minPitch) * (bank.count - 1) + 0.5f);
+			float baked = bank.minVolume + (bank.maxVolume - bank.minVolume) * i / (bank.count - 1);
+			mixer.Play(bank.samples[i], baked > 0.0f ? 1.0f / baked : 1.0f, 1.0f, 0.0f, priority, impactContactTime);
+			return;
+		}
+	}
 
-	SetSoundPitch(fx[id - 1], pitch);
-	PlayFx(id);
-	SetSoundPitch(fx[id - 1], 1.0f);
+	PlayFxVoice(id, 1.0f, pitch, 0.0f, priority);
 }
 
-void ModuleAudio::PlayFxWithVolume(unsigned int id, float volume)
+void ModuleAudio::PlayFxWithVolume(unsigned int id, float volume, int priority)
 {
-	if (IsEnabled() == false || id == 0 || id > fx_count)
-		return;
-
-	if (volume < 0.0f) volume = 0.0f;
-	if (volume > 1.0f) volume = 1.0f;
-
-	SetSoundVolume(fx[id - 1], volume * sfxVolume * masterVolume);
-	PlaySound(fx[id - 1]);
+	PlayFxVoice(id, volume, 1.0f, 0.0f, priority);
 }
 
-void ModuleAudio::PlayFxWithVariation(unsigned int id, float impactForce)
+void ModuleAudio::PlayFxWithVariation(unsigned int id, float impactForce, float pan, int priority)
 {
-	if (IsEnabled() == false || id == 0 || id > fx_count)
-		return;
-
 	if (impactForce < 0.0f) impactForce = 0.0f;
 	if (impactForce > 1.0f) impactForce = 1.0f;
 
+	if (IsEnabled() && id > 0 && id <= fx_count && banks[id - 1].count > 0)
+	{
+		// Variant already carries the pitch and volume for this impact
+		const FxVariantBank& bank = banks[id - 1];
+		int i = (int)(impactForce * (bank.count - 1) + 0.5f);
+		if (pan < -1.0f) pan = -1.0f;
+		if (pan > 1.0f) pan = 1.0f;
+		mixer.Play(bank.samples[i], 1.0f, 1.0f, pan, priority, impactContactTime);
+		return;
+	}
+
 	// Vary pitch: 0.8 to 1.2 based on impact
-	float pitch = 0.8f + (impactForce * 0.4f);
+	float pitch = VARIATION_MIN_PITCH + (impactForce * (VARIATION_MAX_PITCH - VARIATION_MIN_PITCH));
 
 	// Vary volume: 0.6 to 1.0 based on impact
-	float volume = 0.6f + (impactForce * 0.4f);
-
-	SetSoundPitch(fx[id - 1], pitch);
-	SetSoundVolume(fx[id - 1], volume * sfxVolume * masterVolume);
-	PlaySound(fx[id - 1]);
+	float volume = VARIATION_MIN_VOLUME + (impactForce * (VARIATION_MAX_VOLUME - VARIATION_MIN_VOLUME));
 
-	SetSoundPitch(fx[id - 1], 1.0f);
+	PlayFxVoice(id, volume, pitch, pan, priority);
 }
 
 void ModuleAudio::SetMasterVolume(float volume)
@@ -258,12 +548,7 @@ void ModuleAudio::SetMasterVolume(float volume)
 	if (volume > 1.0f) volume = 1.0f;
 
 	masterVolume = volume;
-	::SetMasterVolume(masterVolume);
-
-	if (IsMusicValid(music))
-	{
-		::SetMusicVolume(music, musicVolume * masterVolume);
-	}
+	mixer.SetBusGain(MIXER_BUS_MASTER, masterVolume);
 }
 
 void ModuleAudio::SetSFXVolume(float volume)
@@ -272,6 +557,7 @@ void ModuleAudio::SetSFXVolume(float volume)
 	if (volume > 1.0f) volume = 1.0f;
 
 	sfxVolume = volume;
+	mixer.SetBusGain(MIXER_BUS_SFX, sfxVolume);
 }
 
 void ModuleAudio::SetMusicVolume(float volume)
@@ -280,11 +566,7 @@ void ModuleAudio::SetMusicVolume(float volume)
 	if (volume > 1.0f) volume = 1.0f;
 
 	musicVolume = volume;
-
-	if (IsMusicValid(music))
-	{
-		::SetMusicVolume(music, musicVolume * masterVolume);
-	}
+	mixer.SetBusGain(MIXER_BUS_MUSIC, musicVolume);
 }
 
 void ModuleAudio::PlayComboProgressSound(int progress, int total)
@@ -341,4 +623,187 @@ void ModuleAudio::PlayScoreMilestone(int score)
 		// Hit bajo
 		PlayFxWithPitch(bonusFx, 1.1f);
 	}
-}
\ No newline at end of file
+}
+
+bool ModuleAudio::AllowImpact(int kind, const PhysBody* source, double now)
+{
+	uint32 hash = (uint32)(((size_t)source >> 4) * 2654435761u) ^ (uint32)kind;
+	int slot = -1;
+	int oldest = 0;
+
+	for (int probe = 0; probe < MAX_IMPACT_SOURCES; ++probe)
+	{
+		int i = (hash + probe) % MAX_IMPACT_SOURCES;
+		ImpactSource& entry = impactSources[i];
+
+		if (entry.source == source && entry.kind == kind && entry.lastTrigger > 0.0)
+		{
+			slot = i;
+			break;
+		}
+		if (entry.lastTrigger == 0.0)
+		{
+			if (slot < 0) slot = i;
+			break;
+		}
+		if (entry.lastTrigger < impactSources[oldest].lastTrigger) oldest = i;
+	}
+
+	// Table full: the least recently heard source gives up its slot
+	if (slot < 0) slot = oldest;
+
+	ImpactSource& entry = impactSources[slot];
+	if (entry.source == source && entry.kind == kind && now - entry.lastTrigger < IMPACT_RETRIGGER_INTERVAL[kind])
+	{
+		impactsSuppressed[kind]++;
+		return false;
+	}
+
+	entry.source = source;
+	entry.kind = kind;
+	entry.lastTrigger = now;
+	impactsTriggered[kind]++;
+	return true;
+}
+
+void ModuleAudio::CollectLatency()
+{
+	LatencySample sample;
+	while (mixer.PopLatency(sample))
+	{
+		latency[LATENCY_CONTACT_TO_PLAY].Add((float)((sample.postTime - sample.contactTime) * 1000.0));
+		latency[LATENCY_PLAY_TO_MIX].Add((float)((sample.mixTime - sample.postTime) * 1000.0));
+		latency[LATENCY_CONTACT_TO_MIX].Add((float)((sample.mixTime - sample.contactTime) * 1000.0));
+	}
+}
+
+void ModuleAudio::PrintLatencyReport() const
+{
+	MixerStats stats = mixer.GetStats();
+
+	LOG("-------------- Collision sound latency --------------");
+	LOG("Output: %s, %.1f ms buffers, ~%.1f ms device buffering after the mix (estimate)",
+		stats.lowLatency ? "low-latency device" : "raylib stream", stats.bufferMs, stats.outputLatencyMs);
+
+	latency[LATENCY_CONTACT_TO_PLAY].Print("BeginContact -> PlaySound");
+	latency[LATENCY_PLAY_TO_MIX].Print("PlaySound -> device buffer");
+	latency[LATENCY_CONTACT_TO_MIX].Print("BeginContact -> device buffer");
+
+	const LatencyHistogram& total = latency[LATENCY_CONTACT_TO_MIX];
+	LOG("Estimated contact to speaker: p50 %.2f ms, p99 %.2f ms",
+		total.GetPercentile(0.5f) + stats.outputLatencyMs, total.GetPercentile(0.99f) + stats.outputLatencyMs);
+}
+
+void ModuleAudio::OnBumperHits(const BumperHitEvent* events, int count)
+{
+	ImpactGroup groups[MAX_EVENTS_PER_FRAME];
+	int groupCount = GroupImpacts(events, count, groups, false);
+	impactsSuppressed[IMPACT_BUMPER] += count - groupCount;
+
+	double now = App->GetSimTime();
+	for (int i = 0; i < groupCount; ++i)
+	{
+		if (!AllowImpact(IMPACT_BUMPER, groups[i].source, now))
+			continue;
+
+		// Pan each hit towards the bumper that produced it. The timbre comes from its
+		// position rather than its address so it stays the same from run to run
+		float pan = 0.0f;
+		int timbre = 0;
+		if (groups[i].source != nullptr)
+		{
+			int x, y;
+			groups[i].source->GetPosition(x, y);
+			pan = ((float)x / SCREEN_WIDTH * 2.0f - 1.0f) * 0.6f;
+			timbre = (int)((((uint32)x * 73856093u) ^ ((uint32)y * 19349663u)) % BUMPER_TIMBRES);
+		}
+
+		impactContactTime = groups[i].contactTime;
+		PlayBumperHit(groups[i].impactForce, pan, timbre);
+	}
+	impactContactTime = 0.0;
+}
+
+void ModuleAudio::OnFlipperHits(const FlipperHitEvent* events, int count)
+{
+	ImpactGroup groups[MAX_EVENTS_PER_FRAME];
+	int groupCount = GroupImpacts(events, count, groups, false);
+	impactsSuppressed[IMPACT_FLIPPER] += count - groupCount;
+
+	double now = App->GetSimTime();
+	for (int i = 0; i < groupCount; ++i)
+	{
+		if (AllowImpact(IMPACT_FLIPPER, groups[i].source, now))
+		{
+			impactContactTime = groups[i].contactTime;
+			PlayFlipperHit(groups[i].impactForce);
+		}
+	}
+	impactContactTime = 0.0;
+}
+
+// The table chain reports through a forward and a reverse fixture and a rolling ball
+// touches it constantly, so all wall contacts of a batch make at most one sound
+void ModuleAudio::OnWallHits(const WallHitEvent* events, int count)
+{
+	ImpactGroup groups[MAX_EVENTS_PER_FRAME];
+	int groupCount = GroupImpacts(events, count, groups, true);
+	impactsSuppressed[IMPACT_WALL] += count - groupCount;
+
+	if (groupCount > 0 && AllowImpact(IMPACT_WALL, groups[0].source, App->GetSimTime()))
+	{
+		impactContactTime = groups[0].contactTime;
+		PlayFxWithVariation(bumperHitFx, groups[0].impactForce * 0.5f, 0.0f, SFX_PRIORITY_LOW);
+		impactContactTime = 0.0;
+	}
+}
+
+void ModuleAudio::OnTargetHits(const TargetHitEvent* events, int count)
+{
+	for (int i = 0; i < count; ++i)
+	{
+		PlayBonusSound();
+	}
+}
+
+void ModuleAudio::OnComboProgress(const ComboProgressEvent* events, int count)
+{
+	// Only the latest progress matters within one batch
+	if (count > 0)
+	{
+		PlayComboProgressSound(events[count - 1].progress, events[count - 1].total);
+	}
+}
+
+void ModuleAudio::OnComboCompleted(const ComboCompletedEvent* events, int count)
+{
+	if (count > 0)
+	{
+		PlayComboCompleteSequence();
+		PlayExtraBallAward();
+	}
+}
+
+void ModuleAudio::OnScoreChanged(const ScoreChangedEvent* events, int count)
+{
+	if (count <= 0)
+		return;
+
+	// One milestone sound per batch, even if several hits crossed it together
+	int previousMilestone = events[0].previousScore / 5000;
+	int currentScore = events[count - 1].currentScore;
+	int currentMilestone = currentScore / 5000;
+
+	if (currentMilestone > previousMilestone && currentScore >= 5000)
+	{
+		PlayScoreMilestone(currentScore);
+	}
+}
+
+void ModuleAudio::OnBallLost(const BallLostEvent* events, int count)
+{
+	if (count > 0)
+	{
+		PlayBallLost();
+	}
+}
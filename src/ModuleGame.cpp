@@ -1,12 +1,19 @@
 #include "Globals.h"
 #include "Application.h"
+#include "InputScript.h"
 #include "ModuleRender.h"
 #include "ModuleGame.h"
 #include "ModuleAudio.h"
 #include "ModulePhysics.h"
 #include "PhysBody.h"
 #include "GameState.h"
+#include "Trace.h"
+#include "AllocTracker.h"
+#include "FrameArena.h"
+#include "FlightRecorder.h"
+#include "WorldSnapshot.h"
 #include <string.h>
+#include <float.h>
 #include <algorithm>
 
 ModuleGame::ModuleGame(Application* app, bool start_enabled) : Module(app, start_enabled)
@@ -17,8 +24,8 @@ ModuleGame::ModuleGame(Application* app, bool start_enabled) : Module(app, start
     kicker = nullptr;
     ballLossSensor = nullptr;
 
-    leftFlipperJoint = nullptr;
-    rightFlipperJoint = nullptr;
+    leftFlipperJoint = 0;
+    rightFlipperJoint = 0;
 
     backgroundTexture = { 0 };
     titleTexture = { 0 };
@@ -43,6 +50,11 @@ ModuleGame::ModuleGame(Application* app, bool start_enabled) : Module(app, start
 
     showAudioSettings = false;
     settingsSavedMessage = false;
+
+    // Game logic and drawing touch everything, so Update waits for all earlier work
+    DeclareAccess(PHASE_PREUPDATE, RESOURCE_NONE, RESOURCE_NONE);
+    DeclareAccess(PHASE_UPDATE, RESOURCE_ALL, RESOURCE_ALL);
+    DeclareAccess(PHASE_POSTUPDATE, RESOURCE_NONE, RESOURCE_NONE);
     settingsSavedTimer = 0.0f;
 
     ballLaunched = false;
@@ -65,12 +77,7 @@ ModuleGame::ModuleGame(Application* app, bool start_enabled) : Module(app, start
     // Spawn point safety eject
     spawnZoneDwellTime = 0.0f;
 
-    ballSavedPosX = 0.0f;
-    ballSavedPosY = 0.0f;
-    ballSavedVelX = 0.0f;
-    ballSavedVelY = 0.0f;
-    ballSavedAngularVel = 0.0f;
-    ballSavedAwake = false;
+    ballZeroVelTime = 0.0f;
 
     isGamePaused = false;
 
@@ -97,6 +104,7 @@ ModuleGame::~ModuleGame()
 
 bool ModuleGame::Start()
 {
+    TRACE_SCOPE("Load game assets");
     LOG("ModuleGame Start(): loading assets");
     bool ret = true;
 
@@ -176,16 +184,23 @@ bool ModuleGame::Start()
     titleTexture = LoadTexture("assets/UI/title.png");
     if (titleTexture.id == 0) LOG("Warning: Failed to load title texture");
 
-    bumperHitSfx = App->audio->LoadFx("assets/audio/bumper_hit.wav");
-    launchSfx = App->audio->LoadFx("assets/audio/flipper_hit.wav");
-    targetHitSfx = App->audio->LoadFx("assets/audio/target_hit.wav");
-    specialHitSfx = App->audio->LoadFx("assets/audio/bonus_sound.wav");
-    ballLostSfx = App->audio->LoadFx("assets/audio/flipper_hit.wav");
-    letterCollectSfx = App->audio->LoadFx("assets/audio/bonus_sound.wav");
+    bumperHitSfx = App->audio->GetFx(SFX_BUMPER);
+    launchSfx = App->audio->GetFx(SFX_LAUNCH);
+    targetHitSfx = App->audio->GetFx(SFX_TARGET);
+    specialHitSfx = App->audio->GetFx(SFX_SPECIAL);
+    ballLostSfx = App->audio->GetFx(SFX_BALL_LOST);
+    letterCollectSfx = App->audio->GetFx(SFX_LETTER);
 
     LoadAudioSettings();
     LoadHighScore();
 
+    // Grown once here so steady-state frames don't allocate
+    starLetters.reserve(MAX_STAR_LETTERS);
+    bodiesToDestroy.reserve(MAX_STAR_LETTERS * 2);
+
+    App->events->Subscribe<BumperHitEvent, ModuleGame, &ModuleGame::OnBumperHits>(this);
+    App->events->Subscribe<LetterCollectedEvent, ModuleGame, &ModuleGame::OnLettersCollected>(this);
+
     if (LoadTMXMap("assets/map/Pinball_Table.tmx"))
     {
         CreateMapCollision();
@@ -195,16 +210,16 @@ bool ModuleGame::Start()
         LOG("Warning: Could not load TMX map");
     }
 
-    ball = App->physics->CreateCircle((int)(2.0f * METERS_TO_PIXELS), (int)(8.7f * METERS_TO_PIXELS), 15, b2_dynamicBody);
+    ball = App->physics->CreateCircle((int)(2.0f * METERS_TO_PIXELS), (int)(8.7f * METERS_TO_PIXELS), 15, PHYS_BODY_DYNAMIC);
 
     if (ball)
     {
         ball->listener = this;
         if (ball->body)
         {
-            ball->body->SetEnabled(false);
+            ball->SetEnabled(false);
             // Add slight linear damping to prevent excessive speed buildup
-            ball->body->SetLinearDamping(0.05f);
+            ball->SetLinearDamping(0.05f);
         }
     }
 
@@ -229,11 +244,11 @@ bool ModuleGame::Start()
             bRect.x + bRect.width / 2, bRect.y + bRect.height / 2, bRect.width / 2,
             screen_x, screen_y, screen_radius);
 
-        PhysBody* b = App->physics->CreateCircle(screen_x, screen_y, screen_radius, b2_staticBody);
+        PhysBody* b = App->physics->CreateCircle(screen_x, screen_y, screen_radius, PHYS_BODY_STATIC);
         if (b)
         {
-            if (b->body && b->body->GetFixtureList())
-                b->body->GetFixtureList()->SetRestitution(0.8f);  // Reduced from 1.5f
+            if (b->body)
+                b->SetRestitution(0.8f);  // Reduced from 1.5f
             b->listener = this;
             bumpers.push_back(b);
         }
@@ -261,12 +276,12 @@ bool ModuleGame::Start()
 
         PhysBody* p = App->physics->CreatePolygonLoop(screen_x, screen_y,
             scaledPoints.data(), (int)scaledPoints.size(),
-            b2_staticBody, rotation_rad);
+            PHYS_BODY_STATIC, rotation_rad);
 
         if (p)
         {
-            if (p->body && p->body->GetFixtureList())
-                p->body->GetFixtureList()->SetRestitution(0.8f);  // Reduced from 1.5f
+            if (p->body)
+                p->SetRestitution(0.8f);  // Reduced from 1.5f
             p->listener = this;
             specialPolygons.push_back(p);
         }
@@ -321,7 +336,7 @@ bool ModuleGame::Start()
         LOG("Creating flipper base at TMX(%.0f, %.0f) -> Screen(%d, %d)",
             tmx_cx, tmx_cy, screen_x, screen_y);
 
-        PhysBody* base = App->physics->CreateCircle(screen_x, screen_y, screen_radius, b2_staticBody);
+        PhysBody* base = App->physics->CreateCircle(screen_x, screen_y, screen_radius, PHYS_BODY_STATIC);
         if (base)
         {
             base->listener = this;
@@ -380,8 +395,31 @@ bool ModuleGame::Start()
             (int)tmxFlipperBases.size());
     }
 
+    // All static geometry exists now: rasterise it once for spawn placement
+    // Letters keep the same 4px padding the old AABB probe used
+    spawnGrid.Build(App->physics->GetBackend(), SPAWN_GRID_CELL_SIZE, STAR_LETTER_RADIUS + 4);
+    {
+        int centerX = SCREEN_WIDTH / 2;
+        int minY = (int)(SCREEN_HEIGHT * 0.3f);
+        int maxY = (int)(SCREEN_HEIGHT * 0.7f);
+        letterSpawnZone = spawnGrid.AddSpawnZone(Rectangle{ (float)(centerX - 200), (float)minY, 400.0f, (float)(maxY - minY) });
+    }
+
     InitGameData(&gameData);
 
+    // So a pipelined first frame has something to draw
+    CaptureSnapshot(snapshots.GetBack());
+    snapshots.Swap();
+
+    // Pipelined frames run the logic on a worker and draw in PreUpdate instead,
+    // one frame behind; PostUpdate publishes the snapshot once both are done
+    if (App->IsPipelined())
+    {
+        DeclareAccess(PHASE_PREUPDATE, RESOURCE_NONE, RESOURCE_RENDER);
+        DeclareAccess(PHASE_UPDATE, RESOURCE_ALL, RESOURCE_ALL & ~(RESOURCE_RENDER | RESOURCE_WINDOW), false);
+        DeclareAccess(PHASE_POSTUPDATE, RESOURCE_NONE, RESOURCE_RENDER);
+    }
+
     LOG("ModuleGame Start complete");
     return ret;
 }
@@ -437,22 +475,18 @@ bool ModuleGame::CleanUp()
     if (titleFont.texture.id && titleFont.texture.id != GetFontDefault().texture.id) UnloadFont(titleFont);
 
     for (auto& starLetter : starLetters) {
-        if (starLetter.body && starLetter.body->body) {
-            App->physics->GetWorld()->DestroyBody(starLetter.body->body);
-        }
+        App->physics->DestroyBody(starLetter.body);
     }
     starLetters.clear();
 
     for (auto body : bodiesToDestroy) {
-        if (body && body->body) {
-            App->physics->GetWorld()->DestroyBody(body->body);
-        }
+        App->physics->DestroyBody(body);
     }
     bodiesToDestroy.clear();
 
     for (auto& target : targets) {
         if (target.body && target.body->body) {
-            App->physics->GetWorld()->DestroyBody(target.body->body);
+            App->physics->DestroyBody(target.body);
         }
     }
     targets.clear();
@@ -468,22 +502,44 @@ bool ModuleGame::CleanUp()
     tmxSpecialPolygons.clear();
     tmxExtraPiecesWithType.clear();
     tmxFlipperBases.clear();
+    spawnGrid.Clear();
     // tmxFlippers ya fue eliminado
 
     return true;
 }
 
+update_status ModuleGame::PreUpdate()
+{
+    if (App->IsPipelined()) DrawSnapshot(snapshots.GetFront());
+    return UPDATE_CONTINUE;
+}
+
 update_status ModuleGame::Update()
 {
-    float dt = GetFrameTime();
+    update_status ret = Simulate(App->GetFrameDelta());
+    CaptureSnapshot(snapshots.GetBack());
 
-    for (auto it = bodiesToDestroy.begin(); it != bodiesToDestroy.end(); ) {
-        PhysBody* body = *it;
-        if (body && body->body) {
-            App->physics->GetWorld()->DestroyBody(body->body);
-        }
-        it = bodiesToDestroy.erase(it);
+    if (!App->IsPipelined())
+    {
+        snapshots.Swap();
+        DrawSnapshot(snapshots.GetFront());
+    }
+
+    return ret;
+}
+
+update_status ModuleGame::PostUpdate()
+{
+    if (App->IsPipelined()) snapshots.Swap();
+    return UPDATE_CONTINUE;
+}
+
+update_status ModuleGame::Simulate(float dt)
+{
+    for (PhysBody* body : bodiesToDestroy) {
+        App->physics->DestroyBody(body);
     }
+    bodiesToDestroy.clear();
 
     if (ballLossTimer > 0)
     {
@@ -527,7 +583,7 @@ update_status ModuleGame::Update()
         gameData.scoreNeedsSaving = false;
     }
 
-    if (IsKeyPressed(KEY_F2))
+    if (App->input->IsKeyPressed(KEY_F2))
     {
         showAudioSettings = !showAudioSettings;
     }
@@ -535,7 +591,6 @@ update_status ModuleGame::Update()
     if (showAudioSettings)
     {
         UpdateAudioSettings();
-        DrawAudioSettings();
         return UPDATE_CONTINUE;
     }
 
@@ -549,62 +604,58 @@ update_status ModuleGame::Update()
             starLetterSpawnTimer = 0.0f;
         }
 
-        for (auto it = starLetters.begin(); it != starLetters.end(); ) {
-            if (it->collected) {
-                if (it->body) {
-                    bodiesToDestroy.push_back(it->body);
+        // Compact in place, keeping the order
+        size_t kept = 0;
+        for (size_t i = 0; i < starLetters.size(); ++i) {
+            StarLetter& letter = starLetters[i];
+            if (letter.collected) {
+                if (letter.body) {
+                    bodiesToDestroy.push_back(letter.body);
                 }
-                it = starLetters.erase(it);
             }
-            else if (it->spawnTime > 8.0f) {
-                LOG("Letter %c timed out, will respawn", it->letter);
-                if (it->body) {
-                    bodiesToDestroy.push_back(it->body);
+            else if (letter.spawnTime > 8.0f) {
+                LOG("Letter %c timed out, will respawn", letter.letter);
+                if (letter.body) {
+                    bodiesToDestroy.push_back(letter.body);
                 }
-                it = starLetters.erase(it);
                 starLetterSpawnTimer = 0.0f;
             }
             else {
-                it->spawnTime += dt;
-                ++it;
+                letter.spawnTime += dt;
+                starLetters[kept++] = letter;
             }
         }
+        starLetters.resize(kept);
     }
 
     switch (gameData.currentState)
     {
     case STATE_MENU:
         UpdateMenuState();
-        RenderMenuState();
         break;
 
     case STATE_PLAYING:
         UpdatePlayingState();
-        RenderPlayingState();
         break;
 
     case STATE_PAUSED:
         UpdatePausedState();
-        RenderPausedState();
         break;
 
     case STATE_GAME_OVER:
         UpdateGameOverState();
-        RenderGameOverState();
         break;
 
     case STATE_YOU_WIN:
         UpdateYouWinState();
-        RenderYouWinState();
         break;
 
     default:
         UpdatePlayingState();
-        RenderPlayingState();
         break;
     }
 
-    if (IsKeyPressed(KEY_F1))
+    if (App->input->IsKeyPressed(KEY_F1))
         showDebug = !showDebug;
 
     if (settingsSavedMessage)
@@ -620,19 +671,271 @@ update_status ModuleGame::Update()
     return UPDATE_CONTINUE;
 }
 
+// Appends one body's transform, returns false when the snapshot is full
+static bool CaptureBody(SnapshotTransforms& transforms, const PhysBody* body)
+{
+    if (transforms.size >= SNAPSHOT_MAX_BODIES) return false;
+
+    int k = transforms.size++;
+    transforms.active[k] = body != nullptr && body->body != 0;
+    if (!transforms.active[k])
+    {
+        transforms.x[k] = transforms.y[k] = transforms.angle[k] = 0.0f;
+        transforms.width[k] = transforms.height[k] = 0.0f;
+        return true;
+    }
+
+    vec2f position = body->GetPosition();
+    transforms.x[k] = METERS_TO_PIXELS * position.x;
+    transforms.y[k] = SCREEN_HEIGHT - METERS_TO_PIXELS * position.y;
+    transforms.angle[k] = body->GetAngle();
+    transforms.width[k] = (float)body->width;
+    transforms.height[k] = (float)body->height;
+    return true;
+}
+
+static void CaptureBodies(SnapshotTransforms& transforms, SnapshotKind kind, PhysBody* const* bodies, int count)
+{
+    transforms.first[kind] = transforms.size;
+    int captured = 0;
+    while (captured < count && CaptureBody(transforms, bodies[captured])) captured++;
+    transforms.count[kind] = captured;
+}
+
+void ModuleGame::CaptureSnapshot(RenderSnapshot& snapshot) const
+{
+    TRACE_SCOPE("CaptureSnapshot");
+    snapshot.game = gameData;
+
+    snapshot.comboCompleteEffect = comboCompleteEffect;
+    snapshot.comboCompleteTimer = comboCompleteTimer;
+    snapshot.comboCompleteFlashCount = comboCompleteFlashCount;
+    snapshot.comboCompleteFlashColor = comboCompleteFlashColor;
+
+    snapshot.scoreFlashActive = scoreFlashActive;
+    snapshot.scoreFlashTimer = scoreFlashTimer;
+    snapshot.lastScoreIncrease = lastScoreIncrease;
+
+    snapshot.charging = App->input->IsKeyDown(KEY_DOWN) && !ballLaunched;
+    snapshot.chargePercent = kickerForce / MAX_KICKER_FORCE;
+
+    snapshot.showDebug = showDebug;
+    snapshot.showAudioSettings = showAudioSettings;
+    snapshot.settingsSavedMessage = settingsSavedMessage;
+    snapshot.masterVolume = App->audio->GetMasterVolume();
+    snapshot.musicVolume = App->audio->GetMusicVolume();
+    snapshot.sfxVolume = App->audio->GetSFXVolume();
+
+    SnapshotTransforms& transforms = snapshot.bodies;
+    transforms.size = 0;
+    CaptureBodies(transforms, SNAPSHOT_BALL, &ball, 1);
+    CaptureBodies(transforms, SNAPSHOT_LEFT_FLIPPER, &leftFlipper, 1);
+    CaptureBodies(transforms, SNAPSHOT_RIGHT_FLIPPER, &rightFlipper, 1);
+    CaptureBodies(transforms, SNAPSHOT_BALL_LOSS_SENSOR, &ballLossSensor, 1);
+    CaptureBodies(transforms, SNAPSHOT_BUMPERS, bumpers.data(), (int)bumpers.size());
+    CaptureBodies(transforms, SNAPSHOT_BLACK_HOLES, blackHoles.data(), (int)blackHoles.size());
+    CaptureBodies(transforms, SNAPSHOT_SPECIAL_POLYGONS, specialPolygons.data(), (int)specialPolygons.size());
+    CaptureBodies(transforms, SNAPSHOT_FLIPPER_BASES, flipperBases.data(), (int)flipperBases.size());
+
+    // Only the letters still on the table
+    transforms.first[SNAPSHOT_STAR_LETTERS] = transforms.size;
+    int letterCount = 0;
+    for (size_t i = 0; i < starLetters.size() && letterCount < SNAPSHOT_MAX_LETTERS; ++i)
+    {
+        const StarLetter& starLetter = starLetters[i];
+        if (starLetter.collected || !starLetter.body) continue;
+        if (!CaptureBody(transforms, starLetter.body)) break;
+
+        snapshot.letters[letterCount++] = starLetter.letter;
+    }
+    transforms.count[SNAPSHOT_STAR_LETTERS] = letterCount;
+}
+
+void ModuleGame::CaptureState(WorldSnapshot& snapshot) const
+{
+    GameSnapshot& game = snapshot.game;
+    game.data = gameData;
+
+    game.kickerForce = kickerForce;
+    game.kickerChargeTime = kickerChargeTime;
+    game.ballLossTimer = ballLossTimer;
+    game.starLetterSpawnTimer = starLetterSpawnTimer;
+    game.scoreFlashTimer = scoreFlashTimer;
+    game.comboCompleteTimer = comboCompleteTimer;
+    game.blackHoleDwellTime = blackHoleDwellTime;
+    game.teleportCooldown = teleportCooldown;
+    game.spawnZoneDwellTime = spawnZoneDwellTime;
+    game.ballZeroVelTime = ballZeroVelTime;
+
+    game.lastScoreIncrease = lastScoreIncrease;
+    game.comboCompleteFlashCount = comboCompleteFlashCount;
+    game.currentBlackHoleIndex = currentBlackHoleIndex;
+    game.nextLetterIndex = nextLetterIndex;
+    game.comboCompleteFlashColor[0] = comboCompleteFlashColor.r;
+    game.comboCompleteFlashColor[1] = comboCompleteFlashColor.g;
+    game.comboCompleteFlashColor[2] = comboCompleteFlashColor.b;
+    game.comboCompleteFlashColor[3] = comboCompleteFlashColor.a;
+
+    game.ballLaunched = ballLaunched;
+    game.scoreFlashActive = scoreFlashActive;
+    game.comboCompleteEffect = comboCompleteEffect;
+    game.isGamePaused = isGamePaused;
+
+    snapshot.letterCount = 0;
+    for (size_t i = 0; i < starLetters.size() && snapshot.letterCount < WORLD_SNAPSHOT_MAX_LETTERS; ++i)
+    {
+        const StarLetter& starLetter = starLetters[i];
+        LetterSnapshot& letter = snapshot.letters[snapshot.letterCount++];
+        letter.body = starLetter.body ? starLetter.body->id : 0;
+        letter.x = starLetter.x;
+        letter.y = starLetter.y;
+        letter.spawnTime = starLetter.spawnTime;
+        letter.letter = starLetter.letter;
+        letter.collected = starLetter.collected;
+        letter.pad[0] = letter.pad[1] = 0;
+    }
+
+    snapshot.targetCount = MIN((int)targets.size(), WORLD_SNAPSHOT_MAX_TARGETS);
+    for (int i = 0; i < snapshot.targetCount; ++i)
+    {
+        snapshot.targetsMovingDown[i] = targets[i].movingDown;
+    }
+}
+
+void ModuleGame::RestoreState(const WorldSnapshot& snapshot)
+{
+    const GameSnapshot& game = snapshot.game;
+    gameData = game.data;
+
+    kickerForce = game.kickerForce;
+    kickerChargeTime = game.kickerChargeTime;
+    ballLossTimer = game.ballLossTimer;
+    starLetterSpawnTimer = game.starLetterSpawnTimer;
+    scoreFlashTimer = game.scoreFlashTimer;
+    comboCompleteTimer = game.comboCompleteTimer;
+    blackHoleDwellTime = game.blackHoleDwellTime;
+    teleportCooldown = game.teleportCooldown;
+    spawnZoneDwellTime = game.spawnZoneDwellTime;
+    ballZeroVelTime = game.ballZeroVelTime;
+
+    lastScoreIncrease = game.lastScoreIncrease;
+    comboCompleteFlashCount = game.comboCompleteFlashCount;
+    currentBlackHoleIndex = game.currentBlackHoleIndex;
+    nextLetterIndex = game.nextLetterIndex;
+    comboCompleteFlashColor = { game.comboCompleteFlashColor[0], game.comboCompleteFlashColor[1],
+        game.comboCompleteFlashColor[2], game.comboCompleteFlashColor[3] };
+
+    ballLaunched = game.ballLaunched;
+    scoreFlashActive = game.scoreFlashActive;
+    comboCompleteEffect = game.comboCompleteEffect;
+    isGamePaused = game.isGamePaused;
+
+    // Letters spawned after the capture go now, before they can report a contact
+    for (StarLetter& starLetter : starLetters) {
+        if (!starLetter.body) continue;
+
+        bool kept = false;
+        for (int i = 0; i < snapshot.letterCount && !kept; ++i) {
+            kept = snapshot.letters[i].body == starLetter.body->id;
+        }
+        if (!kept) {
+            App->physics->DestroyBody(starLetter.body);
+        }
+    }
+    starLetters.clear();
+
+    // Letters still in the world keep their body, even one already queued for
+    // destruction; the rest are spawned again where they were
+    for (int i = 0; i < snapshot.letterCount; ++i) {
+        const LetterSnapshot& letter = snapshot.letters[i];
+
+        PhysBody* body = letter.body ? App->physics->FindBody(letter.body) : nullptr;
+        if (body) {
+            bodiesToDestroy.erase(std::remove(bodiesToDestroy.begin(), bodiesToDestroy.end(), body), bodiesToDestroy.end());
+        }
+        else if (!letter.collected) {
+            body = CreateStarLetterBody(letter.x, letter.y);
+        }
+
+        StarLetter starLetter;
+        starLetter.body = body;
+        starLetter.x = letter.x;
+        starLetter.y = letter.y;
+        starLetter.letter = letter.letter;
+        starLetter.collected = letter.collected;
+        starLetter.spawnTime = letter.spawnTime;
+        starLetters.push_back(starLetter);
+    }
+
+    int targetCount = MIN(snapshot.targetCount, (int)targets.size());
+    for (int i = 0; i < targetCount; ++i) {
+        targets[i].movingDown = snapshot.targetsMovingDown[i];
+    }
+}
+
+void ModuleGame::DrawSnapshot(const RenderSnapshot& snapshot)
+{
+    if (snapshot.showAudioSettings)
+    {
+        DrawAudioSettings(snapshot);
+        return;
+    }
+
+    switch (snapshot.game.currentState)
+    {
+    case STATE_MENU:
+        RenderMenuState(snapshot);
+        break;
+
+    case STATE_PAUSED:
+        RenderPausedState(snapshot);
+        break;
+
+    case STATE_GAME_OVER:
+        RenderGameOverState(snapshot);
+        break;
+
+    case STATE_YOU_WIN:
+        RenderYouWinState(snapshot);
+        break;
+
+    default:
+        RenderPlayingState(snapshot);
+        break;
+    }
+}
+
 void ModuleGame::AddScore(int points, const char* source)
 {
+    int previousScore = gameData.currentScore;
+
     ::AddScore(&gameData, points, source);
-    lastScoreIncrease = points * gameData.scoreMultiplier * gameData.comboMultiplier;
+    lastScoreIncrease = gameData.currentScore - previousScore;
     scoreFlashActive = true;
     scoreFlashTimer = 0.0f;
 
-    int previousMilestone = (gameData.currentScore - lastScoreIncrease) / 5000;
-    int currentMilestone = gameData.currentScore / 5000;
+    App->events->Publish(ScoreChangedEvent{ previousScore, gameData.currentScore, source });
+}
+
+void ModuleGame::OnBumperHits(const BumperHitEvent* events, int count)
+{
+    if (gameData.currentState != STATE_PLAYING)
+        return;
+
+    for (int i = 0; i < count; ++i)
+    {
+        if (events[i].points > 0)
+        {
+            AddScore(events[i].points, "Bumper");
+        }
+    }
+}
 
-    if (currentMilestone > previousMilestone && gameData.currentScore >= 5000)
+void ModuleGame::OnLettersCollected(const LetterCollectedEvent* events, int count)
+{
+    for (int i = 0; i < count; ++i)
     {
-        App->audio->PlayScoreMilestone(gameData.currentScore);
+        CollectStarLetter(events[i].letter);
     }
 }
 
@@ -686,7 +989,7 @@ void ModuleGame::LoadHighScore()
 float ModuleGame::CalculateImpactForce(PhysBody* body)
 {
     if (!body || !body->body) return 0.0f;
-    b2Vec2 vel = body->body->GetLinearVelocity();
+    vec2f vel = body->GetLinearVelocity();
     float speed = vel.Length();
     float maxSpeed = 20.0f;
     float force = speed / maxSpeed;
@@ -743,6 +1046,7 @@ CollisionType ModuleGame::IdentifyCollision(PhysBody* bodyA, PhysBody* bodyB)
 
 void ModuleGame::OnCollision(PhysBody* bodyA, PhysBody* bodyB)
 {
+    TRACE_SCOPE("OnCollision");
     if (!bodyA || !bodyB) return;
 
     PhysBody* ballBody = (bodyA == ball) ? bodyA : (bodyB == ball) ? bodyB : nullptr;
@@ -753,10 +1057,17 @@ void ModuleGame::OnCollision(PhysBody* bodyA, PhysBody* bodyB)
     }
 
     CollisionType type = IdentifyCollision(bodyA, bodyB);
+    float impactForce = CalculateImpactForce(ballBody);
+
+    if (ballBody->body)
+    {
+        vec2f position = ballBody->GetPosition();
+        App->recorder->Contact(type, position.x, position.y, impactForce);
+    }
 
     if (gameData.currentState == STATE_PLAYING)
     {
-        float impactForce = CalculateImpactForce(ballBody);
+        double contactTime = App->physics->GetContactTime();
 
         switch (type)
         {
@@ -770,15 +1081,12 @@ void ModuleGame::OnCollision(PhysBody* bodyA, PhysBody* bodyB)
         {
             if (ball && ball->body)
             {
-                b2Vec2 vel = ball->body->GetLinearVelocity();
+                vec2f vel = ball->GetLinearVelocity();
                 vel *= 1.1f;  // Reduced from 1.3f
-                ball->body->SetLinearVelocity(vel);
+                ball->SetLinearVelocity(vel);
 
-                if (bumperHitSfx >= 0)
-                {
-                    App->audio->PlayBumperHit(impactForce);
-                }
                 // No score for e1/e2 (special polygons)
+                App->events->Publish(BumperHitEvent{ otherBody, impactForce, 0, contactTime });
             }
             break;
         }
@@ -787,37 +1095,26 @@ void ModuleGame::OnCollision(PhysBody* bodyA, PhysBody* bodyB)
         {
             if (ball && ball->body)
             {
-                b2Vec2 vel = ball->body->GetLinearVelocity();
+                vec2f vel = ball->GetLinearVelocity();
                 vel *= 1.1f;  // Reduced from 1.3f
-                ball->body->SetLinearVelocity(vel);
-
-                if (bumperHitSfx >= 0)
-                {
-                    App->audio->PlayBumperHit(impactForce);
-                }
+                ball->SetLinearVelocity(vel);
 
-                AddScore(TARGET_BUMPER, "Bumper");
+                App->events->Publish(BumperHitEvent{ otherBody, impactForce, TARGET_BUMPER, contactTime });
             }
             break;
         }
 
         case COLLISION_TARGET:
         {
-            if (targetHitSfx >= 0)
-            {
-                App->audio->PlayBonusSound();
-            }
             // Removed score - only bumpers and black holes give points
+            App->events->Publish(TargetHitEvent{ otherBody, false });
             break;
         }
 
         case COLLISION_SPECIAL_TARGET:
         {
-            if (specialHitSfx >= 0)
-            {
-                App->audio->PlayBonusSound();
-            }
             // Removed score - only bumpers and black holes give points
+            App->events->Publish(TargetHitEvent{ otherBody, true });
             break;
         }
 
@@ -827,8 +1124,9 @@ void ModuleGame::OnCollision(PhysBody* bodyA, PhysBody* bodyB)
 
             for (auto& starLetter : starLetters) {
                 if (starLetter.body == letterBody && !starLetter.collected) {
+                    // Mark now so a second contact this step can't collect it twice
                     starLetter.collected = true;
-                    CollectStarLetter(starLetter.letter);
+                    App->events->Publish(LetterCollectedEvent{ letterBody, starLetter.letter });
                     break;
                 }
             }
@@ -842,15 +1140,15 @@ void ModuleGame::OnCollision(PhysBody* bodyA, PhysBody* bodyB)
 
         case COLLISION_FLIPPER:
         {
-            App->audio->PlayFlipperHit(impactForce);
             // Removed score - only bumpers and black holes give points
+            App->events->Publish(FlipperHitEvent{ otherBody, impactForce, contactTime });
             break;
         }
 
         case COLLISION_WALL:
         {
-            App->audio->PlayBumperHit(impactForce * 0.5f);
             // Removed score - only bumpers and black holes give points
+            App->events->Publish(WallHitEvent{ otherBody, impactForce, contactTime });
             break;
         }
 
@@ -862,27 +1160,27 @@ void ModuleGame::OnCollision(PhysBody* bodyA, PhysBody* bodyB)
 
 void ModuleGame::UpdateMenuState()
 {
-    if (ball && ball->body) ball->body->SetEnabled(false);
+    if (ball && ball->body) ball->SetEnabled(false);
 
-    if (IsKeyPressed(KEY_SPACE))
+    if (App->input->IsKeyPressed(KEY_SPACE))
     {
         LOG("Starting new game from menu");
         ResetGame(&gameData);
-        TransitionToState(&gameData, STATE_PLAYING);
+        ChangeState(STATE_PLAYING);
 
         if (ball && ball->body)
         {
-            ball->body->SetEnabled(true);
-            ball->body->SetTransform(b2Vec2(2.0f, 8.7f), 0);
-            ball->body->SetLinearVelocity(b2Vec2(0, 0));
-            ball->body->SetAngularVelocity(0);
+            ball->SetEnabled(true);
+            ball->SetTransform(vec2f(2.0f, 8.7f), 0);
+            ball->SetLinearVelocity(vec2f(0, 0));
+            ball->SetAngularVelocity(0);
         }
 
         ballLaunched = false;
     }
 }
 
-void ModuleGame::RenderMenuState()
+void ModuleGame::RenderMenuState(const RenderSnapshot& snapshot)
 {
     if (backgroundTexture.id)
     {
@@ -920,7 +1218,7 @@ void ModuleGame::RenderMenuState()
     Vector2 startSize = MeasureTextEx(font, startText, 32, 1);
     DrawTextEx(font, startText, { (float)(screenCenterX - startSize.x / 2), (float)startTextY }, 32, 1, WHITE);
 
-    const char* highScoreText = TextFormat("High Score: %d", gameData.highestScore);
+    const char* highScoreText = TextFormat("High Score: %d", snapshot.game.highestScore);
     Vector2 highScoreSize = MeasureTextEx(font, highScoreText, 28, 1);
     DrawTextEx(font, highScoreText, { (float)(screenCenterX - highScoreSize.x / 2), (float)highScoreY }, 28, 1, GOLD);
 
@@ -929,25 +1227,37 @@ void ModuleGame::RenderMenuState()
     DrawTextEx(font, controlsText, { (float)(screenCenterX - controlsSize.x / 2), (float)controlsY }, 20, 1, LIGHTGRAY);
 }
 
+void ModuleGame::ChangeState(GameState state)
+{
+    App->recorder->State(gameData.currentState, state);
+    TransitionToState(&gameData, state);
+}
+
 void ModuleGame::UpdatePlayingState()
 {
-    ApplyBlackHoleForces(GetFrameTime());
-    UpdateMovingTargets(GetFrameTime());
+    if (ball && ball->body)
+    {
+        vec2f position = ball->GetPosition();
+        vec2f velocity = ball->GetLinearVelocity();
+        App->recorder->Ball(position.x, position.y, velocity.x, velocity.y);
+    }
+
+    ApplyBlackHoleForces(App->GetFrameDelta());
+    UpdateMovingTargets(App->GetFrameDelta());
 
         // Ball stuck velocity eject logic (anywhere on playfield)
-        static float ballZeroVelTime = 0.0f;
         if (ball && ball->body && ballLaunched) {
-            b2Vec2 ballVel = ball->body->GetLinearVelocity();
+            vec2f ballVel = ball->GetLinearVelocity();
             if (ballVel.Length() < 0.01f) {
-                ballZeroVelTime += GetFrameTime();
+                ballZeroVelTime += App->GetFrameDelta();
                 if (ballZeroVelTime >= 5.0f) {
                     float ejectAngle = GetRandomValue(180, 270) * DEGTORAD;
                     float ejectForce = 15.0f;
-                    b2Vec2 ejectImpulse(cosf(ejectAngle) * ejectForce, sinf(ejectAngle) * ejectForce);
-                    ball->body->ApplyLinearImpulseToCenter(ejectImpulse, true);
+                    vec2f ejectImpulse(cosf(ejectAngle) * ejectForce, sinf(ejectAngle) * ejectForce);
+                    ball->ApplyLinearImpulseToCenter(ejectImpulse);
                     LOG("Auto-ejected ball after 5s at 0 m/s");
                     ballZeroVelTime = 0.0f;
-                    if (specialHitSfx >= 0) {
+                    if (specialHitSfx > 0) {
                         App->audio->PlayFx(specialHitSfx);
                     }
                 }
@@ -960,29 +1270,29 @@ void ModuleGame::UpdatePlayingState()
     // Check if ball is stuck in spawn zone and needs auto-eject
     if (ball && ball->body && ballLaunched)
     {
-        const b2Vec2 SPAWN_POSITION(2.0f, 8.7f); // spawn point in Box2D coords
+        const vec2f SPAWN_POSITION(2.0f, 8.7f); // spawn point in Box2D coords
         
-        b2Vec2 ballPos = ball->body->GetPosition();
-        b2Vec2 diff = ballPos - SPAWN_POSITION;
+        vec2f ballPos = ball->GetPosition();
+        vec2f diff = ballPos - SPAWN_POSITION;
         float distToSpawn = diff.Length();
 
         if (distToSpawn < SPAWN_ZONE_RADIUS)
         {
             // Ball is in spawn zone
-            spawnZoneDwellTime += GetFrameTime();
+            spawnZoneDwellTime += App->GetFrameDelta();
 
             if (spawnZoneDwellTime >= SPAWN_EJECT_THRESHOLD_TIME)
             {
                 // Auto-eject: give ball a strong push away from spawn
                 float ejectAngle = GetRandomValue(180, 270) * DEGTORAD; // Push down-left or down-right
                 float ejectForce = 15.0f;
-                b2Vec2 ejectImpulse(cosf(ejectAngle) * ejectForce, sinf(ejectAngle) * ejectForce);
-                ball->body->ApplyLinearImpulseToCenter(ejectImpulse, true);
+                vec2f ejectImpulse(cosf(ejectAngle) * ejectForce, sinf(ejectAngle) * ejectForce);
+                ball->ApplyLinearImpulseToCenter(ejectImpulse);
 
                 LOG("Auto-ejected ball from spawn zone after %.1fs", spawnZoneDwellTime);
                 spawnZoneDwellTime = 0.0f;
 
-                if (specialHitSfx >= 0)
+                if (specialHitSfx > 0)
                 {
                     App->audio->PlayFx(specialHitSfx);
                 }
@@ -995,18 +1305,18 @@ void ModuleGame::UpdatePlayingState()
         }
     }
 
-    if (IsKeyPressed(KEY_P))
+    if (App->input->IsKeyPressed(KEY_P))
     {
-        TransitionToState(&gameData, STATE_PAUSED);
+        ChangeState(STATE_PAUSED);
         return;
     }
 
-    if (IsKeyDown(KEY_DOWN) && !ballLaunched)
+    if (App->input->IsKeyDown(KEY_DOWN) && !ballLaunched)
     {
-        kickerChargeTime += GetFrameTime();
+        kickerChargeTime += App->GetFrameDelta();
         kickerForce = MIN(kickerChargeTime * KICKER_CHARGE_SPEED, MAX_KICKER_FORCE);
     }
-    if (IsKeyReleased(KEY_DOWN) && !ballLaunched)
+    if (App->input->IsKeyReleased(KEY_DOWN) && !ballLaunched)
     {
         LaunchBall();
     }
@@ -1014,27 +1324,30 @@ void ModuleGame::UpdatePlayingState()
     // Flipper motor control: ensure key press rotates bat upward (toward playfield center)
     if (leftFlipperJoint)
     {
-        if (IsKeyDown(KEY_LEFT))
-            leftFlipperJoint->SetMotorSpeed(30.0f);  // upward
+        if (App->input->IsKeyDown(KEY_LEFT))
+            App->physics->SetMotorSpeed(leftFlipperJoint, 30.0f);  // upward
         else
-            leftFlipperJoint->SetMotorSpeed(-15.0f);   // return downward
+            App->physics->SetMotorSpeed(leftFlipperJoint, -15.0f);   // return downward
     }
 
     if (rightFlipperJoint)
     {
-        if (IsKeyDown(KEY_RIGHT))
-            rightFlipperJoint->SetMotorSpeed(-30.0f);  // upward (mirror)
+        if (App->input->IsKeyDown(KEY_RIGHT))
+            App->physics->SetMotorSpeed(rightFlipperJoint, -30.0f);  // upward (mirror)
         else
-            rightFlipperJoint->SetMotorSpeed(15.0f); // return downward
+            App->physics->SetMotorSpeed(rightFlipperJoint, 15.0f); // return downward
     }
 }
 
-void ModuleGame::RenderPlayingState()
+void ModuleGame::RenderPlayingState(const RenderSnapshot& snapshot)
 {
-    if (comboCompleteEffect) {
+    TRACE_SCOPE("RenderPlayingState");
+    const SnapshotTransforms& bodies = snapshot.bodies;
+
+    if (snapshot.comboCompleteEffect) {
         DrawRectangle(0, 0, SCREEN_WIDTH, SCREEN_HEIGHT,
-            Color{ comboCompleteFlashColor.r, comboCompleteFlashColor.g,
-                 comboCompleteFlashColor.b, 80 });
+            Color{ snapshot.comboCompleteFlashColor.r, snapshot.comboCompleteFlashColor.g,
+                 snapshot.comboCompleteFlashColor.b, 80 });
     }
 
     if (backgroundTexture.id)
@@ -1050,33 +1363,33 @@ void ModuleGame::RenderPlayingState()
     DrawRectangle(0, 0, 350, 200, Color{ 0,0,0,180 });
 
     Color scoreColor = WHITE;
-    if (scoreFlashActive && scoreFlashTimer < 0.25f) {
+    if (snapshot.scoreFlashActive && snapshot.scoreFlashTimer < 0.25f) {
         scoreColor = YELLOW;
     }
 
-    DrawTextEx(font, TextFormat("SCORE: %d", gameData.currentScore), { 20, 20 }, 32, 1, scoreColor);
-    DrawTextEx(font, TextFormat("Previous: %d", gameData.previousScore), { 20, 60 }, 24, 1, GRAY);
-    DrawTextEx(font, TextFormat("High: %d", gameData.highestScore), { 20, 95 }, 24, 1, GOLD);
-    DrawTextEx(font, TextFormat("Balls: %d", gameData.ballsLeft), { 20, 130 }, 32, 1, RED);
-    DrawTextEx(font, TextFormat("Round: %d", gameData.currentRound), { 20, 170 }, 24, 1, SKYBLUE);
+    DrawTextEx(font, TextFormat("SCORE: %d", snapshot.game.currentScore), { 20, 20 }, 32, 1, scoreColor);
+    DrawTextEx(font, TextFormat("Previous: %d", snapshot.game.previousScore), { 20, 60 }, 24, 1, GRAY);
+    DrawTextEx(font, TextFormat("High: %d", snapshot.game.highestScore), { 20, 95 }, 24, 1, GOLD);
+    DrawTextEx(font, TextFormat("Balls: %d", snapshot.game.ballsLeft), { 20, 130 }, 32, 1, RED);
+    DrawTextEx(font, TextFormat("Round: %d", snapshot.game.currentRound), { 20, 170 }, 24, 1, SKYBLUE);
 
-    if (gameData.scoreMultiplier > 1 || gameData.comboMultiplier > 1) {
-        DrawTextEx(font, TextFormat("Multiplier: %dx", gameData.scoreMultiplier * gameData.comboMultiplier),
+    if (snapshot.game.scoreMultiplier > 1 || snapshot.game.comboMultiplier > 1) {
+        DrawTextEx(font, TextFormat("Multiplier: %dx", snapshot.game.scoreMultiplier * snapshot.game.comboMultiplier),
             { 20, 205 }, 22, 1, GREEN);
     }
 
-    if (comboCompleteEffect && comboCompleteFlashCount < 10) {
+    if (snapshot.comboCompleteEffect && snapshot.comboCompleteFlashCount < 10) {
         const char* comboText = "COMBO COMPLETE! +5000 POINTS!";
         Vector2 textSize = MeasureTextEx(font, comboText, 32, 1);
 
         DrawRectangle(SCREEN_WIDTH / 2 - textSize.x / 2 - 10, 250, textSize.x + 20, 50, Color{ 0,0,0,200 });
-        DrawTextEx(font, comboText, { SCREEN_WIDTH / 2 - textSize.x / 2, 260 }, 32, 1, comboCompleteFlashColor);
+        DrawTextEx(font, comboText, { SCREEN_WIDTH / 2 - textSize.x / 2, 260 }, 32, 1, snapshot.comboCompleteFlashColor);
 
         for (int i = 0; i < 8; i++) {
-            float angle = comboCompleteTimer * 10.0f + i * (360.0f / 8.0f);
+            float angle = snapshot.comboCompleteTimer * 10.0f + i * (360.0f / 8.0f);
             int x = SCREEN_WIDTH / 2 + (int)(cosf(angle * DEG2RAD) * 200.0f);
             int y = 300 + (int)(sinf(angle * DEG2RAD) * 80.0f);
-            DrawCircle(x, y, 10.0f + 5.0f * sinf(comboCompleteTimer * 20.0f + (float)i), comboCompleteFlashColor);
+            DrawCircle(x, y, 10.0f + 5.0f * sinf(snapshot.comboCompleteTimer * 20.0f + (float)i), snapshot.comboCompleteFlashColor);
         }
     }
 
@@ -1088,82 +1401,80 @@ void ModuleGame::RenderPlayingState()
     const char* star = "STAR";
     for (int i = 0; i < 4; ++i)
     {
-        Color letterColor = (i < gameData.comboProgress) ? YELLOW : DARKGRAY;
+        Color letterColor = (i < snapshot.game.comboProgress) ? YELLOW : DARKGRAY;
 
-        if (comboCompleteEffect && i < gameData.comboProgress) {
-            float pulse = sinf(comboCompleteTimer * 20.0f) * 5.0f + 25.0f;
-            DrawTextEx(font, TextFormat("%c", star[i]), { (float)(starStartX + i * 25), (float)starY }, pulse, 1, comboCompleteFlashColor);
+        if (snapshot.comboCompleteEffect && i < snapshot.game.comboProgress) {
+            float pulse = sinf(snapshot.comboCompleteTimer * 20.0f) * 5.0f + 25.0f;
+            DrawTextEx(font, TextFormat("%c", star[i]), { (float)(starStartX + i * 25), (float)starY }, pulse, 1, snapshot.comboCompleteFlashColor);
         }
         else {
             DrawTextEx(font, TextFormat("%c", star[i]), { (float)(starStartX + i * 25), (float)starY }, 25, 1, letterColor);
         }
     }
 
-    if (scoreFlashActive && lastScoreIncrease > 0) {
+    if (snapshot.scoreFlashActive && snapshot.lastScoreIncrease > 0) {
         Color flashColor = YELLOW;
-        if (scoreFlashTimer < 0.25f) {
-            DrawTextEx(font, TextFormat("+%d!", lastScoreIncrease),
+        if (snapshot.scoreFlashTimer < 0.25f) {
+            DrawTextEx(font, TextFormat("+%d!", snapshot.lastScoreIncrease),
                 { (float)(SCREEN_WIDTH / 2 - 40), 100.0f }, 30, 1, flashColor);
         }
     }
 
-    for (size_t i = 0; i < starLetters.size(); ++i)
+    for (int i = 0; i < bodies.count[SNAPSHOT_STAR_LETTERS]; ++i)
     {
-        const auto& starLetter = starLetters[i];
-        if (!starLetter.collected && starLetter.body) {
-            int x, y;
-            starLetter.body->GetPosition(x, y);
-
-            if (x >= 0 && x <= SCREEN_WIDTH && y >= 0 && y <= SCREEN_HEIGHT) {
-                Texture2D* texture = nullptr;
-                switch (starLetter.letter) {
-                case 'S': texture = &letterSTexture; break;
-                case 'T': texture = &letterTTexture; break;
-                case 'A': texture = &letterATexture; break;
-                case 'R': texture = &letterRTexture; break;
-                }
+        int k = bodies.first[SNAPSHOT_STAR_LETTERS] + i;
+        float x = bodies.x[k], y = bodies.y[k];
+        char letter = snapshot.letters[i];
 
-                if (texture && texture->id) {
-                    float scale = 0.1f;
-                    int width = (int)(texture->width * scale);
-                    int height = (int)(texture->height * scale);
-                    Rectangle src = { 0,0,(float)texture->width,(float)texture->height };
-                    Rectangle dst = { (float)x, (float)y, (float)width, (float)height };
-                    Vector2 origin = { width / 2.0f, height / 2.0f };
-                    DrawTexturePro(*texture, src, dst, origin, 0.0f, WHITE);
-                }
-                else {
-                    DrawCircle(x, y, 15, ORANGE);
-                    DrawTextEx(font, TextFormat("%c", starLetter.letter), { (float)(x - 5), (float)(y - 10) }, 20, 1, WHITE);
-                }
+        if (x >= 0 && x <= SCREEN_WIDTH && y >= 0 && y <= SCREEN_HEIGHT) {
+            Texture2D* texture = nullptr;
+            switch (letter) {
+            case 'S': texture = &letterSTexture; break;
+            case 'T': texture = &letterTTexture; break;
+            case 'A': texture = &letterATexture; break;
+            case 'R': texture = &letterRTexture; break;
+            }
+
+            if (texture && texture->id) {
+                float scale = 0.1f;
+                int width = (int)(texture->width * scale);
+                int height = (int)(texture->height * scale);
+                Rectangle src = { 0,0,(float)texture->width,(float)texture->height };
+                Rectangle dst = { x, y, (float)width, (float)height };
+                Vector2 origin = { width / 2.0f, height / 2.0f };
+                DrawTexturePro(*texture, src, dst, origin, 0.0f, WHITE);
+            }
+            else {
+                DrawCircleV(Vector2{ x, y }, 15, ORANGE);
+                DrawTextEx(font, TextFormat("%c", letter), { x - 5, y - 10 }, 20, 1, WHITE);
             }
         }
     }
 
-    if (IsKeyDown(KEY_DOWN) && !ballLaunched)
+    if (snapshot.charging)
     {
-        float chargePercent = kickerForce / MAX_KICKER_FORCE;
+        float chargePercent = snapshot.chargePercent;
         DrawTextEx(font, "CHARGING...", { (float)(SCREEN_WIDTH / 2 - 80), (float)(SCREEN_HEIGHT - 100) }, 25, 1, YELLOW);
         DrawRectangle(SCREEN_WIDTH / 2 - 100, SCREEN_HEIGHT - 60, 200, 20, DARKGRAY);
         DrawRectangle(SCREEN_WIDTH / 2 - 100, SCREEN_HEIGHT - 60, (int)(200 * chargePercent), 20, GREEN);
     }
 
-    if (showDebug && ballLossSensor)
+    int sensor = bodies.Find(SNAPSHOT_BALL_LOSS_SENSOR);
+    if (snapshot.showDebug && sensor >= 0)
     {
-        int x, y;
-        ballLossSensor->GetPosition(x, y);
-        DrawRectangle(x - ballLossSensor->width / 2, y - ballLossSensor->height / 2,
-            ballLossSensor->width, ballLossSensor->height,
+        float x = bodies.x[sensor], y = bodies.y[sensor];
+        DrawRectangleV(Vector2{ x - bodies.width[sensor] / 2, y - bodies.height[sensor] / 2 },
+            Vector2{ bodies.width[sensor], bodies.height[sensor] },
             Color{ 255, 0, 0, 100 });
-        DrawTextEx(font, "BALL LOSS SENSOR", { (float)(x - 80), (float)(y - 20) }, 12, 1, RED);
+        DrawTextEx(font, "BALL LOSS SENSOR", { x - 80, y - 20 }, 12, 1, RED);
     }
 
     // Render bumpers (B1, B2, B3) with their specific textures
-    for (size_t i = 0; i < bumpers.size() && i < tmxBumpers.size(); ++i)
+    for (size_t i = 0; i < (size_t)bodies.count[SNAPSHOT_BUMPERS] && i < tmxBumpers.size(); ++i)
     {
-        int x = 0, y = 0;
-        if (!bumpers[i]) continue;
-        bumpers[i]->GetPosition(x, y);
+        int k = bodies.first[SNAPSHOT_BUMPERS] + (int)i;
+        if (!bodies.active[k]) continue;
+        float x = bodies.x[k], y = bodies.y[k];
 
         // Determine texture from TMX name by index (parse original order from TMX)
         // Since TMX lists objects in order, we can rely on that
@@ -1176,41 +1487,41 @@ void ModuleGame::RenderPlayingState()
 
         if (bumperTex && bumperTex->id)
         {
-            float scale = (float)bumpers[i]->width / (float)bumperTex->width;
+            float scale = bodies.width[k] / (float)bumperTex->width;
             int width = (int)(bumperTex->width * scale);
             int height = (int)(bumperTex->height * scale);
             Rectangle src = { 0,0,(float)bumperTex->width,(float)bumperTex->height };
-            Rectangle dst = { (float)x, (float)y, (float)width, (float)height };
+            Rectangle dst = { x, y, (float)width, (float)height };
             Vector2 origin = { width / 2.0f, height / 2.0f };
             DrawTexturePro(*bumperTex, src, dst, origin, 0.0f, WHITE);
         }
         else
         {
-            DrawCircle(x, y, (float)bumpers[i]->width / 2.0f, ORANGE);
+            DrawCircleV(Vector2{ x, y }, bodies.width[k] / 2.0f, ORANGE);
         }
     }
 
-    for (size_t i = 0; i < blackHoles.size(); ++i)
+    for (int i = 0; i < bodies.count[SNAPSHOT_BLACK_HOLES]; ++i)
     {
-        int x = 0, y = 0;
-        if (!blackHoles[i]) continue;
-        blackHoles[i]->GetPosition(x, y);
+        int k = bodies.first[SNAPSHOT_BLACK_HOLES] + i;
+        if (!bodies.active[k]) continue;
+        float x = bodies.x[k], y = bodies.y[k];
 
         if (blackHoleTexture.id)
         {
-            float scale = (float)blackHoles[i]->width / (float)blackHoleTexture.width;
+            float scale = bodies.width[k] / (float)blackHoleTexture.width;
             int width = (int)(blackHoleTexture.width * scale);
             int height = (int)(blackHoleTexture.height * scale);
             Rectangle src = { 0,0,(float)blackHoleTexture.width,(float)blackHoleTexture.height };
-            Rectangle dst = { (float)x, (float)y, (float)width, (float)height };
+            Rectangle dst = { x, y, (float)width, (float)height };
             Vector2 origin = { width / 2.0f, height / 2.0f };
             DrawTexturePro(blackHoleTexture, src, dst, origin, 0.0f, WHITE);
         }
         else
         {
-            int radius = blackHoles[i]->width / 2;
-            DrawCircle(x, y, (float)radius, BLACK);
-            DrawCircle(x, y, (float)radius * 0.8f, Color{ 20, 0, 40, 255 });
+            float radius = bodies.width[k] / 2.0f;
+            DrawCircleV(Vector2{ x, y }, radius, BLACK);
+            DrawCircleV(Vector2{ x, y }, radius * 0.8f, Color{ 20, 0, 40, 255 });
         }
     }
 
@@ -1224,26 +1535,20 @@ void ModuleGame::RenderPlayingState()
     static bool logged = false;
     if (!logged)
     {
-        LOG("Rendering special polygons: specialPolygons.size()=%zu, tmxSpecialPolygons.size()=%zu, tmxExtraPiecesWithType.size()=%zu",
-            specialPolygons.size(), tmxSpecialPolygons.size(), tmxExtraPiecesWithType.size());
+        LOG("Rendering special polygons: specialPolygons.size()=%d, tmxSpecialPolygons.size()=%zu, tmxExtraPiecesWithType.size()=%zu",
+            bodies.count[SNAPSHOT_SPECIAL_POLYGONS], tmxSpecialPolygons.size(), tmxExtraPiecesWithType.size());
         logged = true;
     }
 
-    // Precompute flipper base screen positions for potential anchoring (used to attach e2 to base)
-    std::vector<Vector2> flipperBasePositions;
-    for (size_t bi = 0; bi < flipperBases.size(); ++bi)
-    {
-        if (!flipperBases[bi]) continue;
-        int bx = 0, by = 0;
-        flipperBases[bi]->GetPosition(bx, by);
-        flipperBasePositions.push_back(Vector2{ (float)bx, (float)by });
-    }
+    // Flipper bases, for anchoring e2 pieces to them
+    int firstBase = bodies.first[SNAPSHOT_FLIPPER_BASES];
+    int baseCount = bodies.count[SNAPSHOT_FLIPPER_BASES];
 
-    for (size_t i = 0; i < specialPolygons.size() && i < tmxSpecialPolygons.size(); ++i)
+    for (size_t i = 0; i < (size_t)bodies.count[SNAPSHOT_SPECIAL_POLYGONS] && i < tmxSpecialPolygons.size(); ++i)
     {
-        int x = 0, y = 0;
-        if (!specialPolygons[i]) continue;
-        specialPolygons[i]->GetPosition(x, y);
+        int k = bodies.first[SNAPSHOT_SPECIAL_POLYGONS] + (int)i;
+        if (!bodies.active[k]) continue;
+        float x = bodies.x[k], y = bodies.y[k];
 
         const TmxPolygon& tmxPoly = tmxSpecialPolygons[i];
         int type = tmxPoly.type;  // 1 = e1, 2 = e2
@@ -1270,46 +1575,38 @@ void ModuleGame::RenderPlayingState()
             // Correct center relative to polygon origin (object position is its top-left in Tiled)
             float centerOffsetX = (minX + (maxX - minX) * 0.5f) * scaleX;
             float centerOffsetY = (minY + (maxY - minY) * 0.5f) * scaleY;
-            Vector2 center = { (float)x + centerOffsetX, (float)y + centerOffsetY };
+            Vector2 center = { x + centerOffsetX, y + centerOffsetY };
 
             // Box2D angle is inverted due to Y flip during body creation; invert for visual
-            float rotation = 0.0f;
-            float bodyAngle = 0.0f;
-            if (specialPolygons[i]->body)
-            {
-                bodyAngle = specialPolygons[i]->body->GetAngle();
-                rotation = -(bodyAngle * RADTODEG);
-            }
+            float bodyAngle = bodies.angle[k];
+            float rotation = -(bodyAngle * RADTODEG);
 
             // If e2: Left base -> snap BR corner to base's LEFT edge. Right base -> only mirror (no anchoring).
             bool mirrorTexture = false;
-            if (type == 2 && !flipperBasePositions.empty())
+            if (type == 2 && baseCount > 0)
             {
                 // Find nearest base center
                 float bestDist = FLT_MAX;
                 int bestIndex = -1;
-                for (size_t bi = 0; bi < flipperBases.size(); ++bi)
+                for (int b = firstBase; b < firstBase + baseCount; ++b)
                 {
-                    if (!flipperBases[bi]) continue;
-                    int bx = 0, by = 0;
-                    flipperBases[bi]->GetPosition(bx, by);
-                    float dx = (float)bx - ((float)x);
-                    float dy = (float)by - ((float)y);
+                    if (!bodies.active[b]) continue;
+                    float dx = bodies.x[b] - x;
+                    float dy = bodies.y[b] - y;
                     float d2 = dx * dx + dy * dy;
-                    if (d2 < bestDist) { bestDist = d2; bestIndex = (int)bi; }
+                    if (d2 < bestDist) { bestDist = d2; bestIndex = b; }
                 }
 
                 if (bestIndex >= 0)
                 {
-                    int bx = 0, by = 0;
-                    flipperBases[bestIndex]->GetPosition(bx, by);
-                    float baseRadius = flipperBases[bestIndex]->width * 0.5f;
+                    float bx = bodies.x[bestIndex], by = bodies.y[bestIndex];
+                    float baseRadius = bodies.width[bestIndex] * 0.5f;
                     float ang = -bodyAngle; // visual rotation radians
 
-                    if ((float)bx < SCREEN_WIDTH * 0.5f)
+                    if (bx < SCREEN_WIDTH * 0.5f)
                     {
                         // LEFT side base: anchor bottom-right of e2 to the LEFT edge of the base
-                        Vector2 anchor = { (float)bx - baseRadius, (float)by };
+                        Vector2 anchor = { bx - baseRadius, by };
                         Vector2 localBR = { width * 0.5f, height * 0.5f }; // bottom-right corner
                         Vector2 rotatedBR = { localBR.x * cosf(ang) - localBR.y * sinf(ang),
                                               localBR.x * sinf(ang) + localBR.y * cosf(ang) };
@@ -1319,7 +1616,7 @@ void ModuleGame::RenderPlayingState()
                     else
                     {
                         // RIGHT side base: anchor bottom-left of e2 to the RIGHT edge of the base
-                        Vector2 anchor = { (float)bx + baseRadius, (float)by };
+                        Vector2 anchor = { bx + baseRadius, by };
                         Vector2 localBL = { -width * 0.5f, height * 0.5f }; // bottom-left corner
                         Vector2 rotatedBL = { localBL.x * cosf(ang) - localBL.y * sinf(ang),
                                               localBL.x * sinf(ang) + localBL.y * cosf(ang) };
@@ -1352,65 +1649,63 @@ void ModuleGame::RenderPlayingState()
         else
         {
             // Fallback polygon outline
-            float angle_rad = specialPolygons[i]->body ? specialPolygons[i]->body->GetAngle() : 0.0f;
-            std::vector<Vector2> screenPoints;
+            float angle_rad = bodies.angle[k];
+            FrameVector<Vector2> outlinePoints{ FrameAllocator<Vector2>(App->frame_arena) };
+            outlinePoints.reserve(tmxPoly.points.size() / 2);
             for (size_t j = 0; j < tmxPoly.points.size(); j += 2)
             {
                 float localX = tmxPoly.points[j] * scaleX;
                 float localY = tmxPoly.points[j + 1] * scaleY;
                 float rotatedX = localX * cosf(angle_rad) - localY * sinf(angle_rad);
                 float rotatedY = localX * sinf(angle_rad) + localY * cosf(angle_rad);
-                screenPoints.push_back(Vector2{ (float)x + rotatedX, (float)y + rotatedY });
+                outlinePoints.push_back(Vector2{ x + rotatedX, y + rotatedY });
             }
-            for (size_t j = 0; j < screenPoints.size(); ++j)
+            for (size_t j = 0; j < outlinePoints.size(); ++j)
             {
-                DrawLineV(screenPoints[j], screenPoints[(j + 1) % screenPoints.size()], YELLOW);
+                DrawLineV(outlinePoints[j], outlinePoints[(j + 1) % outlinePoints.size()], YELLOW);
             }
         }
     }
 
     // Render flipper bases (BF from TMX)
-    for (size_t i = 0; i < flipperBases.size(); ++i)
+    for (int k = firstBase; k < firstBase + baseCount; ++k)
     {
-        int x = 0, y = 0;
-        if (!flipperBases[i]) continue;
-        flipperBases[i]->GetPosition(x, y);
+        if (!bodies.active[k]) continue;
+        float x = bodies.x[k], y = bodies.y[k];
 
         if (flipperBaseTexture.id)
         {
-            float bs = (float)flipperBases[i]->width / (float)flipperBaseTexture.width;
+            float bs = bodies.width[k] / (float)flipperBaseTexture.width;
             int bw = (int)(flipperBaseTexture.width * bs);
             int bh = (int)(flipperBaseTexture.height * bs);
             Rectangle src = { 0,0,(float)flipperBaseTexture.width,(float)flipperBaseTexture.height };
-            Rectangle dst = { (float)x, (float)y, (float)bw, (float)bh };
+            Rectangle dst = { x, y, (float)bw, (float)bh };
             Vector2 origin = { bw / 2.0f, bh / 2.0f };
             DrawTexturePro(flipperBaseTexture, src, dst, origin, 0.0f, WHITE);
         }
         else
         {
-            DrawCircle(x, y, (float)flipperBases[i]->width / 2.0f, DARKGRAY);
+            DrawCircleV(Vector2{ x, y }, bodies.width[k] / 2.0f, DARKGRAY);
         }
     }
 
     // =================================================================
     // Render Flippers with Texture
     // =================================================================
-    auto draw_flipper_with_texture = [this](PhysBody* flipperBody, bool isLeft)
+    auto draw_flipper_with_texture = [this, &bodies](int k, bool isLeft)
         {
-            if (!flipperBody || !flipperBody->body) return;
+            if (k < 0) return;
             if (!flipperTexture.id) return;
 
-            b2Body* body = flipperBody->body;
-            b2Vec2 pos = body->GetPosition();
-            float angle = body->GetAngle();
+            float angle = bodies.angle[k];
 
-            // Convert position to screen coordinates
-            int x = (int)(METERS_TO_PIXELS * pos.x);
-            int y = (int)(SCREEN_HEIGHT - (METERS_TO_PIXELS * pos.y));
+            // Already in screen coordinates
+            float x = bodies.x[k];
+            float y = bodies.y[k];
 
             // Desired visual height - increased by 2.0x for better visibility
             float visualScale = 2.0f;
-            float dstHeight = (float)flipperBody->height * visualScale;
+            float dstHeight = bodies.height[k] * visualScale;
             // Compute scale to preserve aspect ratio of the texture (no stretching)
             float scale = dstHeight / (float)flipperTexture.height;
             float dstWidth = (float)flipperTexture.width * scale;
@@ -1432,8 +1727,8 @@ void ModuleGame::RenderPlayingState()
             float offsetY = localOffsetX * sinf(ang_rad) + 0.0f * cosf(ang_rad);
 
             // Compute visual center in screen coordinates (pivot is at x,y)
-            float centerX = (float)x + offsetX;
-            float centerY = (float)y + offsetY;
+            float centerX = x + offsetX;
+            float centerY = y + offsetY;
 
             Rectangle dst = { centerX, centerY, dstWidth, dstHeight };
             Vector2 origin = { dstWidth / 2.0f, dstHeight / 2.0f };
@@ -1443,32 +1738,32 @@ void ModuleGame::RenderPlayingState()
         };
 
     // Render left flipper
-    draw_flipper_with_texture(leftFlipper, true);
+    draw_flipper_with_texture(bodies.Find(SNAPSHOT_LEFT_FLIPPER), true);
 
     // Render right flipper
-    draw_flipper_with_texture(rightFlipper, false);
+    draw_flipper_with_texture(bodies.Find(SNAPSHOT_RIGHT_FLIPPER), false);
     // =================================================================
     // END Flipper Rendering
     // =================================================================
 
     // Render ball
-    if (ball && ball->body)
+    int ballIndex = bodies.Find(SNAPSHOT_BALL);
+    if (ballIndex >= 0)
     {
-        int x, y;
-        ball->GetPosition(x, y);
+        float x = bodies.x[ballIndex], y = bodies.y[ballIndex];
         if (ballTexture.id)
         {
             float s = 30.0f / (float)ballTexture.width;
             int w = (int)(ballTexture.width * s);
             int h = (int)(ballTexture.height * s);
             Rectangle src = { 0,0,(float)ballTexture.width,(float)ballTexture.height };
-            Rectangle dst = { (float)x, (float)y, (float)w, (float)h };
+            Rectangle dst = { x, y, (float)w, (float)h };
             Vector2 origin = { w / 2.0f, h / 2.0f };
             DrawTexturePro(ballTexture, src, dst, origin, 0.0f, WHITE);
         }
         else
         {
-            DrawCircle(x, y, 15, BLUE);
+            DrawCircleV(Vector2{ x, y }, 15, BLUE);
         }
     }
 
@@ -1477,21 +1772,21 @@ void ModuleGame::RenderPlayingState()
 
 void ModuleGame::UpdatePausedState()
 {
-    if (IsKeyPressed(KEY_P) || IsKeyPressed(KEY_SPACE))
+    if (App->input->IsKeyPressed(KEY_P) || App->input->IsKeyPressed(KEY_SPACE))
     {
-        TransitionToState(&gameData, STATE_PLAYING);
+        ChangeState(STATE_PLAYING);
     }
 
-    if (IsKeyPressed(KEY_M))
+    if (App->input->IsKeyPressed(KEY_M))
     {
-        TransitionToState(&gameData, STATE_MENU);
-        if (ball && ball->body) ball->body->SetEnabled(false);
+        ChangeState(STATE_MENU);
+        if (ball && ball->body) ball->SetEnabled(false);
     }
 }
 
-void ModuleGame::RenderPausedState()
+void ModuleGame::RenderPausedState(const RenderSnapshot& snapshot)
 {
-    RenderPlayingState();
+    RenderPlayingState(snapshot);
 
     DrawRectangle(0, 0, SCREEN_WIDTH, SCREEN_HEIGHT, Color{ 0, 0, 0, 180 });
 
@@ -1505,30 +1800,30 @@ void ModuleGame::RenderPausedState()
 
 void ModuleGame::UpdateGameOverState()
 {
-    if (IsKeyPressed(KEY_M))
+    if (App->input->IsKeyPressed(KEY_M))
     {
-        TransitionToState(&gameData, STATE_MENU);
-        if (ball && ball->body) ball->body->SetEnabled(false);
+        ChangeState(STATE_MENU);
+        if (ball && ball->body) ball->SetEnabled(false);
     }
 
-    if (IsKeyPressed(KEY_R))
+    if (App->input->IsKeyPressed(KEY_R))
     {
         ResetGame(&gameData);
-        TransitionToState(&gameData, STATE_PLAYING);
+        ChangeState(STATE_PLAYING);
 
         if (ball && ball->body)
         {
-            ball->body->SetEnabled(true);
-            ball->body->SetTransform(b2Vec2(2.0f, 8.7f), 0);
-            ball->body->SetLinearVelocity(b2Vec2(0, 0));
-            ball->body->SetAngularVelocity(0);
+            ball->SetEnabled(true);
+            ball->SetTransform(vec2f(2.0f, 8.7f), 0);
+            ball->SetLinearVelocity(vec2f(0, 0));
+            ball->SetAngularVelocity(0);
         }
 
         ballLaunched = false;
     }
 }
 
-void ModuleGame::RenderGameOverState()
+void ModuleGame::RenderGameOverState(const RenderSnapshot& snapshot)
 {
     if (backgroundTexture.id)
     {
@@ -1544,15 +1839,15 @@ void ModuleGame::RenderGameOverState()
     Vector2 textSize = MeasureTextEx(font, gameOverText, 70, 2);
     DrawTextEx(font, gameOverText, { (float)(SCREEN_WIDTH / 2 - textSize.x / 2), 150.0f }, 70, 2, RED);
 
-    DrawTextEx(font, TextFormat("Final Score: %d", gameData.previousScore),
+    DrawTextEx(font, TextFormat("Final Score: %d", snapshot.game.previousScore),
         { (float)(SCREEN_WIDTH / 2 - 150), 280.0f }, 35, 1, WHITE);
 
-    if (gameData.previousScore == gameData.highestScore && gameData.highestScore > 0)
+    if (snapshot.game.previousScore == snapshot.game.highestScore && snapshot.game.highestScore > 0)
     {
         DrawTextEx(font, "NEW HIGH SCORE!", { (float)(SCREEN_WIDTH / 2 - 150), 340.0f }, 30, 1, GOLD);
     }
 
-    DrawTextEx(font, TextFormat("High Score: %d", gameData.highestScore),
+    DrawTextEx(font, TextFormat("High Score: %d", snapshot.game.highestScore),
         { (float)(SCREEN_WIDTH / 2 - 140), 380.0f }, 30, 1, YELLOW);
 
     DrawTextEx(font, "Press M to Main Menu", { (float)(SCREEN_WIDTH / 2 - 150), 450.0f }, 25, 1, SKYBLUE);
@@ -1561,30 +1856,30 @@ void ModuleGame::RenderGameOverState()
 
 void ModuleGame::UpdateYouWinState()
 {
-    if (IsKeyPressed(KEY_M))
+    if (App->input->IsKeyPressed(KEY_M))
     {
-        TransitionToState(&gameData, STATE_MENU);
-        if (ball && ball->body) ball->body->SetEnabled(false);
+        ChangeState(STATE_MENU);
+        if (ball && ball->body) ball->SetEnabled(false);
     }
 
-    if (IsKeyPressed(KEY_R))
+    if (App->input->IsKeyPressed(KEY_R))
     {
         ResetGame(&gameData);
-        TransitionToState(&gameData, STATE_PLAYING);
+        ChangeState(STATE_PLAYING);
 
         if (ball && ball->body)
         {
-            ball->body->SetEnabled(true);
-            ball->body->SetTransform(b2Vec2(2.0f, 8.7f), 0);
-            ball->body->SetLinearVelocity(b2Vec2(0, 0));
-            ball->body->SetAngularVelocity(0);
+            ball->SetEnabled(true);
+            ball->SetTransform(vec2f(2.0f, 8.7f), 0);
+            ball->SetLinearVelocity(vec2f(0, 0));
+            ball->SetAngularVelocity(0);
         }
 
         ballLaunched = false;
     }
 }
 
-void ModuleGame::RenderYouWinState()
+void ModuleGame::RenderYouWinState(const RenderSnapshot& snapshot)
 {
     if (backgroundTexture.id)
     {
@@ -1600,12 +1895,12 @@ void ModuleGame::RenderYouWinState()
     Vector2 textSize = MeasureTextEx(font, youWinText, 70, 2);
     DrawTextEx(font, youWinText, { (float)(SCREEN_WIDTH / 2 - textSize.x / 2), 150.0f }, 70, 2, GREEN);
 
-    DrawTextEx(font, TextFormat("New High Score: %d", gameData.previousScore),
+    DrawTextEx(font, TextFormat("New High Score: %d", snapshot.game.previousScore),
         { (float)(SCREEN_WIDTH / 2 - 180), 280.0f }, 35, 1, GOLD);
 
     DrawTextEx(font, "CONGRATULATIONS!", { (float)(SCREEN_WIDTH / 2 - 150), 340.0f }, 30, 1, YELLOW);
 
-    DrawTextEx(font, TextFormat("Previous High Score: %d", gameData.highestScore),
+    DrawTextEx(font, TextFormat("Previous High Score: %d", snapshot.game.highestScore),
         { (float)(SCREEN_WIDTH / 2 - 200), 380.0f }, 25, 1, LIGHTGRAY);
 
     DrawTextEx(font, "Press M to Main Menu", { (float)(SCREEN_WIDTH / 2 - 150), 450.0f }, 25, 1, SKYBLUE);
@@ -1618,15 +1913,15 @@ void ModuleGame::LaunchBall()
 
     LOG("Launching ball with force: %.2f", kickerForce);
 
-    b2Vec2 impulse(0.0f, -kickerForce);
-    ball->body->ApplyLinearImpulseToCenter(impulse, true);
+    vec2f impulse(0.0f, -kickerForce);
+    ball->ApplyLinearImpulseToCenter(impulse);
 
     ballLaunched = true;
     kickerChargeTime = 0.0f;
     kickerForce = 0.0f;
     spawnZoneDwellTime = 0.0f; // Reset spawn zone timer on launch
 
-    if (launchSfx >= 0) App->audio->PlayFx(launchSfx);
+    if (launchSfx > 0) App->audio->PlayFx(launchSfx);
 }
 
 void ModuleGame::RespawnBall()
@@ -1639,10 +1934,10 @@ void ModuleGame::RespawnBall()
         return;
     }
 
-    ball->body->SetTransform(b2Vec2(2.0f, 8.7f), 0);
-    ball->body->SetLinearVelocity(b2Vec2(0, 0));
-    ball->body->SetAngularVelocity(0);
-    ball->body->SetEnabled(true);
+    ball->SetTransform(vec2f(2.0f, 8.7f), 0);
+    ball->SetLinearVelocity(vec2f(0, 0));
+    ball->SetAngularVelocity(0);
+    ball->SetEnabled(true);
 
     ballLaunched = false;
     spawnZoneDwellTime = 0.0f; // Reset spawn zone timer on respawn
@@ -1671,14 +1966,10 @@ void ModuleGame::LoseBall()
 {
     LOG("Processing ball loss");
 
-    if (ballLostSfx >= 0)
-    {
-        App->audio->PlayFx(ballLostSfx);
-    }
-
     ResetStarCombo();
 
     gameData.ballsLeft--;
+    App->events->Publish(BallLostEvent{ gameData.ballsLeft });
 
     LOG("Balls left: %d", gameData.ballsLeft);
 
@@ -1696,16 +1987,16 @@ void ModuleGame::LoseBall()
         {
             gameData.highestScore = gameData.currentScore;
             gameData.scoreNeedsSaving = true;
-            TransitionToState(&gameData, STATE_YOU_WIN);
+            ChangeState(STATE_YOU_WIN);
         }
         else
         {
-            TransitionToState(&gameData, STATE_GAME_OVER);
+            ChangeState(STATE_GAME_OVER);
         }
 
         if (ball && ball->body)
         {
-            ball->body->SetEnabled(false);
+            ball->SetEnabled(false);
         }
 
         ballLaunched = false;
@@ -1718,11 +2009,7 @@ void ModuleGame::AddComboLetter(char letter)
         letter == gameData.comboLetters[gameData.comboProgress])
     {
         gameData.comboProgress++;
-        if (letterCollectSfx >= 0) {
-            App->audio->PlayFx(letterCollectSfx);
-        }
-
-        App->audio->PlayComboProgressSound(gameData.comboProgress, 4);
+        App->events->Publish(ComboProgressEvent{ gameData.comboProgress, 4 });
         AddScore(TARGET_COMBO_LETTER, "Combo Letter");
 
         if (gameData.comboProgress >= 4)
@@ -1734,6 +2021,7 @@ void ModuleGame::AddComboLetter(char letter)
 
 void ModuleGame::SpawnStarLetter()
 {
+    ALLOC_TAG("Star letters");
     if (!starLetters.empty()) return;
 
     if (gameData.comboProgress >= 4) {
@@ -1749,73 +2037,18 @@ void ModuleGame::SpawnStarLetter()
 
     char letter = letters[nextLetterIndex];
 
-    int centerX = SCREEN_WIDTH / 2;
-    int minY = (int)(SCREEN_HEIGHT * 0.3f);
-    int maxY = (int)(SCREEN_HEIGHT * 0.7f);
-
-    // Try multiple random positions and pick one that doesn't overlap static collisions (e1/e2, walls, bases)
-    const int letterRadiusPx = 20;
-    const int maxTries = 40;
-    int x = centerX;
-    int y = (minY + maxY) / 2;
-
-    auto isBlocked = [&](int sx, int sy) -> bool {
-        b2World* world = App->physics->GetWorld();
-        if (!world) return false;
-
-        float wx = PIXELS_TO_METERS * sx;
-        float wy = PIXELS_TO_METERS * (SCREEN_HEIGHT - sy);
-        float r = PIXELS_TO_METERS * (letterRadiusPx + 4); // small padding
-
-        b2AABB aabb;
-        aabb.lowerBound.Set(wx - r, wy - r);
-        aabb.upperBound.Set(wx + r, wy + r);
-
-        struct QCb : public b2QueryCallback {
-            bool hit = false;
-            bool ReportFixture(b2Fixture* f) override {
-                // Avoid any fixture (static/dynamic) within the AABB so letters don't spawn inside geometry
-                hit = true;
-                return false; // stop early
-            }
-        } cb;
-
-        world->QueryAABB(&cb, aabb);
-        return cb.hit;
-    };
-
-    bool placed = false;
-    for (int i = 0; i < maxTries; ++i) {
-        int rx = GetRandomValue(centerX - 200, centerX + 200);
-        int ry = GetRandomValue(minY, maxY);
-        if (!isBlocked(rx, ry)) { x = rx; y = ry; placed = true; break; }
-    }
-
-    if (!placed) {
-        // Last resort: scan a small grid near center to find an empty slot
-        for (int dy = -150; dy <= 150 && !placed; dy += 30) {
-            for (int dx = -200; dx <= 200 && !placed; dx += 30) {
-                int rx = centerX + dx;
-                int ry = (minY + maxY) / 2 + dy;
-                if (rx > 40 && rx < SCREEN_WIDTH - 40 && ry > 40 && ry < SCREEN_HEIGHT - 40) {
-                    if (!isBlocked(rx, ry)) { x = rx; y = ry; placed = true; break; }
-                }
-            }
-        }
-    }
+    // Free cells were precomputed from the static geometry at table load
+    int x = SCREEN_WIDTH / 2;
+    int y = SCREEN_HEIGHT / 2;
+    bool placed = spawnGrid.SampleFree(letterSpawnZone, x, y);
 
-    PhysBody* letterBody = App->physics->CreateCircle(x, y, letterRadiusPx, b2_staticBody);
+    PhysBody* letterBody = CreateStarLetterBody(x, y);
 
     if (letterBody) {
-        b2Fixture* fixture = letterBody->body->GetFixtureList();
-        if (fixture) {
-            fixture->SetSensor(true);
-        }
-
-        letterBody->listener = this;
-
         StarLetter newLetter;
         newLetter.body = letterBody;
+        newLetter.x = x;
+        newLetter.y = y;
         newLetter.letter = letter;
         newLetter.collected = false;
         newLetter.spawnTime = 0.0f;
@@ -1826,6 +2059,18 @@ void ModuleGame::SpawnStarLetter()
     }
 }
 
+PhysBody* ModuleGame::CreateStarLetterBody(int x, int y)
+{
+    PhysBody* letterBody = App->physics->CreateCircle(x, y, STAR_LETTER_RADIUS, PHYS_BODY_STATIC);
+
+    if (letterBody) {
+        letterBody->SetSensor(true);
+
+        letterBody->listener = this;
+    }
+    return letterBody;
+}
+
 void ModuleGame::CollectStarLetter(char letter)
 {
     const char* expectedSequence = "STAR";
@@ -1834,10 +2079,7 @@ void ModuleGame::CollectStarLetter(char letter)
         gameData.comboProgress++;
         nextLetterIndex = gameData.comboProgress;
 
-        if (letterCollectSfx >= 0) {
-            App->audio->PlayFx(letterCollectSfx);
-        }
-
+        App->events->Publish(ComboProgressEvent{ gameData.comboProgress, 4 });
         AddScore(TARGET_COMBO_LETTER, "Combo Letter");
         LOG("Collected letter %c, progress: %d/4, next index: %d",
             letter, gameData.comboProgress, nextLetterIndex);
@@ -1859,12 +2101,7 @@ void ModuleGame::CompleteStarCombo()
     gameData.ballsLeft++;
 
     AddScore(5000, "Combo Complete");
-
-    if (specialHitSfx >= 0) {
-        App->audio->PlayFx(specialHitSfx);
-    }
-    App->audio->PlayComboCompleteSequence();
-    App->audio->PlayExtraBallAward();
+    App->events->Publish(ComboCompletedEvent{ 5000 });
 
     comboCompleteEffect = true;
     comboCompleteTimer = 0.0f;
@@ -1875,7 +2112,7 @@ void ModuleGame::CompleteStarCombo()
     ResetStarCombo();
 }
 
-void ModuleGame::DrawAudioSettings()
+void ModuleGame::DrawAudioSettings(const RenderSnapshot& snapshot)
 {
     DrawRectangle(0, 0, SCREEN_WIDTH, SCREEN_HEIGHT, Color{ 0,0,0,200 });
     DrawTextEx(font, "AUDIO SETTINGS", { (float)(SCREEN_WIDTH / 2 - 150), 50.0f }, 30, 1, WHITE);
@@ -1884,52 +2121,52 @@ void ModuleGame::DrawAudioSettings()
     int startY = 150;
     int spacing = 80;
     DrawTextEx(font, "Master Volume:", { 100.0f, (float)startY }, 20, 1, WHITE);
-    DrawTextEx(font, TextFormat("%.0f%%", App->audio->GetMasterVolume() * 100), { 400.0f, (float)startY }, 20, 1, YELLOW);
+    DrawTextEx(font, TextFormat("%.0f%%", snapshot.masterVolume * 100), { 400.0f, (float)startY }, 20, 1, YELLOW);
     DrawRectangle(100, startY + 30, 400, 20, DARKGRAY);
-    DrawRectangle(100, startY + 30, (int)(400 * App->audio->GetMasterVolume()), 20, GREEN);
+    DrawRectangle(100, startY + 30, (int)(400 * snapshot.masterVolume), 20, GREEN);
     DrawTextEx(font, "[1/2] Decrease/Increase", { 520.0f, (float)(startY + 5) }, 16, 1, LIGHTGRAY);
 
     DrawTextEx(font, "Music Volume:", { 100.0f, (float)(startY + spacing) }, 20, 1, WHITE);
-    DrawTextEx(font, TextFormat("%.0f%%", App->audio->GetMusicVolume() * 100), { 400.0f, (float)(startY + spacing) }, 20, 1, YELLOW);
+    DrawTextEx(font, TextFormat("%.0f%%", snapshot.musicVolume * 100), { 400.0f, (float)(startY + spacing) }, 20, 1, YELLOW);
     DrawRectangle(100, startY + spacing + 30, 400, 20, DARKGRAY);
-    DrawRectangle(100, startY + spacing + 30, (int)(400 * App->audio->GetMusicVolume()), 20, BLUE);
+    DrawRectangle(100, startY + spacing + 30, (int)(400 * snapshot.musicVolume), 20, BLUE);
     DrawTextEx(font, "[3/4] Decrease/Increase", { 520.0f, (float)(startY + spacing + 5) }, 16, 1, LIGHTGRAY);
 
     DrawTextEx(font, "SFX Volume:", { 100.0f, (float)(startY + spacing * 2) }, 20, 1, WHITE);
-    DrawTextEx(font, TextFormat("%.0f%%", App->audio->GetSFXVolume() * 100), { 400.0f, (float)(startY + spacing * 2) }, 20, 1, YELLOW);
+    DrawTextEx(font, TextFormat("%.0f%%", snapshot.sfxVolume * 100), { 400.0f, (float)(startY + spacing * 2) }, 20, 1, YELLOW);
     DrawRectangle(100, startY + spacing * 2 + 30, 400, 20, DARKGRAY);
-    DrawRectangle(100, startY + spacing * 2 + 30, (int)(400 * App->audio->GetSFXVolume()), 20, RED);
+    DrawRectangle(100, startY + spacing * 2 + 30, (int)(400 * snapshot.sfxVolume), 20, RED);
     DrawTextEx(font, "[5/6] Decrease/Increase", { 520.0f, (float)(startY + spacing * 2 + 5) }, 16, 1, LIGHTGRAY);
 
     DrawTextEx(font, "Mute All: [M]", { 100.0f, (float)(startY + spacing * 3) }, 20, 1, WHITE);
-    if (App->audio->GetMasterVolume() == 0.0f) DrawTextEx(font, "MUTED", { 300.0f, (float)(startY + spacing * 3) }, 20, 1, RED);
+    if (snapshot.masterVolume == 0.0f) DrawTextEx(font, "MUTED", { 300.0f, (float)(startY + spacing * 3) }, 20, 1, RED);
     else DrawTextEx(font, "ACTIVE", { 300.0f, (float)(startY + spacing * 3) }, 20, 1, GREEN);
 
     DrawTextEx(font, "Press [S] to save settings", { (float)(SCREEN_WIDTH / 2 - 120), (float)(SCREEN_HEIGHT - 80) }, 18, 1, GREEN);
-    if (settingsSavedMessage) DrawTextEx(font, "Settings Saved!", { (float)(SCREEN_WIDTH / 2 - 80), (float)(SCREEN_HEIGHT - 50) }, 20, 1, LIME);
+    if (snapshot.settingsSavedMessage) DrawTextEx(font, "Settings Saved!", { (float)(SCREEN_WIDTH / 2 - 80), (float)(SCREEN_HEIGHT - 50) }, 20, 1, LIME);
 }
 
 void ModuleGame::UpdateAudioSettings()
 {
     float step = 0.05f;
-    if (IsKeyPressed(KEY_ONE)) App->audio->SetMasterVolume(App->audio->GetMasterVolume() - step);
-    if (IsKeyPressed(KEY_TWO)) App->audio->SetMasterVolume(App->audio->GetMasterVolume() + step);
-    if (IsKeyPressed(KEY_THREE)) App->audio->SetMusicVolume(App->audio->GetMusicVolume() - step);
-    if (IsKeyPressed(KEY_FOUR)) App->audio->SetMusicVolume(App->audio->GetMusicVolume() + step);
-    if (IsKeyPressed(KEY_FIVE)) App->audio->SetSFXVolume(App->audio->GetSFXVolume() - step);
-    if (IsKeyPressed(KEY_SIX)) App->audio->SetSFXVolume(App->audio->GetSFXVolume() + step);
-    if (IsKeyPressed(KEY_M))
+    if (App->input->IsKeyPressed(KEY_ONE)) App->audio->SetMasterVolume(App->audio->GetMasterVolume() - step);
+    if (App->input->IsKeyPressed(KEY_TWO)) App->audio->SetMasterVolume(App->audio->GetMasterVolume() + step);
+    if (App->input->IsKeyPressed(KEY_THREE)) App->audio->SetMusicVolume(App->audio->GetMusicVolume() - step);
+    if (App->input->IsKeyPressed(KEY_FOUR)) App->audio->SetMusicVolume(App->audio->GetMusicVolume() + step);
+    if (App->input->IsKeyPressed(KEY_FIVE)) App->audio->SetSFXVolume(App->audio->GetSFXVolume() - step);
+    if (App->input->IsKeyPressed(KEY_SIX)) App->audio->SetSFXVolume(App->audio->GetSFXVolume() + step);
+    if (App->input->IsKeyPressed(KEY_M))
     {
         if (App->audio->GetMasterVolume() > 0.0f) App->audio->SetMasterVolume(0.0f);
         else App->audio->SetMasterVolume(1.0f);
     }
-    if (IsKeyPressed(KEY_S))
+    if (App->input->IsKeyPressed(KEY_S))
     {
         SaveAudioSettings();
         settingsSavedMessage = true;
         settingsSavedTimer = 0.0f;
     }
-    if (IsKeyPressed(KEY_ESCAPE)) showAudioSettings = false;
+    if (App->input->IsKeyPressed(KEY_ESCAPE)) showAudioSettings = false;
 }
 
 bool ModuleGame::LoadTMXMap(const char* filepath)
@@ -2255,7 +2492,7 @@ void ModuleGame::CreateMapCollision()
     mapBoundary = App->physics->CreateChain(0, 0,
         scaledPoints.data(),
         (int)scaledPoints.size(),
-        b2_staticBody);
+        PHYS_BODY_STATIC);
 
     if (!mapBoundary)
     {
@@ -2341,10 +2578,10 @@ void ModuleGame::ApplyBlackHoleForces(float dt)
         return;
     }
 
-    b2Vec2 ballPos = ball->body->GetPosition();
-    b2Vec2 ballVel = ball->body->GetLinearVelocity();
+    vec2f ballPos = ball->GetPosition();
+    vec2f ballVel = ball->GetLinearVelocity();
     float ballSpeed = ballVel.Length();
-    float ballMass = ball->body->GetMass();
+    float ballMass = ball->GetMass();
 
     // Update teleport cooldown
     if (teleportCooldown > 0.0f)
@@ -2361,9 +2598,9 @@ void ModuleGame::ApplyBlackHoleForces(float dt)
     for (size_t i = 0; i < blackHoles.size(); ++i)
     {
         PhysBody* bh = blackHoles[i];
-        b2Vec2 bhPos = bh->body->GetPosition();
-        b2Vec2 diff = bhPos - ballPos;
-        float distSq = diff.LengthSquared();
+        vec2f bhPos = bh->GetPosition();
+        vec2f diff = bhPos - ballPos;
+        float distSq = diff.dot(diff);
 
         if (distSq < closestDistSq)
         {
@@ -2408,7 +2645,7 @@ void ModuleGame::ApplyBlackHoleForces(float dt)
                 if (targetBHIndex != closestBHIndex)
                 {
                     PhysBody* targetBH = blackHoles[targetBHIndex];
-                    b2Vec2 targetPos = targetBH->body->GetPosition();
+                    vec2f targetPos = targetBH->GetPosition();
 
                     // Calculate map boundaries in Box2D coordinates (meters)
                     const float MAP_MIN_X = 0.5f; // 0.5 meter margin from left edge
@@ -2416,10 +2653,9 @@ void ModuleGame::ApplyBlackHoleForces(float dt)
                     const float MAP_MIN_Y = 0.5f; // 0.5 meter margin from top
                     const float MAP_MAX_Y = (SCREEN_HEIGHT * PIXELS_TO_METERS) - 0.5f; // 0.5 meter margin from bottom
 
-                    // Helper class to check if a position overlaps with collision objects
-                    class TeleportCollisionCallback : public b2QueryCallback
+                    // Helper to check if a position overlaps with collision objects
+                    struct TeleportCollisionCallback
                     {
-                    public:
                         bool foundCollision;
                         PhysBody* ballBody;
                         std::vector<PhysBody*>* blackHolesToIgnore;
@@ -2427,31 +2663,31 @@ void ModuleGame::ApplyBlackHoleForces(float dt)
                         TeleportCollisionCallback(PhysBody* ball, std::vector<PhysBody*>* bhList) 
                             : foundCollision(false), ballBody(ball), blackHolesToIgnore(bhList) {}
 
-                        bool ReportFixture(b2Fixture* fixture) override
+                        static bool Report(void* context, const PhysQueryHit& hit)
                         {
-                            PhysBody* pb = (PhysBody*)fixture->GetBody()->GetUserData().pointer;
+                            TeleportCollisionCallback* callback = (TeleportCollisionCallback*)context;
                             
                             // Ignore the ball itself and black holes (sensors)
-                            if (pb == ballBody || fixture->IsSensor())
+                            if (hit.body == callback->ballBody || hit.sensor)
                                 return true;
                             
                             // Found a solid collision object at this position
-                            foundCollision = true;
+                            callback->foundCollision = true;
                             return false; // Stop searching
                         }
                     };
 
                     // Teleport ball to the target black hole with slight offset to avoid re-trapping
                     // Try multiple times to find a valid position within map bounds and without collisions
-                    b2Vec2 finalPos = targetPos;
+                    vec2f finalPos = targetPos;
                     bool foundValidPos = false;
                     
                     for (int attempt = 0; attempt < 40 && !foundValidPos; attempt++)
                     {
                         float offsetAngle = GetRandomValue(0, 360) * DEGTORAD;
                         float offsetDist = 1.5f; // meters - spawn well outside the trap zone (increased from 0.8)
-                        b2Vec2 offset(cosf(offsetAngle) * offsetDist, sinf(offsetAngle) * offsetDist);
-                        b2Vec2 testPos = targetPos + offset;
+                        vec2f offset(cosf(offsetAngle) * offsetDist, sinf(offsetAngle) * offsetDist);
+                        vec2f testPos = targetPos + offset;
 
                         // Check if position is within map boundaries
                         if (testPos.x >= MAP_MIN_X && testPos.x <= MAP_MAX_X &&
@@ -2459,13 +2695,11 @@ void ModuleGame::ApplyBlackHoleForces(float dt)
                         {
                             // Check if position overlaps with any collision objects
                             const float BALL_RADIUS = 0.25f; // Ball radius in meters (approximate)
-                            b2AABB aabb;
-                            aabb.lowerBound = b2Vec2(testPos.x - BALL_RADIUS, testPos.y - BALL_RADIUS);
-                            aabb.upperBound = b2Vec2(testPos.x + BALL_RADIUS, testPos.y + BALL_RADIUS);
+                            vec2f lower(testPos.x - BALL_RADIUS, testPos.y - BALL_RADIUS);
+                            vec2f upper(testPos.x + BALL_RADIUS, testPos.y + BALL_RADIUS);
 
                             TeleportCollisionCallback callback(ball, &blackHoles);
-                            b2World* world = App->physics->GetWorld();
-                            world->QueryAABB(&callback, aabb);
+                            App->physics->GetBackend()->QueryAABB(lower, upper, &TeleportCollisionCallback::Report, &callback);
 
                             if (!callback.foundCollision)
                             {
@@ -2482,13 +2716,13 @@ void ModuleGame::ApplyBlackHoleForces(float dt)
                         LOG("Warning: Could not find valid teleport offset, using black hole center");
                     }
 
-                    ball->body->SetTransform(finalPos, ball->body->GetAngle());
+                    ball->SetTransform(finalPos, ball->GetAngle());
 
                     // Give a stronger random velocity to eject from the black hole
                     float angle = GetRandomValue(0, 360) * DEGTORAD;
                     float ejectSpeed = 5.0f; // Increased from 3.0 to 5.0 meters/second
-                    b2Vec2 ejectVel(cosf(angle) * ejectSpeed, sinf(angle) * ejectSpeed);
-                    ball->body->SetLinearVelocity(ejectVel);
+                    vec2f ejectVel(cosf(angle) * ejectSpeed, sinf(angle) * ejectSpeed);
+                    ball->SetLinearVelocity(ejectVel);
 
                     LOG("BLACK HOLE TELEPORT! %d -> %d (ejection speed: %.2f m/s)", closestBHIndex, targetBHIndex, ejectSpeed);
                     AddScore(500, "Black Hole Teleport");
@@ -2497,7 +2731,7 @@ void ModuleGame::ApplyBlackHoleForces(float dt)
                     teleportCooldown = TELEPORT_COOLDOWN_TIME;
 
                     // Play special sound if available
-                    if (specialHitSfx >= 0)
+                    if (specialHitSfx > 0)
                     {
                         App->audio->PlayFx(specialHitSfx);
                     }
@@ -2534,9 +2768,9 @@ void ModuleGame::ApplyBlackHoleForces(float dt)
     // Apply gravitational attraction force to all black holes
     for (PhysBody* bh : blackHoles)
     {
-        b2Vec2 bhPos = bh->body->GetPosition();
-        b2Vec2 diff = bhPos - ballPos;
-        float distSq = diff.LengthSquared();
+        vec2f bhPos = bh->GetPosition();
+        vec2f diff = bhPos - ballPos;
+        float distSq = diff.dot(diff);
 
         const float MAX_ATTRACTION_DIST_SQ = 10.0f * 10.0f;
         const float MIN_ATTRACTION_DIST = 0.5f;
@@ -2554,11 +2788,11 @@ void ModuleGame::ApplyBlackHoleForces(float dt)
 
             float forceMag = (GRAVITY_CONSTANT * ballMass) / (effectiveDist * effectiveDist);
 
-            b2Vec2 forceVec = diff;
+            vec2f forceVec = diff;
             forceVec.Normalize();
             forceVec *= forceMag;
 
-            ball->body->ApplyForceToCenter(forceVec, true);
+            ball->ApplyForceToCenter(forceVec);
         }
     }
 }
@@ -2569,7 +2803,7 @@ void ModuleGame::UpdateMovingTargets(float dt)
     {
         if (!target.body || !target.body->body) continue;
 
-        b2Vec2 currentPos = target.body->body->GetPosition();
+        vec2f currentPos = target.body->GetPosition();
         float currentY = currentPos.y * METERS_TO_PIXELS;
         currentY = SCREEN_HEIGHT - currentY;
 
@@ -2593,7 +2827,7 @@ void ModuleGame::UpdateMovingTargets(float dt)
         }
 
         float newYBox2D = (SCREEN_HEIGHT - currentY) * PIXELS_TO_METERS;
-        target.body->body->SetTransform(b2Vec2(currentPos.x, newYBox2D), 0);
+        target.body->SetTransform(vec2f(currentPos.x, newYBox2D), 0);
     }
 }
 
@@ -2601,7 +2835,7 @@ void ModuleGame::PauseGame()
 {
     if (gameData.currentState == STATE_PLAYING)
     {
-        TransitionToState(&gameData, STATE_PAUSED);
+        ChangeState(STATE_PAUSED);
         isGamePaused = true;
     }
 }
@@ -2610,7 +2844,7 @@ void ModuleGame::ResumeGame()
 {
     if (gameData.currentState == STATE_PAUSED)
     {
-        TransitionToState(&gameData, STATE_PLAYING);
+        ChangeState(STATE_PLAYING);
         isGamePaused = false;
     }
 }
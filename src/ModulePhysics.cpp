@@ -2,17 +2,24 @@
 #include "Application.h"
 #include "ModulePhysics.h"
 #include "PhysBody.h"
+#include "Timer.h"
+#include "Trace.h"
+#include "InputScript.h"
+#include "PerfCounters.h"
+#include "SpikeDetector.h"
+#include "WorldSnapshot.h"
 #include "raylib.h"
 
+#include <algorithm>
+
 // Funci�n helper para filtrar v�rtices muy cercanos
-std::vector<b2Vec2> FilterCloseVertices(b2Vec2* vertices, int count, float minDistance = 0.05f)
+static void FilterCloseVertices(std::vector<vec2f>& vertices, float minDistance = 0.05f)
 {
-	std::vector<b2Vec2> filteredVertices;
-
-	if (count <= 0) return filteredVertices;
+	int count = (int)vertices.size();
+	if (count <= 0) return;
 
 	// Siempre agregar el primer v�rtice
-	filteredVertices.push_back(vertices[0]);
+	int kept = 1;
 
 	// Filtrar v�rtices subsecuentes que est�n muy cerca
 	for (int i = 1; i < count; ++i)
@@ -20,9 +27,10 @@ std::vector<b2Vec2> FilterCloseVertices(b2Vec2* vertices, int count, float minDi
 		bool tooClose = false;
 
 		// Verificar distancia con todos los v�rtices ya agregados
-		for (const auto& existing : filteredVertices)
+		for (int k = 0; k < kept; ++k)
 		{
-			float distSq = b2DistanceSquared(vertices[i], existing);
+			vec2f d = vertices[i] - vertices[k];
+			float distSq = d.dot(d);
 			if (distSq < minDistance * minDistance)
 			{
 				tooClose = true;
@@ -32,20 +40,92 @@ std::vector<b2Vec2> FilterCloseVertices(b2Vec2* vertices, int count, float minDi
 
 		if (!tooClose)
 		{
-			filteredVertices.push_back(vertices[i]);
+			vertices[kept++] = vertices[i];
 		}
 	}
 
-	LOG("Filtered vertices: %d -> %d", count, (int)filteredVertices.size());
-	return filteredVertices;
+	vertices.resize(kept);
+	LOG("Filtered vertices: %d -> %d", count, kept);
 }
 
+// Names and bin widths of the PhysStat histograms. Timings are in ms
+struct PhysStatInfo
+{
+	const char* name;
+	float binWidth;
+};
+
+static const PhysStatInfo STAT_INFO[PHYS_STAT_COUNT] =
+{
+	{ "Step", 0.025f },
+	{ "Collide", 0.025f },
+	{ "Solve", 0.025f },
+	{ "Solve TOI", 0.025f },
+	{ "Broadphase", 0.025f },
+	{ "Bodies", 2.0f },
+	{ "Proxies", 4.0f },
+	{ "Contacts", 2.0f },
+	{ "Touching", 1.0f },
+	{ "Chain cont.", 2.0f },
+	{ "Sensor cont.", 1.0f },
+	{ "TOI events", 1.0f },
+	{ "Substeps", 1.0f },
+};
+
+static bool IsTimeStat(int stat)
+{
+	return stat <= PHYS_STAT_BROADPHASE;
+}
+
+static bool IsValid(vec2f v)
+{
+	return isfinite(v.x) && isfinite(v.y);
+}
+
+// A ball faster than this, or this close to a chain edge or a flipper, gets the
+// frame split so it moves at most SUBSTEP_MAX_TRAVEL of its radius per step
+static const float SUBSTEP_SPEED = 12.0f;			// m/s
+static const float SUBSTEP_NEAR_DISTANCE = 0.3f;	// m, on top of the frame's travel
+static const float SUBSTEP_MAX_TRAVEL = 0.5f;
+
+// Thin things a ball can tunnel through: the chains, and the flippers, the only
+// dynamic bodies that aren't bullets
+struct TunnelHazardQuery
+{
+	PhysBody* ball = nullptr;
+	bool found = false;
+
+	static bool Report(void* context, const PhysQueryHit& hit)
+	{
+		TunnelHazardQuery* query = (TunnelHazardQuery*)context;
+		if (hit.body == query->ball || hit.sensor) return true;
+
+		if (hit.shape == PHYS_SHAPE_CHAIN || (hit.type == PHYS_BODY_DYNAMIC && !hit.bullet))
+		{
+			query->found = true;
+			return false;
+		}
+		return true;
+	}
+};
+
 ModulePhysics::ModulePhysics(Application* app, bool start_enabled) : Module(app, start_enabled)
 {
     debug = false;
-    world = nullptr;
-    mouseJoint = nullptr;
-    ground = nullptr;
+    backend = nullptr;
+    mouseJoint = 0;
+    ground = 0;
+
+    for (int i = 0; i < PHYS_STAT_COUNT; ++i)
+    {
+        stats[i] = RollingHistogram(STAT_INFO[i].binWidth);
+    }
+
+    // Contacts reach ModuleGame::OnCollision between the substeps, and the step is
+    // measured with the game-thread perf counters, so it stays on the main thread
+    DeclareAccess(PHASE_PREUPDATE, RESOURCE_NONE, RESOURCE_PHYSICS_WORLD | RESOURCE_GAME_DATA | RESOURCE_AUDIO | RESOURCE_EVENTS);
+    DeclareAccess(PHASE_UPDATE, RESOURCE_NONE, RESOURCE_NONE);
+    DeclareAccess(PHASE_POSTUPDATE, RESOURCE_WINDOW, RESOURCE_PHYSICS_WORLD | RESOURCE_RENDER);
 }
 
 ModulePhysics::~ModulePhysics()
@@ -54,32 +134,30 @@ ModulePhysics::~ModulePhysics()
 
 bool ModulePhysics::Start()
 {
-	LOG("Creating Physics 2D environment");
-
-	b2Vec2 gravity(0.0f, -10.0f);
-	world = new b2World(gravity);
+	backend = CreatePhysicsBackend(App->jobs);
+	LOG("Creating Physics 2D environment (%s)", backend->GetName());
 
-	if (!world)
+	if (!backend->CreateWorld(vec2f(GRAVITY_X, GRAVITY_Y)))
 	{
-		LOG("ERROR: Failed to create Box2D world");
+		LOG("ERROR: Failed to create physics world");
 		return false;
 	}
 
-	world->SetContactListener(this);
-
-	b2BodyDef bd;
-	bd.type = b2_staticBody;
-	bd.position.Set(0.0f, 0.0f);
-	ground = world->CreateBody(&bd);
+	// Anchor for the debug mouse joint. A tiny sensor, since engines want a shape on every body
+	PhysBodyDef bd;
+	bd.type = PHYS_BODY_STATIC;
+	PhysMaterial anchor;
+	anchor.sensor = true;
+	ground = backend->CreateBox(bd, 0.01f, 0.01f, vec2f(0.0f, 0.0f), anchor);
 
 	return true;
 }
 
 update_status ModulePhysics::PreUpdate()
 {
-	if (!world) return UPDATE_CONTINUE;
+	if (!backend || !backend->HasWorld()) return UPDATE_CONTINUE;
 
-	float dt = GetFrameTime();
+	float dt = App->GetFrameDelta();
 
 	// Validar dt para evitar problemas
 	if (dt <= 0.0f || dt > 0.033f) // M�ximo 30fps
@@ -88,25 +166,91 @@ update_status ModulePhysics::PreUpdate()
 	}
 
 	// Step del mundo con par�metros m�s conservadores
-	world->Step(dt, 6, 2);
-
-	// Limpiar bodies marcados para destruir
-	for (auto body : bodiesToDestroy)
 	{
-		if (body && body->body)
+		TRACE_SCOPE("Physics step");
+		PerfScope perfScope(App->perf, PERF_SECTION_PHYSICS_STEP);
+		SpikeScope spikeScope(App->spikes, SPIKE_SECTION_PHYSICS_STEP);
+		contactCount = 0;
+		substeps = ChooseSubsteps(dt);
+		backend->ResetProfile();
+
+		for (int i = 0; i < substeps; ++i)
 		{
-			world->DestroyBody(body->body);
-			body->body = nullptr;
+			backend->Step(dt / substeps);
+			DispatchContacts();
 		}
+
+		// Game forces (black holes) are applied once a frame and held through every substep
+		backend->ClearForces();
 	}
-	bodiesToDestroy.clear();
+
+	CollectStats();
 
 	return UPDATE_CONTINUE;
 }
 
-PhysBody* ModulePhysics::CreateCircle(int x, int y, int radius, b2BodyType type)
+// One step per frame unless a ball could cross a chain or a flipper within it. The
+// balls are the bullets, see CreateCircle(); continuous collision alone doesn't stop
+// them tunnelling through the flippers, which are dynamic too, or the doubled chain
+int ModulePhysics::ChooseSubsteps(float dt) const
 {
-	if (!world)
+	int count = 1;
+
+	for (PhysBody* b : bodies)
+	{
+		if (!backend->IsBullet(b->body) || !backend->IsAwake(b->body)) continue;
+
+		float radius = backend->GetRadius(b->body);
+		if (radius <= 0.0f) continue;
+
+		float speed = backend->GetLinearVelocity(b->body).Length();
+		float travel = speed * dt;
+
+		if (speed < SUBSTEP_SPEED)
+		{
+			TunnelHazardQuery query;
+			query.ball = b;
+
+			float reach = radius + travel + SUBSTEP_NEAR_DISTANCE;
+			vec2f position = backend->GetPosition(b->body);
+			backend->QueryAABB(position - vec2f(reach, reach), position + vec2f(reach, reach), &TunnelHazardQuery::Report, &query);
+
+			if (!query.found) continue;
+		}
+
+		int needed = (int)ceilf(travel / (radius * SUBSTEP_MAX_TRAVEL));
+		count = MAX(count, MIN(needed, PHYSICS_MAX_SUBSTEPS));
+	}
+
+	return count;
+}
+
+// Begin-contact events of the step that just ran, in the order the engine found them.
+// Listeners may destroy bodies, which is fine: the events only hold PhysBody pointers
+void ModulePhysics::DispatchContacts()
+{
+	const PhysContactEvent* events = nullptr;
+	int count = backend->GetContactEvents(&events);
+
+	for (int i = 0; i < count; ++i)
+	{
+		PhysBody* physA = events[i].a;
+		PhysBody* physB = events[i].b;
+
+		contactTime = events[i].time;
+		contactCount++;
+
+		if (physA && physA->listener != NULL)
+			((Module*)physA->listener)->OnCollision(physA, physB);
+
+		if (physB && physB->listener != NULL)
+			((Module*)physB->listener)->OnCollision(physB, physA);
+	}
+}
+
+PhysBody* ModulePhysics::CreateCircle(int x, int y, int radius, PhysBodyType type)
+{
+	if (!backend || !backend->HasWorld())
 	{
 		LOG("ERROR: World is null in CreateCircle");
 		return nullptr;
@@ -118,65 +262,54 @@ PhysBody* ModulePhysics::CreateCircle(int x, int y, int radius, b2BodyType type)
 		return nullptr;
 	}
 
-	b2BodyDef body;
+	PhysBodyDef body;
 	body.type = type;
 
 	// **CLAVE: Invertir Y para que coincida con el sistema de Box2D**
 	float posX = PIXELS_TO_METERS * x;
-	float posY = PIXELS_TO_METERS * (SCREEN_HEIGHT - y); // Inversi�n de Y
+	float posY = PIXELS_TO_METERS * (SCREEN_HEIGHT - y); // Inversión de Y
 
-	if (!b2Vec2(posX, posY).IsValid())
+	if (!IsValid(vec2f(posX, posY)))
 	{
 		LOG("ERROR: Invalid position in CreateCircle: (%f, %f)", posX, posY);
 		return nullptr;
 	}
 
-	body.position.Set(posX, posY);
+	body.position = vec2f(posX, posY);
 
-	b2Body* b = world->CreateBody(&body);
-	if (!b)
-	{
-		LOG("ERROR: Failed to create body in CreateCircle");
-		return nullptr;
-	}
+	// Moving circles are balls: continuous collision against the flippers as well
+	body.bullet = (type == PHYS_BODY_DYNAMIC);
 
-	b2CircleShape shape;
 	float radiusM = PIXELS_TO_METERS * radius;
 	if (radiusM <= 0.0f)
 	{
 		LOG("ERROR: Invalid radius in meters: %f", radiusM);
-		world->DestroyBody(b);
 		return nullptr;
 	}
 
-	shape.m_radius = radiusM;
+	PhysMaterial material;
+	material.density = 1.0f;
+	material.restitution = 0.3f;  // Reduced from 0.5f to make ball less bouncy
+	material.friction = 0.3f;
 
-	b2FixtureDef fixture;
-	fixture.shape = &shape;
-	fixture.density = 1.0f;
-	fixture.restitution = 0.3f;  // Reduced from 0.5f to make ball less bouncy
-	fixture.friction = 0.3f;
+	PhysBody* pbody = NewPhysBody();
+	body.user = pbody;
 
-	b2Fixture* f = b->CreateFixture(&fixture);
-	if (!f)
+	PhysHandle b = backend->CreateCircle(body, radiusM, material);
+	if (!b)
 	{
-		LOG("ERROR: Failed to create fixture in CreateCircle");
-		world->DestroyBody(b);
+		LOG("ERROR: Failed to create body in CreateCircle");
+		freeBodies.push_back(pbody);
 		return nullptr;
 	}
 
-	PhysBody* pbody = new PhysBody();
-	pbody->body = b;
-	b->GetUserData().pointer = (uintptr_t)pbody;
-	pbody->width = pbody->height = radius * 2;
-
-	return pbody;
+	return Attach(pbody, b, radius * 2, radius * 2);
 }
 
 // Create a static circle sensor (non-colliding) at screen coordinates
 PhysBody* ModulePhysics::CreateCircleSensor(int x, int y, int radius)
 {
-	if (!world)
+	if (!backend || !backend->HasWorld())
 	{
 		LOG("ERROR: World is null in CreateCircleSensor");
 		return nullptr;
@@ -188,49 +321,39 @@ PhysBody* ModulePhysics::CreateCircleSensor(int x, int y, int radius)
 		return nullptr;
 	}
 
-	b2BodyDef body;
-	body.type = b2_staticBody;
+	PhysBodyDef body;
+	body.type = PHYS_BODY_STATIC;
 
 	float posX = PIXELS_TO_METERS * x;
 	float posY = PIXELS_TO_METERS * (SCREEN_HEIGHT - y);
-	if (!b2Vec2(posX, posY).IsValid())
+	if (!IsValid(vec2f(posX, posY)))
 	{
 		LOG("ERROR: Invalid position in CreateCircleSensor: (%f, %f)", posX, posY);
 		return nullptr;
 	}
-	body.position.Set(posX, posY);
+	body.position = vec2f(posX, posY);
 
-	b2Body* b = world->CreateBody(&body);
-	if (!b)
-	{
-		LOG("ERROR: Failed to create body in CreateCircleSensor");
-		return nullptr;
-	}
+	PhysMaterial material;
+	material.friction = 0.2f;
+	material.sensor = true;
 
-	b2CircleShape shape;
-	shape.m_radius = PIXELS_TO_METERS * radius;
+	PhysBody* pbody = NewPhysBody();
+	body.user = pbody;
 
-	b2FixtureDef fixture;
-	fixture.shape = &shape;
-	fixture.isSensor = true;
-	if (!b->CreateFixture(&fixture))
+	PhysHandle b = backend->CreateCircle(body, PIXELS_TO_METERS * radius, material);
+	if (!b)
 	{
-		LOG("ERROR: Failed to create fixture in CreateCircleSensor");
-		world->DestroyBody(b);
+		LOG("ERROR: Failed to create body in CreateCircleSensor");
+		freeBodies.push_back(pbody);
 		return nullptr;
 	}
 
-	PhysBody* pbody = new PhysBody();
-	pbody->body = b;
-	b->GetUserData().pointer = (uintptr_t)pbody;
-	pbody->width = pbody->height = radius * 2;
-
-	return pbody;
+	return Attach(pbody, b, radius * 2, radius * 2);
 }
 
-PhysBody* ModulePhysics::CreateRectangle(int x, int y, int width, int height, b2BodyType type)
+PhysBody* ModulePhysics::CreateRectangle(int x, int y, int width, int height, PhysBodyType type)
 {
-	if (!world)
+	if (!backend || !backend->HasWorld())
 	{
 		LOG("ERROR: World is null in CreateRectangle");
 		return nullptr;
@@ -242,67 +365,52 @@ PhysBody* ModulePhysics::CreateRectangle(int x, int y, int width, int height, b2
 		return nullptr;
 	}
 
-	b2BodyDef body;
+	PhysBodyDef body;
 	body.type = type;
 
 	// **CLAVE: Invertir Y para que coincida con el sistema de Box2D**
 	float posX = PIXELS_TO_METERS * x;
-	float posY = PIXELS_TO_METERS * (SCREEN_HEIGHT - y); // Inversi�n de Y
+	float posY = PIXELS_TO_METERS * (SCREEN_HEIGHT - y); // Inversión de Y
 
-	if (!b2Vec2(posX, posY).IsValid())
+	if (!IsValid(vec2f(posX, posY)))
 	{
 		LOG("ERROR: Invalid position in CreateRectangle: (%f, %f)", posX, posY);
 		return nullptr;
 	}
 
-	body.position.Set(posX, posY);
-
-	b2Body* b = world->CreateBody(&body);
-	if (!b)
-	{
-		LOG("ERROR: Failed to create body in CreateRectangle");
-		return nullptr;
-	}
+	body.position = vec2f(posX, posY);
 
-	b2PolygonShape box;
 	float halfWidth = PIXELS_TO_METERS * width * 0.5f;
 	float halfHeight = PIXELS_TO_METERS * height * 0.5f;
 
 	if (halfWidth <= 0.0f || halfHeight <= 0.0f)
 	{
 		LOG("ERROR: Invalid box dimensions: %fx%f", halfWidth, halfHeight);
-		world->DestroyBody(b);
 		return nullptr;
 	}
 
-	box.SetAsBox(halfWidth, halfHeight);
+	PhysMaterial material;
+	material.density = 1.0f;
+	material.restitution = 0.5f;
+	material.friction = 0.3f;
 
-	b2FixtureDef fixture;
-	fixture.shape = &box;
-	fixture.density = 1.0f;
-	fixture.restitution = 0.5f;
-	fixture.friction = 0.3f;
+	PhysBody* pbody = NewPhysBody();
+	body.user = pbody;
 
-	b2Fixture* f = b->CreateFixture(&fixture);
-	if (!f)
+	PhysHandle b = backend->CreateBox(body, halfWidth, halfHeight, vec2f(0.0f, 0.0f), material);
+	if (!b)
 	{
-		LOG("ERROR: Failed to create fixture in CreateRectangle");
-		world->DestroyBody(b);
+		LOG("ERROR: Failed to create body in CreateRectangle");
+		freeBodies.push_back(pbody);
 		return nullptr;
 	}
 
-	PhysBody* pbody = new PhysBody();
-	pbody->body = b;
-	b->GetUserData().pointer = (uintptr_t)pbody;
-	pbody->width = width;
-	pbody->height = height;
-
-	return pbody;
+	return Attach(pbody, b, width, height);
 }
 
 PhysBody* ModulePhysics::CreateRectangleSensor(int x, int y, int width, int height)
 {
-	if (!world)
+	if (!backend || !backend->HasWorld())
 	{
 		LOG("ERROR: World is null in CreateRectangleSensor");
 		return nullptr;
@@ -314,101 +422,80 @@ PhysBody* ModulePhysics::CreateRectangleSensor(int x, int y, int width, int heig
 		return nullptr;
 	}
 
-	b2BodyDef body;
-	body.type = b2_staticBody;
+	PhysBodyDef body;
+	body.type = PHYS_BODY_STATIC;
 
 	// **CLAVE: Invertir Y para que coincida con el sistema de Box2D**
 	float posX = PIXELS_TO_METERS * x;
-	float posY = PIXELS_TO_METERS * (SCREEN_HEIGHT - y); // Inversi�n de Y
+	float posY = PIXELS_TO_METERS * (SCREEN_HEIGHT - y); // Inversión de Y
 
-	if (!b2Vec2(posX, posY).IsValid())
+	if (!IsValid(vec2f(posX, posY)))
 	{
 		LOG("ERROR: Invalid position in CreateRectangleSensor: (%f, %f)", posX, posY);
 		return nullptr;
 	}
 
-	body.position.Set(posX, posY);
-
-	b2Body* b = world->CreateBody(&body);
-	if (!b)
-	{
-		LOG("ERROR: Failed to create body in CreateRectangleSensor");
-		return nullptr;
-	}
+	body.position = vec2f(posX, posY);
 
-	b2PolygonShape box;
 	float halfWidth = PIXELS_TO_METERS * width * 0.5f;
 	float halfHeight = PIXELS_TO_METERS * height * 0.5f;
 
 	if (halfWidth <= 0.0f || halfHeight <= 0.0f)
 	{
 		LOG("ERROR: Invalid sensor box dimensions: %fx%f", halfWidth, halfHeight);
-		world->DestroyBody(b);
 		return nullptr;
 	}
 
-	box.SetAsBox(halfWidth, halfHeight);
+	PhysMaterial material;
+	material.density = 1.0f;
+	material.friction = 0.2f;
+	material.sensor = true;
 
-	b2FixtureDef fixture;
-	fixture.shape = &box;
-	fixture.density = 1.0f;
-	fixture.isSensor = true;
+	PhysBody* pbody = NewPhysBody();
+	body.user = pbody;
 
-	b2Fixture* f = b->CreateFixture(&fixture);
-	if (!f)
+	PhysHandle b = backend->CreateBox(body, halfWidth, halfHeight, vec2f(0.0f, 0.0f), material);
+	if (!b)
 	{
-		LOG("ERROR: Failed to create fixture in CreateRectangleSensor");
-		world->DestroyBody(b);
+		LOG("ERROR: Failed to create body in CreateRectangleSensor");
+		freeBodies.push_back(pbody);
 		return nullptr;
 	}
 
-	PhysBody* pbody = new PhysBody();
-	pbody->body = b;
-	b->GetUserData().pointer = (uintptr_t)pbody;
-	pbody->width = width;
-	pbody->height = height;
-
-	return pbody;
+	return Attach(pbody, b, width, height);
 }
 
-PhysBody* ModulePhysics::CreateChain(int x, int y, int* points, int point_count, b2BodyType type)
+PhysBody* ModulePhysics::CreateChain(int x, int y, int* points, int point_count, PhysBodyType type)
 {
-	if (!world)
+	if (!backend || !backend->HasWorld())
 	{
 		LOG("ERROR: World is null in CreateChain");
 		return nullptr;
 	}
 
-	if (!points || point_count < 4) // M�nimo 2 puntos (4 valores)
+	if (!points || point_count < 4) // Mínimo 2 puntos (4 valores)
 	{
 		LOG("ERROR: Invalid points or point_count in CreateChain: %d", point_count);
 		return nullptr;
 	}
 
-	b2BodyDef body;
+	PhysBodyDef body;
 	body.type = type;
 
 	// **CLAVE: Invertir Y para que coincida con el sistema de Box2D**
 	float posX = PIXELS_TO_METERS * x;
-	float posY = PIXELS_TO_METERS * (SCREEN_HEIGHT - y); // Inversi�n de Y
+	float posY = PIXELS_TO_METERS * (SCREEN_HEIGHT - y); // Inversión de Y
 
-	if (!b2Vec2(posX, posY).IsValid())
+	if (!IsValid(vec2f(posX, posY)))
 	{
 		LOG("ERROR: Invalid position in CreateChain: (%f, %f)", posX, posY);
 		return nullptr;
 	}
 
-	body.position.Set(posX, posY);
-
-	b2Body* b = world->CreateBody(&body);
-	if (!b)
-	{
-		LOG("ERROR: Failed to create body in CreateChain");
-		return nullptr;
-	}
+	body.position = vec2f(posX, posY);
 
 	int num_points = point_count / 2;
-	b2Vec2* p = new b2Vec2[num_points];
+	std::vector<vec2f> filteredVertices(num_points, vec2f(0.0f, 0.0f));
 
 	// Convertir puntos a metros, invirtiendo Y para cada punto
 	for (uint i = 0; i < num_points; ++i)
@@ -416,77 +503,44 @@ PhysBody* ModulePhysics::CreateChain(int x, int y, int* points, int point_count,
 		float px = PIXELS_TO_METERS * points[i * 2 + 0];
 		float py = PIXELS_TO_METERS * -points[i * 2 + 1]; // **CLAVE: Invertir Y de los puntos**
 
-		if (!b2Vec2(px, py).IsValid())
+		if (!IsValid(vec2f(px, py)))
 		{
 			LOG("ERROR: Invalid point %d in CreateChain: (%f, %f)", i, px, py);
-			delete[] p;
-			world->DestroyBody(b);
 			return nullptr;
 		}
 
-		p[i].Set(px, py);
+		filteredVertices[i] = vec2f(px, py);
 	}
 
-	std::vector<b2Vec2> filteredVertices = FilterCloseVertices(p, num_points);
-
-	delete[] p; // Liberar el array original
+	FilterCloseVertices(filteredVertices);
 
 	if (filteredVertices.size() < 2)
 	{
 		LOG("ERROR: Not enough valid vertices after filtering in CreateChain: %d", (int)filteredVertices.size());
-		world->DestroyBody(b);
 		return nullptr;
 	}
 
-	// Build forward-wound chain (one-sided normal to the right of edge)
-	b2ChainShape chainForward;
-	{
-		b2Vec2 prevVertex = filteredVertices[0] + (filteredVertices[0] - filteredVertices[1]);
-		b2Vec2 nextVertex = filteredVertices.back() + (filteredVertices.back() - filteredVertices[filteredVertices.size() - 2]);
-		chainForward.CreateChain(filteredVertices.data(), (int)filteredVertices.size(), prevVertex, nextVertex);
-	}
-
-	// Build reverse-wound chain to emulate two-sided collisions
-	b2ChainShape chainReverse;
-	{
-		std::vector<b2Vec2> reversed(filteredVertices.rbegin(), filteredVertices.rend());
-		b2Vec2 prevVertex = reversed[0] + (reversed[0] - reversed[1]);
-		b2Vec2 nextVertex = reversed.back() + (reversed.back() - reversed[reversed.size() - 2]);
-		chainReverse.CreateChain(reversed.data(), (int)reversed.size(), prevVertex, nextVertex);
-	}
+	// Two-sided: the backend adds both windings, or edges that collide from either side
+	PhysMaterial material;
+	material.friction = 0.3f;
 
-	// Attach both forward and reverse chain fixtures
-	b2FixtureDef fixtureF;
-	fixtureF.shape = &chainForward;
-	fixtureF.friction = 0.3f;
-	if (!b->CreateFixture(&fixtureF))
-	{
-		LOG("ERROR: Failed to create forward chain fixture in CreateChain");
-		world->DestroyBody(b);
-		return nullptr;
-	}
+	PhysBody* pbody = NewPhysBody();
+	body.user = pbody;
 
-	b2FixtureDef fixtureR;
-	fixtureR.shape = &chainReverse;
-	fixtureR.friction = 0.3f;
-	if (!b->CreateFixture(&fixtureR))
+	PhysHandle b = backend->CreateChain(body, filteredVertices.data(), (int)filteredVertices.size(), false, material);
+	if (!b)
 	{
-		LOG("ERROR: Failed to create reverse chain fixture in CreateChain");
-		world->DestroyBody(b);
+		LOG("ERROR: Failed to create chain in CreateChain");
+		freeBodies.push_back(pbody);
 		return nullptr;
 	}
 
-	PhysBody* pbody = new PhysBody();
-	pbody->body = b;
-	b->GetUserData().pointer = (uintptr_t)pbody;
-	pbody->width = pbody->height = 0;
-
-	return pbody;
+	return Attach(pbody, b, 0, 0);
 }
 
-PhysBody* ModulePhysics::CreatePolygonLoop(int x, int y, int* points, int point_count, b2BodyType type, float angle_rad, float restitution)
+PhysBody* ModulePhysics::CreatePolygonLoop(int x, int y, int* points, int point_count, PhysBodyType type, float angle_rad, float restitution)
 {
-	if (!world)
+	if (!backend || !backend->HasWorld())
 	{
 		LOG("ERROR: World is null in CreatePolygonLoop");
 		return nullptr;
@@ -505,159 +559,115 @@ PhysBody* ModulePhysics::CreatePolygonLoop(int x, int y, int* points, int point_
 		return nullptr;
 	}
 
-	b2BodyDef body;
+	PhysBodyDef body;
 	body.type = type;
 
 	float posX = PIXELS_TO_METERS * x;
 	float posY = PIXELS_TO_METERS * (SCREEN_HEIGHT - y);
 
-	if (!b2Vec2(posX, posY).IsValid())
+	if (!IsValid(vec2f(posX, posY)))
 	{
 		LOG("ERROR: Invalid position in CreatePolygonLoop: (%f, %f)", posX, posY);
 		return nullptr;
 	}
 
-	body.position.Set(posX, posY);
+	body.position = vec2f(posX, posY);
 	body.angle = -angle_rad;
 
-	b2Body* b = world->CreateBody(&body);
-	if (!b)
-	{
-		LOG("ERROR: Failed to create body in CreatePolygonLoop");
-		return nullptr;
-	}
-
-	b2Vec2* p = new b2Vec2[num_points];
+	std::vector<vec2f> filteredVertices(num_points, vec2f(0.0f, 0.0f));
 
 	for (uint i = 0; i < num_points; ++i)
 	{
 		float px = PIXELS_TO_METERS * points[i * 2 + 0];
 		float py = PIXELS_TO_METERS * -points[i * 2 + 1];
 
-		if (!b2Vec2(px, py).IsValid())
+		if (!IsValid(vec2f(px, py)))
 		{
 			LOG("ERROR: Invalid point %d in CreatePolygonLoop: (%f, %f)", i, px, py);
-			delete[] p;
-			world->DestroyBody(b);
 			return nullptr;
 		}
 
-		p[i].Set(px, py);
+		filteredVertices[i] = vec2f(px, py);
 	}
 
-	std::vector<b2Vec2> filteredVertices = FilterCloseVertices(p, num_points);
-
-	delete[] p;
+	FilterCloseVertices(filteredVertices);
 
 	if (filteredVertices.size() < 3)
 	{
 		LOG("ERROR: Not enough valid vertices after filtering in CreatePolygonLoop: %d", (int)filteredVertices.size());
-		world->DestroyBody(b);
 		return nullptr;
 	}
 
-	// Create two-sided collision by adding forward and reversed chain fixtures
-	b2ChainShape chain;
-	chain.CreateLoop(filteredVertices.data(), (int)filteredVertices.size());
+	// Two-sided collision, like CreateChain
+	PhysMaterial material;
+	material.density = 1.0f;
+	material.restitution = restitution;
+	material.friction = 0.3f;
 
-	b2FixtureDef fixture;
-	fixture.shape = &chain;
-	fixture.density = 1.0f;
-	fixture.restitution = restitution;
-	fixture.friction = 0.3f;
+	PhysBody* pbody = NewPhysBody();
+	body.user = pbody;
 
-	b2Fixture* f = b->CreateFixture(&fixture);
-	if (!f)
+	PhysHandle b = backend->CreateChain(body, filteredVertices.data(), (int)filteredVertices.size(), true, material);
+	if (!b)
 	{
-		LOG("ERROR: Failed to create fixture in CreatePolygonLoop");
-		world->DestroyBody(b);
+		LOG("ERROR: Failed to create loop in CreatePolygonLoop");
+		freeBodies.push_back(pbody);
 		return nullptr;
 	}
 
-	std::vector<b2Vec2> reversedVerts = filteredVertices;
-	std::reverse(reversedVerts.begin(), reversedVerts.end());
-	b2ChainShape chainRev;
-	chainRev.CreateLoop(reversedVerts.data(), (int)reversedVerts.size());
-	b2FixtureDef fixtureRev = fixture;
-	fixtureRev.shape = &chainRev;
-	if (!b->CreateFixture(&fixtureRev))
-	{
-		LOG("ERROR: Failed to create reversed fixture in CreatePolygonLoop");
-	}
-
-	PhysBody* pbody = new PhysBody();
-	pbody->body = b;
-	b->GetUserData().pointer = (uintptr_t)pbody;
-	pbody->width = pbody->height = 0;
-
-	return pbody;
+	return Attach(pbody, b, 0, 0);
 }
 
-b2RevoluteJoint* ModulePhysics::CreateFlipper(int x, int y, int width, int height, bool isLeft, PhysBody** flipperBody)
+PhysHandle ModulePhysics::CreateFlipper(int x, int y, int width, int height, bool isLeft, PhysBody** flipperBody)
 {
-	if (!world || !flipperBody)
+	if (!backend || !backend->HasWorld() || !flipperBody)
 	{
 		LOG("ERROR: World is null or flipperBody is null in CreateFlipper");
-		return nullptr;
+		return 0;
 	}
 
 	if (width <= 0 || height <= 0)
 	{
 		LOG("ERROR: Invalid dimensions in CreateFlipper: %dx%d", width, height);
-		return nullptr;
+		return 0;
 	}
 
-	// Crear base esttica
-	b2BodyDef baseDef;
-	baseDef.type = b2_staticBody;
+	// Crear base estática
+	PhysBodyDef baseDef;
+	baseDef.type = PHYS_BODY_STATIC;
 
 	// **CLAVE: Invertir Y para que coincida con el sistema de Box2D**
 	float posX = PIXELS_TO_METERS * x;
-	float posY = PIXELS_TO_METERS * (SCREEN_HEIGHT - y); // Inversin de Y
+	float posY = PIXELS_TO_METERS * (SCREEN_HEIGHT - y); // Inversión de Y
 
-	if (!b2Vec2(posX, posY).IsValid())
+	if (!IsValid(vec2f(posX, posY)))
 	{
 		LOG("ERROR: Invalid position in CreateFlipper: (%f, %f)", posX, posY);
-		return nullptr;
+		return 0;
 	}
 
-	baseDef.position.Set(posX, posY);
-	b2Body* base = world->CreateBody(&baseDef);
+	baseDef.position = vec2f(posX, posY);
+
+	PhysBody* basePBody = NewPhysBody();
+	baseDef.user = basePBody;
+
+	PhysMaterial baseMaterial;
+	baseMaterial.friction = 0.2f;
+	PhysHandle base = backend->CreateCircle(baseDef, PIXELS_TO_METERS * 5, baseMaterial); // Un ancla pequeña
 
 	if (!base)
 	{
 		LOG("ERROR: Failed to create base body in CreateFlipper");
-		return nullptr;
+		freeBodies.push_back(basePBody);
+		return 0;
 	}
+	Attach(basePBody, base, 10, 10);
 
-	b2CircleShape baseShape;
-	baseShape.m_radius = PIXELS_TO_METERS * 5; // Un ancla pequeña
-	b2FixtureDef baseFixture;
-	baseFixture.shape = &baseShape;
-	base->CreateFixture(&baseFixture);
-
-	PhysBody* basePBody = new PhysBody();
-	basePBody->body = base;
-	base->GetUserData().pointer = (uintptr_t)basePBody;
+	// Crear flipper dinámico, en la misma posición que la base
+	PhysBodyDef flipperDef;
+	flipperDef.type = PHYS_BODY_DYNAMIC;
+	flipperDef.position = vec2f(posX, posY);
 
-	// Crear flipper dinmico
-	b2BodyDef flipperDef;
-	flipperDef.type = b2_dynamicBody;
-	flipperDef.position.Set(posX, posY); // Se crea en la misma posición que la base
-	b2Body* flipper = world->CreateBody(&flipperDef);
-
-	if (!flipper)
-	{
-		LOG("ERROR: Failed to create flipper body in CreateFlipper");
-		world->DestroyBody(base);
-		delete basePBody;
-		return nullptr;
-	}
-
-	// =================================================================
-	// INICIO DE LA SECCIÓN CORREGIDA (Caja Sólida)
-	// =================================================================
-	b2PolygonShape flipperShape;
 	float flipperWidthM = PIXELS_TO_METERS * width;
 	float flipperHeightM = PIXELS_TO_METERS * height;
 
@@ -665,61 +675,45 @@ b2RevoluteJoint* ModulePhysics::CreateFlipper(int x, int y, int width, int heigh
 	float halfWidth = flipperWidthM * 0.5f;
 	float halfHeight = flipperHeightM * 0.5f;
 
-	// Crear un vector para desplazar el centro de la caja
-	// El cuerpo del flipper (flipper) se crea en (0,0) relativo a su base (base)
-	// El pivote (joint) estará en (0,0)
-	b2Vec2 centerOffset(0.0f, 0.0f);
+	// El pivote (joint) está en el origen del cuerpo, así que se desplaza la caja:
+	// a la derecha del pivote si es izquierdo, a la izquierda si es derecho
+	vec2f centerOffset(isLeft ? halfWidth : -halfWidth, 0.0f);
 
-	if (isLeft) {
-		// Si es izquierdo, el pivote está a la izquierda.
-		// El centro de la caja debe estar a la DERECHA del pivote.
-		centerOffset.Set(halfWidth, 0.0f);
+	PhysMaterial flipperMaterial;
+	flipperMaterial.density = 10.0f;
+	flipperMaterial.friction = 0.5f;
+
+	*flipperBody = NewPhysBody();
+	flipperDef.user = *flipperBody;
+
+	PhysHandle flipper = backend->CreateBox(flipperDef, halfWidth, halfHeight, centerOffset, flipperMaterial);
+
+	if (!flipper)
+	{
+		LOG("ERROR: Failed to create flipper body in CreateFlipper");
+		freeBodies.push_back(*flipperBody);
+		*flipperBody = nullptr;
+		DestroyBody(basePBody);
+		return 0;
 	}
-	else {
-		// Si es derecho, el pivote está a la derecha.
-		// El centro de la caja debe estar a la IZQUIERDA del pivote.
-		centerOffset.Set(-halfWidth, 0.0f);
-	}
-
-	// Configurar la forma como una caja, con el centro desplazado
-	// El origen del cuerpo (y el pivote) estará en un extremo de la caja.
-	flipperShape.SetAsBox(halfWidth, halfHeight, centerOffset, 0.0f);
-	// =================================================================
-	// FIN DE LA SECCIÓN CORREGIDA
-	// =================================================================
-
-	b2FixtureDef flipperFixture;
-	flipperFixture.shape = &flipperShape;
-	flipperFixture.density = 10.0f;
-	flipperFixture.friction = 0.5f;
-	flipper->CreateFixture(&flipperFixture);
-
-	*flipperBody = new PhysBody();
-	(*flipperBody)->body = flipper;
-	flipper->GetUserData().pointer = (uintptr_t)(*flipperBody);
-	(*flipperBody)->width = width;
-	(*flipperBody)->height = height;
-
-	// Crear joint
-	b2RevoluteJointDef jointDef;
+	Attach(*flipperBody, flipper, width, height);
+
+	// Crear joint, anclado en el origen de los dos cuerpos
+	PhysRevoluteDef jointDef;
 	jointDef.bodyA = base;
 	jointDef.bodyB = flipper;
-	// El ancla en la base (estática) está en su origen (0,0)
-	jointDef.localAnchorA.Set(0, 0);
-
-	// **FIX:** El ancla en el bate (dinámico) AHORA también está en su origen (0,0),
-	// porque hemos desplazado la *forma* de la caja, no el cuerpo.
-	jointDef.localAnchorB.Set(0, 0);
+	jointDef.anchorA = vec2f(0.0f, 0.0f);
+	jointDef.anchorB = vec2f(0.0f, 0.0f);
 
 	if (isLeft) {
-		// **CLAVE: Invertir ngulos para el nuevo sistema de coordenadas**
-		jointDef.lowerAngle = -0.15f * b2_pi;
-		jointDef.upperAngle = 0.25f * b2_pi;
+		// **CLAVE: Invertir ángulos para el nuevo sistema de coordenadas**
+		jointDef.lowerAngle = -0.15f * PI;
+		jointDef.upperAngle = 0.25f * PI;
 	}
 	else {
-		// **CLAVE: Invertir ngulos para el nuevo sistema de coordenadas**
-		jointDef.lowerAngle = -0.25f * b2_pi;
-		jointDef.upperAngle = 0.15f * b2_pi;
+		// **CLAVE: Invertir ángulos para el nuevo sistema de coordenadas**
+		jointDef.lowerAngle = -0.25f * PI;
+		jointDef.upperAngle = 0.15f * PI;
 	}
 
 	jointDef.enableLimit = true;
@@ -728,30 +722,61 @@ b2RevoluteJoint* ModulePhysics::CreateFlipper(int x, int y, int width, int heigh
 	jointDef.maxMotorTorque = 2000.0f;
 	jointDef.motorSpeed = 0.0f;
 
-	b2RevoluteJoint* joint = (b2RevoluteJoint*)world->CreateJoint(&jointDef);
+	PhysHandle joint = backend->CreateRevoluteJoint(jointDef);
 
 	if (!joint)
 	{
 		LOG("ERROR: Failed to create joint in CreateFlipper");
-		world->DestroyBody(base);
-		world->DestroyBody(flipper);
-		delete basePBody;
-		delete* flipperBody;
+		DestroyBody(basePBody);
+		DestroyBody(*flipperBody);
 		*flipperBody = nullptr;
-		return nullptr;
+		return 0;
 	}
 
+	joints.push_back(joint);
 	return joint;
 }
 
+void ModulePhysics::SetMotorSpeed(PhysHandle joint, float speed)
+{
+	if (joint && backend) backend->SetMotorSpeed(joint, speed);
+}
+
+// Debug outline of one shape, converted back to screen coordinates
+static void DrawShape(void* context, const PhysShapeView& shape)
+{
+	if (shape.kind == PHYS_SHAPE_CIRCLE)
+	{
+		int x = METERS_TO_PIXELS * shape.center.x;
+		int y = SCREEN_HEIGHT - (METERS_TO_PIXELS * shape.center.y);
+		int radius = METERS_TO_PIXELS * shape.radius;
+		DrawCircleLines(x, y, radius, WHITE);
+		return;
+	}
+
+	// Polygons close back on their first vertex, chains don't
+	int edges = shape.kind == PHYS_SHAPE_POLYGON ? shape.count : shape.count - 1;
+	for (int i = 0; i < edges; ++i)
+	{
+		vec2f p1 = shape.vertices[i];
+		vec2f p2 = shape.vertices[(i + 1) % shape.count];
+		int x1 = METERS_TO_PIXELS * p1.x;
+		int y1 = SCREEN_HEIGHT - (METERS_TO_PIXELS * p1.y);
+		int x2 = METERS_TO_PIXELS * p2.x;
+		int y2 = SCREEN_HEIGHT - (METERS_TO_PIXELS * p2.y);
+		DrawLine(x1, y1, x2, y2, WHITE);
+	}
+}
+
 update_status ModulePhysics::PostUpdate()
 {
-	if (IsKeyPressed(KEY_F1))
+	// Through the input script like the game's keys, so replays toggle it too
+	if (App->input->IsKeyPressed(KEY_F1))
 	{
 		debug = !debug;
 	}
 
-	if (!debug || !world)
+	if (!debug || !backend || !backend->HasWorld())
 		return UPDATE_CONTINUE;
 
 	if (IsMouseButtonPressed(MOUSE_LEFT_BUTTON))
@@ -760,46 +785,40 @@ update_status ModulePhysics::PostUpdate()
 		int mouseY = GetMouseY();
 
 		// **CLAVE: Convertir coordenadas del mouse al sistema de Box2D**
-		b2Vec2 mousePos(PIXELS_TO_METERS * mouseX, PIXELS_TO_METERS * (SCREEN_HEIGHT - mouseY));
+		vec2f mousePos(PIXELS_TO_METERS * mouseX, PIXELS_TO_METERS * (SCREEN_HEIGHT - mouseY));
 
-		if (!mousePos.IsValid())
+		if (!IsValid(mousePos))
 		{
 			return UPDATE_CONTINUE;
 		}
 
-		b2AABB aabb;
-		aabb.lowerBound = mousePos - b2Vec2(0.1f, 0.1f);
-		aabb.upperBound = mousePos + b2Vec2(0.1f, 0.1f);
-
-		class QueryCallback : public b2QueryCallback {
-		public:
-			b2Vec2 m_point;
-			b2Body* m_body = nullptr;
-			bool ReportFixture(b2Fixture* fixture) override {
-				if (fixture->GetBody()->GetType() == b2_dynamicBody) {
-					if (fixture->TestPoint(m_point)) {
-						m_body = fixture->GetBody();
-						return false;
-					}
+		struct PickQuery
+		{
+			PhysicsBackend* backend;
+			vec2f point;
+			PhysBody* body = nullptr;
+
+			static bool Report(void* context, const PhysQueryHit& hit)
+			{
+				PickQuery* query = (PickQuery*)context;
+				if (hit.type == PHYS_BODY_DYNAMIC && hit.body && query->backend->TestPoint(hit.body->body, query->point)) {
+					query->body = hit.body;
+					return false;
 				}
 				return true;
 			}
-		} callback;
-
-		callback.m_point = mousePos;
-		world->QueryAABB(&callback, aabb);
-
-		if (callback.m_body && !mouseJoint && ground) {
-			b2MouseJointDef def;
-			def.bodyA = ground;
-			def.bodyB = callback.m_body;
-			def.target = mousePos;
-			def.maxForce = 1000.0f * callback.m_body->GetMass();
-			def.damping = 0.0f;
-			def.stiffness = 50.0f;
-			mouseJoint = (b2MouseJoint*)world->CreateJoint(&def);
+		} query;
+
+		query.backend = backend;
+		query.point = mousePos;
+		backend->QueryAABB(mousePos - vec2f(0.1f, 0.1f), mousePos + vec2f(0.1f, 0.1f), &PickQuery::Report, &query);
+
+		if (query.body && !mouseJoint && ground) {
+			PhysHandle picked = query.body->body;
+			mouseJoint = backend->CreateMouseJoint(ground, picked, mousePos, 1000.0f * backend->GetMass(picked));
+			mouseBody = picked;
 			if (mouseJoint) {
-				callback.m_body->SetAwake(true);
+				backend->SetAwake(picked, true);
 			}
 		}
 	}
@@ -808,191 +827,303 @@ update_status ModulePhysics::PostUpdate()
 		int mouseX = GetMouseX();
 		int mouseY = GetMouseY();
 		// **CLAVE: Convertir coordenadas del mouse al sistema de Box2D**
-		b2Vec2 target(PIXELS_TO_METERS * mouseX, PIXELS_TO_METERS * (SCREEN_HEIGHT - mouseY));
+		vec2f target(PIXELS_TO_METERS * mouseX, PIXELS_TO_METERS * (SCREEN_HEIGHT - mouseY));
 
-		if (target.IsValid())
+		if (IsValid(target))
 		{
-			mouseJoint->SetTarget(target);
+			backend->SetMouseTarget(mouseJoint, target);
+			vec2f bodyPos = backend->GetPosition(mouseBody);
 			DrawLine(mouseX, mouseY,
-				METERS_TO_PIXELS * mouseJoint->GetBodyB()->GetPosition().x,
-				SCREEN_HEIGHT - (METERS_TO_PIXELS * mouseJoint->GetBodyB()->GetPosition().y), // **CLAVE: Convertir de vuelta**
+				METERS_TO_PIXELS * bodyPos.x,
+				SCREEN_HEIGHT - (METERS_TO_PIXELS * bodyPos.y), // **CLAVE: Convertir de vuelta**
 				Color{ 0, 255, 0, 100 });
 		}
 	}
 
 	if (IsMouseButtonReleased(MOUSE_LEFT_BUTTON) && mouseJoint) {
-		world->DestroyJoint(mouseJoint);
-		mouseJoint = NULL;
+		backend->DestroyJoint(mouseJoint);
+		mouseJoint = 0;
+		mouseBody = 0;
 	}
 
 	// Dibujar shapes para debug
-	for (b2Body* b = world->GetBodyList(); b; b = b->GetNext())
+	backend->VisitShapes(false, &DrawShape, nullptr);
+
+	DrawStats();
+
+	return UPDATE_CONTINUE;
+}
+
+bool ModulePhysics::CleanUp()
+{
+	LOG("Destroying physics world");
+
+	// Scripted runs are the benchmarks, so they always get the report
+	if (backend && backend->HasWorld() && (App->HasArgument("--physics-report") || App->input->IsPlaying()))
 	{
-		for (b2Fixture* f = b->GetFixtureList(); f; f = f->GetNext())
-		{
-			switch (f->GetType())
-			{
-			case b2Shape::e_circle:
-			{
-				b2CircleShape* shape = (b2CircleShape*)f->GetShape();
-				b2Vec2 pos = f->GetBody()->GetPosition();
-				// **CLAVE: Convertir coordenadas de Box2D de vuelta a pantalla**
-				int x = METERS_TO_PIXELS * pos.x;
-				int y = SCREEN_HEIGHT - (METERS_TO_PIXELS * pos.y);
-				int radius = METERS_TO_PIXELS * shape->m_radius;
-				DrawCircleLines(x, y, radius, WHITE);
-			}
-			break;
+		PrintStats();
+	}
 
-			case b2Shape::e_polygon:
-			{
-				b2PolygonShape* shape = (b2PolygonShape*)f->GetShape();
-				int vertexCount = shape->m_count;
-				assert(vertexCount <= b2_maxPolygonVertices);
-				b2Vec2 vertices[b2_maxPolygonVertices];
-
-				for (int i = 0; i < vertexCount; ++i)
-				{
-					vertices[i] = b->GetWorldPoint(shape->m_vertices[i]);
-				}
+	if (backend)
+	{
+		// Joints and bodies go with the world
+		backend->DestroyWorld();
+		delete backend;
+		backend = nullptr;
+	}
+	mouseJoint = 0;
+	mouseBody = 0;
+	ground = 0;
+	joints.clear();
 
-				for (int i = 0; i < vertexCount; ++i)
-				{
-					b2Vec2 p1 = vertices[i];
-					b2Vec2 p2 = vertices[(i + 1) % vertexCount];
-					// **CLAVE: Convertir coordenadas de Box2D de vuelta a pantalla**
-					int x1 = METERS_TO_PIXELS * p1.x;
-					int y1 = SCREEN_HEIGHT - (METERS_TO_PIXELS * p1.y);
-					int x2 = METERS_TO_PIXELS * p2.x;
-					int y2 = SCREEN_HEIGHT - (METERS_TO_PIXELS * p2.y);
-					DrawLine(x1, y1, x2, y2, WHITE);
-				}
-			}
-			break;
+	for (PhysBody* pbody : bodies)
+	{
+		delete pbody;
+	}
+	bodies.clear();
 
-			case b2Shape::e_chain:
-			{
-				b2ChainShape* shape = (b2ChainShape*)f->GetShape();
-				int vertexCount = shape->m_count;
-				b2Vec2* vertices = shape->m_vertices;
-
-				b2Vec2 p1, p2;
-				for (int i = 0; i < vertexCount - 1; ++i)
-				{
-					p1 = b->GetWorldPoint(vertices[i]);
-					p2 = b->GetWorldPoint(vertices[i + 1]);
-					// **CLAVE: Convertir coordenadas de Box2D de vuelta a pantalla**
-					int x1 = METERS_TO_PIXELS * p1.x;
-					int y1 = SCREEN_HEIGHT - (METERS_TO_PIXELS * p1.y);
-					int x2 = METERS_TO_PIXELS * p2.x;
-					int y2 = SCREEN_HEIGHT - (METERS_TO_PIXELS * p2.y);
-					DrawLine(x1, y1, x2, y2, WHITE);
-				}
+	for (PhysBody* pbody : freeBodies)
+	{
+		delete pbody;
+	}
+	freeBodies.clear();
 
-				if (shape->m_prevVertex.LengthSquared() > 0 && shape->m_nextVertex.LengthSquared() > 0)
-				{
-					b2Vec2 first = b->GetWorldPoint(vertices[0]);
-					b2Vec2 last = b->GetWorldPoint(vertices[vertexCount - 1]);
-					b2Vec2 prev = b->GetWorldPoint(shape->m_prevVertex);
-					b2Vec2 next = b->GetWorldPoint(shape->m_nextVertex);
-
-					if (b2DistanceSquared(first, next) < 0.001f * 0.001f && b2DistanceSquared(last, prev) < 0.001f * 0.001f)
-					{
-						// **CLAVE: Convertir coordenadas de Box2D de vuelta a pantalla**
-						int x1 = METERS_TO_PIXELS * last.x;
-						int y1 = SCREEN_HEIGHT - (METERS_TO_PIXELS * last.y);
-						int x2 = METERS_TO_PIXELS * first.x;
-						int y2 = SCREEN_HEIGHT - (METERS_TO_PIXELS * first.y);
-						DrawLine(x1, y1, x2, y2, WHITE);
-					}
-				}
-			}
-			break;
+	return true;
+}
+
+// Recycled so bodies spawned during play (star letters) don't hit the heap
+PhysBody* ModulePhysics::NewPhysBody()
+{
+	if (freeBodies.empty()) return new PhysBody();
+
+	PhysBody* pbody = freeBodies.back();
+	freeBodies.pop_back();
+	return pbody;
+}
+
+PhysBody* ModulePhysics::Attach(PhysBody* pbody, PhysHandle body, int width, int height)
+{
+	pbody->id = nextBodyId++;
+	pbody->body = body;
+	pbody->backend = backend;
+	pbody->width = width;
+	pbody->height = height;
+	bodies.push_back(pbody);
+	return pbody;
+}
+
+void ModulePhysics::DestroyBody(PhysBody* pbody)
+{
+	if (pbody == nullptr) return;
+
+	if (pbody->body != 0 && backend != nullptr)
+	{
+		if (pbody->body == mouseBody)
+		{
+			backend->DestroyJoint(mouseJoint);
+			mouseJoint = 0;
+			mouseBody = 0;
+		}
+		backend->DestroyBody(pbody->body);
 
-			case b2Shape::e_edge:
+		for (size_t i = 0; i < bodies.size(); ++i)
+		{
+			if (bodies[i] == pbody)
 			{
-				b2EdgeShape* shape = (b2EdgeShape*)f->GetShape();
-				b2Vec2 p1, p2;
-				p1 = b->GetWorldPoint(shape->m_vertex1);
-				p2 = b->GetWorldPoint(shape->m_vertex2);
-				// **CLAVE: Convertir coordenadas de Box2D de vuelta a pantalla**
-				int x1 = METERS_TO_PIXELS * p1.x;
-				int y1 = SCREEN_HEIGHT - (METERS_TO_PIXELS * p1.y);
-				int x2 = METERS_TO_PIXELS * p2.x;
-				int y2 = SCREEN_HEIGHT - (METERS_TO_PIXELS * p2.y);
-				DrawLine(x1, y1, x2, y2, WHITE);
-			}
-			break;
+				bodies[i] = bodies.back();
+				bodies.pop_back();
+				break;
 			}
 		}
 	}
 
-	return UPDATE_CONTINUE;
+	*pbody = PhysBody();
+	freeBodies.push_back(pbody);
 }
 
-bool ModulePhysics::CleanUp()
+PhysBody* ModulePhysics::FindBody(uint32 id) const
 {
-	LOG("Destroying physics world");
+	for (PhysBody* pbody : bodies)
+	{
+		if (pbody->id == id) return pbody;
+	}
+	return nullptr;
+}
+
+void ModulePhysics::CaptureState(WorldSnapshot& snapshot) const
+{
+	snapshot.bodyCount = 0;
+	for (PhysBody* pbody : bodies)
+	{
+		if (snapshot.bodyCount >= WORLD_SNAPSHOT_MAX_BODIES)
+		{
+			LOG("World snapshot full, %d bodies left out", (int)bodies.size() - snapshot.bodyCount);
+			break;
+		}
+
+		BodySnapshot& state = snapshot.bodies[snapshot.bodyCount++];
+		vec2f position = backend->GetPosition(pbody->body);
+		vec2f velocity = backend->GetLinearVelocity(pbody->body);
+		state.id = pbody->id;
+		state.x = position.x;
+		state.y = position.y;
+		state.angle = backend->GetAngle(pbody->body);
+		state.vx = velocity.x;
+		state.vy = velocity.y;
+		state.angularVelocity = backend->GetAngularVelocity(pbody->body);
+		state.enabled = backend->IsEnabled(pbody->body);
+		state.awake = backend->IsAwake(pbody->body);
+		state.pad[0] = state.pad[1] = 0;
+	}
+
+	// DestroyBody() reorders the list, restores look bodies up by id
+	std::sort(snapshot.bodies, snapshot.bodies + snapshot.bodyCount,
+		[](const BodySnapshot& a, const BodySnapshot& b) { return a.id < b.id; });
+
+	snapshot.jointCount = MIN((int)joints.size(), WORLD_SNAPSHOT_MAX_JOINTS);
+	for (int i = 0; i < snapshot.jointCount; ++i)
+	{
+		snapshot.joints[i].angle = backend->GetJointAngle(joints[i]);
+		snapshot.joints[i].motorSpeed = backend->GetMotorSpeed(joints[i]);
+	}
+}
+
+// A few backend calls per body, no shapes are rebuilt. Static bodies are only moved
+// when they actually differ, since that refreshes all their proxies
+void ModulePhysics::RestoreState(const WorldSnapshot& snapshot)
+{
+	if (!backend || !backend->HasWorld()) return;
 
+	// The dragged body is about to jump
 	if (mouseJoint)
 	{
-		world->DestroyJoint(mouseJoint);
-		mouseJoint = NULL;
+		backend->DestroyJoint(mouseJoint);
+		mouseJoint = 0;
+		mouseBody = 0;
 	}
 
-	if (world)
+	int missing = 0;
+	for (PhysBody* pbody : bodies)
 	{
-		b2Body* body = world->GetBodyList();
-		while (body)
+		const BodySnapshot* state = snapshot.FindBody(pbody->id);
+		if (state == nullptr)
 		{
-			b2Body* nextBody = body->GetNext();
+			missing++;
+			continue;
+		}
 
-			if (body->GetUserData().pointer)
-			{
-				PhysBody* pbody = (PhysBody*)body->GetUserData().pointer;
-				delete pbody;
-				body->GetUserData().pointer = 0;
-			}
+		PhysHandle body = pbody->body;
+		bool enabled = state->enabled != 0;
+		if (backend->IsEnabled(body) != enabled) backend->SetEnabled(body, enabled);
 
-			world->DestroyBody(body);
-			body = nextBody;
+		vec2f position(state->x, state->y);
+		if (backend->GetPosition(body) != position || backend->GetAngle(body) != state->angle)
+		{
+			backend->SetTransform(body, position, state->angle);
 		}
+
+		if (backend->GetType(body) == PHYS_BODY_STATIC) continue;
+
+		backend->SetLinearVelocity(body, vec2f(state->vx, state->vy));
+		backend->SetAngularVelocity(body, state->angularVelocity);
+		if (enabled) backend->SetAwake(body, state->awake != 0);
 	}
 
-	if (world)
+	int jointCount = MIN(snapshot.jointCount, (int)joints.size());
+	for (int i = 0; i < jointCount; ++i)
 	{
-		delete world;
-		world = NULL;
+		backend->SetMotorSpeed(joints[i], snapshot.joints[i].motorSpeed);
 	}
 
-	return true;
+	if (missing > 0 || snapshot.jointCount != (int)joints.size())
+	{
+		LOG("World restore: %d bodies and %d joints not in the snapshot", missing, MAX((int)joints.size() - snapshot.jointCount, 0));
+	}
+}
+
+const char* ModulePhysics::GetStatName(PhysStat stat)
+{
+	return STAT_INFO[stat].name;
 }
 
-b2World* ModulePhysics::GetWorld()
+// Called after every frame's steps. The backend walks its shapes and contacts, a few hundred at most
+void ModulePhysics::CollectStats()
 {
-	return world;
+	const PhysStepProfile& profile = backend->GetProfile();
+	stats[PHYS_STAT_STEP].Add(profile.step);
+	stats[PHYS_STAT_COLLIDE].Add(profile.collide);
+	stats[PHYS_STAT_SOLVE].Add(profile.solve);
+	stats[PHYS_STAT_SOLVE_TOI].Add(profile.solveTOI);
+	stats[PHYS_STAT_BROADPHASE].Add(profile.broadphase);
+
+	backend->GetStats(worldStats);
+	stats[PHYS_STAT_BODIES].Add((float)worldStats.bodies);
+	stats[PHYS_STAT_PROXIES].Add((float)worldStats.proxies);
+	stats[PHYS_STAT_CONTACTS].Add((float)worldStats.contacts);
+	stats[PHYS_STAT_TOUCHING].Add((float)worldStats.touching);
+	stats[PHYS_STAT_CHAIN_CONTACTS].Add((float)worldStats.chainContacts);
+	stats[PHYS_STAT_SENSOR_CONTACTS].Add((float)worldStats.sensorContacts);
+	stats[PHYS_STAT_TOI_EVENTS].Add((float)worldStats.toiEvents);
+	stats[PHYS_STAT_SUBSTEPS].Add((float)substeps);
 }
 
-void ModulePhysics::BeginContact(b2Contact* contact)
+// F1 panel: p50 / p99 / max over the last ROLLING_WINDOW steps and the histogram itself
+void ModulePhysics::DrawStats() const
 {
-	if (!contact) return;
+	const int x = SCREEN_WIDTH - 250;
+	const int y = 34;
+	const int rowHeight = 12;
+	const int graphX = x + 176;
+	const int graphWidth = 64;
+
+	DrawRectangle(x, y, 244, rowHeight * (PHYS_STAT_COUNT + 2) + 6, Color{ 0, 0, 0, 180 });
 
-	b2Fixture* fixtureA = contact->GetFixtureA();
-	b2Fixture* fixtureB = contact->GetFixtureB();
+	DrawText("Physics", x + 4, y + 3, 10, YELLOW);
+	DrawText("p50", x + 84, y + 3, 10, YELLOW);
+	DrawText("p99", x + 114, y + 3, 10, YELLOW);
+	DrawText("max", x + 144, y + 3, 10, YELLOW);
 
-	if (!fixtureA || !fixtureB) return;
+	for (int i = 0; i < PHYS_STAT_COUNT; ++i)
+	{
+		const RollingHistogram& h = stats[i];
+		int rowY = y + 3 + rowHeight * (i + 1);
+		const char* format = IsTimeStat(i) ? "%.2f" : "%.0f";
 
-	b2Body* bodyA = fixtureA->GetBody();
-	b2Body* bodyB = fixtureB->GetBody();
+		DrawText(STAT_INFO[i].name, x + 4, rowY, 10, LIME);
+		DrawText(TextFormat(format, h.GetPercentile(0.5f)), x + 84, rowY, 10, LIME);
+		DrawText(TextFormat(format, h.GetPercentile(0.99f)), x + 114, rowY, 10, LIME);
+		DrawText(TextFormat(format, h.GetMax()), x + 144, rowY, 10, LIME);
 
-	if (!bodyA || !bodyB) return;
+		// Bins folded in pairs to fit, scaled to the fullest one
+		int binsPerPixel = (h.GetBinCount() + graphWidth - 1) / graphWidth;
+		uint32 largest = h.GetLargestBin() * binsPerPixel;
+		if (largest == 0) continue;
 
-	PhysBody* physA = (PhysBody*)bodyA->GetUserData().pointer;
-	PhysBody* physB = (PhysBody*)bodyB->GetUserData().pointer;
+		for (int px = 0; px < graphWidth; ++px)
+		{
+			uint32 samples = 0;
+			for (int b = px * binsPerPixel; b < (px + 1) * binsPerPixel && b < h.GetBinCount(); ++b)
+			{
+				samples += h.GetBin(b);
+			}
+			int barHeight = (int)((rowHeight - 2) * samples / largest);
+			if (samples > 0 && barHeight == 0) barHeight = 1;
+			if (barHeight > 0) DrawLine(graphX + px, rowY + rowHeight - 2, graphX + px, rowY + rowHeight - 2 - barHeight, SKYBLUE);
+		}
+	}
 
-	if (physA && physA->listener != NULL)
-		((Module*)physA->listener)->OnCollision(physA, physB);
+	DrawText(TextFormat("Proxies: chain %d  sensor %d  other %d", worldStats.chainProxies, worldStats.sensorProxies, worldStats.otherProxies),
+		x + 4, y + 3 + rowHeight * (PHYS_STAT_COUNT + 1), 10, LIME);
+}
 
-	if (physB && physB->listener != NULL)
-		((Module*)physB->listener)->OnCollision(physB, physA);
+void ModulePhysics::PrintStats() const
+{
+	LOG("Physics stats for %s over %llu frames (last %u for p50 / p99 / max, times in ms):", backend->GetName(), (unsigned long long)stats[PHYS_STAT_STEP].GetRunCount(), stats[PHYS_STAT_STEP].GetCount());
+	for (int i = 0; i < PHYS_STAT_COUNT; ++i)
+	{
+		const RollingHistogram& h = stats[i];
+		LOG("  %-12s mean %8.3f  peak %8.3f  |  p50 %8.3f  p99 %8.3f  max %8.3f",
+			STAT_INFO[i].name, h.GetRunMean(), h.GetRunMax(), h.GetPercentile(0.5f), h.GetPercentile(0.99f), h.GetMax());
+	}
+	LOG("  Proxies by shape: chain %d  sensor %d  other %d", worldStats.chainProxies, worldStats.sensorProxies, worldStats.otherProxies);
 }
@@ -2,11 +2,22 @@
 #include "Application.h"
 #include "ModuleWindow.h"
 #include "ModuleRender.h"
+#include "ModulePhysics.h"
+#include "ModuleAudio.h"
+#include "PerfCounters.h"
+#include "AllocTracker.h"
+#include "FrameArena.h"
+#include "SpikeDetector.h"
 #include <math.h>
 
 ModuleRender::ModuleRender(Application* app, bool start_enabled) : Module(app, start_enabled)
 {
     background = RAYWHITE;
+
+    DeclareAccess(PHASE_PREUPDATE, RESOURCE_NONE, RESOURCE_NONE);
+    DeclareAccess(PHASE_UPDATE, RESOURCE_NONE, RESOURCE_RENDER);
+    // The debug overlay shows physics, mixer and latency stats
+    DeclareAccess(PHASE_POSTUPDATE, RESOURCE_PHYSICS_WORLD | RESOURCE_AUDIO, RESOURCE_RENDER);
 }
 
 // Destructor
@@ -47,6 +58,11 @@ update_status ModuleRender::PostUpdate()
     // Draw everything in our batch!
     DrawFPS(10, 10);
 
+    if (App->physics->IsDebug())
+    {
+        DrawDebugOverlay();
+    }
+
     EndDrawing();
 
 	return UPDATE_CONTINUE;
@@ -58,6 +74,77 @@ bool ModuleRender::CleanUp()
 	return true;
 }
 
+// Engine counters shown together with the F1 physics view
+void ModuleRender::DrawDebugOverlay() const
+{
+    MixerStats mixer = App->audio->GetMixerStats();
+    float load = mixer.bufferMs > 0.0f ? 100.0f * mixer.averageMixMs / mixer.bufferMs : 0.0f;
+
+    ::DrawText(TextFormat("Mixer: %d/%d voices  stolen %u  dropped %u  queue drops %u",
+        mixer.activeVoices, mixer.voiceCount, mixer.voicesStolen, mixer.voicesDropped, mixer.commandsDropped), 10, 34, 10, LIME);
+    ::DrawText(TextFormat("Mix: %.3f ms avg  %.3f ms peak  of %.1f ms buffer (%.1f%%)",
+        mixer.averageMixMs, mixer.peakMixMs, mixer.bufferMs, load), 10, 46, 10, LIME);
+    ::DrawText(TextFormat("Music: %.0f/%.0f ms buffered  underruns %u  failed loads %u",
+        mixer.musicBufferedMs, mixer.musicPrefetchMs, mixer.musicUnderruns, mixer.musicFailedLoads), 10, 70, 10, LIME);
+    ::DrawText(TextFormat("Impacts played/suppressed: bumper %u/%u  flipper %u/%u  wall %u/%u",
+        App->audio->GetTriggeredImpacts(IMPACT_BUMPER), App->audio->GetSuppressedImpacts(IMPACT_BUMPER),
+        App->audio->GetTriggeredImpacts(IMPACT_FLIPPER), App->audio->GetSuppressedImpacts(IMPACT_FLIPPER),
+        App->audio->GetTriggeredImpacts(IMPACT_WALL), App->audio->GetSuppressedImpacts(IMPACT_WALL)), 10, 58, 10, LIME);
+
+    const LatencyHistogram& latency = App->audio->GetLatency(LATENCY_CONTACT_TO_MIX);
+    ::DrawText(TextFormat("Hit latency (%s): p50 %.2f ms  p99 %.2f ms  max %.2f ms  + ~%.0f ms output",
+        mixer.lowLatency ? "low-latency" : "stream", latency.GetPercentile(0.5f), latency.GetPercentile(0.99f),
+        latency.GetMax(), mixer.outputLatencyMs), 10, 82, 10, LIME);
+
+    // Counters below are for the previous frame, this one is still being counted
+    const AllocCount& allocs = AllocTracker::GetFrame();
+    ::DrawText(TextFormat("Allocs: %llu (%llu bytes)  pre %llu  update %llu  post %llu  other %llu",
+        (unsigned long long)allocs.count, (unsigned long long)allocs.bytes,
+        (unsigned long long)AllocTracker::GetFramePhase(ALLOC_PHASE_PREUPDATE).count,
+        (unsigned long long)AllocTracker::GetFramePhase(ALLOC_PHASE_UPDATE).count,
+        (unsigned long long)AllocTracker::GetFramePhase(ALLOC_PHASE_POSTUPDATE).count,
+        (unsigned long long)AllocTracker::GetFramePhase(ALLOC_PHASE_OTHER).count), 10, 94, 10, allocs.count > 0 ? ORANGE : LIME);
+
+    // Tags that allocated, one line
+    int tagX = 10;
+    for (int t = 0; t < AllocTracker::GetTagCount() && tagX < SCREEN_WIDTH - 100; ++t)
+    {
+        const AllocCount& tag = AllocTracker::GetFrameTag(t);
+        if (tag.count == 0) continue;
+
+        const char* text = TextFormat("%s %llu", AllocTracker::GetTagName(t), (unsigned long long)tag.count);
+        ::DrawText(text, tagX, 106, 10, ORANGE);
+        tagX += MeasureText(text, 10) + 12;
+    }
+
+    const FrameArena* arena = App->frame_arena;
+    ::DrawText(TextFormat("Frame arena: %.1f KB  high-water %.1f of %.0f KB  overflows %u",
+        arena->GetLastFrameUsed() / 1024.0f, arena->GetHighWater() / 1024.0f, arena->GetCapacity() / 1024.0f,
+        arena->GetOverflows()), 10, 118, 10, arena->GetLastFrameOverflows() > 0 ? RED : LIME);
+
+    const SpikeDetector* spikes = App->spikes;
+    if (spikes->IsEnabled())
+    {
+        int cause = spikes->GetLastCause();
+        ::DrawText(TextFormat("Spikes over %.1f ms: %u (%u reports)  last: frame %u %.1f ms, %s %.1f ms",
+            spikes->GetBudget(), spikes->GetSpikes(), spikes->GetReports(), spikes->GetLastSpike().frame,
+            spikes->GetLastSpike().totalMs, spikes->GetSectionName(cause),
+            cause >= 0 ? spikes->GetLastSpike().sectionMs[cause] : 0.0f), 10, 130, 10, spikes->GetSpikes() > 0 ? ORANGE : LIME);
+    }
+
+    if (App->perf->IsOpen())
+    {
+        static const char* sections[PERF_SECTION_COUNT] = { "PreUpdate", "Update", "PostUpdate", "Physics step" };
+        for (int i = 0; i < PERF_SECTION_COUNT; ++i)
+        {
+            const PerfValues& values = App->perf->GetLastFrame(i);
+            ::DrawText(TextFormat("%s: %.2f Mcycles  IPC %.2f  cache miss %.2f/kinstr  branch miss %.2f/kinstr",
+                sections[i], values.counts[PERF_CYCLES] / 1000000.0, values.Ipc(),
+                values.CacheMissesPerKilo(), values.BranchMissesPerKilo()), 10, 142 + 12 * i, 10, LIME);
+        }
+    }
+}
+
 void ModuleRender::SetBackgroundColor(Color color)
 {
 	background = color;
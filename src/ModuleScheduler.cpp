@@ -0,0 +1,143 @@
+#include "Globals.h"
+#include "ModuleScheduler.h"
+#include "Timer.h"
+
+// Phases that both touch a resource can't overlap unless both only read it
+static bool Conflicts(const ModuleAccess& a, const ModuleAccess& b)
+{
+	return (a.writes & (b.reads | b.writes)) != 0 || (b.writes & a.reads) != 0;
+}
+
+ModuleScheduler::ModuleScheduler()
+{
+}
+
+ModuleScheduler::~ModuleScheduler()
+{
+}
+
+void ModuleScheduler::Start(JobSystem* jobSystem)
+{
+	jobs = jobSystem;
+	LOG("Module scheduler: phases run in parallel on %d job workers", jobs->GetWorkerCount());
+}
+
+void ModuleScheduler::Stop()
+{
+	jobs = nullptr;
+}
+
+update_status ModuleScheduler::RunPhase(const std::vector<Module*>& modules, ModulePhase phase, TaskFunction taskFunction, void* taskContext)
+{
+	for (int i = 0; i < MAX_SCHEDULED_MODULES; ++i) taskMs[i] = 0.0f;
+	workerTasks.store(0, std::memory_order_relaxed);
+
+	if (!IsParallel())
+	{
+		update_status ret = UPDATE_CONTINUE;
+		for (size_t i = 0; i < modules.size() && ret == UPDATE_CONTINUE; ++i)
+		{
+			if (!modules[i]->IsEnabled()) continue;
+
+			double start = GetPerfTime();
+			ret = taskFunction(taskContext, (int)i, phase);
+			if (i < MAX_SCHEDULED_MODULES) taskMs[i] = (float)((GetPerfTime() - start) * 1000.0);
+		}
+		return ret;
+	}
+
+	function = taskFunction;
+	context = taskContext;
+	currentPhase = phase;
+	result.store(UPDATE_CONTINUE);
+	BuildGraph(modules, phase);
+
+	// Roots are picked before anything runs: once the first job is out, Execute()
+	// submits tasks whose count reaches 0, and checking pending here would submit them again
+	int ready[MAX_SCHEDULED_MODULES];
+	int readyCount = 0;
+	for (int t = 0; t < taskCount; ++t)
+	{
+		if (!tasks[t].access.mainThread && tasks[t].pending.load(std::memory_order_relaxed) == 0) ready[readyCount++] = t;
+	}
+	for (int r = 0; r < readyCount; ++r) jobs->Run(&TaskJob, &tasks[ready[r]], &fence);
+
+	// Main-thread phases in module order. While one waits for its dependencies
+	// this thread runs queued jobs instead of idling
+	for (int t = 0; t < taskCount; ++t)
+	{
+		if (!tasks[t].access.mainThread) continue;
+
+		while (tasks[t].pending.load(std::memory_order_acquire) > 0)
+		{
+			if (!jobs->RunOne()) std::this_thread::yield();
+		}
+		Execute(tasks[t]);
+	}
+
+	jobs->Wait(&fence);
+
+	function = nullptr;
+	context = nullptr;
+	return (update_status)result.load();
+}
+
+void ModuleScheduler::BuildGraph(const std::vector<Module*>& modules, ModulePhase phase)
+{
+	taskCount = 0;
+
+	for (size_t i = 0; i < modules.size() && taskCount < MAX_SCHEDULED_MODULES; ++i)
+	{
+		if (!modules[i]->IsEnabled()) continue;
+
+		int id = taskCount++;
+		Task& task = tasks[id];
+		task.scheduler = this;
+		task.index = (int)i;
+		task.access = modules[i]->GetAccess(phase);
+		task.dependentCount = 0;
+
+		// Main-thread phases already run in order, only the other edges are needed
+		int pending = 0;
+		for (int earlier = 0; earlier < id; ++earlier)
+		{
+			Task& before = tasks[earlier];
+			if (before.access.mainThread && task.access.mainThread) continue;
+			if (!Conflicts(before.access, task.access)) continue;
+
+			before.dependents[before.dependentCount++] = id;
+			pending++;
+		}
+		task.pending.store(pending, std::memory_order_relaxed);
+	}
+}
+
+void ModuleScheduler::TaskJob(void* data)
+{
+	Task* task = (Task*)data;
+	task->scheduler->Execute(*task);
+}
+
+// Runs the phase unless an earlier one asked to stop, then releases whatever was waiting on it
+void ModuleScheduler::Execute(Task& task)
+{
+	if (result.load() == UPDATE_CONTINUE)
+	{
+		double start = GetPerfTime();
+		update_status status = function(context, task.index, currentPhase);
+		taskMs[task.index] = (float)((GetPerfTime() - start) * 1000.0);
+
+		int expected = UPDATE_CONTINUE;
+		if (status != UPDATE_CONTINUE) result.compare_exchange_strong(expected, status);
+		if (!jobs->IsMainThread()) workerTasks.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	for (int i = 0; i < task.dependentCount; ++i)
+	{
+		Task& dependent = tasks[task.dependents[i]];
+		if (dependent.pending.fetch_sub(1, std::memory_order_acq_rel) == 1 && !dependent.access.mainThread)
+		{
+			jobs->Run(&TaskJob, &dependent, &fence);
+		}
+	}
+}
@@ -4,6 +4,9 @@
 
 ModuleWindow::ModuleWindow(Application* app, bool start_enabled) : Module(app, start_enabled)
 {
+	DeclareAccess(PHASE_PREUPDATE, RESOURCE_NONE, RESOURCE_WINDOW);
+	DeclareAccess(PHASE_UPDATE, RESOURCE_NONE, RESOURCE_NONE);
+	DeclareAccess(PHASE_POSTUPDATE, RESOURCE_NONE, RESOURCE_NONE);
 }
 
 // Destructor
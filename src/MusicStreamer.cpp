@@ -0,0 +1,447 @@
+#include "Globals.h"
+#include "MusicStreamer.h"
+#include "Trace.h"
+
+// Decoders come from raylib's external folder, their implementations are compiled into raylib
+#include "dr_wav.h"
+#include "dr_mp3.h"
+#define STB_VORBIS_HEADER_ONLY
+#include "stb_vorbis.c"
+
+#include <chrono>
+#include <ctype.h>
+#include <string.h>
+
+enum MusicFormat
+{
+	MUSIC_FORMAT_UNKNOWN = 0,
+	MUSIC_FORMAT_WAV,
+	MUSIC_FORMAT_OGG,
+	MUSIC_FORMAT_MP3
+};
+
+static MusicFormat GetMusicFormat(const char* path)
+{
+	const char* dot = strrchr(path, '.');
+	if (dot == nullptr) return MUSIC_FORMAT_UNKNOWN;
+
+	char ext[8] = {};
+	for (int i = 0; i < 7 && dot[i + 1] != '\0'; ++i)
+	{
+		ext[i] = (char)tolower((unsigned char)dot[i + 1]);
+	}
+
+	if (strcmp(ext, "wav") == 0) return MUSIC_FORMAT_WAV;
+	if (strcmp(ext, "ogg") == 0) return MUSIC_FORMAT_OGG;
+	if (strcmp(ext, "mp3") == 0) return MUSIC_FORMAT_MP3;
+	return MUSIC_FORMAT_UNKNOWN;
+}
+
+// FrameRing -----------
+
+void FrameRing::Allocate(uint32 minFrames)
+{
+	capacity = 1;
+	while (capacity < minFrames) capacity <<= 1;
+
+	data.assign(capacity * 2, 0.0f);
+	Reset();
+}
+
+uint32 FrameRing::Write(const float* frames, uint32 count)
+{
+	uint32 write = writePos.load(std::memory_order_relaxed);
+	uint32 read = readPos.load(std::memory_order_acquire);
+	count = MIN(count, capacity - (write - read));
+
+	for (uint32 i = 0; i < count; ++i)
+	{
+		uint32 index = ((write + i) & (capacity - 1)) * 2;
+		data[index] = frames[i * 2];
+		data[index + 1] = frames[i * 2 + 1];
+	}
+
+	writePos.store(write + count, std::memory_order_release);
+	return count;
+}
+
+uint32 FrameRing::Read(float* frames, uint32 count)
+{
+	uint32 read = readPos.load(std::memory_order_relaxed);
+	uint32 write = writePos.load(std::memory_order_acquire);
+	count = MIN(count, write - read);
+
+	// At most two contiguous spans
+	uint32 start = read & (capacity - 1);
+	uint32 first = MIN(count, capacity - start);
+	memcpy(frames, &data[start * 2], first * 2 * sizeof(float));
+	if (count > first)
+	{
+		memcpy(frames + first * 2, &data[0], (count - first) * 2 * sizeof(float));
+	}
+
+	readPos.store(read + count, std::memory_order_release);
+	return count;
+}
+
+uint32 FrameRing::Available() const
+{
+	return writePos.load(std::memory_order_acquire) - readPos.load(std::memory_order_acquire);
+}
+
+void FrameRing::Reset()
+{
+	readPos.store(0, std::memory_order_relaxed);
+	writePos.store(0, std::memory_order_release);
+}
+
+// Decoder -----------
+
+struct MusicStreamer::Decoder
+{
+	MusicFormat format = MUSIC_FORMAT_UNKNOWN;
+	drwav wav;
+	drmp3 mp3;
+	stb_vorbis* ogg = nullptr;
+	uint32 channels = 0;
+	uint32 sampleRate = 0;
+
+	bool Open(const char* path)
+	{
+		format = GetMusicFormat(path);
+
+		switch (format)
+		{
+		case MUSIC_FORMAT_WAV:
+			if (!drwav_init_file(&wav, path, NULL)) return false;
+			channels = wav.channels;
+			sampleRate = wav.sampleRate;
+			break;
+
+		case MUSIC_FORMAT_MP3:
+			if (!drmp3_init_file(&mp3, path, NULL)) return false;
+			channels = mp3.channels;
+			sampleRate = mp3.sampleRate;
+			break;
+
+		case MUSIC_FORMAT_OGG:
+		{
+			ogg = stb_vorbis_open_filename(path, NULL, NULL);
+			if (ogg == nullptr) return false;
+			stb_vorbis_info info = stb_vorbis_get_info(ogg);
+			channels = 2;		// stb_vorbis mixes down/up to the channel count we ask for
+			sampleRate = info.sample_rate;
+		}
+		break;
+
+		default:
+			return false;
+		}
+
+		return channels > 0 && sampleRate > 0;
+	}
+
+	// Returns interleaved frames with 'channels' channels
+	uint32 Read(float* out, uint32 frames)
+	{
+		switch (format)
+		{
+		case MUSIC_FORMAT_WAV: return (uint32)drwav_read_pcm_frames_f32(&wav, frames, out);
+		case MUSIC_FORMAT_MP3: return (uint32)drmp3_read_pcm_frames_f32(&mp3, frames, out);
+		case MUSIC_FORMAT_OGG: return (uint32)stb_vorbis_get_samples_float_interleaved(ogg, 2, out, (int)(frames * 2));
+		default: return 0;
+		}
+	}
+
+	bool Rewind()
+	{
+		switch (format)
+		{
+		case MUSIC_FORMAT_WAV: return drwav_seek_to_pcm_frame(&wav, 0);
+		case MUSIC_FORMAT_MP3: return drmp3_seek_to_pcm_frame(&mp3, 0);
+		case MUSIC_FORMAT_OGG: return stb_vorbis_seek_start(ogg) != 0;
+		default: return false;
+		}
+	}
+
+	void Close()
+	{
+		switch (format)
+		{
+		case MUSIC_FORMAT_WAV: drwav_uninit(&wav); break;
+		case MUSIC_FORMAT_MP3: drmp3_uninit(&mp3); break;
+		case MUSIC_FORMAT_OGG: stb_vorbis_close(ogg); ogg = nullptr; break;
+		default: break;
+		}
+		format = MUSIC_FORMAT_UNKNOWN;
+	}
+};
+
+// MusicStreamer -----------
+
+MusicStreamer::MusicStreamer()
+{
+}
+
+MusicStreamer::~MusicStreamer()
+{
+	CleanUp();
+}
+
+bool MusicStreamer::Init(int prefetchMs, uint32 rate, bool threaded)
+{
+	if (running.load()) return true;
+
+	outputRate = rate;
+	this->threaded = threaded;
+	refillIntervalMs = MAX(prefetchMs / 4, 5);
+
+	uint32 prefetchFrames = (uint32)((uint64)prefetchMs * outputRate / 1000);
+	for (int i = 0; i < MUSIC_DECKS; ++i)
+	{
+		decks[i].ring.Allocate(prefetchFrames);
+	}
+
+	// Worst case: MUSIC_MAX_CHANNELS source channels, and a 4:1 upsample from 11 kHz material
+	decodeBuffer.assign(MUSIC_DECODE_CHUNK * MUSIC_MAX_CHANNELS, 0.0f);
+	stereoBuffer.assign(MUSIC_DECODE_CHUNK * 2, 0.0f);
+	outputBuffer.assign((MUSIC_DECODE_CHUNK * 4 + 4) * 2, 0.0f);
+
+	running.store(true);
+	if (threaded)
+	{
+		worker = std::thread(&MusicStreamer::WorkerLoop, this);
+
+		LOG("Music streamer running: %d ms prefetch (%d frames per deck), refill every %d ms",
+			prefetchMs, decks[0].ring.Capacity(), refillIntervalMs);
+	}
+	else
+	{
+		LOG("Music streamer running inline: %d ms prefetch (%d frames per deck)", prefetchMs, decks[0].ring.Capacity());
+	}
+
+	return true;
+}
+
+void MusicStreamer::CleanUp()
+{
+	if (!running.load()) return;
+
+	running.store(false);
+	if (worker.joinable())
+	{
+		wake.notify_one();
+		worker.join();
+	}
+
+	for (int i = 0; i < MUSIC_DECKS; ++i)
+	{
+		CloseDeck(decks[i]);
+		decks[i].state.store(MUSIC_DECK_IDLE);
+	}
+}
+
+bool MusicStreamer::Request(int deck, const char* path, uint32 token)
+{
+	if (deck < 0 || deck >= MUSIC_DECKS || !running.load())
+		return false;
+
+	MusicRequest request;
+	request.deck = deck;
+	request.token = token;
+	strncpy(request.path, path, MUSIC_MAX_PATH - 1);
+	request.path[MUSIC_MAX_PATH - 1] = '\0';
+
+	if (!requests.Push(request))
+		return false;
+
+	if (threaded) wake.notify_one();
+	return true;
+}
+
+void MusicStreamer::Pump()
+{
+	MusicRequest request;
+	while (requests.Pop(request))
+	{
+		// A newer request for the same deck replaces one that hasn't started yet
+		strcpy(decks[request.deck].pendingPath, request.path);
+		decks[request.deck].pendingToken = request.token;
+	}
+
+	for (int i = 0; i < MUSIC_DECKS; ++i)
+	{
+		UpdateDeck(decks[i]);
+	}
+}
+
+void MusicStreamer::WorkerLoop()
+{
+	TRACE_THREAD_NAME("Music streamer");
+
+	while (running.load())
+	{
+		Pump();
+
+		std::unique_lock<std::mutex> lock(wakeMutex);
+		wake.wait_for(lock, std::chrono::milliseconds(refillIntervalMs));
+	}
+}
+
+void MusicStreamer::UpdateDeck(Deck& deck)
+{
+	int state = deck.state.load(std::memory_order_acquire);
+
+	if (state == MUSIC_DECK_RELEASED)
+	{
+		CloseDeck(deck);
+		state = MUSIC_DECK_IDLE;
+		deck.state.store(state, std::memory_order_release);
+	}
+
+	if (state == MUSIC_DECK_IDLE && deck.pendingPath[0] != '\0')
+	{
+		if (OpenDeck(deck))
+		{
+			state = MUSIC_DECK_LOADING;
+			deck.state.store(state, std::memory_order_release);
+		}
+		else
+		{
+			failedLoads.fetch_add(1, std::memory_order_relaxed);
+		}
+		deck.pendingPath[0] = '\0';
+	}
+
+	if (state == MUSIC_DECK_LOADING || state == MUSIC_DECK_PRIMED || state == MUSIC_DECK_PLAYING)
+	{
+		Refill(deck);
+
+		if (state == MUSIC_DECK_LOADING && (deck.ring.Available() >= deck.ring.Capacity() / 2 || deck.ended.load()))
+		{
+			deck.state.store(MUSIC_DECK_PRIMED, std::memory_order_release);
+		}
+	}
+}
+
+bool MusicStreamer::OpenDeck(Deck& deck)
+{
+	TRACE_SCOPE_CAT("Open music", "audio");
+	Decoder* decoder = new Decoder();
+
+	if (!decoder->Open(deck.pendingPath))
+	{
+		LOG("Failed to open music stream: %s", deck.pendingPath);
+		delete decoder;
+		return false;
+	}
+
+	if (decoder->sampleRate * 4 < outputRate)
+	{
+		LOG("Music stream %s: %d Hz is below the supported 4:1 upsample", deck.pendingPath, decoder->sampleRate);
+		decoder->Close();
+		delete decoder;
+		return false;
+	}
+
+	if (decoder->channels > MUSIC_MAX_CHANNELS)
+	{
+		LOG("Music stream %s: %d channels, at most %d are supported", deck.pendingPath, decoder->channels, MUSIC_MAX_CHANNELS);
+		decoder->Close();
+		delete decoder;
+		return false;
+	}
+
+	LOG("Streaming music %s: %d Hz, %d channels", deck.pendingPath, decoder->sampleRate, decoder->channels);
+
+	deck.decoder = decoder;
+	deck.token.store(deck.pendingToken, std::memory_order_relaxed);
+	deck.ended.store(false);
+	deck.resamplePos = 1.0;
+	deck.prevFrame[0] = deck.prevFrame[1] = 0.0f;
+	return true;
+}
+
+void MusicStreamer::CloseDeck(Deck& deck)
+{
+	if (deck.decoder != nullptr)
+	{
+		deck.decoder->Close();
+		delete deck.decoder;
+		deck.decoder = nullptr;
+	}
+
+	deck.ring.Reset();
+	deck.ended.store(false);
+	deck.token.store(0, std::memory_order_relaxed);
+}
+
+void MusicStreamer::Refill(Deck& deck)
+{
+	Decoder* decoder = deck.decoder;
+	if (decoder == nullptr) return;
+
+	TRACE_SCOPE_CAT("Decode music", "audio");
+
+	uint32 maxOutput = (uint32)((uint64)MUSIC_DECODE_CHUNK * outputRate / decoder->sampleRate) + 2;
+	bool rewound = false;
+
+	while (running.load(std::memory_order_relaxed) && !deck.ended.load(std::memory_order_relaxed) && deck.ring.Free() >= maxOutput)
+	{
+		uint32 frames = decoder->Read(decodeBuffer.data(), MUSIC_DECODE_CHUNK);
+
+		if (frames == 0)
+		{
+			// Loop the track. A second empty read right after rewinding means there is nothing to play
+			if (rewound || !decoder->Rewind())
+			{
+				deck.ended.store(true, std::memory_order_release);
+				break;
+			}
+			rewound = true;
+			continue;
+		}
+		rewound = false;
+
+		// To stereo
+		const float* src = decodeBuffer.data();
+		float* stereo = stereoBuffer.data();
+		uint32 channels = decoder->channels;
+		for (uint32 i = 0; i < frames; ++i)
+		{
+			stereo[i * 2] = src[i * channels];
+			stereo[i * 2 + 1] = src[i * channels + (channels > 1 ? 1 : 0)];
+		}
+
+		if (decoder->sampleRate == outputRate)
+		{
+			deck.ring.Write(stereo, frames);
+			continue;
+		}
+
+		// Linear resample. Index 0 is the last frame of the previous chunk, i is stereo[i - 1]
+		float* out = outputBuffer.data();
+		double step = (double)decoder->sampleRate / outputRate;
+		double pos = deck.resamplePos;
+		uint32 produced = 0;
+
+		while (pos < frames)
+		{
+			uint32 i = (uint32)pos;
+			float t = (float)(pos - i);
+			const float* a = i == 0 ? deck.prevFrame : &stereo[(i - 1) * 2];
+			const float* b = &stereo[i * 2];
+
+			out[produced * 2] = a[0] + (b[0] - a[0]) * t;
+			out[produced * 2 + 1] = a[1] + (b[1] - a[1]) * t;
+			produced++;
+			pos += step;
+		}
+
+		deck.resamplePos = pos - frames;
+		deck.prevFrame[0] = stereo[(frames - 1) * 2];
+		deck.prevFrame[1] = stereo[(frames - 1) * 2 + 1];
+
+		deck.ring.Write(out, produced);
+	}
+}
@@ -0,0 +1,284 @@
+#include "Globals.h"
+#include "OccupancyGrid.h"
+#include "PhysicsBackend.h"
+
+#include <math.h>
+
+// Distance squared from point (px, py) to segment (x1, y1)-(x2, y2)
+static float SegmentDistanceSq(float px, float py, float x1, float y1, float x2, float y2)
+{
+	float dx = x2 - x1;
+	float dy = y2 - y1;
+	float lenSq = dx * dx + dy * dy;
+	float t = 0.0f;
+
+	if (lenSq > 0.0f)
+	{
+		t = ((px - x1) * dx + (py - y1) * dy) / lenSq;
+		if (t < 0.0f) t = 0.0f;
+		if (t > 1.0f) t = 1.0f;
+	}
+
+	float cx = x1 + t * dx - px;
+	float cy = y1 + t * dy - py;
+	return cx * cx + cy * cy;
+}
+
+static void ToScreen(const vec2f& p, float& x, float& y)
+{
+	x = METERS_TO_PIXELS * p.x;
+	y = SCREEN_HEIGHT - (METERS_TO_PIXELS * p.y);
+}
+
+OccupancyGrid::OccupancyGrid()
+{
+}
+
+void OccupancyGrid::Clear()
+{
+	bits.clear();
+	zoneFreeCells.clear();
+	cols = rows = 0;
+}
+
+void OccupancyGrid::Build(PhysicsBackend* physics, int cell_size, int clearance_px)
+{
+	Clear();
+
+	if (!physics || !physics->HasWorld() || cell_size <= 0)
+	{
+		LOG("ERROR: Invalid world or cell size in OccupancyGrid::Build");
+		return;
+	}
+
+	cellSize = cell_size;
+	clearance = clearance_px;
+	cols = (SCREEN_WIDTH + cellSize - 1) / cellSize;
+	rows = (SCREEN_HEIGHT + cellSize - 1) / cellSize;
+	bits.assign((cols * rows + 63) / 64, 0);
+
+	shapeCount = 0;
+	physics->VisitShapes(true, &OccupancyGrid::MarkShape, this);
+	int shapes = shapeCount;
+
+	int occupied = 0;
+	for (int i = 0; i < cols * rows; ++i)
+	{
+		if (GetCell(i % cols, i / cols)) occupied++;
+	}
+
+	LOG("Occupancy grid built: %dx%d cells of %dpx, %d static shapes, %d/%d cells occupied",
+		cols, rows, cellSize, shapes, occupied, cols * rows);
+}
+
+void OccupancyGrid::MarkShape(void* context, const PhysShapeView& shape)
+{
+	OccupancyGrid* grid = (OccupancyGrid*)context;
+
+	switch (shape.kind)
+	{
+	case PHYS_SHAPE_CIRCLE:
+	{
+		float x, y;
+		ToScreen(shape.center, x, y);
+		grid->MarkCircle(x, y, METERS_TO_PIXELS * shape.radius);
+	}
+	break;
+
+	case PHYS_SHAPE_POLYGON:
+	{
+		std::vector<float>& xs = grid->polygonXs;
+		std::vector<float>& ys = grid->polygonYs;
+		xs.resize(shape.count);
+		ys.resize(shape.count);
+		for (int i = 0; i < shape.count; ++i)
+		{
+			ToScreen(shape.vertices[i], xs[i], ys[i]);
+		}
+		grid->MarkPolygon(xs.data(), ys.data(), shape.count);
+	}
+	break;
+
+	case PHYS_SHAPE_CHAIN:
+	{
+		// Loops repeat their first vertex at the end, so this also covers the closing edge
+		for (int i = 0; i < shape.count - 1; ++i)
+		{
+			float x1, y1, x2, y2;
+			ToScreen(shape.vertices[i], x1, y1);
+			ToScreen(shape.vertices[i + 1], x2, y2);
+			grid->MarkSegment(x1, y1, x2, y2);
+		}
+	}
+	break;
+	}
+
+	grid->shapeCount++;
+}
+
+int OccupancyGrid::AddSpawnZone(const Rectangle& region)
+{
+	std::vector<int> freeCells;
+
+	if (cellSize > 0)
+	{
+		int minX = (int)(region.x / cellSize);
+		int minY = (int)(region.y / cellSize);
+		int maxX = (int)((region.x + region.width) / cellSize);
+		int maxY = (int)((region.y + region.height) / cellSize);
+
+		if (minX < 0) minX = 0;
+		if (minY < 0) minY = 0;
+		if (maxX > cols - 1) maxX = cols - 1;
+		if (maxY > rows - 1) maxY = rows - 1;
+
+		for (int cy = minY; cy <= maxY; ++cy)
+		{
+			for (int cx = minX; cx <= maxX; ++cx)
+			{
+				if (!GetCell(cx, cy)) freeCells.push_back(cy * cols + cx);
+			}
+		}
+	}
+
+	zoneFreeCells.push_back(freeCells);
+
+	LOG("Spawn zone %d: (%.0f, %.0f, %.0fx%.0f) has %d free cells",
+		(int)zoneFreeCells.size() - 1, region.x, region.y, region.width, region.height, (int)freeCells.size());
+
+	return (int)zoneFreeCells.size() - 1;
+}
+
+bool OccupancyGrid::SampleFree(int zone, int& x, int& y) const
+{
+	if (zone < 0 || zone >= (int)zoneFreeCells.size())
+		return false;
+
+	const std::vector<int>& freeCells = zoneFreeCells[zone];
+	if (freeCells.empty())
+		return false;
+
+	int cell = freeCells[GetRandomValue(0, (int)freeCells.size() - 1)];
+	x = (cell % cols) * cellSize + cellSize / 2;
+	y = (cell / cols) * cellSize + cellSize / 2;
+
+	return true;
+}
+
+bool OccupancyGrid::IsOccupied(int x, int y) const
+{
+	if (cellSize <= 0) return false;
+	if (x < 0 || y < 0) return true;
+
+	int cx = x / cellSize;
+	int cy = y / cellSize;
+	if (cx >= cols || cy >= rows) return true;
+
+	return GetCell(cx, cy);
+}
+
+int OccupancyGrid::GetFreeCount(int zone) const
+{
+	if (zone < 0 || zone >= (int)zoneFreeCells.size())
+		return 0;
+
+	return (int)zoneFreeCells[zone].size();
+}
+
+void OccupancyGrid::SetCell(int cx, int cy)
+{
+	int index = cy * cols + cx;
+	bits[index >> 6] |= (uint64)1 << (index & 63);
+}
+
+bool OccupancyGrid::GetCell(int cx, int cy) const
+{
+	int index = cy * cols + cx;
+	return (bits[index >> 6] >> (index & 63)) & 1;
+}
+
+void OccupancyGrid::MarkCircle(float x, float y, float radius)
+{
+	float r = radius + clearance;
+
+	int minX = MAX((int)((x - r) / cellSize), 0);
+	int minY = MAX((int)((y - r) / cellSize), 0);
+	int maxX = MIN((int)((x + r) / cellSize), cols - 1);
+	int maxY = MIN((int)((y + r) / cellSize), rows - 1);
+
+	for (int cy = minY; cy <= maxY; ++cy)
+	{
+		for (int cx = minX; cx <= maxX; ++cx)
+		{
+			float dx = (cx + 0.5f) * cellSize - x;
+			float dy = (cy + 0.5f) * cellSize - y;
+			if (dx * dx + dy * dy <= r * r) SetCell(cx, cy);
+		}
+	}
+}
+
+void OccupancyGrid::MarkSegment(float x1, float y1, float x2, float y2)
+{
+	float r = (float)clearance;
+
+	int minX = MAX((int)((MIN(x1, x2) - r) / cellSize), 0);
+	int minY = MAX((int)((MIN(y1, y2) - r) / cellSize), 0);
+	int maxX = MIN((int)((MAX(x1, x2) + r) / cellSize), cols - 1);
+	int maxY = MIN((int)((MAX(y1, y2) + r) / cellSize), rows - 1);
+
+	for (int cy = minY; cy <= maxY; ++cy)
+	{
+		for (int cx = minX; cx <= maxX; ++cx)
+		{
+			float px = (cx + 0.5f) * cellSize;
+			float py = (cy + 0.5f) * cellSize;
+			if (SegmentDistanceSq(px, py, x1, y1, x2, y2) <= r * r) SetCell(cx, cy);
+		}
+	}
+}
+
+void OccupancyGrid::MarkPolygon(const float* xs, const float* ys, int count)
+{
+	if (count < 3) return;
+
+	float r = (float)clearance;
+	float bx0 = xs[0], by0 = ys[0], bx1 = xs[0], by1 = ys[0];
+	for (int i = 1; i < count; ++i)
+	{
+		bx0 = MIN(bx0, xs[i]); bx1 = MAX(bx1, xs[i]);
+		by0 = MIN(by0, ys[i]); by1 = MAX(by1, ys[i]);
+	}
+
+	int minX = MAX((int)((bx0 - r) / cellSize), 0);
+	int minY = MAX((int)((by0 - r) / cellSize), 0);
+	int maxX = MIN((int)((bx1 + r) / cellSize), cols - 1);
+	int maxY = MIN((int)((by1 + r) / cellSize), rows - 1);
+
+	for (int cy = minY; cy <= maxY; ++cy)
+	{
+		for (int cx = minX; cx <= maxX; ++cx)
+		{
+			float px = (cx + 0.5f) * cellSize;
+			float py = (cy + 0.5f) * cellSize;
+
+			// Even-odd inside test, then clearance band around the edges
+			bool inside = false;
+			bool nearEdge = false;
+			for (int i = 0, j = count - 1; i < count; j = i++)
+			{
+				if (((ys[i] > py) != (ys[j] > py)) &&
+					(px < (xs[j] - xs[i]) * (py - ys[i]) / (ys[j] - ys[i]) + xs[i]))
+				{
+					inside = !inside;
+				}
+
+				if (SegmentDistanceSq(px, py, xs[i], ys[i], xs[j], ys[j]) <= r * r)
+				{
+					nearEdge = true;
+				}
+			}
+
+			if (inside || nearEdge) SetCell(cx, cy);
+		}
+	}
+}
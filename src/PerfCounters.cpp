@@ -0,0 +1,184 @@
+#include "Globals.h"
+#include "PerfCounters.h"
+
+#include <string.h>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#define PERF_SUPPORTED 1
+#else
+#define PERF_SUPPORTED 0
+#endif
+
+static const char* COUNTER_NAMES[PERF_COUNTER_COUNT] = { "cycles", "instructions", "cache misses", "branch misses" };
+static const char* SECTION_NAMES[PERF_SECTION_COUNT] = { "PreUpdate", "Update", "PostUpdate", "Physics step" };
+
+PerfCounters::PerfCounters()
+{
+	for (int i = 0; i < PERF_COUNTER_COUNT; ++i)
+	{
+		fds[i] = -1;
+		slot[i] = -1;
+	}
+	memset(startValues, 0, sizeof(startValues));
+}
+
+PerfCounters::~PerfCounters()
+{
+	Close();
+}
+
+bool PerfCounters::Open()
+{
+#if PERF_SUPPORTED
+	static const uint64 CONFIGS[PERF_COUNTER_COUNT] = {
+		PERF_COUNT_HW_CPU_CYCLES,
+		PERF_COUNT_HW_INSTRUCTIONS,
+		PERF_COUNT_HW_CACHE_MISSES,
+		PERF_COUNT_HW_BRANCH_MISSES
+	};
+
+	Close();
+
+	// One group so a single read() returns every counter for the same interval.
+	// Counters the PMU doesn't have are left out rather than failing the whole group
+	for (int i = 0; i < PERF_COUNTER_COUNT; ++i)
+	{
+		perf_event_attr attr;
+		memset(&attr, 0, sizeof(attr));
+		attr.size = sizeof(attr);
+		attr.type = PERF_TYPE_HARDWARE;
+		attr.config = CONFIGS[i];
+		attr.disabled = leader < 0 ? 1 : 0;
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+		attr.read_format = PERF_FORMAT_GROUP;
+
+		int fd = (int)syscall(__NR_perf_event_open, &attr, 0, -1, leader, 0);
+		if (fd < 0)
+		{
+			LOG("perf counter '%s' unavailable", COUNTER_NAMES[i]);
+			continue;
+		}
+
+		if (leader < 0) leader = fd;
+		fds[i] = fd;
+		slot[i] = groupSize++;
+	}
+
+	if (leader < 0)
+	{
+		LOG("Hardware performance counters unavailable (check /proc/sys/kernel/perf_event_paranoid)");
+		return false;
+	}
+
+	ioctl(leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+	ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+	owner = std::this_thread::get_id();
+
+	LOG("Hardware performance counters enabled: %d of %d events", groupSize, PERF_COUNTER_COUNT);
+	return true;
+#else
+	LOG("Hardware performance counters are only available on Linux");
+	return false;
+#endif
+}
+
+void PerfCounters::Close()
+{
+#if PERF_SUPPORTED
+	for (int i = 0; i < PERF_COUNTER_COUNT; ++i)
+	{
+		if (fds[i] >= 0 && fds[i] != leader) close(fds[i]);
+		fds[i] = -1;
+		slot[i] = -1;
+	}
+	if (leader >= 0) close(leader);
+#endif
+	leader = -1;
+	groupSize = 0;
+}
+
+bool PerfCounters::Read(uint64* values)
+{
+#if PERF_SUPPORTED
+	// PERF_FORMAT_GROUP layout: nr, then one value per member in open order
+	uint64 buffer[1 + PERF_COUNTER_COUNT];
+	ssize_t size = read(leader, buffer, sizeof(buffer));
+	if (size < (ssize_t)((1 + groupSize) * sizeof(uint64)))
+		return false;
+
+	for (int i = 0; i < PERF_COUNTER_COUNT; ++i)
+	{
+		values[i] = slot[i] >= 0 ? buffer[1 + slot[i]] : 0;
+	}
+	return true;
+#else
+	return false;
+#endif
+}
+
+// Other threads would read the owner's counts, so their sections are skipped
+void PerfCounters::Begin(int section)
+{
+	if (leader < 0 || std::this_thread::get_id() != owner) return;
+	Read(startValues[section]);
+}
+
+void PerfCounters::End(int section)
+{
+	if (leader < 0 || std::this_thread::get_id() != owner) return;
+
+	uint64 values[PERF_COUNTER_COUNT];
+	if (!Read(values)) return;
+
+	for (int i = 0; i < PERF_COUNTER_COUNT; ++i)
+	{
+		current[section].counts[i] += values[i] - startValues[section][i];
+	}
+}
+
+void PerfCounters::EndFrame()
+{
+	if (leader < 0) return;
+
+	for (int s = 0; s < PERF_SECTION_COUNT; ++s)
+	{
+		lastFrame[s] = current[s];
+		for (int i = 0; i < PERF_COUNTER_COUNT; ++i)
+		{
+			total[s].counts[i] += current[s].counts[i];
+		}
+		current[s] = PerfValues();
+	}
+	frames++;
+}
+
+PerfValues PerfCounters::GetAverage(int section) const
+{
+	PerfValues average;
+	for (int i = 0; i < PERF_COUNTER_COUNT && frames > 0; ++i)
+	{
+		average.counts[i] = total[section].counts[i] / frames;
+	}
+	return average;
+}
+
+void PerfCounters::PrintReport() const
+{
+	if (frames == 0)
+		return;
+
+	LOG("-------------- Hardware counters, per frame over %u frames --------------", frames);
+	for (int s = 0; s < PERF_SECTION_COUNT; ++s)
+	{
+		PerfValues average = GetAverage(s);
+		LOG("%-14s %10llu cycles %10llu instr  IPC %.2f  cache miss %.2f/kinstr  branch miss %.2f/kinstr",
+			SECTION_NAMES[s],
+			(unsigned long long)average.counts[PERF_CYCLES], (unsigned long long)average.counts[PERF_INSTRUCTIONS],
+			average.Ipc(), average.CacheMissesPerKilo(), average.BranchMissesPerKilo());
+	}
+}
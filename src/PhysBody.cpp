@@ -13,62 +13,41 @@ PhysBody::~PhysBody()
 
 void PhysBody::GetPosition(int& x, int& y) const
 {
-	b2Vec2 pos = body->GetPosition();
+	vec2f pos = backend->GetPosition(body);
 	x = METERS_TO_PIXELS * pos.x;
 	y = SCREEN_HEIGHT - (METERS_TO_PIXELS * pos.y);
 }
 
 float PhysBody::GetRotation() const
 {
-	return body->GetAngle() * RADTODEG;
+	return backend->GetAngle(body) * RADTODEG;
 }
 
 bool PhysBody::Contains(int x, int y) const
 {
 	// Convert screen coords to Box2D coords
-	b2Vec2 p(x * PIXELS_TO_METERS, (SCREEN_HEIGHT - y) * PIXELS_TO_METERS);
+	vec2f p(x * PIXELS_TO_METERS, (SCREEN_HEIGHT - y) * PIXELS_TO_METERS);
 	
-	const b2Fixture* fixture = body->GetFixtureList();
-	
-	while(fixture != nullptr)
-	{
-		if(fixture->TestPoint(p))
-			return true;
-		fixture = fixture->GetNext();
-	}
-	
-	return false;
+	return backend->TestPoint(body, p);
 }
 
 int PhysBody::RayCast(int x1, int y1, int x2, int y2, float& normal_x, float& normal_y) const
 {
-	int ret = -1;
-	
-	b2RayCastInput input;
-	b2RayCastOutput output;
-	
 	// Convert screen coords to Box2D coords
-	input.p1.Set(x1 * PIXELS_TO_METERS, (SCREEN_HEIGHT - y1) * PIXELS_TO_METERS);
-	input.p2.Set(x2 * PIXELS_TO_METERS, (SCREEN_HEIGHT - y2) * PIXELS_TO_METERS);
-	input.maxFraction = 1.0f;
+	vec2f p1(x1 * PIXELS_TO_METERS, (SCREEN_HEIGHT - y1) * PIXELS_TO_METERS);
+	vec2f p2(x2 * PIXELS_TO_METERS, (SCREEN_HEIGHT - y2) * PIXELS_TO_METERS);
+	
+	float fraction;
+	vec2f normal;
+	if(!backend->RayCast(body, p1, p2, fraction, normal))
+		return -1;
 	
-	const b2Fixture* fixture = body->GetFixtureList();
+	float fx = (float)(x2 - x1);
+	float fy = (float)(y2 - y1);
+	float dist = sqrtf((fx*fx) + (fy*fy));
 	
-	while(fixture != nullptr)
-	{
-		if(fixture->RayCast(&output, input, 0))
-		{
-			float fx = (float)(x2 - x1);
-			float fy = (float)(y2 - y1);
-			float dist = sqrtf((fx*fx) + (fy*fy));
-			
-			normal_x = output.normal.x;
-			normal_y = -output.normal.y; // Flip Y normal back to screen coords
-			
-			return (int)(output.fraction * dist);
-		}
-		fixture = fixture->GetNext();
-	}
+	normal_x = normal.x;
+	normal_y = -normal.y; // Flip Y normal back to screen coords
 	
-	return ret;
+	return (int)(fraction * dist);
 }
@@ -0,0 +1,541 @@
+#ifndef PHYSICS_BOX2D_V3
+
+#include "Globals.h"
+#include "PhysicsBackendBox2D.h"
+#include "Timer.h"
+
+#include <algorithm>
+
+static b2Body* ToBody(PhysHandle handle)
+{
+	return (b2Body*)(uintptr_t)handle;
+}
+
+static PhysHandle ToHandle(const void* pointer)
+{
+	return (PhysHandle)(uintptr_t)pointer;
+}
+
+static b2Vec2 ToB2(vec2f v)
+{
+	return b2Vec2(v.x, v.y);
+}
+
+static vec2f FromB2(const b2Vec2& v)
+{
+	return vec2f(v.x, v.y);
+}
+
+static PhysShapeKind ShapeKind(const b2Fixture* fixture)
+{
+	switch (fixture->GetType())
+	{
+	case b2Shape::e_circle: return PHYS_SHAPE_CIRCLE;
+	case b2Shape::e_polygon: return PHYS_SHAPE_POLYGON;
+	default: return PHYS_SHAPE_CHAIN;
+	}
+}
+
+static PhysBodyType BodyType(const b2Body* body)
+{
+	switch (body->GetType())
+	{
+	case b2_dynamicBody: return PHYS_BODY_DYNAMIC;
+	case b2_kinematicBody: return PHYS_BODY_KINEMATIC;
+	default: return PHYS_BODY_STATIC;
+	}
+}
+
+PhysicsBackend* CreatePhysicsBackend(JobSystem* jobs)
+{
+	return new PhysicsBackendBox2D();
+}
+
+PhysicsBackendBox2D::PhysicsBackendBox2D()
+{
+	contacts.reserve(256);
+}
+
+PhysicsBackendBox2D::~PhysicsBackendBox2D()
+{
+	DestroyWorld();
+}
+
+bool PhysicsBackendBox2D::CreateWorld(vec2f gravity)
+{
+	world = new b2World(ToB2(gravity));
+	world->SetContactListener(this);
+	world->SetAutoClearForces(false);
+	lastToiCalls = b2_toiCalls;
+	return true;
+}
+
+void PhysicsBackendBox2D::DestroyWorld()
+{
+	delete world;
+	world = nullptr;
+	contacts.clear();
+}
+
+void PhysicsBackendBox2D::Step(float dt)
+{
+	contacts.clear();
+	world->Step(dt, 6, 2);
+
+	const b2Profile& step = world->GetProfile();
+	profile.step += step.step;
+	profile.collide += step.collide;
+	profile.solve += step.solve;
+	profile.solveTOI += step.solveTOI;
+	profile.broadphase += step.broadphase;
+}
+
+void PhysicsBackendBox2D::ClearForces()
+{
+	world->ClearForces();
+}
+
+int PhysicsBackendBox2D::GetContactEvents(const PhysContactEvent** events) const
+{
+	*events = contacts.data();
+	return (int)contacts.size();
+}
+
+void PhysicsBackendBox2D::BeginContact(b2Contact* contact)
+{
+	PhysBody* a = (PhysBody*)contact->GetFixtureA()->GetBody()->GetUserData().pointer;
+	PhysBody* b = (PhysBody*)contact->GetFixtureB()->GetBody()->GetUserData().pointer;
+	contacts.push_back(PhysContactEvent{ a, b, GetPerfTime() });
+}
+
+void PhysicsBackendBox2D::ResetProfile()
+{
+	profile = PhysStepProfile();
+}
+
+void PhysicsBackendBox2D::GetStats(PhysWorldStats& stats)
+{
+	stats = PhysWorldStats();
+	stats.bodies = world->GetBodyCount();
+	stats.proxies = world->GetProxyCount();
+	stats.contacts = world->GetContactCount();
+
+	// Box2D counts every time-of-impact query, only the difference is new
+	stats.toiEvents = b2_toiCalls - lastToiCalls;
+	lastToiCalls = b2_toiCalls;
+
+	// Sensors first: a sensor against a chain is still a sensor overlap
+	for (b2Contact* c = world->GetContactList(); c; c = c->GetNext())
+	{
+		b2Fixture* fixtureA = c->GetFixtureA();
+		b2Fixture* fixtureB = c->GetFixtureB();
+
+		if (c->IsTouching()) stats.touching++;
+
+		if (fixtureA->IsSensor() || fixtureB->IsSensor()) stats.sensorContacts++;
+		else if (fixtureA->GetType() == b2Shape::e_chain || fixtureB->GetType() == b2Shape::e_chain) stats.chainContacts++;
+	}
+
+	// One proxy per chain edge, so the doubled chains show up here
+	for (b2Body* b = world->GetBodyList(); b; b = b->GetNext())
+	{
+		if (!b->IsEnabled()) continue;
+
+		for (b2Fixture* f = b->GetFixtureList(); f; f = f->GetNext())
+		{
+			int proxies = f->GetShape()->GetChildCount();
+			if (f->IsSensor()) stats.sensorProxies += proxies;
+			else if (f->GetType() == b2Shape::e_chain) stats.chainProxies += proxies;
+			else stats.otherProxies += proxies;
+		}
+	}
+}
+
+b2Body* PhysicsBackendBox2D::CreateBody(const PhysBodyDef& def)
+{
+	b2BodyDef body;
+	body.type = def.type == PHYS_BODY_DYNAMIC ? b2_dynamicBody : def.type == PHYS_BODY_KINEMATIC ? b2_kinematicBody : b2_staticBody;
+	body.position = ToB2(def.position);
+	body.angle = def.angle;
+	body.bullet = def.bullet;
+	body.userData.pointer = (uintptr_t)def.user;
+	return world->CreateBody(&body);
+}
+
+PhysHandle PhysicsBackendBox2D::CreateCircle(const PhysBodyDef& def, float radius, const PhysMaterial& material)
+{
+	b2Body* b = CreateBody(def);
+	if (!b) return 0;
+
+	b2CircleShape shape;
+	shape.m_radius = radius;
+
+	b2FixtureDef fixture;
+	fixture.shape = &shape;
+	fixture.density = material.density;
+	fixture.friction = material.friction;
+	fixture.restitution = material.restitution;
+	fixture.isSensor = material.sensor;
+
+	if (!b->CreateFixture(&fixture))
+	{
+		world->DestroyBody(b);
+		return 0;
+	}
+	return ToHandle(b);
+}
+
+PhysHandle PhysicsBackendBox2D::CreateBox(const PhysBodyDef& def, float halfWidth, float halfHeight, vec2f center, const PhysMaterial& material)
+{
+	b2Body* b = CreateBody(def);
+	if (!b) return 0;
+
+	b2PolygonShape box;
+	box.SetAsBox(halfWidth, halfHeight, ToB2(center), 0.0f);
+
+	b2FixtureDef fixture;
+	fixture.shape = &box;
+	fixture.density = material.density;
+	fixture.friction = material.friction;
+	fixture.restitution = material.restitution;
+	fixture.isSensor = material.sensor;
+
+	if (!b->CreateFixture(&fixture))
+	{
+		world->DestroyBody(b);
+		return 0;
+	}
+	return ToHandle(b);
+}
+
+// Box2D 2.4 chains only collide on one side, so every chain is added twice, once per winding
+PhysHandle PhysicsBackendBox2D::CreateChain(const PhysBodyDef& def, const vec2f* points, int count, bool loop, const PhysMaterial& material)
+{
+	if (count < (loop ? 3 : 2)) return 0;
+
+	b2Body* b = CreateBody(def);
+	if (!b) return 0;
+
+	std::vector<b2Vec2> vertices(count);
+	for (int i = 0; i < count; ++i) vertices[i] = ToB2(points[i]);
+
+	b2FixtureDef fixture;
+	fixture.density = material.density;
+	fixture.friction = material.friction;
+	fixture.restitution = material.restitution;
+	fixture.isSensor = material.sensor;
+
+	for (int winding = 0; winding < 2; ++winding)
+	{
+		// The shape keeps its own copy, so the vertices are reversed in place for the second one
+		if (winding == 1) std::reverse(vertices.begin(), vertices.end());
+
+		b2ChainShape chain;
+		if (loop)
+		{
+			chain.CreateLoop(vertices.data(), count);
+		}
+		else
+		{
+			b2Vec2 prevVertex = vertices[0] + (vertices[0] - vertices[1]);
+			b2Vec2 nextVertex = vertices[count - 1] + (vertices[count - 1] - vertices[count - 2]);
+			chain.CreateChain(vertices.data(), count, prevVertex, nextVertex);
+		}
+
+		fixture.shape = &chain;
+		if (!b->CreateFixture(&fixture))
+		{
+			world->DestroyBody(b);
+			return 0;
+		}
+	}
+	return ToHandle(b);
+}
+
+void PhysicsBackendBox2D::DestroyBody(PhysHandle body)
+{
+	if (body && world) world->DestroyBody(ToBody(body));
+}
+
+vec2f PhysicsBackendBox2D::GetPosition(PhysHandle body) const
+{
+	return FromB2(ToBody(body)->GetPosition());
+}
+
+float PhysicsBackendBox2D::GetAngle(PhysHandle body) const
+{
+	return ToBody(body)->GetAngle();
+}
+
+void PhysicsBackendBox2D::SetTransform(PhysHandle body, vec2f position, float angle)
+{
+	ToBody(body)->SetTransform(ToB2(position), angle);
+}
+
+vec2f PhysicsBackendBox2D::GetLinearVelocity(PhysHandle body) const
+{
+	return FromB2(ToBody(body)->GetLinearVelocity());
+}
+
+void PhysicsBackendBox2D::SetLinearVelocity(PhysHandle body, vec2f velocity)
+{
+	ToBody(body)->SetLinearVelocity(ToB2(velocity));
+}
+
+float PhysicsBackendBox2D::GetAngularVelocity(PhysHandle body) const
+{
+	return ToBody(body)->GetAngularVelocity();
+}
+
+void PhysicsBackendBox2D::SetAngularVelocity(PhysHandle body, float velocity)
+{
+	ToBody(body)->SetAngularVelocity(velocity);
+}
+
+void PhysicsBackendBox2D::ApplyLinearImpulse(PhysHandle body, vec2f impulse)
+{
+	ToBody(body)->ApplyLinearImpulseToCenter(ToB2(impulse), true);
+}
+
+void PhysicsBackendBox2D::ApplyForce(PhysHandle body, vec2f force)
+{
+	ToBody(body)->ApplyForceToCenter(ToB2(force), true);
+}
+
+float PhysicsBackendBox2D::GetMass(PhysHandle body) const
+{
+	return ToBody(body)->GetMass();
+}
+
+PhysBodyType PhysicsBackendBox2D::GetType(PhysHandle body) const
+{
+	return BodyType(ToBody(body));
+}
+
+bool PhysicsBackendBox2D::IsBullet(PhysHandle body) const
+{
+	return ToBody(body)->IsBullet();
+}
+
+bool PhysicsBackendBox2D::IsEnabled(PhysHandle body) const
+{
+	return ToBody(body)->IsEnabled();
+}
+
+void PhysicsBackendBox2D::SetEnabled(PhysHandle body, bool enabled)
+{
+	ToBody(body)->SetEnabled(enabled);
+}
+
+bool PhysicsBackendBox2D::IsAwake(PhysHandle body) const
+{
+	return ToBody(body)->IsAwake();
+}
+
+void PhysicsBackendBox2D::SetAwake(PhysHandle body, bool awake)
+{
+	ToBody(body)->SetAwake(awake);
+}
+
+void PhysicsBackendBox2D::SetLinearDamping(PhysHandle body, float damping)
+{
+	ToBody(body)->SetLinearDamping(damping);
+}
+
+void PhysicsBackendBox2D::SetRestitution(PhysHandle body, float restitution)
+{
+	for (b2Fixture* f = ToBody(body)->GetFixtureList(); f; f = f->GetNext()) f->SetRestitution(restitution);
+}
+
+void PhysicsBackendBox2D::SetSensor(PhysHandle body, bool sensor)
+{
+	for (b2Fixture* f = ToBody(body)->GetFixtureList(); f; f = f->GetNext()) f->SetSensor(sensor);
+}
+
+float PhysicsBackendBox2D::GetRadius(PhysHandle body) const
+{
+	for (const b2Fixture* f = ToBody(body)->GetFixtureList(); f; f = f->GetNext())
+	{
+		if (f->GetType() == b2Shape::e_circle) return f->GetShape()->m_radius;
+	}
+	return 0.0f;
+}
+
+bool PhysicsBackendBox2D::TestPoint(PhysHandle body, vec2f point) const
+{
+	for (const b2Fixture* f = ToBody(body)->GetFixtureList(); f; f = f->GetNext())
+	{
+		if (f->TestPoint(ToB2(point))) return true;
+	}
+	return false;
+}
+
+bool PhysicsBackendBox2D::RayCast(PhysHandle body, vec2f p1, vec2f p2, float& fraction, vec2f& normal) const
+{
+	b2RayCastInput input;
+	input.p1 = ToB2(p1);
+	input.p2 = ToB2(p2);
+	input.maxFraction = 1.0f;
+
+	for (const b2Fixture* f = ToBody(body)->GetFixtureList(); f; f = f->GetNext())
+	{
+		b2RayCastOutput output;
+		if (f->RayCast(&output, input, 0))
+		{
+			fraction = output.fraction;
+			normal = FromB2(output.normal);
+			return true;
+		}
+	}
+	return false;
+}
+
+PhysHandle PhysicsBackendBox2D::CreateRevoluteJoint(const PhysRevoluteDef& def)
+{
+	b2RevoluteJointDef joint;
+	joint.bodyA = ToBody(def.bodyA);
+	joint.bodyB = ToBody(def.bodyB);
+	joint.localAnchorA = ToB2(def.anchorA);
+	joint.localAnchorB = ToB2(def.anchorB);
+	joint.enableLimit = def.enableLimit;
+	joint.lowerAngle = def.lowerAngle;
+	joint.upperAngle = def.upperAngle;
+	joint.enableMotor = def.enableMotor;
+	joint.maxMotorTorque = def.maxMotorTorque;
+	joint.motorSpeed = def.motorSpeed;
+	return ToHandle(world->CreateJoint(&joint));
+}
+
+float PhysicsBackendBox2D::GetJointAngle(PhysHandle joint) const
+{
+	return ((b2RevoluteJoint*)(uintptr_t)joint)->GetJointAngle();
+}
+
+float PhysicsBackendBox2D::GetMotorSpeed(PhysHandle joint) const
+{
+	return ((b2RevoluteJoint*)(uintptr_t)joint)->GetMotorSpeed();
+}
+
+void PhysicsBackendBox2D::SetMotorSpeed(PhysHandle joint, float speed)
+{
+	((b2RevoluteJoint*)(uintptr_t)joint)->SetMotorSpeed(speed);
+}
+
+PhysHandle PhysicsBackendBox2D::CreateMouseJoint(PhysHandle ground, PhysHandle body, vec2f target, float maxForce)
+{
+	b2MouseJointDef def;
+	def.bodyA = ToBody(ground);
+	def.bodyB = ToBody(body);
+	def.target = ToB2(target);
+	def.maxForce = maxForce;
+	def.damping = 0.0f;
+	def.stiffness = 50.0f;
+	return ToHandle(world->CreateJoint(&def));
+}
+
+void PhysicsBackendBox2D::SetMouseTarget(PhysHandle joint, vec2f target)
+{
+	((b2MouseJoint*)(uintptr_t)joint)->SetTarget(ToB2(target));
+}
+
+void PhysicsBackendBox2D::DestroyJoint(PhysHandle joint)
+{
+	if (joint && world) world->DestroyJoint((b2Joint*)(uintptr_t)joint);
+}
+
+void PhysicsBackendBox2D::QueryAABB(vec2f lower, vec2f upper, PhysQueryFunction function, void* context) const
+{
+	class Callback : public b2QueryCallback
+	{
+	public:
+		PhysQueryFunction function;
+		void* context;
+
+		bool ReportFixture(b2Fixture* fixture) override
+		{
+			b2Body* body = fixture->GetBody();
+
+			PhysQueryHit hit;
+			hit.body = (PhysBody*)body->GetUserData().pointer;
+			hit.shape = ShapeKind(fixture);
+			hit.type = BodyType(body);
+			hit.sensor = fixture->IsSensor();
+			hit.bullet = body->IsBullet();
+			return function(context, hit);
+		}
+	} callback;
+
+	callback.function = function;
+	callback.context = context;
+
+	b2AABB aabb;
+	aabb.lowerBound = ToB2(lower);
+	aabb.upperBound = ToB2(upper);
+	world->QueryAABB(&callback, aabb);
+}
+
+void PhysicsBackendBox2D::VisitShapes(bool staticOnly, PhysShapeFunction function, void* context) const
+{
+	for (b2Body* b = world->GetBodyList(); b; b = b->GetNext())
+	{
+		if (staticOnly && b->GetType() != b2_staticBody) continue;
+
+		for (b2Fixture* f = b->GetFixtureList(); f; f = f->GetNext())
+		{
+			PhysShapeView view = {};
+			view.kind = ShapeKind(f);
+			view.type = BodyType(b);
+			view.sensor = f->IsSensor();
+			view.body = (PhysBody*)b->GetUserData().pointer;
+
+			switch (f->GetType())
+			{
+			case b2Shape::e_circle:
+			{
+				b2CircleShape* shape = (b2CircleShape*)f->GetShape();
+				view.center = FromB2(b->GetWorldPoint(shape->m_p));
+				view.radius = shape->m_radius;
+			}
+			break;
+
+			case b2Shape::e_polygon:
+			{
+				b2PolygonShape* shape = (b2PolygonShape*)f->GetShape();
+				shapeVertices.resize(shape->m_count, vec2f(0.0f, 0.0f));
+				for (int i = 0; i < shape->m_count; ++i) shapeVertices[i] = FromB2(b->GetWorldPoint(shape->m_vertices[i]));
+				view.vertices = shapeVertices.data();
+				view.count = shape->m_count;
+			}
+			break;
+
+			case b2Shape::e_chain:
+			{
+				b2ChainShape* shape = (b2ChainShape*)f->GetShape();
+				shapeVertices.resize(shape->m_count, vec2f(0.0f, 0.0f));
+				for (int i = 0; i < shape->m_count; ++i) shapeVertices[i] = FromB2(b->GetWorldPoint(shape->m_vertices[i]));
+				view.vertices = shapeVertices.data();
+				view.count = shape->m_count;
+			}
+			break;
+
+			case b2Shape::e_edge:
+			{
+				b2EdgeShape* shape = (b2EdgeShape*)f->GetShape();
+				shapeVertices.resize(2, vec2f(0.0f, 0.0f));
+				shapeVertices[0] = FromB2(b->GetWorldPoint(shape->m_vertex1));
+				shapeVertices[1] = FromB2(b->GetWorldPoint(shape->m_vertex2));
+				view.vertices = shapeVertices.data();
+				view.count = 2;
+			}
+			break;
+
+			default:
+				continue;
+			}
+
+			function(context, view);
+		}
+	}
+}
+
+#endif // PHYSICS_BOX2D_V3
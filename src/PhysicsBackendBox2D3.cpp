@@ -0,0 +1,657 @@
+#ifdef PHYSICS_BOX2D_V3
+
+#include "Globals.h"
+#include "PhysicsBackendBox2D3.h"
+#include "Timer.h"
+
+static b2BodyId ToBody(PhysHandle handle)
+{
+	return b2LoadBodyId(handle);
+}
+
+static b2JointId ToJoint(PhysHandle handle)
+{
+	return b2LoadJointId(handle);
+}
+
+static b2Vec2 ToB2(vec2f v)
+{
+	return b2Vec2{ v.x, v.y };
+}
+
+static vec2f FromB2(b2Vec2 v)
+{
+	return vec2f(v.x, v.y);
+}
+
+static PhysShapeKind ShapeKind(b2ShapeId shape)
+{
+	switch (b2Shape_GetType(shape))
+	{
+	case b2_circleShape: return PHYS_SHAPE_CIRCLE;
+	case b2_polygonShape: return PHYS_SHAPE_POLYGON;
+	default: return PHYS_SHAPE_CHAIN;
+	}
+}
+
+static PhysBodyType BodyType(b2BodyId body)
+{
+	switch (b2Body_GetType(body))
+	{
+	case b2_dynamicBody: return PHYS_BODY_DYNAMIC;
+	case b2_kinematicBody: return PHYS_BODY_KINEMATIC;
+	default: return PHYS_BODY_STATIC;
+	}
+}
+
+static PhysBody* UserOf(b2ShapeId shape)
+{
+	return (PhysBody*)b2Body_GetUserData(b2Shape_GetBody(shape));
+}
+
+// Every shape reports sensor and contact events, the game listens to all of them
+static b2ShapeDef ShapeDef(const PhysMaterial& material)
+{
+	b2ShapeDef def = b2DefaultShapeDef();
+	def.density = material.density;
+	def.material.friction = material.friction;
+	def.material.restitution = material.restitution;
+	def.isSensor = material.sensor;
+	def.enableSensorEvents = true;
+	def.enableContactEvents = true;
+	return def;
+}
+
+PhysicsBackend* CreatePhysicsBackend(JobSystem* jobs)
+{
+	return new PhysicsBackendBox2D3(jobs);
+}
+
+PhysicsBackendBox2D3::PhysicsBackendBox2D3(JobSystem* jobs) : jobs(jobs)
+{
+	contacts.reserve(256);
+	bodies.reserve(256);
+}
+
+PhysicsBackendBox2D3::~PhysicsBackendBox2D3()
+{
+	DestroyWorld();
+}
+
+bool PhysicsBackendBox2D3::CreateWorld(vec2f gravity)
+{
+	b2WorldDef def = b2DefaultWorldDef();
+	def.gravity = ToB2(gravity);
+
+	workerCount = 1;
+	if (jobs != nullptr && jobs->GetWorkerCount() > 0)
+	{
+		workerCount = jobs->GetWorkerCount() + 1;
+		def.workerCount = workerCount;
+		def.enqueueTask = &PhysicsBackendBox2D3::EnqueueTask;
+		def.finishTask = &PhysicsBackendBox2D3::FinishTask;
+		def.userTaskContext = this;
+	}
+
+	world = b2CreateWorld(&def);
+	return B2_IS_NON_NULL(world);
+}
+
+void PhysicsBackendBox2D3::DestroyWorld()
+{
+	if (B2_IS_NON_NULL(world)) b2DestroyWorld(world);
+	world = b2_nullWorldId;
+	bodies.clear();
+	contacts.clear();
+	forces.clear();
+}
+
+// Box2D asks for items [0, itemCount) in ranges of at least minRange. Returning
+// null means the task already ran, and then it doesn't call FinishTask
+void* PhysicsBackendBox2D3::EnqueueTask(b2TaskCallback* callback, int itemCount, int minRange, void* taskContext, void* userContext)
+{
+	PhysicsBackendBox2D3* backend = (PhysicsBackendBox2D3*)userContext;
+
+	if (backend->taskCount == BOX2D3_MAX_TASKS)
+	{
+		callback(0, itemCount, 0, taskContext);
+		return nullptr;
+	}
+
+	Task& task = backend->tasks[backend->taskCount++];
+	task.callback = callback;
+	task.context = taskContext;
+
+	int batchCount = MIN(backend->workerCount, (itemCount + minRange - 1) / MAX(minRange, 1));
+	batchCount = MAX(batchCount, 1);
+	int batchSize = (itemCount + batchCount - 1) / batchCount;
+
+	for (int i = 0; i < batchCount; ++i)
+	{
+		TaskBatch& batch = task.batches[i];
+		batch.task = &task;
+		batch.begin = i * batchSize;
+		batch.end = MIN(batch.begin + batchSize, itemCount);
+		batch.worker = (uint32_t)i;
+		if (batch.begin < batch.end) backend->jobs->Run(&PhysicsBackendBox2D3::RunBatch, &batch, &task.fence);
+	}
+	return &task;
+}
+
+void PhysicsBackendBox2D3::FinishTask(void* userTask, void* userContext)
+{
+	PhysicsBackendBox2D3* backend = (PhysicsBackendBox2D3*)userContext;
+	backend->jobs->Wait(&((Task*)userTask)->fence);
+}
+
+void PhysicsBackendBox2D3::RunBatch(void* data)
+{
+	TaskBatch* batch = (TaskBatch*)data;
+	batch->task->callback(batch->begin, batch->end, batch->worker, batch->task->context);
+}
+
+void PhysicsBackendBox2D3::Step(float dt)
+{
+	contacts.clear();
+	taskCount = 0;
+
+	for (const HeldForce& held : forces)
+	{
+		if (b2Body_IsValid(held.body)) b2Body_ApplyForceToCenter(held.body, held.force, true);
+	}
+	b2World_Step(world, dt, BOX2D3_SUBSTEPS);
+	ReadEvents();
+
+	b2Profile step = b2World_GetProfile(world);
+	profile.step += step.step;
+	profile.collide += step.collide;
+	profile.solve += step.solve;
+	profile.solveTOI += step.bullets;
+	profile.broadphase += step.pairs;
+}
+
+void PhysicsBackendBox2D3::ClearForces()
+{
+	forces.clear();
+}
+
+// Box2D 3 reports after the step, so every event gets the same time. Sensors
+// aren't contacts any more, their overlaps come in a second list
+void PhysicsBackendBox2D3::ReadEvents()
+{
+	double now = GetPerfTime();
+
+	b2ContactEvents events = b2World_GetContactEvents(world);
+	for (int i = 0; i < events.beginCount; ++i)
+	{
+		const b2ContactBeginTouchEvent& e = events.beginEvents[i];
+		if (!b2Shape_IsValid(e.shapeIdA) || !b2Shape_IsValid(e.shapeIdB)) continue;
+		contacts.push_back(PhysContactEvent{ UserOf(e.shapeIdA), UserOf(e.shapeIdB), now });
+	}
+
+	b2SensorEvents sensors = b2World_GetSensorEvents(world);
+	for (int i = 0; i < sensors.beginCount; ++i)
+	{
+		const b2SensorBeginTouchEvent& e = sensors.beginEvents[i];
+		if (!b2Shape_IsValid(e.sensorShapeId) || !b2Shape_IsValid(e.visitorShapeId)) continue;
+		contacts.push_back(PhysContactEvent{ UserOf(e.sensorShapeId), UserOf(e.visitorShapeId), now });
+	}
+}
+
+int PhysicsBackendBox2D3::GetContactEvents(const PhysContactEvent** events) const
+{
+	*events = contacts.data();
+	return (int)contacts.size();
+}
+
+void PhysicsBackendBox2D3::ResetProfile()
+{
+	profile = PhysStepProfile();
+}
+
+// Box2D 3 has no time-of-impact counter and sensors make no contacts, so
+// toiEvents and sensorContacts stay at 0
+void PhysicsBackendBox2D3::GetStats(PhysWorldStats& stats)
+{
+	b2Counters counters = b2World_GetCounters(world);
+
+	stats = PhysWorldStats();
+	stats.bodies = counters.bodyCount;
+	stats.proxies = counters.shapeCount;
+	stats.contacts = counters.contactCount;
+
+	for (b2BodyId body : bodies)
+	{
+		if (!b2Body_IsEnabled(body)) continue;
+
+		int count = GetShapes(b2StoreBodyId(body));
+		for (int i = 0; i < count; ++i)
+		{
+			if (b2Shape_IsSensor(shapes[i])) stats.sensorProxies++;
+			else if (b2Shape_GetType(shapes[i]) == b2_segmentShape) stats.chainProxies++;
+			else stats.otherProxies++;
+		}
+
+		// Only touching contacts are listed, once on each body: count them on shape A's
+		int capacity = b2Body_GetContactCapacity(body);
+		if (capacity == 0) continue;
+
+		contactData.resize(capacity);
+		int contactCount = b2Body_GetContactData(body, contactData.data(), capacity);
+		for (int i = 0; i < contactCount; ++i)
+		{
+			const b2ContactData& c = contactData[i];
+			if (B2_ID_EQUALS(b2Shape_GetBody(c.shapeIdA), body) == false) continue;
+
+			stats.touching++;
+			if (b2Shape_GetType(c.shapeIdA) == b2_segmentShape || b2Shape_GetType(c.shapeIdB) == b2_segmentShape) stats.chainContacts++;
+		}
+	}
+}
+
+b2BodyId PhysicsBackendBox2D3::CreateBody(const PhysBodyDef& def)
+{
+	b2BodyDef body = b2DefaultBodyDef();
+	body.type = def.type == PHYS_BODY_DYNAMIC ? b2_dynamicBody : def.type == PHYS_BODY_KINEMATIC ? b2_kinematicBody : b2_staticBody;
+	body.position = ToB2(def.position);
+	body.rotation = b2MakeRot(def.angle);
+	body.isBullet = def.bullet;
+	body.userData = def.user;
+
+	b2BodyId id = b2CreateBody(world, &body);
+	bodies.push_back(id);
+	return id;
+}
+
+PhysHandle PhysicsBackendBox2D3::CreateCircle(const PhysBodyDef& def, float radius, const PhysMaterial& material)
+{
+	b2BodyId body = CreateBody(def);
+
+	b2Circle circle = { { 0.0f, 0.0f }, radius };
+	b2ShapeDef shape = ShapeDef(material);
+	b2CreateCircleShape(body, &shape, &circle);
+	return b2StoreBodyId(body);
+}
+
+PhysHandle PhysicsBackendBox2D3::CreateBox(const PhysBodyDef& def, float halfWidth, float halfHeight, vec2f center, const PhysMaterial& material)
+{
+	b2BodyId body = CreateBody(def);
+
+	b2Polygon box = b2MakeOffsetBox(halfWidth, halfHeight, ToB2(center), b2MakeRot(0.0f));
+	b2ShapeDef shape = ShapeDef(material);
+	b2CreatePolygonShape(body, &shape, &box);
+	return b2StoreBodyId(body);
+}
+
+// Box2D 3 chains are one-sided too, but its segments aren't: one per edge collides from both sides
+PhysHandle PhysicsBackendBox2D3::CreateChain(const PhysBodyDef& def, const vec2f* points, int count, bool loop, const PhysMaterial& material)
+{
+	if (count < (loop ? 3 : 2)) return 0;
+
+	b2BodyId body = CreateBody(def);
+	b2ShapeDef shape = ShapeDef(material);
+
+	int edges = loop ? count : count - 1;
+	for (int i = 0; i < edges; ++i)
+	{
+		b2Segment segment = { ToB2(points[i]), ToB2(points[(i + 1) % count]) };
+		b2CreateSegmentShape(body, &shape, &segment);
+	}
+	return b2StoreBodyId(body);
+}
+
+void PhysicsBackendBox2D3::DestroyBody(PhysHandle body)
+{
+	if (body == 0 || B2_IS_NULL(world)) return;
+
+	b2BodyId id = ToBody(body);
+	for (size_t i = 0; i < bodies.size(); ++i)
+	{
+		if (B2_ID_EQUALS(bodies[i], id))
+		{
+			bodies[i] = bodies.back();
+			bodies.pop_back();
+			break;
+		}
+	}
+	b2DestroyBody(id);
+}
+
+int PhysicsBackendBox2D3::GetShapes(PhysHandle body) const
+{
+	b2BodyId id = ToBody(body);
+	shapes.resize(b2Body_GetShapeCount(id));
+	return b2Body_GetShapes(id, shapes.data(), (int)shapes.size());
+}
+
+vec2f PhysicsBackendBox2D3::GetPosition(PhysHandle body) const
+{
+	return FromB2(b2Body_GetPosition(ToBody(body)));
+}
+
+float PhysicsBackendBox2D3::GetAngle(PhysHandle body) const
+{
+	return b2Rot_GetAngle(b2Body_GetRotation(ToBody(body)));
+}
+
+void PhysicsBackendBox2D3::SetTransform(PhysHandle body, vec2f position, float angle)
+{
+	b2Body_SetTransform(ToBody(body), ToB2(position), b2MakeRot(angle));
+}
+
+vec2f PhysicsBackendBox2D3::GetLinearVelocity(PhysHandle body) const
+{
+	return FromB2(b2Body_GetLinearVelocity(ToBody(body)));
+}
+
+void PhysicsBackendBox2D3::SetLinearVelocity(PhysHandle body, vec2f velocity)
+{
+	b2Body_SetLinearVelocity(ToBody(body), ToB2(velocity));
+}
+
+float PhysicsBackendBox2D3::GetAngularVelocity(PhysHandle body) const
+{
+	return b2Body_GetAngularVelocity(ToBody(body));
+}
+
+void PhysicsBackendBox2D3::SetAngularVelocity(PhysHandle body, float velocity)
+{
+	b2Body_SetAngularVelocity(ToBody(body), velocity);
+}
+
+void PhysicsBackendBox2D3::ApplyLinearImpulse(PhysHandle body, vec2f impulse)
+{
+	b2Body_ApplyLinearImpulseToCenter(ToBody(body), ToB2(impulse), true);
+}
+
+void PhysicsBackendBox2D3::ApplyForce(PhysHandle body, vec2f force)
+{
+	HeldForce held;
+	held.body = ToBody(body);
+	held.force = ToB2(force);
+	forces.push_back(held);
+}
+
+float PhysicsBackendBox2D3::GetMass(PhysHandle body) const
+{
+	return b2Body_GetMass(ToBody(body));
+}
+
+PhysBodyType PhysicsBackendBox2D3::GetType(PhysHandle body) const
+{
+	return BodyType(ToBody(body));
+}
+
+bool PhysicsBackendBox2D3::IsBullet(PhysHandle body) const
+{
+	return b2Body_IsBullet(ToBody(body));
+}
+
+bool PhysicsBackendBox2D3::IsEnabled(PhysHandle body) const
+{
+	return b2Body_IsEnabled(ToBody(body));
+}
+
+void PhysicsBackendBox2D3::SetEnabled(PhysHandle body, bool enabled)
+{
+	if (enabled) b2Body_Enable(ToBody(body));
+	else b2Body_Disable(ToBody(body));
+}
+
+bool PhysicsBackendBox2D3::IsAwake(PhysHandle body) const
+{
+	return b2Body_IsAwake(ToBody(body));
+}
+
+void PhysicsBackendBox2D3::SetAwake(PhysHandle body, bool awake)
+{
+	b2Body_SetAwake(ToBody(body), awake);
+}
+
+void PhysicsBackendBox2D3::SetLinearDamping(PhysHandle body, float damping)
+{
+	b2Body_SetLinearDamping(ToBody(body), damping);
+}
+
+void PhysicsBackendBox2D3::SetRestitution(PhysHandle body, float restitution)
+{
+	int count = GetShapes(body);
+	for (int i = 0; i < count; ++i) b2Shape_SetRestitution(shapes[i], restitution);
+}
+
+// A shape can't change between sensor and solid in Box2D 3, so it is rebuilt
+void PhysicsBackendBox2D3::SetSensor(PhysHandle body, bool sensor)
+{
+	b2BodyId id = ToBody(body);
+	int count = GetShapes(body);
+
+	for (int i = 0; i < count; ++i)
+	{
+		b2ShapeId old = shapes[i];
+		if (b2Shape_IsSensor(old) == sensor) continue;
+
+		PhysMaterial material;
+		material.density = b2Shape_GetDensity(old);
+		material.friction = b2Shape_GetFriction(old);
+		material.restitution = b2Shape_GetRestitution(old);
+		material.sensor = sensor;
+		b2ShapeDef def = ShapeDef(material);
+
+		switch (b2Shape_GetType(old))
+		{
+		case b2_circleShape:
+		{
+			b2Circle circle = b2Shape_GetCircle(old);
+			b2CreateCircleShape(id, &def, &circle);
+		}
+		break;
+
+		case b2_polygonShape:
+		{
+			b2Polygon polygon = b2Shape_GetPolygon(old);
+			b2CreatePolygonShape(id, &def, &polygon);
+		}
+		break;
+
+		case b2_segmentShape:
+		{
+			b2Segment segment = b2Shape_GetSegment(old);
+			b2CreateSegmentShape(id, &def, &segment);
+		}
+		break;
+
+		default:
+			continue;
+		}
+
+		b2DestroyShape(old, true);
+	}
+}
+
+float PhysicsBackendBox2D3::GetRadius(PhysHandle body) const
+{
+	int count = GetShapes(body);
+	for (int i = 0; i < count; ++i)
+	{
+		if (b2Shape_GetType(shapes[i]) == b2_circleShape) return b2Shape_GetCircle(shapes[i]).radius;
+	}
+	return 0.0f;
+}
+
+bool PhysicsBackendBox2D3::TestPoint(PhysHandle body, vec2f point) const
+{
+	int count = GetShapes(body);
+	for (int i = 0; i < count; ++i)
+	{
+		if (b2Shape_TestPoint(shapes[i], ToB2(point))) return true;
+	}
+	return false;
+}
+
+bool PhysicsBackendBox2D3::RayCast(PhysHandle body, vec2f p1, vec2f p2, float& fraction, vec2f& normal) const
+{
+	b2RayCastInput input;
+	input.origin = ToB2(p1);
+	input.translation = b2Sub(ToB2(p2), input.origin);
+	input.maxFraction = 1.0f;
+
+	int count = GetShapes(body);
+	for (int i = 0; i < count; ++i)
+	{
+		b2CastOutput output = b2Shape_RayCast(shapes[i], &input);
+		if (output.hit)
+		{
+			fraction = output.fraction;
+			normal = FromB2(output.normal);
+			return true;
+		}
+	}
+	return false;
+}
+
+PhysHandle PhysicsBackendBox2D3::CreateRevoluteJoint(const PhysRevoluteDef& def)
+{
+	b2RevoluteJointDef joint = b2DefaultRevoluteJointDef();
+	joint.bodyIdA = ToBody(def.bodyA);
+	joint.bodyIdB = ToBody(def.bodyB);
+	joint.localAnchorA = ToB2(def.anchorA);
+	joint.localAnchorB = ToB2(def.anchorB);
+	joint.enableLimit = def.enableLimit;
+	joint.lowerAngle = def.lowerAngle;
+	joint.upperAngle = def.upperAngle;
+	joint.enableMotor = def.enableMotor;
+	joint.maxMotorTorque = def.maxMotorTorque;
+	joint.motorSpeed = def.motorSpeed;
+	return b2StoreJointId(b2CreateRevoluteJoint(world, &joint));
+}
+
+float PhysicsBackendBox2D3::GetJointAngle(PhysHandle joint) const
+{
+	return b2RevoluteJoint_GetAngle(ToJoint(joint));
+}
+
+float PhysicsBackendBox2D3::GetMotorSpeed(PhysHandle joint) const
+{
+	return b2RevoluteJoint_GetMotorSpeed(ToJoint(joint));
+}
+
+// Box2D 3 doesn't wake the bodies for a new motor speed, and a resting flipper sleeps
+void PhysicsBackendBox2D3::SetMotorSpeed(PhysHandle joint, float speed)
+{
+	b2RevoluteJoint_SetMotorSpeed(ToJoint(joint), speed);
+	b2Joint_WakeBodies(ToJoint(joint));
+}
+
+PhysHandle PhysicsBackendBox2D3::CreateMouseJoint(PhysHandle ground, PhysHandle body, vec2f target, float maxForce)
+{
+	b2MouseJointDef def = b2DefaultMouseJointDef();
+	def.bodyIdA = ToBody(ground);
+	def.bodyIdB = ToBody(body);
+	def.target = ToB2(target);
+	def.maxForce = maxForce;
+	def.hertz = 5.0f;
+	def.dampingRatio = 0.7f;
+	return b2StoreJointId(b2CreateMouseJoint(world, &def));
+}
+
+void PhysicsBackendBox2D3::SetMouseTarget(PhysHandle joint, vec2f target)
+{
+	b2MouseJoint_SetTarget(ToJoint(joint), ToB2(target));
+}
+
+void PhysicsBackendBox2D3::DestroyJoint(PhysHandle joint)
+{
+	if (joint && B2_IS_NON_NULL(world)) b2DestroyJoint(ToJoint(joint));
+}
+
+struct OverlapQuery
+{
+	PhysQueryFunction function;
+	void* context;
+};
+
+static bool OverlapCallback(b2ShapeId shape, void* context)
+{
+	OverlapQuery* query = (OverlapQuery*)context;
+	b2BodyId body = b2Shape_GetBody(shape);
+
+	PhysQueryHit hit;
+	hit.body = (PhysBody*)b2Body_GetUserData(body);
+	hit.shape = ShapeKind(shape);
+	hit.type = BodyType(body);
+	hit.sensor = b2Shape_IsSensor(shape);
+	hit.bullet = b2Body_IsBullet(body);
+	return query->function(query->context, hit);
+}
+
+void PhysicsBackendBox2D3::QueryAABB(vec2f lower, vec2f upper, PhysQueryFunction function, void* context) const
+{
+	OverlapQuery query = { function, context };
+
+	b2AABB aabb;
+	aabb.lowerBound = ToB2(lower);
+	aabb.upperBound = ToB2(upper);
+	b2World_OverlapAABB(world, aabb, b2DefaultQueryFilter(), &OverlapCallback, &query);
+}
+
+// Chains come back one segment at a time
+void PhysicsBackendBox2D3::VisitShapes(bool staticOnly, PhysShapeFunction function, void* context) const
+{
+	for (b2BodyId body : bodies)
+	{
+		if (staticOnly && b2Body_GetType(body) != b2_staticBody) continue;
+
+		b2Transform xf = b2Body_GetTransform(body);
+		int count = GetShapes(b2StoreBodyId(body));
+
+		for (int i = 0; i < count; ++i)
+		{
+			b2ShapeId shape = shapes[i];
+
+			PhysShapeView view = {};
+			view.kind = ShapeKind(shape);
+			view.type = BodyType(body);
+			view.sensor = b2Shape_IsSensor(shape);
+			view.body = (PhysBody*)b2Body_GetUserData(body);
+
+			switch (b2Shape_GetType(shape))
+			{
+			case b2_circleShape:
+			{
+				b2Circle circle = b2Shape_GetCircle(shape);
+				view.center = FromB2(b2TransformPoint(xf, circle.center));
+				view.radius = circle.radius;
+			}
+			break;
+
+			case b2_polygonShape:
+			{
+				b2Polygon polygon = b2Shape_GetPolygon(shape);
+				shapeVertices.resize(polygon.count, vec2f(0.0f, 0.0f));
+				for (int v = 0; v < polygon.count; ++v) shapeVertices[v] = FromB2(b2TransformPoint(xf, polygon.vertices[v]));
+				view.vertices = shapeVertices.data();
+				view.count = polygon.count;
+			}
+			break;
+
+			case b2_segmentShape:
+			{
+				b2Segment segment = b2Shape_GetSegment(shape);
+				shapeVertices.resize(2, vec2f(0.0f, 0.0f));
+				shapeVertices[0] = FromB2(b2TransformPoint(xf, segment.point1));
+				shapeVertices[1] = FromB2(b2TransformPoint(xf, segment.point2));
+				view.vertices = shapeVertices.data();
+				view.count = 2;
+			}
+			break;
+
+			default:
+				continue;
+			}
+
+			function(context, view);
+		}
+	}
+}
+
+#endif // PHYSICS_BOX2D_V3
@@ -0,0 +1,86 @@
+#include "Globals.h"
+#include "RollingHistogram.h"
+
+#include <string.h>
+
+RollingHistogram::RollingHistogram(float binWidth, int binCount) : binWidth(binWidth > 0.0f ? binWidth : 1.0f), binCount(binCount)
+{
+	if (this->binCount < 1 || this->binCount > ROLLING_MAX_BINS) this->binCount = ROLLING_MAX_BINS;
+	Reset();
+}
+
+void RollingHistogram::Reset()
+{
+	memset(samples, 0, sizeof(samples));
+	memset(bins, 0, sizeof(bins));
+	next = 0;
+	count = 0;
+	windowSum = 0.0;
+	runSum = 0.0;
+	runCount = 0;
+	runMax = 0.0f;
+}
+
+// Values past the last bin are counted in it
+int RollingHistogram::BinOf(float value) const
+{
+	int bin = (int)(value / binWidth);
+	return bin < 0 ? 0 : (bin >= binCount ? binCount - 1 : bin);
+}
+
+void RollingHistogram::Add(float value)
+{
+	if (count == ROLLING_WINDOW)
+	{
+		float oldest = samples[next];
+		bins[BinOf(oldest)]--;
+		windowSum -= oldest;
+	}
+	else
+	{
+		count++;
+	}
+
+	samples[next] = value;
+	next = (next + 1) % ROLLING_WINDOW;
+	bins[BinOf(value)]++;
+	windowSum += value;
+
+	runSum += value;
+	runCount++;
+	runMax = MAX(runMax, value);
+}
+
+float RollingHistogram::GetMax() const
+{
+	float maxValue = 0.0f;
+	for (uint32 i = 0; i < count; ++i)
+	{
+		maxValue = MAX(maxValue, samples[i]);
+	}
+	return maxValue;
+}
+
+float RollingHistogram::GetPercentile(float fraction) const
+{
+	if (count == 0) return 0.0f;
+
+	uint32 target = (uint32)(fraction * count);
+	uint32 seen = 0;
+	for (int i = 0; i < binCount; ++i)
+	{
+		seen += bins[i];
+		if (seen > target) return (i + 1) * binWidth;
+	}
+	return binCount * binWidth;
+}
+
+uint32 RollingHistogram::GetLargestBin() const
+{
+	uint32 largest = 0;
+	for (int i = 0; i < binCount; ++i)
+	{
+		largest = MAX(largest, bins[i]);
+	}
+	return largest;
+}
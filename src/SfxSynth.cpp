@@ -0,0 +1,164 @@
+#include "Globals.h"
+#include "SfxSynth.h"
+
+#include <math.h>
+
+#define SYNTH_PI			3.14159265f
+#define SYNTH_RELEASE		0.01f		// Seconds of fade at the end so nothing clicks
+
+// The whole effect set: name, wave, Hz, sweep, seconds, attack, decay, partials,
+// noise, noise decay, notes, note length, volume
+static const SfxPatch SFX_PATCHES[SFX_COUNT] = {
+	// Short low thump with a click on top
+	{ "flipper_hit", SYNTH_TRIANGLE, 190.0f, 0.55f, 0.14f, 0.002f, 28.0f,
+		{ { 1.0f, 1.0f }, { 2.0f, 0.35f } }, 0.55f, 110.0f, 0, {}, 0.0f, 0.8f },
+
+	// Inharmonic bell pop
+	{ "bumper_hit", SYNTH_SINE, 620.0f, 0.97f, 0.40f, 0.001f, 11.0f,
+		{ { 1.0f, 1.0f }, { 2.76f, 0.5f }, { 5.40f, 0.25f }, { 8.93f, 0.12f } }, 0.25f, 180.0f, 0, {}, 0.0f, 0.85f },
+
+	// Long detuned fall
+	{ "ball_lost", SYNTH_SAW, 440.0f, 0.25f, 1.40f, 0.01f, 1.6f,
+		{ { 1.0f, 1.0f }, { 1.012f, 0.7f }, { 0.5f, 0.4f } }, 0.0f, 0.0f, 0, {}, 0.0f, 0.7f },
+
+	// Major arpeggio blip, played at many pitches by the variant bank
+	{ "bonus", SYNTH_SQUARE, 880.0f, 1.0f, 0.30f, 0.002f, 7.0f,
+		{ { 1.0f, 1.0f } }, 0.0f, 0.0f, 4, { 0.0f, 4.0f, 7.0f, 12.0f }, 0.06f, 0.45f },
+
+	// Fanfare
+	{ "combo_complete", SYNTH_TRIANGLE, 523.25f, 1.0f, 1.10f, 0.004f, 2.2f,
+		{ { 1.0f, 1.0f }, { 2.0f, 0.3f }, { 3.0f, 0.12f } }, 0.0f, 0.0f, 7, { 0.0f, 4.0f, 7.0f, 12.0f, 16.0f, 19.0f, 24.0f }, 0.09f, 0.8f },
+
+	// Rising whoosh for the plunger
+	{ "launch", SYNTH_SINE, 110.0f, 3.5f, 0.35f, 0.03f, 5.0f,
+		{ { 1.0f, 1.0f }, { 2.0f, 0.2f } }, 0.6f, 9.0f, 0, {}, 0.0f, 0.7f },
+
+	// Bright blip
+	{ "target_hit", SYNTH_SINE, 1200.0f, 1.0f, 0.12f, 0.001f, 30.0f,
+		{ { 1.0f, 1.0f }, { 3.0f, 0.2f } }, 0.1f, 300.0f, 0, {}, 0.0f, 0.7f },
+
+	// Fifth and octave jump
+	{ "special_hit", SYNTH_SQUARE, 1320.0f, 1.0f, 0.24f, 0.002f, 9.0f,
+		{ { 1.0f, 1.0f } }, 0.0f, 0.0f, 3, { 0.0f, 7.0f, 12.0f }, 0.07f, 0.4f },
+
+	// Chime
+	{ "letter_collect", SYNTH_SINE, 1568.0f, 1.0f, 0.30f, 0.001f, 9.0f,
+		{ { 1.0f, 1.0f }, { 2.0f, 0.4f }, { 4.0f, 0.15f } }, 0.0f, 0.0f, 2, { 0.0f, 12.0f }, 0.08f, 0.6f }
+};
+
+const SfxPatch& GetSfxPatch(int id)
+{
+	return SFX_PATCHES[(id >= 0 && id < SFX_COUNT) ? id : 0];
+}
+
+// xorshift32, never seeded with 0
+static uint32 NextRandom(uint32& state)
+{
+	state ^= state << 13;
+	state ^= state >> 17;
+	state ^= state << 5;
+	return state;
+}
+
+// -1 to 1
+static float RandomSigned(uint32& state)
+{
+	return (float)(NextRandom(state) & 0xFFFFFF) / (float)0x800000 - 1.0f;
+}
+
+static float Oscillator(SynthWave wave, float phase)
+{
+	switch (wave)
+	{
+	case SYNTH_TRIANGLE: return 4.0f * fabsf(phase - 0.5f) - 1.0f;
+	case SYNTH_SQUARE: return phase < 0.5f ? 1.0f : -1.0f;
+	case SYNTH_SAW: return 2.0f * phase - 1.0f;
+	default: return sinf(2.0f * SYNTH_PI * phase);
+	}
+}
+
+SfxPatch VarySfxPatch(const SfxPatch& patch, uint32 seed, float amount)
+{
+	SfxPatch varied = patch;
+	uint32 state = seed * 2654435761u + 1;
+
+	// Up to about a semitone of pitch and +-25% decay at amount 1
+	varied.frequency *= powf(2.0f, RandomSigned(state) * amount / 12.0f);
+	varied.decay *= 1.0f + RandomSigned(state) * amount * 0.25f;
+	varied.noise = MAX(0.0f, patch.noise * (1.0f + RandomSigned(state) * amount * 0.5f));
+
+	// The fundamental stays put, upper partials detune and change level
+	for (int i = 1; i < SYNTH_MAX_PARTIALS && varied.partials[i].ratio > 0.0f; ++i)
+	{
+		varied.partials[i].ratio *= 1.0f + RandomSigned(state) * amount * 0.04f;
+		varied.partials[i].gain = MAX(0.0f, varied.partials[i].gain * (1.0f + RandomSigned(state) * amount * 0.6f));
+	}
+
+	return varied;
+}
+
+Wave SynthesizeSfx(const SfxPatch& patch, uint32 seed)
+{
+	Wave wave = { 0 };
+	uint32 frames = (uint32)(patch.duration * SYNTH_SAMPLE_RATE);
+	if (frames == 0) return wave;
+
+	float* data = (float*)RL_MALLOC(frames * sizeof(float));
+	if (data == nullptr) return wave;
+
+	uint32 state = seed * 2246822519u + 0x9E3779B9u;
+	if (state == 0) state = 1;
+
+	float phases[SYNTH_MAX_PARTIALS] = {};
+	float peak = 0.0f;
+	int noteCount = MAX(patch.noteCount, 1);
+
+	for (uint32 i = 0; i < frames; ++i)
+	{
+		float t = (float)i / SYNTH_SAMPLE_RATE;
+
+		// Current arpeggio step and the time since it started
+		int note = patch.noteLength > 0.0f ? MIN((int)(t / patch.noteLength), noteCount - 1) : 0;
+		float noteTime = t - note * patch.noteLength;
+		float semitones = patch.noteCount > 0 ? patch.notes[note] : 0.0f;
+
+		float frequency = patch.frequency * powf(2.0f, semitones / 12.0f) * powf(patch.sweep, t / patch.duration);
+
+		float tone = 0.0f;
+		for (int p = 0; p < SYNTH_MAX_PARTIALS && patch.partials[p].ratio > 0.0f; ++p)
+		{
+			tone += Oscillator(patch.wave, phases[p]) * patch.partials[p].gain;
+			phases[p] += frequency * patch.partials[p].ratio / SYNTH_SAMPLE_RATE;
+			phases[p] -= floorf(phases[p]);
+		}
+
+		float envelope = expf(-patch.decay * noteTime);
+		if (noteTime < patch.attack) envelope *= noteTime / patch.attack;
+
+		float sample = tone * envelope;
+		if (patch.noise > 0.0f)
+		{
+			sample += RandomSigned(state) * patch.noise * expf(-patch.noiseDecay * t);
+		}
+
+		// Short fade at the tail
+		float left = patch.duration - t;
+		if (left < SYNTH_RELEASE) sample *= left / SYNTH_RELEASE;
+
+		data[i] = sample;
+		peak = MAX(peak, fabsf(sample));
+	}
+
+	float gain = peak > 0.0f ? patch.volume / peak : 0.0f;
+	for (uint32 i = 0; i < frames; ++i)
+	{
+		data[i] *= gain;
+	}
+
+	wave.frameCount = frames;
+	wave.sampleRate = SYNTH_SAMPLE_RATE;
+	wave.sampleSize = 32;
+	wave.channels = 1;
+	wave.data = data;
+	return wave;
+}
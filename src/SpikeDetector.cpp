@@ -0,0 +1,197 @@
+#include "Globals.h"
+#include "SpikeDetector.h"
+#include "Timer.h"
+#include "Trace.h"
+
+#include <algorithm>
+#include <stdio.h>
+#include <string.h>
+
+#define SPIKE_NESTED_PREFERENCE		0.75f	// A nested section is blamed if it explains this much of its parent
+
+SpikeDetector::SpikeDetector()
+{
+	memset(names, 0, sizeof(names));
+	memset(nested, 0, sizeof(nested));
+
+	AddSection("Physics step", true);
+	AddSection("Events");
+	AddSection("Untracked");
+}
+
+void SpikeDetector::Enable(float budget)
+{
+	enabled = true;
+	budgetMs = budget > 0.0f ? budget : SPIKE_DEFAULT_BUDGET_MS;
+	LOG("Frame spike detector enabled, budget %.1f ms", budgetMs);
+}
+
+int SpikeDetector::AddSection(const char* name, bool isNested)
+{
+	if (sectionCount >= SPIKE_MAX_SECTIONS) return -1;
+
+	strncpy(names[sectionCount], name, sizeof(names[sectionCount]) - 1);
+	nested[sectionCount] = isNested;
+	return sectionCount++;
+}
+
+bool SpikeDetector::BeginFrame(uint32 frame)
+{
+	if (!enabled) return false;
+
+	double now = GetPerfTime();
+	bool spike = frameStart > 0.0 && CloseFrame(now);
+
+	current = SpikeFrame();
+	current.frame = frame;
+	frameStart = now;
+	return spike;
+}
+
+void SpikeDetector::AddTime(int section, float ms)
+{
+	if (section >= 0 && section < SPIKE_MAX_SECTIONS) current.sectionMs[section] += ms;
+}
+
+float SpikeDetector::Median(int section) const
+{
+	float values[SPIKE_HISTORY_FRAMES];
+	int count = (int)MIN(recorded, (uint32)SPIKE_HISTORY_FRAMES);
+	if (count == 0) return 0.0f;
+
+	for (int i = 0; i < count; ++i)
+	{
+		values[i] = history[i].sectionMs[section];
+	}
+
+	std::nth_element(values, values + count / 2, values + count);
+	return values[count / 2];
+}
+
+bool SpikeDetector::CloseFrame(double now)
+{
+	current.totalMs = (float)((now - frameStart) * 1000.0);
+
+	float tracked = 0.0f;
+	for (int s = 0; s < sectionCount; ++s)
+	{
+		if (!nested[s] && s != SPIKE_SECTION_UNTRACKED) tracked += current.sectionMs[s];
+	}
+	current.sectionMs[SPIKE_SECTION_UNTRACKED] = MAX(current.totalMs - tracked, 0.0f);
+
+	bool spike = current.totalMs > budgetMs && current.frame >= SPIKE_WARMUP_FRAMES;
+	if (spike)
+	{
+		spikes++;
+
+		// Blame whatever grew the most over its usual cost, not whatever is usually big
+		float typical[SPIKE_MAX_SECTIONS];
+		int cause = -1;
+		float worst = 0.0f;
+		for (int s = 0; s < sectionCount; ++s)
+		{
+			typical[s] = Median(s);
+			float excess = current.sectionMs[s] - typical[s];
+			if (excess > worst)
+			{
+				worst = excess;
+				cause = s;
+			}
+		}
+
+		for (int s = 0; s < sectionCount && cause >= 0; ++s)
+		{
+			if (nested[s] && s != cause && current.sectionMs[s] - typical[s] >= worst * SPIKE_NESTED_PREFERENCE)
+			{
+				cause = s;
+				break;
+			}
+		}
+
+		lastSpike = current;
+		lastCause = cause;
+
+		LOG("Frame spike: frame %u took %.2f ms (budget %.1f), most likely %s: %.2f ms, typically %.2f ms",
+			current.frame, current.totalMs, budgetMs, GetSectionName(cause),
+			cause >= 0 ? current.sectionMs[cause] : 0.0f, cause >= 0 ? typical[cause] : 0.0f);
+		TRACE_INSTANT("Frame spike");
+
+		if (reports < SPIKE_MAX_REPORTS && (reports == 0 || current.frame - lastReportFrame >= SPIKE_COOLDOWN_FRAMES))
+		{
+			WriteReport(current, cause, typical);
+		}
+	}
+
+	history[recorded & (SPIKE_HISTORY_FRAMES - 1)] = current;
+	recorded++;
+	return spike;
+}
+
+void SpikeDetector::WriteReport(const SpikeFrame& spike, int cause, const float* typical)
+{
+	char path[64];
+	snprintf(path, sizeof(path), "spike_%u.txt", spike.frame);
+
+	FILE* file = fopen(path, "w");
+	if (file == nullptr)
+	{
+		LOG("ERROR: Cannot write spike report %s", path);
+		return;
+	}
+
+	reports++;
+	lastReportFrame = spike.frame;
+
+	// The spike goes last, after the frames that led to it
+	const SpikeFrame* frames[SPIKE_CONTEXT_FRAMES + 1];
+	int context = (int)MIN(recorded, (uint32)SPIKE_CONTEXT_FRAMES);
+	for (int i = 0; i < context; ++i)
+	{
+		frames[i] = &history[(recorded - context + i) & (SPIKE_HISTORY_FRAMES - 1)];
+	}
+	frames[context] = &spike;
+	int count = context + 1;
+
+	fprintf(file, "Frame %u took %.2f ms, budget %.1f ms\n", spike.frame, spike.totalMs, budgetMs);
+	if (cause >= 0)
+	{
+		fprintf(file, "Most likely cause: %s, %.2f ms against a median of %.2f ms (+%.2f ms)\n",
+			names[cause], spike.sectionMs[cause], typical[cause], spike.sectionMs[cause] - typical[cause]);
+	}
+	fprintf(file, "Median over the last %u frames in the first column, times in ms\n\n", MIN(recorded, (uint32)SPIKE_HISTORY_FRAMES));
+
+	fprintf(file, "%-24s %8s", "", "median");
+	for (int i = 0; i < count; ++i) fprintf(file, " %9u%s", frames[i]->frame, i == count - 1 ? "*" : " ");
+	fprintf(file, "\n%-24s %8s", "Frame", "");
+	for (int i = 0; i < count; ++i) fprintf(file, " %9.2f ", frames[i]->totalMs);
+	fprintf(file, "\n");
+
+	for (int s = 0; s < sectionCount; ++s)
+	{
+		fprintf(file, "%s%-22s %8.2f", s == cause ? "> " : "  ", names[s], typical[s]);
+		for (int i = 0; i < count; ++i) fprintf(file, " %9.2f ", frames[i]->sectionMs[s]);
+		fprintf(file, "\n");
+	}
+
+	fprintf(file, "%-24s %8s", "Contacts", "");
+	for (int i = 0; i < count; ++i) fprintf(file, " %9d ", frames[i]->contacts);
+	fprintf(file, "\n%-24s %8s", "Allocations", "");
+	for (int i = 0; i < count; ++i) fprintf(file, " %9u ", frames[i]->allocations);
+	fprintf(file, "\n%-24s %8s", "Allocated bytes", "");
+	for (int i = 0; i < count; ++i) fprintf(file, " %9u ", frames[i]->allocatedBytes);
+	fprintf(file, "\n");
+
+	fclose(file);
+	LOG("Spike report written to %s", path);
+}
+
+SpikeScope::SpikeScope(SpikeDetector* detector, int section) : detector(detector), section(section), start(0.0)
+{
+	if (detector != nullptr && detector->IsEnabled()) start = GetPerfTime();
+	else this->detector = nullptr;
+}
+
+SpikeScope::~SpikeScope()
+{
+	if (detector != nullptr) detector->AddTime(section, (float)((GetPerfTime() - start) * 1000.0));
+}
@@ -7,6 +7,8 @@
 
 #include "raylib.h"
 
+#include <chrono>
+
 Timer::Timer()
 {
 	Start();
@@ -20,4 +22,10 @@ void Timer::Start()
 double Timer::ReadSec() const
 {
 	return (GetTime() - started_at);
+}
+
+double GetPerfTime()
+{
+	static const std::chrono::steady_clock::time_point origin = std::chrono::steady_clock::now();
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - origin).count();
 }
\ No newline at end of file
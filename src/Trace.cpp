@@ -0,0 +1,206 @@
+#include "Globals.h"
+#include "Trace.h"
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <stdio.h>
+#include <vector>
+
+enum TracePhase
+{
+	TRACE_PHASE_COMPLETE = 0,
+	TRACE_PHASE_INSTANT,
+	TRACE_PHASE_COUNTER
+};
+
+struct TraceEvent
+{
+	const char* name;
+	const char* category;
+	uint64 start;
+	uint64 end;
+	double value;
+	int phase;
+};
+
+// Written only by its own thread. The flusher reads behind the write index and
+// throws away whatever the writer may have lapped while it was copying
+struct TraceBuffer
+{
+	TraceEvent events[TRACE_EVENTS_PER_THREAD];
+	std::atomic<uint64> written{ 0 };
+	std::atomic<const char*> name{ nullptr };
+	int tid = 0;
+};
+
+// Buffers live until the process exits so threads that already finished still get flushed
+static TraceBuffer* buffers[TRACE_MAX_THREADS];
+static std::atomic<int> bufferCount{ 0 };
+static std::mutex registerMutex;
+static std::mutex flushMutex;
+
+static thread_local TraceBuffer* localBuffer = nullptr;
+static thread_local bool localFull = false;
+
+static const std::chrono::steady_clock::time_point traceOrigin = std::chrono::steady_clock::now();
+
+static TraceBuffer* GetBuffer()
+{
+	if (localBuffer != nullptr || localFull)
+		return localBuffer;
+
+	std::lock_guard<std::mutex> lock(registerMutex);
+	int count = bufferCount.load(std::memory_order_relaxed);
+	if (count >= TRACE_MAX_THREADS)
+	{
+		localFull = true;
+		return nullptr;
+	}
+
+	localBuffer = new TraceBuffer();
+	localBuffer->tid = count + 1;
+	buffers[count] = localBuffer;
+	bufferCount.store(count + 1, std::memory_order_release);
+	return localBuffer;
+}
+
+static void Push(const char* name, const char* category, uint64 start, uint64 end, double value, int phase)
+{
+	TraceBuffer* buffer = GetBuffer();
+	if (buffer == nullptr) return;
+
+	uint64 index = buffer->written.load(std::memory_order_relaxed);
+	TraceEvent& event = buffer->events[index & (TRACE_EVENTS_PER_THREAD - 1)];
+	event.name = name;
+	event.category = category;
+	event.start = start;
+	event.end = end;
+	event.value = value;
+	event.phase = phase;
+	buffer->written.store(index + 1, std::memory_order_release);
+}
+
+uint64 Trace::Now()
+{
+	return (uint64)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - traceOrigin).count();
+}
+
+void Trace::Complete(const char* name, const char* category, uint64 start, uint64 end)
+{
+	Push(name, category, start, end, 0.0, TRACE_PHASE_COMPLETE);
+}
+
+void Trace::Instant(const char* name, const char* category)
+{
+	uint64 now = Now();
+	Push(name, category, now, now, 0.0, TRACE_PHASE_INSTANT);
+}
+
+void Trace::Counter(const char* name, double value)
+{
+	uint64 now = Now();
+	Push(name, "counter", now, now, value, TRACE_PHASE_COUNTER);
+}
+
+void Trace::SetThreadName(const char* name)
+{
+	TraceBuffer* buffer = GetBuffer();
+	if (buffer != nullptr) buffer->name.store(name, std::memory_order_relaxed);
+}
+
+static void WriteString(FILE* file, const char* text)
+{
+	fputc('"', file);
+	for (const char* c = text ? text : ""; *c; ++c)
+	{
+		if (*c == '"' || *c == '\\') fputc('\\', file);
+		if ((unsigned char)*c >= 0x20) fputc(*c, file);
+	}
+	fputc('"', file);
+}
+
+bool Trace::Flush(const char* path)
+{
+	std::lock_guard<std::mutex> lock(flushMutex);
+
+	FILE* file = fopen(path, "w");
+	if (file == nullptr)
+	{
+		LOG("ERROR: Cannot write trace %s", path);
+		return false;
+	}
+
+	std::vector<TraceEvent> events;
+	uint64 total = 0;
+	uint64 lost = 0;
+	bool first = true;
+
+	fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+
+	int count = bufferCount.load(std::memory_order_acquire);
+	for (int b = 0; b < count; ++b)
+	{
+		TraceBuffer* buffer = buffers[b];
+
+		uint64 end = buffer->written.load(std::memory_order_acquire);
+		uint64 begin = end > TRACE_EVENTS_PER_THREAD ? end - TRACE_EVENTS_PER_THREAD : 0;
+
+		events.clear();
+		for (uint64 i = begin; i < end; ++i)
+		{
+			events.push_back(buffer->events[i & (TRACE_EVENTS_PER_THREAD - 1)]);
+		}
+
+		// Anything the writer lapped during the copy may be torn
+		uint64 after = buffer->written.load(std::memory_order_acquire);
+		uint64 safe = after > TRACE_EVENTS_PER_THREAD ? after - TRACE_EVENTS_PER_THREAD : 0;
+		size_t skip = safe > begin ? (size_t)MIN(safe - begin, (uint64)events.size()) : 0;
+		lost += begin + skip;
+
+		const char* name = buffer->name.load(std::memory_order_relaxed);
+		fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":", first ? "" : ",\n", buffer->tid);
+		if (name != nullptr) WriteString(file, name);
+		else fprintf(file, "\"Thread %d\"", buffer->tid);
+		fprintf(file, "}}");
+		first = false;
+
+		for (size_t i = skip; i < events.size(); ++i)
+		{
+			const TraceEvent& event = events[i];
+			double ts = event.start / 1000.0;
+
+			fprintf(file, ",\n{\"name\":");
+			WriteString(file, event.name);
+
+			switch (event.phase)
+			{
+			case TRACE_PHASE_COMPLETE:
+				fprintf(file, ",\"cat\":");
+				WriteString(file, event.category);
+				fprintf(file, ",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f", ts, (event.end - event.start) / 1000.0);
+				break;
+
+			case TRACE_PHASE_INSTANT:
+				fprintf(file, ",\"cat\":");
+				WriteString(file, event.category);
+				fprintf(file, ",\"ph\":\"i\",\"s\":\"t\",\"ts\":%.3f", ts);
+				break;
+
+			default:
+				fprintf(file, ",\"ph\":\"C\",\"ts\":%.3f,\"args\":{\"value\":%g}", ts, event.value);
+				break;
+			}
+
+			fprintf(file, ",\"pid\":1,\"tid\":%d}", buffer->tid);
+			total++;
+		}
+	}
+
+	fprintf(file, "\n]}\n");
+	fclose(file);
+
+	LOG("Trace written to %s: %llu events from %d threads, %llu older events overwritten",
+		path, (unsigned long long)total, count, (unsigned long long)lost);
+	return true;
+}
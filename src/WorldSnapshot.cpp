@@ -0,0 +1,77 @@
+#include "Globals.h"
+#include "WorldSnapshot.h"
+
+#include <stdio.h>
+#include <string.h>
+
+const BodySnapshot* WorldSnapshot::FindBody(uint32 id) const
+{
+	int low = 0;
+	int high = bodyCount - 1;
+	while (low <= high)
+	{
+		int mid = (low + high) / 2;
+		if (bodies[mid].id == id) return &bodies[mid];
+		if (bodies[mid].id < id) low = mid + 1;
+		else high = mid - 1;
+	}
+	return nullptr;
+}
+
+bool WorldSnapshot::Save(const char* path) const
+{
+	if (!valid) return false;
+
+	FILE* file = fopen(path, "wb");
+	if (file == nullptr)
+	{
+		LOG("ERROR: Cannot open %s to save the world", path);
+		return false;
+	}
+
+	WorldSnapshotHeader header;
+	memcpy(header.magic, "PBWS", 4);
+	header.version = WORLD_SNAPSHOT_VERSION;
+	header.size = sizeof(WorldSnapshot);
+	header.frame = frame;
+
+	bool ok = fwrite(&header, sizeof(header), 1, file) == 1 && fwrite(this, sizeof(WorldSnapshot), 1, file) == 1;
+	fclose(file);
+
+	if (!ok) LOG("ERROR: Cannot write the world to %s", path);
+	return ok;
+}
+
+bool WorldSnapshot::Load(const char* path)
+{
+	FILE* file = fopen(path, "rb");
+	if (file == nullptr)
+	{
+		LOG("ERROR: Cannot open world snapshot %s", path);
+		return false;
+	}
+
+	WorldSnapshotHeader header;
+	bool ok = fread(&header, sizeof(header), 1, file) == 1
+		&& memcmp(header.magic, "PBWS", 4) == 0
+		&& header.version == WORLD_SNAPSHOT_VERSION
+		&& header.size == sizeof(WorldSnapshot);
+
+	// Read aside, so a short file leaves this one as it was
+	WorldSnapshot loaded;
+	ok = ok && fread(&loaded, sizeof(WorldSnapshot), 1, file) == 1;
+	fclose(file);
+
+	if (!ok || !loaded.valid
+		|| loaded.bodyCount < 0 || loaded.bodyCount > WORLD_SNAPSHOT_MAX_BODIES
+		|| loaded.jointCount < 0 || loaded.jointCount > WORLD_SNAPSHOT_MAX_JOINTS
+		|| loaded.letterCount < 0 || loaded.letterCount > WORLD_SNAPSHOT_MAX_LETTERS
+		|| loaded.targetCount < 0 || loaded.targetCount > WORLD_SNAPSHOT_MAX_TARGETS)
+	{
+		LOG("ERROR: %s is not a world snapshot from this build", path);
+		return false;
+	}
+
+	*this = loaded;
+	return true;
+}
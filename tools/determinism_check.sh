@@ -0,0 +1,38 @@
+#!/bin/sh
+# Renders the same input script twice to WAV and fails unless the files are identical.
+# --script and --audio-wav run on a fixed step with a fixed random seed, so any
+# difference means something in the simulation still reads the wall clock.
+#
+#   tools/determinism_check.sh <game binary> <input script> [extra game arguments]
+#
+# Run from the folder the game is normally started in (it loads its assets from there)
+
+if [ $# -lt 2 ]; then
+	echo "usage: $0 <game binary> <input script> [extra game arguments]"
+	exit 2
+fi
+
+game="$1"
+script="$2"
+shift 2
+
+out="${TMPDIR:-/tmp}/determinism_$$"
+mkdir -p "$out" || exit 2
+
+for run in 1 2; do
+	if ! "$game" --script "$script" --audio-wav "$out/run$run.wav" --flight-recorder "$out/flight$run.bin" "$@" > "$out/run$run.log" 2>&1; then
+		echo "run $run failed, see $out/run$run.log"
+		exit 1
+	fi
+done
+
+if cmp -s "$out/run1.wav" "$out/run2.wav"; then
+	echo "deterministic: $(wc -c < "$out/run1.wav") bytes identical in both runs"
+	rm -rf "$out"
+	exit 0
+fi
+
+echo "NOT deterministic, first difference:"
+cmp "$out/run1.wav" "$out/run2.wav"
+echo "outputs kept in $out"
+exit 1
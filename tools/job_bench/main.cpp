@@ -0,0 +1,121 @@
+// Measures the job system: per-job overhead, fork-join latency and how a
+// data-parallel sweep scales with the number of workers.
+//
+//   job_bench [--max-workers n] [--size elements]
+//
+// Run it on the target machine; results on a laptop say little about a cabinet.
+
+#include "JobSystem.h"
+
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+#define EMPTY_JOBS			200000
+#define EMPTY_JOB_CHUNK		512		// Well under JOB_QUEUE_SIZE, so nothing runs inline
+#define FORK_JOIN_ROUNDS	20000
+#define SWEEP_BATCH			16384
+#define SWEEP_ROUNDS		10
+
+static double NowMs()
+{
+	using namespace std::chrono;
+	return duration<double, std::milli>(steady_clock::now().time_since_epoch()).count();
+}
+
+static void EmptyJob(void*)
+{
+}
+
+static void EmptyBatch(void*, int, int)
+{
+}
+
+struct Sweep
+{
+	const float* input;
+	float* output;
+};
+
+// Enough arithmetic per element that memory bandwidth isn't the only thing measured
+static void SweepBatch(void* data, int begin, int end)
+{
+	Sweep* sweep = (Sweep*)data;
+	for (int i = begin; i < end; ++i)
+	{
+		float x = sweep->input[i];
+		float y = x;
+		for (int k = 0; k < 8; ++k) y = sinf(y) * 0.5f + sqrtf(x + k);
+		sweep->output[i] = y;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	int maxWorkers = MAX((int)std::thread::hardware_concurrency() - 1, 1);
+	int size = 1 << 22;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		if (strcmp(argv[i], "--max-workers") == 0 && i + 1 < argc) maxWorkers = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--size") == 0 && i + 1 < argc) size = atoi(argv[++i]);
+	}
+	maxWorkers = MIN(MAX(maxWorkers, 0), MAX_JOB_WORKERS);
+
+	// 0, 1, 2, 4... and the full count
+	std::vector<int> workerCounts;
+	for (int n = 0; n < maxWorkers; n = n == 0 ? 1 : n * 2) workerCounts.push_back(n);
+	workerCounts.push_back(maxWorkers);
+
+	std::vector<float> input(size);
+	std::vector<float> output(size);
+	for (int i = 0; i < size; ++i) input[i] = (float)(i % 1000) * 0.01f;
+	Sweep sweep = { input.data(), output.data() };
+
+	printf("%d hardware threads, sweep of %d elements in batches of %d\n\n", (int)std::thread::hardware_concurrency(), size, SWEEP_BATCH);
+	printf("workers   ns/job   us/fork-join   sweep ms   speedup   steals\n");
+
+	double baseline = 0.0;
+	for (int workers : workerCounts)
+	{
+		JobSystem jobs;
+		jobs.Start(workers);
+
+		// Submit and join empty jobs from the main thread
+		double start = NowMs();
+		for (int done = 0; done < EMPTY_JOBS; done += EMPTY_JOB_CHUNK)
+		{
+			JobFence fence;
+			for (int i = 0; i < EMPTY_JOB_CHUNK; ++i) jobs.Run(&EmptyJob, nullptr, &fence);
+			jobs.Wait(&fence);
+		}
+		double nsPerJob = (NowMs() - start) * 1e6 / EMPTY_JOBS;
+
+		// One tiny batch per thread, the cost of waking everyone and waiting for them
+		start = NowMs();
+		for (int i = 0; i < FORK_JOIN_ROUNDS; ++i) jobs.ParallelFor(workers + 1, 1, &EmptyBatch, nullptr);
+		double usPerForkJoin = (NowMs() - start) * 1e3 / FORK_JOIN_ROUNDS;
+
+		uint64 stealsBefore = jobs.GetSteals();
+		start = NowMs();
+		for (int i = 0; i < SWEEP_ROUNDS; ++i) jobs.ParallelFor(size, SWEEP_BATCH, &SweepBatch, &sweep);
+		double sweepMs = (NowMs() - start) / SWEEP_ROUNDS;
+		if (workers == 0) baseline = sweepMs;
+
+		printf("%7d %8.1f %14.2f %10.2f %8.2fx %8llu\n", workers, nsPerJob, usPerForkJoin, sweepMs,
+			sweepMs > 0.0 ? baseline / sweepMs : 0.0, (unsigned long long)(jobs.GetSteals() - stealsBefore));
+
+		jobs.Stop();
+	}
+
+	// Keeps the sweep from being optimised away
+	double checksum = 0.0;
+	for (int i = 0; i < size; i += 4096) checksum += output[i];
+	printf("\nchecksum %.3f\n", checksum);
+
+	return 0;
+}
@@ -0,0 +1,108 @@
+// Prints the live metrics a running game publishes with --metrics-shm.
+//
+//   metrics_reader [name] [--interval ms] [--once]
+//
+// Attaches read-only, so it can't disturb the game whatever it does.
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include "LiveMetrics.h"
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+
+static const char* STATE_NAMES[] = { "MENU", "PLAYING", "PAUSED", "GAME_OVER", "YOU_WIN" };
+
+static const LiveMetricsSegment* Attach(const char* segmentName)
+{
+	char name[80];
+
+#ifdef _WIN32
+	snprintf(name, sizeof(name), "Local\\%s", segmentName);
+	HANDLE handle = OpenFileMappingA(FILE_MAP_READ, FALSE, name);
+	if (handle == NULL) return nullptr;
+
+	// The view keeps the mapping alive, the handle isn't needed any more
+	void* memory = MapViewOfFile(handle, FILE_MAP_READ, 0, 0, sizeof(LiveMetricsSegment));
+	CloseHandle(handle);
+	return (const LiveMetricsSegment*)memory;
+#else
+	snprintf(name, sizeof(name), "/%s", segmentName);
+	int fd = shm_open(name, O_RDONLY, 0);
+	if (fd < 0) return nullptr;
+
+	void* memory = mmap(nullptr, sizeof(LiveMetricsSegment), PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	return memory == MAP_FAILED ? nullptr : (const LiveMetricsSegment*)memory;
+#endif
+}
+
+int main(int argc, char** argv)
+{
+	const char* name = LIVE_METRICS_DEFAULT_NAME;
+	int intervalMs = 250;
+	bool once = false;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		if (strcmp(argv[i], "--once") == 0) once = true;
+		else if (strcmp(argv[i], "--interval") == 0 && i + 1 < argc) intervalMs = atoi(argv[++i]);
+		else name = argv[i];
+	}
+
+	const LiveMetricsSegment* segment = Attach(name);
+	if (segment == nullptr)
+	{
+		fprintf(stderr, "No metrics segment '%s'. Is the game running with --metrics-shm?\n", name);
+		return 1;
+	}
+
+	if (segment->magic != LIVE_METRICS_MAGIC || segment->version != LIVE_METRICS_VERSION || segment->size != sizeof(LiveMetricsSegment))
+	{
+		fprintf(stderr, "Metrics segment '%s' has an unknown layout (version %u, %u bytes)\n", name, segment->version, segment->size);
+		return 1;
+	}
+
+	uint64_t lastFrame = 0;
+	int staleSamples = 0;
+
+	while (true)
+	{
+		LiveMetrics metrics;
+		if (segment->magic != LIVE_METRICS_MAGIC)
+		{
+			printf("Game closed the segment\n");
+			return 0;
+		}
+
+		if (!ReadLiveMetrics(segment, &metrics))
+		{
+			printf("(busy)\n");
+		}
+		else
+		{
+			staleSamples = metrics.frame == lastFrame ? staleSamples + 1 : 0;
+			lastFrame = metrics.frame;
+
+			const char* state = (metrics.gameState >= 0 && metrics.gameState < 5) ? STATE_NAMES[metrics.gameState] : "?";
+			printf("frame %llu  %6.2f ms  update %5.2f ms  step %5.2f ms x%d  bodies %d  contacts %d (+%d)  voices %d/%d  %s  score %d  balls %d%s\n",
+				(unsigned long long)metrics.frame, metrics.frameMs, metrics.updateMs, metrics.physicsStepMs, metrics.physicsSubsteps,
+				metrics.bodies, metrics.contacts, metrics.contactsBegun, metrics.activeVoices, metrics.voiceCount,
+				state, metrics.score, metrics.ballsLeft, staleSamples >= 4 ? "  (not updating)" : "");
+		}
+		fflush(stdout);
+
+		if (once) return 0;
+		std::this_thread::sleep_for(std::chrono::milliseconds(intervalMs));
+	}
+}
@@ -0,0 +1,191 @@
+// Measures the physics backend compiled in (premake5 --physics=...) on a headless
+// arena: a closed wall loop, a field of bumpers and N bullet balls thrown about.
+// The arena gets taller with N so every ball starts inside the walls.
+//
+//   physics_bench [--workers n] [--steps n] [--worlds k]
+//
+// --worlds runs k independent arenas side by side, one job each, the way a batch
+// of AI lookaheads would; each world then steps single-threaded.
+
+#include "JobSystem.h"
+#include "PhysicsBackend.h"
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+#define ARENA_WIDTH			14.4f		// m, the table is 720 x 1000 px
+#define ARENA_HEIGHT		20.0f		// Raised when the balls need more room
+#define BALL_RADIUS			0.3f
+#define BALL_SPACING		(BALL_RADIUS * 2.5f)
+#define BALL_FIRST_ROW		13.0f		// Above the top bumper row
+#define BUMPER_RADIUS		0.5f
+#define WARMUP_STEPS		60
+#define STEP_DT				(1.0f / 60.0f)
+
+static const int BALL_COUNTS[] = { 1, 16, 64, 256, 1024 };
+
+static double NowMs()
+{
+	using namespace std::chrono;
+	return duration<double, std::milli>(steady_clock::now().time_since_epoch()).count();
+}
+
+// Same seed for every backend, so runs compare the same scene
+static float Random(uint32& seed)
+{
+	seed = seed * 1664525u + 1013904223u;
+	return (float)(seed >> 8) / (float)(1 << 24);
+}
+
+// Balls per row, and the arena height that keeps every row under the roof
+static int BallsPerRow()
+{
+	return (int)((ARENA_WIDTH - 1.0f) / BALL_SPACING);
+}
+
+static float ArenaHeight(int balls)
+{
+	int rows = (balls + BallsPerRow() - 1) / BallsPerRow();
+	return MAX(ARENA_HEIGHT, BALL_FIRST_ROW + rows * BALL_SPACING + 1.0f);
+}
+
+static bool BuildArena(PhysicsBackend* physics, int balls)
+{
+	if (!physics->CreateWorld(vec2f(0.0f, -10.0f))) return false;
+
+	PhysMaterial wall;
+	wall.restitution = 0.5f;
+
+	float height = ArenaHeight(balls);
+	PhysBodyDef staticDef;
+	vec2f corners[4] = { vec2f(0.0f, 0.0f), vec2f(ARENA_WIDTH, 0.0f), vec2f(ARENA_WIDTH, height), vec2f(0.0f, height) };
+	physics->CreateChain(staticDef, corners, 4, true, wall);
+
+	PhysMaterial bumper;
+	bumper.restitution = 0.8f;
+	for (int row = 0; row < 4; ++row)
+	{
+		for (int col = 0; col < 5; ++col)
+		{
+			staticDef.position = vec2f(1.6f + col * 2.8f + (row % 2) * 1.4f, 3.0f + row * 2.5f);
+			physics->CreateCircle(staticDef, BUMPER_RADIUS, bumper);
+		}
+	}
+
+	PhysMaterial ball;
+	ball.restitution = 0.3f;
+
+	PhysBodyDef ballDef;
+	ballDef.type = PHYS_BODY_DYNAMIC;
+	ballDef.bullet = true;
+
+	// Stacked above the bumpers, as many per row as fit, all inside the walls
+	int perRow = BallsPerRow();
+	uint32 seed = 12345;
+	for (int i = 0; i < balls; ++i)
+	{
+		ballDef.position = vec2f(0.8f + (i % perRow) * BALL_SPACING, BALL_FIRST_ROW + (i / perRow) * BALL_SPACING);
+		if (ballDef.position.x + BALL_RADIUS >= ARENA_WIDTH || ballDef.position.y + BALL_RADIUS >= height) return false;
+
+		PhysHandle b = physics->CreateCircle(ballDef, BALL_RADIUS, ball);
+		if (b == 0) return false;
+		physics->SetLinearVelocity(b, vec2f(Random(seed) * 20.0f - 10.0f, Random(seed) * 10.0f - 5.0f));
+	}
+	return true;
+}
+
+struct Arena
+{
+	PhysicsBackend* physics;
+	int steps;
+	int contacts;
+};
+
+static void StepArena(Arena& arena)
+{
+	for (int s = 0; s < arena.steps; ++s)
+	{
+		arena.physics->Step(STEP_DT);
+
+		const PhysContactEvent* events;
+		arena.contacts += arena.physics->GetContactEvents(&events);
+	}
+}
+
+static void StepArenas(void* data, int begin, int end)
+{
+	Arena* arenas = (Arena*)data;
+	for (int i = begin; i < end; ++i) StepArena(arenas[i]);
+}
+
+int main(int argc, char** argv)
+{
+	int workers = MAX((int)std::thread::hardware_concurrency() - 1, 0);
+	int steps = 600;
+	int worlds = 1;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		if (strcmp(argv[i], "--workers") == 0 && i + 1 < argc) workers = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--steps") == 0 && i + 1 < argc) steps = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--worlds") == 0 && i + 1 < argc) worlds = atoi(argv[++i]);
+	}
+	workers = MIN(MAX(workers, 0), MAX_JOB_WORKERS);
+	steps = MAX(steps, 1);
+	worlds = MAX(worlds, 1);
+
+	JobSystem jobs;
+	jobs.Start(workers);
+
+	// Only a single world gets the job system; a batch already uses it across worlds
+	std::vector<Arena> arenas(worlds);
+	for (int w = 0; w < worlds; ++w) arenas[w].physics = CreatePhysicsBackend(worlds == 1 ? &jobs : nullptr);
+
+	printf("%s, %d workers, %d world(s), %d steps of %.1f ms\n\n", arenas[0].physics->GetName(), workers, worlds, steps, STEP_DT * 1000.0f);
+	printf("  balls   arena m   ms/step   ms/world-step   contacts/step\n");
+
+	for (int balls : BALL_COUNTS)
+	{
+		bool built = true;
+		for (Arena& arena : arenas) built = built && BuildArena(arena.physics, balls);
+		if (!built)
+		{
+			printf("%7d   failed to build the arena\n", balls);
+			break;
+		}
+
+		for (Arena& arena : arenas)
+		{
+			arena.steps = WARMUP_STEPS;
+			arena.contacts = 0;
+		}
+		jobs.ParallelFor(worlds, 1, &StepArenas, arenas.data());
+
+		for (Arena& arena : arenas)
+		{
+			arena.steps = steps;
+			arena.contacts = 0;
+		}
+
+		double start = NowMs();
+		jobs.ParallelFor(worlds, 1, &StepArenas, arenas.data());
+		double elapsed = NowMs() - start;
+
+		int contacts = 0;
+		for (Arena& arena : arenas)
+		{
+			contacts += arena.contacts;
+			arena.physics->DestroyWorld();
+		}
+
+		printf("%7d   %7.1f   %7.3f   %13.3f   %13.1f\n", balls, ArenaHeight(balls), elapsed / steps, elapsed / (steps * (double)worlds), (double)contacts / (steps * (double)worlds));
+	}
+
+	for (Arena& arena : arenas) delete arena.physics;
+	jobs.Stop();
+	return 0;
+}